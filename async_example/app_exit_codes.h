@@ -13,5 +13,7 @@
 //  Exit_Code enumeration located in dx_exit_codes.h.
 /// </summary>
 typedef enum {
-	APP_ExitCode_Example = 1
+	APP_ExitCode_Example = 1,
+	APP_ExitCode_AsyncQueueInit = 2,
+	APP_ExitCode_CountThreadStart = 3
 } App_Exit_Code;
\ No newline at end of file
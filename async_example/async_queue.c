@@ -0,0 +1,279 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "async_queue.h"
+
+#include "dx_timer.h"
+#include "handler_profiler.h"
+#include <applibs/eventloop.h>
+#include <applibs/log.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define ASYNC_QUEUE_MASK (ASYNC_QUEUE_CAPACITY - 1)
+
+// Bounded queue cell, sequence tells producers and the consumer who owns the cell
+typedef struct {
+    atomic_size_t sequence;
+    DX_ASYNC_BINDING *binding;
+    void *data;
+#ifdef ENABLE_HANDLER_PROFILER
+    int64_t queuedNs;
+#endif // ENABLE_HANDLER_PROFILER
+} ASYNC_QUEUE_CELL;
+
+typedef struct {
+    DX_ASYNC_BINDING *binding;
+    bool coalesce;
+    atomic_bool pending;
+    _Atomic(void *) data;
+#ifdef ENABLE_HANDLER_PROFILER
+    PROFILER_ENTRY profile;
+#endif // ENABLE_HANDLER_PROFILER
+} ASYNC_QUEUE_BINDING_STATE;
+
+static ASYNC_QUEUE_CELL cells[ASYNC_QUEUE_CAPACITY];
+static atomic_size_t enqueue_position;
+static size_t dequeue_position; // Only touched by the event loop thread
+
+static ASYNC_QUEUE_BINDING_STATE binding_state[ASYNC_QUEUE_MAX_BINDINGS];
+static size_t binding_count = 0;
+
+// Set while a wake up is outstanding so producers write the eventfd once per drain
+static atomic_bool wakeup_pending;
+static int wakeup_fd = -1;
+static EventRegistration *wakeup_registration = NULL;
+
+static atomic_uint_fast64_t stat_sent;
+static atomic_uint_fast64_t stat_coalesced;
+static atomic_uint_fast64_t stat_rejected;
+static uint64_t stat_handled;
+static uint64_t stat_wakeups;
+
+static ASYNC_QUEUE_BINDING_STATE *find_binding(DX_ASYNC_BINDING *binding)
+{
+    for (size_t i = 0; i < binding_count; i++) {
+        if (binding_state[i].binding == binding) {
+            return &binding_state[i];
+        }
+    }
+    return NULL;
+}
+
+static void wake_event_loop(void)
+{
+    uint64_t one = 1;
+
+    if (!atomic_exchange(&wakeup_pending, true)) {
+        if (write(wakeup_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            Log_Debug("ERROR: async queue eventfd write: errno=%d (%s)\n", errno, strerror(errno));
+        }
+    }
+}
+
+static bool enqueue(DX_ASYNC_BINDING *binding, void *data)
+{
+    size_t position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+    ASYNC_QUEUE_CELL *cell;
+
+    for (;;) {
+        cell = &cells[position & ASYNC_QUEUE_MASK];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false; // Full
+        } else {
+            position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+        }
+    }
+
+    cell->binding = binding;
+    cell->data = data;
+#ifdef ENABLE_HANDLER_PROFILER
+    cell->queuedNs = profiler_now_ns();
+#endif // ENABLE_HANDLER_PROFILER
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+static bool dequeue(DX_ASYNC_BINDING **binding, void **data, int64_t *queuedNs)
+{
+    ASYNC_QUEUE_CELL *cell = &cells[dequeue_position & ASYNC_QUEUE_MASK];
+    size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+
+    if (sequence != dequeue_position + 1) {
+        return false; // Empty, or the producer has not finished writing the cell
+    }
+
+    *binding = cell->binding;
+    *data = cell->data;
+#ifdef ENABLE_HANDLER_PROFILER
+    *queuedNs = cell->queuedNs;
+#else
+    (void)queuedNs;
+#endif // ENABLE_HANDLER_PROFILER
+    atomic_store_explicit(&cell->sequence, dequeue_position + ASYNC_QUEUE_CAPACITY,
+                          memory_order_release);
+    dequeue_position++;
+    return true;
+}
+
+/// <summary>
+/// Event loop handler, run up to ASYNC_QUEUE_BATCH_SIZE queued events
+/// </summary>
+static void wakeup_handler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    uint64_t count;
+    DX_ASYNC_BINDING *binding;
+    void *data;
+    int64_t queuedNs;
+    size_t handled = 0;
+
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        Log_Debug("ERROR: async queue eventfd read: errno=%d (%s)\n", errno, strerror(errno));
+    }
+
+    // Clear before draining, any event queued from here on raises a new wake up
+    atomic_store(&wakeup_pending, false);
+    stat_wakeups++;
+
+    while (handled < ASYNC_QUEUE_BATCH_SIZE && dequeue(&binding, &data, &queuedNs)) {
+        ASYNC_QUEUE_BINDING_STATE *state = find_binding(binding);
+
+        if (state != NULL && state->coalesce) {
+            // Clear pending first so a send racing with this handler queues a new event
+            atomic_store(&state->pending, false);
+            data = atomic_load(&state->data);
+        }
+
+        binding->data = data;
+#ifdef ENABLE_HANDLER_PROFILER
+        // Latency is from the send that queued the event, the first of a coalesced burst
+        int64_t started = profiler_now_ns();
+        binding->handler(binding);
+        if (state != NULL) {
+            state->profile.name = binding->name;
+            profiler_record(&state->profile, profiler_now_ns() - started, started - queuedNs);
+        }
+#else
+        binding->handler(binding);
+#endif // ENABLE_HANDLER_PROFILER
+        handled++;
+    }
+
+    stat_handled += handled;
+
+    if (handled == ASYNC_QUEUE_BATCH_SIZE) {
+        wake_event_loop();
+    }
+}
+
+bool async_queue_init(DX_ASYNC_BINDING *bindings[], size_t bindingCount)
+{
+    if (bindingCount > ASYNC_QUEUE_MAX_BINDINGS) {
+        Log_Debug("ERROR: async queue supports %d bindings\n", ASYNC_QUEUE_MAX_BINDINGS);
+        return false;
+    }
+
+    for (size_t i = 0; i < ASYNC_QUEUE_CAPACITY; i++) {
+        atomic_init(&cells[i].sequence, i);
+    }
+    atomic_init(&enqueue_position, 0);
+    dequeue_position = 0;
+    atomic_init(&wakeup_pending, false);
+
+    binding_count = bindingCount;
+    for (size_t i = 0; i < bindingCount; i++) {
+        binding_state[i].binding = bindings[i];
+        binding_state[i].coalesce = false;
+        atomic_init(&binding_state[i].pending, false);
+        atomic_init(&binding_state[i].data, NULL);
+    }
+
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd == -1) {
+        Log_Debug("ERROR: async queue eventfd: errno=%d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    wakeup_registration = EventLoop_RegisterIo(dx_timerGetEventLoop(), wakeup_fd, EventLoop_Input,
+                                               wakeup_handler, NULL);
+    if (wakeup_registration == NULL) {
+        Log_Debug("ERROR: async queue EventLoop_RegisterIo failed\n");
+        async_queue_close();
+        return false;
+    }
+
+    return true;
+}
+
+void async_queue_close(void)
+{
+    if (wakeup_registration != NULL) {
+        EventLoop_UnregisterIo(dx_timerGetEventLoop(), wakeup_registration);
+        wakeup_registration = NULL;
+    }
+
+    if (wakeup_fd != -1) {
+        close(wakeup_fd);
+        wakeup_fd = -1;
+    }
+
+    binding_count = 0;
+}
+
+bool async_queue_set_coalescing(DX_ASYNC_BINDING *binding, bool enabled)
+{
+    ASYNC_QUEUE_BINDING_STATE *state = find_binding(binding);
+
+    if (state == NULL) {
+        return false;
+    }
+    state->coalesce = enabled;
+    return true;
+}
+
+ASYNC_QUEUE_RESULT async_queue_send(DX_ASYNC_BINDING *binding, void *data)
+{
+    ASYNC_QUEUE_BINDING_STATE *state = find_binding(binding);
+
+    if (state != NULL && state->coalesce) {
+        atomic_store(&state->data, data);
+
+        if (atomic_exchange(&state->pending, true)) {
+            atomic_fetch_add_explicit(&stat_coalesced, 1, memory_order_relaxed);
+            return ASYNC_QUEUE_COALESCED;
+        }
+
+        if (!enqueue(binding, NULL)) {
+            atomic_store(&state->pending, false);
+            atomic_fetch_add_explicit(&stat_rejected, 1, memory_order_relaxed);
+            return ASYNC_QUEUE_FULL;
+        }
+    } else if (!enqueue(binding, data)) {
+        atomic_fetch_add_explicit(&stat_rejected, 1, memory_order_relaxed);
+        return ASYNC_QUEUE_FULL;
+    }
+
+    atomic_fetch_add_explicit(&stat_sent, 1, memory_order_relaxed);
+    wake_event_loop();
+    return ASYNC_QUEUE_SENT;
+}
+
+void async_queue_get_stats(ASYNC_QUEUE_STATS *stats)
+{
+    stats->sent = atomic_load_explicit(&stat_sent, memory_order_relaxed);
+    stats->coalesced = atomic_load_explicit(&stat_coalesced, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&stat_rejected, memory_order_relaxed);
+    stats->handled = stat_handled;
+    stats->wakeups = stat_wakeups;
+}
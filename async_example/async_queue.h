@@ -0,0 +1,60 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "dx_async.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of events the queue can hold, must be a power of two
+#define ASYNC_QUEUE_CAPACITY 64
+
+// Maximum number of events handled per event loop wake up, remaining events are handled on
+// the next pass so timers and other I/O are not starved by a burst
+#define ASYNC_QUEUE_BATCH_SIZE 16
+
+// Maximum number of async bindings registered with async_queue_init
+#define ASYNC_QUEUE_MAX_BINDINGS 16
+
+typedef enum {
+    ASYNC_QUEUE_SENT,      // Event queued
+    ASYNC_QUEUE_COALESCED, // Merged into an event already pending for the same binding
+    ASYNC_QUEUE_FULL       // Queue full, the event was not queued. Back off and retry.
+} ASYNC_QUEUE_RESULT;
+
+typedef struct {
+    uint64_t sent;
+    uint64_t coalesced;
+    uint64_t rejected;
+    uint64_t handled;
+    uint64_t wakeups;
+} ASYNC_QUEUE_STATS;
+
+/// <summary>
+/// Multi producer, single consumer event queue. Any thread can call async_queue_send(),
+/// the binding's DX_ASYNC_HANDLER runs on the event loop thread with handle->data set to the
+/// data passed to async_queue_send(). The queue wakes the event loop through an eventfd so
+/// delivery does not depend on other event loop activity.
+/// </summary>
+bool async_queue_init(DX_ASYNC_BINDING *bindings[], size_t bindingCount);
+
+/// <summary>
+/// Unregister from the event loop and close the eventfd. Stop every thread that calls
+/// async_queue_send() first.
+/// </summary>
+void async_queue_close(void);
+
+/// <summary>
+/// When enabled, at most one event per binding is pending. Further sends before the handler
+/// runs replace the data and return ASYNC_QUEUE_COALESCED.
+/// </summary>
+bool async_queue_set_coalescing(DX_ASYNC_BINDING *binding, bool enabled);
+
+/// <summary>
+/// Queue an event for binding. Lock free, safe to call from any thread.
+/// </summary>
+ASYNC_QUEUE_RESULT async_queue_send(DX_ASYNC_BINDING *binding, void *data);
+
+void async_queue_get_stats(ASYNC_QUEUE_STATS *stats);
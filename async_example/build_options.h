@@ -0,0 +1,9 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BUILD_OPTIONS_H
+#define BUILD_OPTIONS_H
+
+// Record call counts, run times and how late every timer and async handler runs. The worst
+// offenders are logged with the stack report, see handler_profiler.h
+//#define ENABLE_HANDLER_PROFILER
+
+#endif 
@@ -40,6 +40,7 @@
 /// </summary>
 static DX_TIMER_HANDLER(LedOffToggleHandler)
 {
+    PROFILE_TIMER_HANDLER(LedOffToggleHandler);
     dx_gpioOff(&led);
 }
 DX_TIMER_HANDLER_END
@@ -49,12 +50,14 @@ DX_TIMER_HANDLER_END
 /// </summary>
 static DX_TIMER_HANDLER(ButtonPressCheckHandler)
 {
+    PROFILE_TIMER_HANDLER(ButtonPressCheckHandler);
+
     static GPIO_Value_Type buttonAState;
 
     if (dx_gpioStateGet(&buttonA, &buttonAState)) {
         dx_gpioOn(&led);
         // set oneshot timer to turn the led off after 1 second
-        dx_timerOneShotSet(&ledOffOneShotTimer, &(struct timespec){1, 0});
+        app_timerOneShotSet(&ledOffOneShotTimer, &(struct timespec){1, 0});
     }
 }
 DX_TIMER_HANDLER_END
@@ -64,6 +67,7 @@ DX_TIMER_HANDLER_END
 /// </summary>
 static DX_TIMER_HANDLER(BlinkLedHandler)
 {
+    PROFILE_TIMER_HANDLER(BlinkLedHandler);
 #ifdef OEM_SEEED_STUDIO_MINI
 
     static bool toggleLed = false;
@@ -75,6 +79,7 @@ static DX_TIMER_HANDLER(BlinkLedHandler)
 DX_TIMER_HANDLER_END
 
 DX_TIMER_HANDLER(led_handler){
+    PROFILE_TIMER_HANDLER(led_handler);
     static bool led_state = true;
 
     dx_gpioStateSet(&led, led_state);
@@ -87,7 +92,7 @@ DX_ASYNC_HANDLER(async_test2_handler, handle)
 {
     // int value = *((int *)handle->data);
     // Log_Debug("Data2:%d\n", value);
-    dx_timerOneShotSet(&tmr_led, &(struct timespec){0,1});
+    app_timerOneShotSet(&tmr_led, &(struct timespec){0,1});
 }
 DX_ASYNC_HANDLER_END
 
@@ -95,36 +100,93 @@ DX_ASYNC_HANDLER(async_test_handler, handle)
 {
     // int value = *((int *)handle->data);
     // Log_Debug("Data1:%d\n", value);
-    dx_timerOneShotSet(&tmr_led, &(struct timespec){0,1});
+    app_timerOneShotSet(&tmr_led, &(struct timespec){0,1});
 }
 DX_ASYNC_HANDLER_END
 
 static void *count_thread(void *arg)
 {
     int count = 0;
+    ASYNC_QUEUE_RESULT result;
 
-    while (true) {
+    while (!atomic_load(&count_thread_stop)) {
         count++;
         if (count % 2 == 0) {
-            dx_asyncSend(&async_test, (void *)&count);
+            result = async_queue_send(&async_test, (void *)&count);
         } else {
-            dx_asyncSend(&async_test2, (void *)&count);
+            result = async_queue_send(&async_test2, (void *)&count);
         }
-        nanosleep(&(struct timespec){0, 20 * ONE_MS}, NULL);
+
+        // Back off while the event loop catches up rather than dropping events
+        nanosleep(&(struct timespec){0, (result == ASYNC_QUEUE_FULL ? 100 : 20) * ONE_MS}, NULL);
     }
+
+    // The thread is detached, this stands in for pthread_join() in ClosePeripheralsAndHandlers
+    sem_post(&count_thread_stopped);
     return NULL;
 }
 
+/// <summary>
+/// Stop count_thread and wait for it, at most one back off period
+/// </summary>
+static void StopCountThread(void)
+{
+    if (count_thread_started) {
+        int result;
+
+        atomic_store(&count_thread_stop, true);
+        do {
+            result = sem_wait(&count_thread_stopped);
+        } while (result == -1 && errno == EINTR);
+        count_thread_started = false;
+    }
+}
+
+/// <summary>
+/// Log the async queue counters and how much of its stack each thread has used so far
+/// </summary>
+static DX_TIMER_HANDLER(StackReportHandler)
+{
+    PROFILE_TIMER_HANDLER(StackReportHandler);
+
+    ASYNC_QUEUE_STATS stats;
+
+    async_queue_get_stats(&stats);
+    Log_Debug("Async queue: %llu sent, %llu coalesced, %llu rejected, %llu handled in %llu wakeups\n",
+              (unsigned long long)stats.sent, (unsigned long long)stats.coalesced,
+              (unsigned long long)stats.rejected, (unsigned long long)stats.handled,
+              (unsigned long long)stats.wakeups);
+
+    stack_monitor_log_report();
+#ifdef ENABLE_HANDLER_PROFILER
+    profiler_log_report();
+#endif // ENABLE_HANDLER_PROFILER
+}
+DX_TIMER_HANDLER_END
+
 /// <summary>
 ///  Initialize peripherals, device twins, direct methods, timers.
 /// </summary>
 static void InitPeripheralsAndHandlers(void)
 {
     dx_gpioSetOpen(gpio_set, NELEMS(gpio_set));
-    dx_asyncSetInit(asyncSet, NELEMS(asyncSet));
-    dx_timerSetStart(timerSet, NELEMS(timerSet));
+    app_timerSetStart(timerSet, NELEMS(timerSet));
+
+    if (!async_queue_init(asyncSet, NELEMS(asyncSet))) {
+        dx_terminate(APP_ExitCode_AsyncQueueInit);
+        return;
+    }
 
-    dx_startThreadDetached(count_thread, NULL, "count_thread");
+    // Both handlers only retrigger the LED timer, so a burst collapses into one call
+    async_queue_set_coalescing(&async_test, true);
+    async_queue_set_coalescing(&async_test2, true);
+
+    sem_init(&count_thread_stopped, 0, 0);
+    if (!stack_monitor_start_thread(count_thread, NULL, "count_thread", COUNT_THREAD_STACK_BYTES)) {
+        dx_terminate(APP_ExitCode_CountThreadStart);
+        return;
+    }
+    count_thread_started = true;
 }
 
 /// <summary>
@@ -132,6 +194,9 @@ static void InitPeripheralsAndHandlers(void)
 /// </summary>
 static void ClosePeripheralsAndHandlers(void)
 {
+    // count_thread sends to the queue, it has to be gone before the queue's eventfd is closed
+    StopCountThread();
+    async_queue_close();
     dx_timerSetStop(timerSet, NELEMS(timerSet));
     dx_gpioSetClose(gpio_set, NELEMS(gpio_set));
     dx_timerEventLoopStop();
@@ -148,8 +213,6 @@ int main(void)
         // Continue if interrupted by signal, e.g. due to breakpoint being set.
         if (result == -1 && errno != EINTR) {
             dx_terminate(DX_ExitCode_Main_EventLoopFail);
-        } else if (asyncEventReady) {
-            dx_asyncRunEvents();
         }
     }
 
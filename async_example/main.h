@@ -3,17 +3,33 @@
 #include "hw/azure_sphere_learning_path.h" // Hardware definition
 
 #include "app_exit_codes.h"
+#include "async_queue.h"
+#include "handler_profiler.h"
+#include "stack_monitor.h"
 #include "dx_gpio.h"
 #include "dx_terminate.h"
 #include "dx_timer.h"
 #include "dx_utilities.h"
 #include <applibs/log.h>
 #include "dx_async.h"
+#include <semaphore.h>
+#include <stdatomic.h>
+
+// Timers are started and set through the profiler when it is enabled, so it knows when each
+// handler was due, see handler_profiler.h
+#ifdef ENABLE_HANDLER_PROFILER
+#define app_timerOneShotSet profiler_timer_oneshot_set
+#define app_timerSetStart profiler_timer_set_start
+#else
+#define app_timerOneShotSet dx_timerOneShotSet
+#define app_timerSetStart dx_timerSetStart
+#endif // ENABLE_HANDLER_PROFILER
 
 // Forward declarations
 static DX_DECLARE_TIMER_HANDLER(BlinkLedHandler);
 static DX_DECLARE_TIMER_HANDLER(ButtonPressCheckHandler);
 static DX_DECLARE_TIMER_HANDLER(LedOffToggleHandler);
+static DX_DECLARE_TIMER_HANDLER(StackReportHandler);
 DX_DECLARE_TIMER_HANDLER(led_handler);
 static DX_DECLARE_ASYNC_HANDLER(async_test_handler);
 static DX_DECLARE_ASYNC_HANDLER(async_test2_handler);
@@ -48,9 +64,20 @@ static DX_TIMER_BINDING blinkLedTimer = {
 
 static DX_TIMER_BINDING tmr_led = {.name = "tmr_led", .handler = led_handler};
 
+static DX_TIMER_BINDING stackReportTimer = {
+    .period = {60, 0}, .name = "stackReportTimer", .handler = StackReportHandler};
+
+// count_thread only calls async_queue_send() and nanosleep(), its reported high water is a few KB.
+// Raise this if the stack report warns about it.
+#define COUNT_THREAD_STACK_BYTES (16 * 1024)
+
+static atomic_bool count_thread_stop = false;
+static sem_t count_thread_stopped;
+static bool count_thread_started = false;
+
 static DX_ASYNC_BINDING async_test = {.name = "async_test", .handler = async_test_handler};
 static DX_ASYNC_BINDING async_test2 = {.name = "async_test2", .handler = async_test2_handler};
 
 // All timers referenced in timers with be opened in the InitPeripheralsAndHandlers function
-DX_TIMER_BINDING *timerSet[] = {&buttonPressCheckTimer, &ledOffOneShotTimer, &blinkLedTimer, &tmr_led};
+DX_TIMER_BINDING *timerSet[] = {&buttonPressCheckTimer, &ledOffOneShotTimer, &blinkLedTimer, &tmr_led, &stackReportTimer};
 DX_ASYNC_BINDING *asyncSet[] = {&async_test, &async_test2};
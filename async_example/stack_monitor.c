@@ -0,0 +1,238 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "stack_monitor.h"
+
+#include <applibs/log.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define PAINT_WORD 0xA5A5A5A5u
+
+typedef struct {
+    const char *name;
+    uint8_t *mapping;    // Guard page and stack, NULL once the thread is joined and it is unmapped
+    size_t mappingSize;
+    uint32_t *low;       // Lowest word of the stack, just above the guard page
+    const uint8_t *top;  // One past the highest address of the stack
+    pthread_t thread;
+    size_t highWater;    // Measured when the thread returned
+    bool saturated;      // Likewise
+    bool running;
+} THREAD_STACK;
+
+typedef struct {
+    void *(*routine)(void *);
+    void *arg;
+    THREAD_STACK *stack;
+} START_ARGS;
+
+static THREAD_STACK stacks[STACK_MONITOR_MAX_THREADS];
+static size_t stack_count;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t page_size(void)
+{
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : 4096;
+}
+
+// The first word that no longer holds the pattern. Called with lock held.
+static const uint32_t *deepest_use(const THREAD_STACK *stack)
+{
+    const volatile uint32_t *word = stack->low;
+    const uint32_t *end = (const uint32_t *)stack->top;
+
+    while (word < end && *word == PAINT_WORD) {
+        word++;
+    }
+    return (const uint32_t *)word;
+}
+
+// Map and paint a stack of stackSize bytes, a whole number of pages. Called with lock held.
+static THREAD_STACK *add_stack(const char *name, size_t stackSize)
+{
+    size_t page = page_size();
+
+    if (stack_count == STACK_MONITOR_MAX_THREADS) {
+        Log_Debug("WARNING: stack_monitor is full, %s runs unmeasured\n", name);
+        return NULL;
+    }
+
+    uint8_t *mapping =
+        mmap(NULL, stackSize + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        Log_Debug("WARNING: no %zu byte stack for %s, it runs unmeasured\n", stackSize, name);
+        return NULL;
+    }
+
+    // An overflow faults here rather than running into whatever is mapped below
+    if (mprotect(mapping, page, PROT_NONE) != 0) {
+        Log_Debug("WARNING: %s has no guard page below its stack\n", name);
+    }
+
+    THREAD_STACK *stack = &stacks[stack_count++];
+    *stack = (THREAD_STACK){.name = name,
+                            .mapping = mapping,
+                            .mappingSize = stackSize + page,
+                            .low = (uint32_t *)(mapping + page),
+                            .top = mapping + page + stackSize,
+                            .running = true};
+
+    for (uint32_t *word = stack->low; word < (uint32_t *)stack->top; word++) {
+        *word = PAINT_WORD;
+    }
+    return stack;
+}
+
+// Join the threads that have returned and unmap their stacks, their results stay. Called with
+// lock held.
+static void reap_stacks(void)
+{
+    for (size_t i = 0; i < stack_count; i++) {
+        THREAD_STACK *stack = &stacks[i];
+
+        if (!stack->running && stack->mapping != NULL) {
+            pthread_join(stack->thread, NULL);
+            munmap(stack->mapping, stack->mappingSize);
+            stack->mapping = NULL;
+        }
+    }
+}
+
+static void *monitored_thread(void *context)
+{
+    START_ARGS start = *(START_ARGS *)context;
+    THREAD_STACK *stack = start.stack;
+
+    free(context);
+
+    void *result = start.routine(start.arg);
+
+    // The stack is unmapped once this thread is joined, measure it while it still exists
+    pthread_mutex_lock(&lock);
+    const uint32_t *deepest = deepest_use(stack);
+    stack->highWater = (size_t)(stack->top - (const uint8_t *)deepest);
+    stack->saturated = deepest == stack->low;
+    stack->running = false;
+    pthread_mutex_unlock(&lock);
+
+    return result;
+}
+
+bool stack_monitor_start_thread(void *(*routine)(void *), void *arg, const char *name,
+                                size_t stackSize)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    size_t page = page_size();
+    int result;
+
+    pthread_attr_init(&attr);
+
+    if (stackSize == 0) {
+        pthread_attr_getstacksize(&attr, &stackSize);
+    }
+    stackSize = (stackSize + page - 1) / page * page;
+    if (stackSize < (size_t)PTHREAD_STACK_MIN) {
+        stackSize = (size_t)PTHREAD_STACK_MIN;
+    }
+
+    START_ARGS *start = malloc(sizeof(START_ARGS));
+    if (start == NULL) {
+        pthread_attr_destroy(&attr);
+        return false;
+    }
+    *start = (START_ARGS){.routine = routine, .arg = arg};
+
+    pthread_mutex_lock(&lock);
+
+    reap_stacks();
+
+    start->stack = add_stack(name, stackSize);
+    if (start->stack != NULL) {
+        pthread_attr_setstack(&attr, start->stack->low, stackSize);
+        result = pthread_create(&start->stack->thread, &attr, monitored_thread, start);
+        if (result != 0) {
+            munmap(start->stack->mapping, start->stack->mappingSize);
+            stack_count--;
+        }
+    } else {
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_attr_setstacksize(&attr, stackSize);
+        result = pthread_create(&thread, &attr, routine, arg);
+    }
+
+    pthread_mutex_unlock(&lock);
+    pthread_attr_destroy(&attr);
+
+    if (result != 0 || start->stack == NULL) {
+        free(start);
+    }
+    if (result != 0) {
+        Log_Debug("ERROR: starting thread %s failed: %d\n", name, result);
+        return false;
+    }
+    return true;
+}
+
+size_t stack_monitor_suggest_size(size_t highWater)
+{
+    size_t page = page_size();
+    size_t headroom = highWater / 2 > page ? highWater / 2 : page;
+    size_t suggested = (highWater + headroom + page - 1) / page * page;
+
+    return suggested < (size_t)PTHREAD_STACK_MIN ? (size_t)PTHREAD_STACK_MIN : suggested;
+}
+
+bool stack_monitor_get(size_t index, STACK_MONITOR_INFO *info)
+{
+    pthread_mutex_lock(&lock);
+
+    bool valid = index < stack_count;
+    if (valid) {
+        const THREAD_STACK *stack = &stacks[index];
+        const uint32_t *deepest = stack->running ? deepest_use(stack) : NULL;
+
+        *info = (STACK_MONITOR_INFO){
+            .name = stack->name,
+            .stackSize = (size_t)(stack->top - (const uint8_t *)stack->low),
+            .highWater = deepest == NULL ? stack->highWater
+                                         : (size_t)(stack->top - (const uint8_t *)deepest),
+            .saturated = deepest == NULL ? stack->saturated : deepest == stack->low,
+            .running = stack->running};
+        info->suggested = stack_monitor_suggest_size(info->highWater);
+    }
+
+    pthread_mutex_unlock(&lock);
+    return valid;
+}
+
+size_t stack_monitor_log_report(void)
+{
+    STACK_MONITOR_INFO info;
+    size_t short_of_stack = 0;
+
+    pthread_mutex_lock(&lock);
+    reap_stacks();
+    pthread_mutex_unlock(&lock);
+
+    Log_Debug("Stack high water: thread used/size | suggested\n");
+
+    for (size_t i = 0; stack_monitor_get(i, &info); i++) {
+        size_t percent = info.highWater * 100 / info.stackSize;
+        bool warn = info.saturated || percent > STACK_MONITOR_WARN_PERCENT;
+
+        Log_Debug("  %-16s %7zu/%7zu %3zu%% | %7zu%s%s%s\n", info.name, info.highWater,
+                  info.stackSize, percent, info.suggested, info.running ? "" : " exited",
+                  info.saturated ? " saturated" : "", warn ? " WARNING" : "");
+        if (warn) {
+            short_of_stack++;
+        }
+    }
+    return short_of_stack;
+}
@@ -0,0 +1,62 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Stack high water measurement. stack_monitor_start_thread() maps each thread's stack itself,
+// with a guard page below it, fills it with a known pattern and hands it to the thread with
+// pthread_attr_setstack(), so the bounds are known without asking the C library for them. The
+// deepest word that no longer holds the pattern is the most stack the thread has ever used. Use
+// the reported sizes to give each thread an explicit stackSize instead of the default, which is
+// far larger than most threads need.
+//
+// Only threads started here are measured. The main thread's stack grows on demand and threads
+// DevX starts get their stacks from the C library, neither has bounds the application set.
+//
+// Painting touches every page of the stack, so a painted thread costs its full stack size in
+// memory. The C library keeps some of its own per thread data at the top of a stack it is
+// given, that shows up as used. Size the stacks from a debug build, then keep or drop the
+// painting as memory allows.
+
+// Maximum number of threads tracked
+#define STACK_MONITOR_MAX_THREADS 8
+
+// A thread is reported as short of stack once it has used more than this percentage
+#define STACK_MONITOR_WARN_PERCENT 75
+
+typedef struct {
+    const char *name;
+    size_t stackSize;  // Painted bytes, the whole stack
+    size_t highWater;  // Most bytes ever used
+    size_t suggested;  // stackSize to ask for, the high water plus headroom, page rounded
+    bool saturated;    // No pattern left, the thread may have used more than highWater
+    bool running;
+} STACK_MONITOR_INFO;
+
+/// <summary>
+/// Start a thread on a painted stack. A stackSize of 0 takes the C library's default size,
+/// anything else is rounded up to a whole page and at least PTHREAD_STACK_MIN. The caller cannot
+/// join the thread. Once routine returns, the next stack_monitor_start_thread() or
+/// stack_monitor_log_report() joins it and unmaps its stack. routine has to return rather than
+/// call pthread_exit(), or it is never measured. Once STACK_MONITOR_MAX_THREADS are tracked the
+/// thread is started unmeasured.
+/// </summary>
+bool stack_monitor_start_thread(void *(*routine)(void *), void *arg, const char *name,
+                                size_t stackSize);
+
+/// <returns>false once index is past the last tracked thread</returns>
+bool stack_monitor_get(size_t index, STACK_MONITOR_INFO *info);
+
+/// <summary>
+/// Log the high water mark of every tracked thread. Call periodically.
+/// </summary>
+/// <returns>Number of threads that have used more than STACK_MONITOR_WARN_PERCENT</returns>
+size_t stack_monitor_log_report(void);
+
+/// <summary>
+/// A stack size with headroom over a measured high water mark.
+/// </summary>
+size_t stack_monitor_suggest_size(size_t highWater);
@@ -0,0 +1,254 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host stress test and benchmark for async_queue.c. 1, 2, 4 and 8 producer threads send
+   events to one binding while the main thread runs the event loop. Every event carries the
+   time it was sent, so the handler measures enqueue-to-handler latency.
+
+   Saturated runs send as fast as the queue accepts, backing off with sched_yield() when it
+   reports ASYNC_QUEUE_FULL. They report events per second, latency percentiles, the sends
+   refused and the events handled per wake up. Paced runs send one event per producer every
+   100 us, well under capacity, for latency without a backlog. Each run checks that every event
+   is handled once and in the order its producer sent it. A last run has 8 producers sending to
+   a coalescing binding.
+
+   Build: gcc -O2 -I host -I .. -o async_queue_bench async_queue_bench.c ../async_queue.c -lpthread
+   Usage: async_queue_bench
+*/
+
+#define _GNU_SOURCE
+
+#include "async_queue.h"
+
+#include "dx_timer.h"
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PRODUCERS 8
+#define SATURATED_EVENTS 400000
+#define PACED_EVENTS_PER_PRODUCER 20000
+#define PACED_INTERVAL_NS 100000
+#define COALESCED_SENDS_PER_PRODUCER 100000
+
+typedef struct {
+    int producer;
+    uint32_t sequence;
+    double sentNs;
+} EVENT;
+
+typedef struct {
+    int producer;
+    size_t events; // Sent by this producer
+    long intervalNs; // 0 to send as fast as the queue accepts
+    DX_ASYNC_BINDING *binding;
+    uint64_t refused;
+} PRODUCER;
+
+static EVENT *events;
+static double *latencies;
+static size_t handled;
+static uint32_t nextSequence[MAX_PRODUCERS];
+static size_t outOfOrder;
+static atomic_int producersDone;
+static EVENT *lastCoalesced;
+
+static int wakeupFd = -1;
+static EventLoopIoCallback *wakeupCallback;
+
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return (EventLoop *)&wakeupFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    wakeupFd = fd;
+    wakeupCallback = callback;
+    return (EventRegistration *)&wakeupFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    wakeupFd = -1;
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static void HandleEvent(DX_ASYNC_BINDING *handle)
+{
+    EVENT *event = (EVENT *)handle->data;
+
+    latencies[handled++] = NowNs() - event->sentNs;
+    if (event->sequence != nextSequence[event->producer]) {
+        outOfOrder++;
+    }
+    nextSequence[event->producer] = event->sequence + 1;
+}
+
+static void HandleCoalesced(DX_ASYNC_BINDING *handle)
+{
+    lastCoalesced = (EVENT *)handle->data;
+    handled++;
+}
+
+static DX_ASYNC_BINDING eventBinding = {.name = "event", .handler = HandleEvent};
+static DX_ASYNC_BINDING coalescedBinding = {.name = "coalesced", .handler = HandleCoalesced};
+
+static void *Produce(void *arg)
+{
+    PRODUCER *producer = (PRODUCER *)arg;
+    EVENT *own = events + (size_t)producer->producer * producer->events;
+    struct timespec nextSend;
+
+    clock_gettime(CLOCK_MONOTONIC, &nextSend);
+
+    for (size_t i = 0; i < producer->events; i++) {
+        EVENT *event = &own[i];
+
+        if (producer->intervalNs > 0) {
+            nextSend.tv_nsec += producer->intervalNs;
+            if (nextSend.tv_nsec >= 1000000000L) {
+                nextSend.tv_sec++;
+                nextSend.tv_nsec -= 1000000000L;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextSend, NULL);
+        }
+
+        event->producer = producer->producer;
+        event->sequence = (uint32_t)i;
+        event->sentNs = NowNs();
+        while (async_queue_send(producer->binding, event) == ASYNC_QUEUE_FULL) {
+            producer->refused++;
+            sched_yield();
+        }
+    }
+    atomic_fetch_add(&producersDone, 1);
+    return NULL;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double Percentile(size_t count, double fraction)
+{
+    size_t index = (size_t)(fraction * (double)(count - 1));
+    return latencies[index] / 1e3;
+}
+
+// One turn of the event loop, run the queue's wake up handler if it is due
+static bool Pump(int timeoutMs)
+{
+    struct pollfd fd = {.fd = wakeupFd, .events = POLLIN};
+
+    if (poll(&fd, 1, timeoutMs) > 0) {
+        wakeupCallback(NULL, wakeupFd, EventLoop_Input, NULL);
+        return true;
+    }
+    return false;
+}
+
+static void Run(int producerCount, size_t eventsPerProducer, long intervalNs, DX_ASYNC_BINDING *binding,
+                bool coalesce)
+{
+    DX_ASYNC_BINDING *bindings[] = {binding};
+    PRODUCER producers[MAX_PRODUCERS];
+    pthread_t threads[MAX_PRODUCERS];
+    ASYNC_QUEUE_STATS before, after;
+    size_t total = (size_t)producerCount * eventsPerProducer;
+    uint64_t refused = 0;
+
+    handled = 0;
+    outOfOrder = 0;
+    lastCoalesced = NULL;
+    memset(nextSequence, 0, sizeof(nextSequence));
+    atomic_store(&producersDone, 0);
+
+    async_queue_init(bindings, 1);
+    async_queue_set_coalescing(binding, coalesce);
+    async_queue_get_stats(&before);
+
+    double startNs = NowNs();
+    for (int i = 0; i < producerCount; i++) {
+        producers[i] = (PRODUCER){
+            .producer = i, .events = eventsPerProducer, .intervalNs = intervalNs, .binding = binding};
+        pthread_create(&threads[i], NULL, Produce, &producers[i]);
+    }
+
+    // Coalesced sends are not all handled, run until the producers stop and the queue is empty
+    while (atomic_load(&producersDone) < producerCount || (!coalesce && handled < total)) {
+        Pump(100);
+    }
+    while (Pump(10)) {
+    }
+    double elapsedNs = NowNs() - startNs;
+
+    for (int i = 0; i < producerCount; i++) {
+        pthread_join(threads[i], NULL);
+        refused += producers[i].refused;
+    }
+    async_queue_get_stats(&after);
+    async_queue_close();
+
+    if (coalesce) {
+        printf("coalescing %d producers  sends %zu  queued %llu  coalesced %llu  handled %zu  refused %llu  "
+               "last handled is a last send %s\n",
+               producerCount, total, (unsigned long long)(after.sent - before.sent),
+               (unsigned long long)(after.coalesced - before.coalesced), handled, (unsigned long long)refused,
+               lastCoalesced != NULL && lastCoalesced->sequence == eventsPerProducer - 1 ? "yes" : "no");
+        return;
+    }
+
+    qsort(latencies, handled, sizeof(latencies[0]), CompareDoubles);
+    printf("%-9s %d producers  %9.0f events/s  latency us p50 %6.2f p90 %6.2f p99 %7.2f p99.9 %7.2f max %7.1f  "
+           "refused %8llu  per wake %4.1f  lost %zu  out of order %zu\n",
+           intervalNs > 0 ? "paced" : "saturated", producerCount, (double)handled / elapsedNs * 1e9,
+           Percentile(handled, 0.5), Percentile(handled, 0.9), Percentile(handled, 0.99),
+           Percentile(handled, 0.999), latencies[handled - 1] / 1e3, (unsigned long long)refused,
+           (double)(after.handled - before.handled) / (double)(after.wakeups - before.wakeups), total - handled,
+           outOfOrder);
+}
+
+int main(void)
+{
+    static const int producerCounts[] = {1, 2, 4, 8};
+
+    events = calloc(SATURATED_EVENTS, sizeof(EVENT));
+    latencies = calloc(SATURATED_EVENTS, sizeof(double));
+
+    for (size_t i = 0; i < sizeof(producerCounts) / sizeof(producerCounts[0]); i++) {
+        Run(producerCounts[i], SATURATED_EVENTS / (size_t)producerCounts[i], 0, &eventBinding, false);
+    }
+    for (size_t i = 0; i < sizeof(producerCounts) / sizeof(producerCounts[0]); i++) {
+        Run(producerCounts[i], PACED_EVENTS_PER_PRODUCER, PACED_INTERVAL_NS, &eventBinding, false);
+    }
+
+    free(events);
+    events = calloc((size_t)MAX_PRODUCERS * COALESCED_SENDS_PER_PRODUCER, sizeof(EVENT));
+    Run(MAX_PRODUCERS, COALESCED_SENDS_PER_PRODUCER, 0, &coalescedBinding, true);
+
+    free(events);
+    free(latencies);
+    return 0;
+}
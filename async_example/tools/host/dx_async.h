@@ -0,0 +1,18 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory
+
+#pragma once
+
+#include <stdbool.h>
+
+#define DX_ASYNC_HANDLER(name, handle) void name(struct _asyncBinding *handle) {
+#define DX_ASYNC_HANDLER_END }
+
+typedef struct _asyncBinding {
+    bool triggered;
+    void *data;
+    const char *name;
+    void (*handler)(struct _asyncBinding *handle);
+} DX_ASYNC_BINDING;
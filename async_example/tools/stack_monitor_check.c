@@ -0,0 +1,214 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host check of stack_monitor.c against threads that use a known depth of stack. Each probe
+   thread is started through stack_monitor_start_thread(), writes every byte of a buffer of the
+   given depth, then waits. Its high water mark is read while it waits and again after it has
+   returned, the two have to agree.
+
+   The first probe gives the fixed cost, its high water less its depth: the C library's own
+   data at the top of the stack and the frames above the buffer. Every other probe has to report
+   that cost plus its depth, within TOLERANCE bytes. A shallow probe does not show the fixed
+   cost, the first call through the dynamic linker goes deeper than it. A probe that fills most
+   of a small stack has to be the one thread warned about, and not reported saturated.
+
+   It also checks that
+   - a returned thread is joined and its stack unmapped by the next report
+   - once the table is full a thread still starts, unmeasured
+   - a thread that overflows its stack faults on the guard page, in a child process
+
+   Nothing here or in stack_monitor.c asks the C library for stack bounds, no
+   pthread_getattr_np(), so it runs the same way on musl as on glibc.
+
+   Build: gcc -O2 -I host -I .. -o stack_monitor_check stack_monitor_check.c ../stack_monitor.c
+              -lpthread
+   Usage: stack_monitor_check 2>/dev/null
+*/
+
+#include "stack_monitor.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TOLERANCE 64
+#define PROBE_STACK_BYTES (256 * 1024)
+#define FILLER_DEPTH 64
+#define SMALL_STACK_BYTES (16 * 1024)
+
+typedef struct {
+    size_t depth;
+    const void *local; // An address on the thread's stack
+    sem_t touched;
+    sem_t release;
+} PROBE;
+
+static size_t next_index;
+static int failures;
+
+static __attribute__((noinline)) uint8_t TouchStack(size_t depth)
+{
+    volatile uint8_t buffer[depth];
+
+    for (size_t i = 0; i < depth; i++) {
+        buffer[i] = (uint8_t)i;
+    }
+    return buffer[depth - 1];
+}
+
+static void *ProbeThread(void *arg)
+{
+    PROBE *probe = arg;
+    volatile int local = 0;
+
+    probe->local = (const void *)&local;
+    local = TouchStack(probe->depth);
+    sem_post(&probe->touched);
+    sem_wait(&probe->release);
+    return NULL;
+}
+
+// Overflows its stack one 1 KB frame at a time
+static __attribute__((noinline)) int Recurse(int depth)
+{
+    volatile uint8_t frame[1024];
+
+    frame[0] = (uint8_t)depth;
+    if (depth == INT_MAX) {
+        return frame[0];
+    }
+    return Recurse(depth + 1) + frame[0];
+}
+
+static void *OverflowThread(void *arg)
+{
+    (void)arg;
+    Recurse(0);
+    return NULL;
+}
+
+static void Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Start a probe, read its high water while it waits and after it returns
+static bool RunProbe(PROBE *probe, size_t depth, size_t stackSize, STACK_MONITOR_INFO *running,
+                     STACK_MONITOR_INFO *exited)
+{
+    size_t index = next_index;
+
+    *probe = (PROBE){.depth = depth};
+    sem_init(&probe->touched, 0, 0);
+    sem_init(&probe->release, 0, 0);
+
+    if (!stack_monitor_start_thread(ProbeThread, probe, "probe", stackSize)) {
+        return false;
+    }
+    next_index++;
+
+    sem_wait(&probe->touched);
+    stack_monitor_get(index, running);
+    sem_post(&probe->release);
+
+    do {
+        usleep(1000);
+        stack_monitor_get(index, exited);
+    } while (exited->running);
+
+    return true;
+}
+
+static bool IsMapped(const void *address)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    unsigned char resident;
+
+    return mincore((void *)((uintptr_t)address / page * page), page, &resident) == 0 || errno != ENOMEM;
+}
+
+int main(void)
+{
+    static const size_t depths[] = {8000, 32000, 100000, 180000};
+    STACK_MONITOR_INFO running;
+    STACK_MONITOR_INFO exited;
+    PROBE probe;
+    size_t fixedCost = 0;
+
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        const void *local;
+
+        if (!RunProbe(&probe, depths[i], PROBE_STACK_BYTES, &running, &exited)) {
+            printf("FAILED: the %zu byte probe did not start\n", depths[i]);
+            return 1;
+        }
+        local = probe.local;
+        if (i == 0) {
+            fixedCost = running.highWater - depths[0];
+            printf("fixed cost %zu bytes, stack %zu\n", fixedCost, running.stackSize);
+            Expect(running.stackSize == PROBE_STACK_BYTES, "the stack size");
+        }
+        long error = (long)running.highWater - (long)(fixedCost + depths[i]);
+        printf("depth %6zu: high water %6zu running, %6zu exited, %+ld from fixed cost + depth\n", depths[i],
+               running.highWater, exited.highWater, error);
+        Expect(error >= -TOLERANCE && error <= TOLERANCE, "high water is fixed cost + depth");
+        Expect(exited.highWater == running.highWater, "the exited measurement agrees");
+        Expect(!running.saturated && !exited.saturated, "not saturated");
+
+        Expect(IsMapped(local), "the returned thread's stack is mapped until the next report");
+        stack_monitor_log_report();
+        Expect(!IsMapped(local), "the report unmapped the returned thread's stack");
+    }
+
+    size_t nearlyFull = SMALL_STACK_BYTES - fixedCost - 256;
+    if (RunProbe(&probe, nearlyFull, SMALL_STACK_BYTES, &running, &exited)) {
+        printf("depth %6zu of %d: high water %zu, %zu%%, %s\n", nearlyFull, SMALL_STACK_BYTES, exited.highWater,
+               exited.highWater * 100 / exited.stackSize, exited.saturated ? "saturated" : "not saturated");
+        Expect(stack_monitor_log_report() == 1, "one thread warned about");
+        Expect(!exited.saturated, "a thread with room left is not saturated");
+    } else {
+        Expect(false, "the nearly full probe started");
+    }
+
+    // Fill the table, the thread after that runs unmeasured
+    while (next_index < STACK_MONITOR_MAX_THREADS) {
+        Expect(RunProbe(&probe, FILLER_DEPTH, SMALL_STACK_BYTES, &running, &exited), "a probe to fill the table");
+    }
+    probe = (PROBE){.depth = FILLER_DEPTH};
+    sem_init(&probe.touched, 0, 0);
+    sem_init(&probe.release, 0, 0);
+    Expect(stack_monitor_start_thread(ProbeThread, &probe, "unmeasured", SMALL_STACK_BYTES),
+           "a thread past the table starts");
+    sem_wait(&probe.touched);
+    sem_post(&probe.release);
+    Expect(!stack_monitor_get(STACK_MONITOR_MAX_THREADS, &running), "the thread past the table is not tracked");
+    printf("table full: the thread past it ran unmeasured\n");
+
+    // Overflow in a child, with its own fresh copy of the table
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        if (stack_monitor_start_thread(OverflowThread, NULL, "overflow", SMALL_STACK_BYTES)) {
+            sleep(5);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    bool faulted = WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV;
+    printf("overflow: %s\n", faulted ? "faulted on the guard page" : "did not fault");
+    Expect(faulted, "an overflow faults");
+
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks FAILED");
+    return failures == 0 ? 0 : 1;
+}
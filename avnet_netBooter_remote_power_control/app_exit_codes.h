@@ -13,5 +13,9 @@ typedef enum {
 	APP_ExitCode_Telemetry_Buffer_Too_Small = 1,
    ExitCode_NetworkReadyTimer_Consume =2,
    ExitCode_ReadButtonAError = 3,
-   ExitCode_ReadButtonBError = 4
+   ExitCode_ReadButtonBError = 4,
+   ExitCode_WorkerPoolInit = 5,
+   ExitCode_MemPoolInit = 6,
+   ExitCode_NetBooterFleetInit = 7,
+   ExitCode_CurlInit = 8
 } App_Exit_Code;
\ No newline at end of file
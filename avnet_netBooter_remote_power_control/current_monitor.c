@@ -0,0 +1,152 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "current_monitor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char *eventNames[] = {"firstSample", "outletOn", "outletOff", "loadStarted",
+                                   "loadStopped", "overThreshold", "underThreshold"};
+
+void current_monitor_init(CURRENT_MONITOR *monitor)
+{
+    memset(monitor, 0, sizeof(*monitor));
+}
+
+void current_monitor_set_threshold(CURRENT_MONITOR *monitor, float amps)
+{
+    monitor->threshold = amps > 0.0F ? amps : 0.0F;
+    monitor->overThreshold = false;
+}
+
+/// <summary>
+///   Schmitt trigger, true once amps reaches level and false again once it drops the
+///   hysteresis below it.
+/// </summary>
+static bool crossed(bool above, float level, float amps)
+{
+    float hysteresis = level * CURRENT_MONITOR_HYSTERESIS;
+
+    if (hysteresis < CURRENT_MONITOR_MIN_HYSTERESIS_AMPS) {
+        hysteresis = CURRENT_MONITOR_MIN_HYSTERESIS_AMPS;
+    }
+    // A threshold at or below the minimum would otherwise never be left
+    if (hysteresis > level * CURRENT_MONITOR_MAX_HYSTERESIS) {
+        hysteresis = level * CURRENT_MONITOR_MAX_HYSTERESIS;
+    }
+    return above ? amps >= level - hysteresis : amps >= level;
+}
+
+unsigned current_monitor_add_sample(CURRENT_MONITOR *monitor, bool outletOn, float amps)
+{
+    unsigned events = 0;
+
+    monitor->ring[monitor->next] = amps;
+    monitor->next = (monitor->next + 1) % CURRENT_MONITOR_RING_SAMPLES;
+    if (monitor->count < CURRENT_MONITOR_RING_SAMPLES) {
+        monitor->count++;
+    }
+    monitor->last = amps;
+
+    if (monitor->periodSamples == 0 || amps < monitor->periodMin) {
+        monitor->periodMin = amps;
+    }
+    if (monitor->periodSamples == 0 || amps > monitor->periodMax) {
+        monitor->periodMax = amps;
+    }
+    monitor->periodSum += amps;
+    monitor->periodSamples++;
+
+    bool loadOn = crossed(monitor->loadOn, CURRENT_MONITOR_LOAD_AMPS, amps);
+    bool overThreshold = monitor->threshold > 0.0F && crossed(monitor->overThreshold, monitor->threshold, amps);
+
+    if (!monitor->primed) {
+        events |= CURRENT_EVENT_FIRST_SAMPLE;
+        monitor->primed = true;
+    } else {
+        if (outletOn != monitor->outletOn) {
+            events |= outletOn ? CURRENT_EVENT_OUTLET_ON : CURRENT_EVENT_OUTLET_OFF;
+        }
+        if (loadOn != monitor->loadOn) {
+            events |= loadOn ? CURRENT_EVENT_LOAD_STARTED : CURRENT_EVENT_LOAD_STOPPED;
+        }
+    }
+
+    // Also on the first reading, so starting up over the threshold is reported
+    if (overThreshold != monitor->overThreshold) {
+        events |= overThreshold ? CURRENT_EVENT_OVER_THRESHOLD : CURRENT_EVENT_UNDER_THRESHOLD;
+    }
+
+    monitor->outletOn = outletOn;
+    monitor->loadOn = loadOn;
+    monitor->overThreshold = overThreshold;
+
+    if (events != 0) {
+        monitor->periodEvents++;
+    }
+    return events;
+}
+
+void current_monitor_rolling_stats(const CURRENT_MONITOR *monitor, CURRENT_STATS *stats)
+{
+    double sum = 0.0;
+
+    *stats = (CURRENT_STATS){.samples = (uint32_t)monitor->count};
+
+    for (size_t i = 0; i < monitor->count; i++) {
+        float amps = monitor->ring[i];
+
+        if (i == 0 || amps < stats->min) {
+            stats->min = amps;
+        }
+        if (i == 0 || amps > stats->max) {
+            stats->max = amps;
+        }
+        sum += amps;
+    }
+
+    if (monitor->count > 0) {
+        stats->mean = (float)(sum / (double)monitor->count);
+    }
+}
+
+bool current_monitor_take_summary(CURRENT_MONITOR *monitor, CURRENT_STATS *stats, uint32_t *events)
+{
+    *stats = (CURRENT_STATS){.min = monitor->periodMin,
+                             .max = monitor->periodMax,
+                             .samples = monitor->periodSamples};
+    *events = monitor->periodEvents;
+
+    if (monitor->periodSamples == 0) {
+        return false;
+    }
+    stats->mean = (float)(monitor->periodSum / (double)monitor->periodSamples);
+
+    monitor->periodSum = 0.0;
+    monitor->periodSamples = 0;
+    monitor->periodEvents = 0;
+    return true;
+}
+
+void current_monitor_event_names(unsigned events, char *buffer, size_t size)
+{
+    size_t len = 0;
+
+    if (size == 0) {
+        return;
+    }
+    buffer[0] = '\0';
+
+    for (size_t i = 0; i < sizeof(eventNames) / sizeof(eventNames[0]); i++) {
+        if ((events & (1u << i)) == 0) {
+            continue;
+        }
+
+        int written = snprintf(buffer + len, size - len, "%s%s", len == 0 ? "" : ",", eventNames[i]);
+        if (written < 0 || (size_t)written >= size - len) {
+            return;
+        }
+        len += (size_t)written;
+    }
+}
@@ -0,0 +1,99 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Current readings of one netBooter outlet. Each reading is checked for edges, the outlet
+// switching, its load starting or stopping and the current crossing a threshold, so telemetry
+// only needs to go up when one of those happens plus a periodic summary of the readings in
+// between. The load and threshold edges use hysteresis so a reading that wobbles around the
+// level does not raise an edge on every poll.
+//
+// Only used from the event loop thread.
+
+// Readings kept for the rolling statistics
+#define CURRENT_MONITOR_RING_SAMPLES 32
+
+// A load is running once the outlet draws this much
+#define CURRENT_MONITOR_LOAD_AMPS 0.10F
+
+// A level is left again once the current drops this fraction below it, but never by less than
+// CURRENT_MONITOR_MIN_HYSTERESIS_AMPS, about the netBooter's reading noise. Nor by more than
+// CURRENT_MONITOR_MAX_HYSTERESIS of the level, so a level near the noise can still be left.
+#define CURRENT_MONITOR_HYSTERESIS 0.10F
+#define CURRENT_MONITOR_MIN_HYSTERESIS_AMPS 0.05F
+#define CURRENT_MONITOR_MAX_HYSTERESIS 0.50F
+
+// Edges seen by current_monitor_add_sample(), one bit each
+typedef enum {
+    CURRENT_EVENT_FIRST_SAMPLE = 0x01, // Nothing to compare the first reading against
+    CURRENT_EVENT_OUTLET_ON = 0x02,
+    CURRENT_EVENT_OUTLET_OFF = 0x04,
+    CURRENT_EVENT_LOAD_STARTED = 0x08,
+    CURRENT_EVENT_LOAD_STOPPED = 0x10,
+    CURRENT_EVENT_OVER_THRESHOLD = 0x20,
+    CURRENT_EVENT_UNDER_THRESHOLD = 0x40
+} CURRENT_EVENT;
+
+typedef struct {
+    float min;
+    float max;
+    float mean;
+    uint32_t samples;
+} CURRENT_STATS;
+
+typedef struct {
+    // Last CURRENT_MONITOR_RING_SAMPLES readings, next is where the following one goes
+    float ring[CURRENT_MONITOR_RING_SAMPLES];
+    size_t next;
+    size_t count;
+
+    float threshold; // 0 when there is none
+    float last;
+    bool primed;
+    bool outletOn;
+    bool loadOn;
+    bool overThreshold;
+
+    // Since the last current_monitor_take_summary()
+    float periodMin;
+    float periodMax;
+    double periodSum;
+    uint32_t periodSamples;
+    uint32_t periodEvents;
+} CURRENT_MONITOR;
+
+void current_monitor_init(CURRENT_MONITOR *monitor);
+
+/// <summary>
+/// Set the threshold in amps, 0 turns it off. A reading already over the new threshold is
+/// reported as a crossing on the next sample.
+/// </summary>
+void current_monitor_set_threshold(CURRENT_MONITOR *monitor, float amps);
+
+/// <summary>
+/// Add a reading and the outlet state it was taken with.
+/// </summary>
+/// <returns>The CURRENT_EVENT bits for the edges this reading caused, 0 for none</returns>
+unsigned current_monitor_add_sample(CURRENT_MONITOR *monitor, bool outletOn, float amps);
+
+/// <summary>
+/// Min, max and mean of the readings in the ring.
+/// </summary>
+void current_monitor_rolling_stats(const CURRENT_MONITOR *monitor, CURRENT_STATS *stats);
+
+/// <summary>
+/// Min, max and mean of the readings since the last call, and how many edges they caused.
+/// Starts the next period.
+/// </summary>
+/// <returns>false when there were no readings</returns>
+bool current_monitor_take_summary(CURRENT_MONITOR *monitor, CURRENT_STATS *stats, uint32_t *events);
+
+/// <summary>
+/// Write the names of the bits in events to buffer, comma separated.
+/// </summary>
+void current_monitor_event_names(unsigned events, char *buffer, size_t size);
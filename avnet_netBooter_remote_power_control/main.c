@@ -42,6 +42,7 @@
 #include "main.h"
 #include <applibs/networking.h>
 #include <arpa/inet.h>
+#include <stdlib.h>
 
 /****************************************************************************************
  * Implementation
@@ -115,10 +116,23 @@ static int ConfigureNetworkInterfaceWithStaticIp(const char* interfaceName)
 }
 
 
+/// <summary>
+///     Release an interface list from the pool, or from the heap when it was too long for it.
+/// </summary>
+static void FreeInterfaces(Networking_NetworkInterface* interfaces, bool pooled)
+{
+    if (pooled) {
+        mem_pool_free(interfaces);
+    } else {
+        free(interfaces);
+    }
+}
+
 /// <summary>
 ///     Check network status and display information about all available network interfaces.
 /// </summary>
 /// <returns>0 on success, or -1 on failure</returns>
+
 static int CheckNetworkStatus(void)
 {
 
@@ -148,9 +162,10 @@ static int CheckNetworkStatus(void)
 
     // Read current status of all interfaces.
     size_t bytesRequired = ((size_t)count) * sizeof(Networking_NetworkInterface);
-    Networking_NetworkInterface* interfaces = malloc(bytesRequired);
+    bool pooled = count <= NETWORK_INTERFACES_POOLED;
+    Networking_NetworkInterface* interfaces = pooled ? mem_pool_alloc(bytesRequired) : malloc(bytesRequired);
     if (!interfaces) {
-        abort();
+        return -1;
     }
 
     ssize_t actualCount = Networking_GetInterfaces(interfaces, (size_t)count);
@@ -213,12 +228,13 @@ static int CheckNetworkStatus(void)
         if (result != 0) {
             Log_Debug("ERROR: Networking_GetInterfaceConnectionStatus: errno=%d (%s)\n", errno,
                 strerror(errno));
+            FreeInterfaces(interfaces, pooled);
             return -1;
         }
         Log_Debug("INFO:   interfaceStatus=0x%02x\n", status);
     }
 
-    free(interfaces);
+    FreeInterfaces(interfaces, pooled);
 
     return 0;
 }
@@ -292,6 +308,55 @@ static DX_TIMER_HANDLER(powerMonitorReadData)
 }
 DX_TIMER_HANDLER_END
 
+/// <summary>
+/// Summary timer event:  Send the current statistics since the last summary
+/// </summary>
+static DX_TIMER_HANDLER(send_summary_handler)
+{
+    SendNetBooterSummary();
+}
+DX_TIMER_HANDLER_END
+
+/// <summary>
+/// Fleet timer event:  Read the netBooters in netBooterFleet that are due
+/// </summary>
+static DX_TIMER_HANDLER(poll_fleet_handler)
+{
+    PollNetBooterFleet();
+}
+DX_TIMER_HANDLER_END
+
+/// <summary>
+/// netBooter flush timer event:  Send the outlet changes held since the window started
+/// </summary>
+static DX_TIMER_HANDLER(flush_netbooter_handler)
+{
+    FlushNetBooterCommands();
+}
+DX_TIMER_HANDLER_END
+
+/// <summary>
+/// Start the coalescing window with the first held request, the ones that follow share it
+/// </summary>
+static void startNetBooterWindow(void)
+{
+    if (!NetBooterCommandsPending()) {
+        dx_timerOneShotSet(&tmr_flushNetBooter, &(struct timespec){0, NETBOOTER_COALESCE_MS * ONE_MS});
+    }
+}
+
+static void queueNetBooterCommand(int devNum, bool newState)
+{
+    startNetBooterWindow();
+    QueueNetBooterCommand(devNum, newState);
+}
+
+static void queueNetBooterPoll(void)
+{
+    startNetBooterWindow();
+    QueueNetBooterPoll();
+}
+
 /****************************************************************************************
  * Using the passed in networkStatus value, turn on/off the connection status LEDs
  * to reflect the current connection status.
@@ -340,7 +405,7 @@ static DX_DEVICE_TWIN_HANDLER(dt_dev1_enable_handler, deviceTwinBinding)
         dev1Enabled = *(bool*)deviceTwinBinding->propertyValue;
         dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
         Log_Debug("Device 1 is %s\n", (dev1Enabled ? "Enabled": "Disabled"));
-        EnableDisableNetBooterDevice(1, dev1Enabled);
+        queueNetBooterCommand(1, dev1Enabled);
 
     } else {
         dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
@@ -356,7 +421,7 @@ static DX_DEVICE_TWIN_HANDLER(dt_dev2_enable_handler, deviceTwinBinding)
         dev2Enabled = *(bool*)deviceTwinBinding->propertyValue;
         dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
         Log_Debug("Device 2 is %s\n", (dev2Enabled ? "Enabled": "Disabled"));
-        EnableDisableNetBooterDevice(2, dev2Enabled);
+        queueNetBooterCommand(2, dev2Enabled);
 
 
     } else {
@@ -372,7 +437,23 @@ static DX_DEVICE_TWIN_HANDLER(dt_telemetry_period_handler, deviceTwinBinding)
         int telemetryTimerTime = *(int*)deviceTwinBinding->propertyValue;
         dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
         Log_Debug("New telemetry period is %d seconds\n", telemetryTimerTime);
-        dx_timerChange(&tmr_readPwrMonitor, &(struct timespec){telemetryTimerTime, 0});
+        dx_timerChange(&tmr_sendSummary, &(struct timespec){telemetryTimerTime, 0});
+
+    } else {
+        dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
+    }
+}
+DX_DEVICE_TWIN_HANDLER_END
+
+static DX_DEVICE_TWIN_HANDLER(dt_current_threshold_handler, deviceTwinBinding)
+{
+    if (deviceTwinBinding->twinType == DX_DEVICE_TWIN_FLOAT) {
+
+        int devNum = *(int*)deviceTwinBinding->context;
+        float threshold = *(float*)deviceTwinBinding->propertyValue;
+        dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
+        Log_Debug("Device %d current threshold is %.2f A\n", devNum, threshold);
+        SetNetBooterCurrentThreshold(devNum, threshold);
 
     } else {
         dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
@@ -405,7 +486,7 @@ static DX_DEVICE_TWIN_HANDLER(dt_gpio_handler, deviceTwinBinding)
         }
 
         // Read the netBooter device and send up telemetry
-        pollNetBooterCurrentData();
+        queueNetBooterPoll();
     }
 }
 DX_DEVICE_TWIN_HANDLER_END
@@ -476,13 +557,13 @@ static void ProcessButtonState(GPIO_Value_Type new_state, GPIO_Value_Type* old_s
                 dev1Enabled = !dev1Enabled;
                 dx_deviceTwinReportValue(&dt_dev1_enabled, (void*)&dev1Enabled);
                 Log_Debug("Device 1 is %s\n", (dev1Enabled ? "Enabled": "Disabled"));
-                EnableDisableNetBooterDevice(1, dev1Enabled);
+                queueNetBooterCommand(1, dev1Enabled);
             }
             else if(0 == strncmp(telemetry_key, "buttonB", 7)){
                 dev2Enabled = !dev2Enabled;
                 dx_deviceTwinReportValue(&dt_dev2_enabled, (void*)&dev2Enabled);
                 Log_Debug("Device 1 is %s\n", (dev2Enabled ? "Enabled": "Disabled"));
-                EnableDisableNetBooterDevice(2, dev2Enabled);
+                queueNetBooterCommand(2, dev2Enabled);
             }
         }
         // else the button was released
@@ -502,6 +583,33 @@ static void InitPeripheralsAndHandlers(void)
 //    dx_azureConnect(&dx_config, NETWORK_INTERFACE, IOT_PLUG_AND_PLAY_MODEL_ID);
 #endif     
     
+    // Response and message buffers come from fixed blocks reserved here, not the heap
+    if (!mem_pool_init(mem_pool_classes, NELEMS(mem_pool_classes))) {
+        dx_terminate(ExitCode_MemPoolInit);
+        return;
+    }
+
+    if (!InitNetBooterCurl()) {
+        dx_terminate(ExitCode_CurlInit);
+        return;
+    }
+
+    // netBooter HTTP requests run on one worker thread so they reach the device in order
+    // and never block the event loop
+    if (!worker_pool_init(1)) {
+        dx_terminate(ExitCode_WorkerPoolInit);
+        return;
+    }
+
+    InitNetBooterCurrentMonitors();
+
+#ifdef USE_NETBOOTER_FLEET
+    if (!InitNetBooterFleet(netBooterFleet, NELEMS(netBooterFleet))) {
+        dx_terminate(ExitCode_NetBooterFleetInit);
+        return;
+    }
+#endif
+
     dx_gpioSetOpen(gpio_bindings, NELEMS(gpio_bindings));
     dx_timerSetStart(timer_bindings, NELEMS(timer_bindings));
     dx_deviceTwinSubscribe(device_twin_bindings, NELEMS(device_twin_bindings));
@@ -514,6 +622,9 @@ static void InitPeripheralsAndHandlers(void)
 static void ClosePeripheralsAndHandlers(void)
 {
     dx_timerSetStop(timer_bindings, NELEMS(timer_bindings));
+    worker_pool_close();
+    CloseNetBooterCurl();
+    mem_pool_close();
     dx_deviceTwinUnsubscribe();
     dx_directMethodUnsubscribe();
     dx_gpioSetClose(gpio_bindings, NELEMS(gpio_bindings));
@@ -12,8 +12,12 @@
 #include "dx_version.h"
 #include <applibs/log.h>
 #include <applibs/applications.h>
+#include <applibs/networking.h>
 #include "dx_avnet_iot_connect.h"
 #include "netBooter.h"
+#include "netBooterFleet.h"
+#include "worker_pool.h"
+#include "mem_pool.h"
 
 // Use main.h to define all your application definitions, message properties/contentProperties,
 // bindings and binding sets.
@@ -55,6 +59,42 @@ typedef enum {
 
 } RGB_Status;
 
+// The netBooter is read every poll period, telemetry goes up when a reading shows an edge (see
+// current_monitor.h) and as a summary every telemetryPeriodSeconds
+#define CURRENT_POLL_PERIOD_SECONDS 2
+#define SUMMARY_PERIOD_SECONDS 60
+
+// Outlet changes from twin updates, relay changes and button presses within this window of the
+// first one go to the netBooter together, followed by one status read
+#define NETBOOTER_COALESCE_MS 100
+
+// Uncomment to also poll the netBooters in netBooterFleet below, every NETBOOTER_FLEET_CYCLE_SECONDS
+// the ones that are due are read at the same time and sent up in one telemetry message. Each
+// address must be added to AllowedConnections in app_manifest.json.
+//#define USE_NETBOOTER_FLEET
+#define NETBOOTER_FLEET_CYCLE_SECONDS 10
+
+#ifdef USE_NETBOOTER_FLEET
+static const NETBOOTER_CONTROLLER netBooterFleet[] = {
+    {.name = "rack1", .address = "10.0.0.3", .outlets = 2, .username = "admin", .password = "admin", .pollPeriodSeconds = 10, .timeoutMs = 2000},
+    {.name = "rack2", .address = "10.0.0.4", .outlets = 8, .username = "admin", .password = "admin", .pollPeriodSeconds = 30, .timeoutMs = 2000}};
+#endif // USE_NETBOOTER_FLEET
+
+// Interface lists CheckNetworkStatus() reads from the pool, a device reporting more interfaces
+// than this gets its list from the heap
+#define NETWORK_INTERFACES_POOLED 4
+
+// Block sizes and counts for mem_pool, smallest first. netBooter responses are parsed as they
+// arrive and need no block. CheckNetworkStatus() reads the interface list into one block at a
+// time and a fleet cycle builds one telemetry message at a time.
+#define NETWORK_INTERFACES_BYTES (NETWORK_INTERFACES_POOLED * sizeof(Networking_NetworkInterface))
+#ifdef USE_NETBOOTER_FLEET
+static const MEM_POOL_CLASS mem_pool_classes[] = {{.blockSize = NETWORK_INTERFACES_BYTES, .blockCount = 2},
+                                                  {.blockSize = NETBOOTER_FLEET_MESSAGE_BYTES, .blockCount = 1}};
+#else
+static const MEM_POOL_CLASS mem_pool_classes[] = {{.blockSize = NETWORK_INTERFACES_BYTES, .blockCount = 2}};
+#endif // USE_NETBOOTER_FLEET
+
 static const int networkReadytimerPollPeriodSeconds = 1;
 static const int networkReadytimerPollPeriodNanoSeconds = 0 * 1000;
 
@@ -63,16 +103,22 @@ static const int networkReadytimerPollPeriodNanoSeconds = 0 * 1000;
  ****************************************************************************************/
 static void setConnectionStatusLed(RGB_Status);
 static void ProcessButtonState(GPIO_Value_Type, GPIO_Value_Type* , const char* );
+static void queueNetBooterCommand(int, bool);
+static void queueNetBooterPoll(void);
 
 static DX_DECLARE_TIMER_HANDLER(update_network_led_handler);
 static DX_DECLARE_TIMER_HANDLER(NetworkReadyPollTimerEventHandler);
 static DX_DECLARE_TIMER_HANDLER(powerMonitorReadData);
+static DX_DECLARE_TIMER_HANDLER(send_summary_handler);
+static DX_DECLARE_TIMER_HANDLER(poll_fleet_handler);
+static DX_DECLARE_TIMER_HANDLER(flush_netbooter_handler);
 static DX_DECLARE_TIMER_HANDLER(ButtonPressCheckHandler);
 
 // Device Twin Handlers
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_dev1_enable_handler);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_dev2_enable_handler);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_telemetry_period_handler);
+static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_current_threshold_handler);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_gpio_handler);
 
 bool dev1Enabled = true;
@@ -92,9 +138,18 @@ static DX_TIMER_BINDING tmr_update_network_led = {.period = {2, 0},
 static DX_TIMER_BINDING tmr_networkReady =       {.period = {networkReadytimerPollPeriodSeconds, networkReadytimerPollPeriodNanoSeconds}, 
                                                   .name = "tmr_check_network", 
                                                   .handler = NetworkReadyPollTimerEventHandler};
-static DX_TIMER_BINDING tmr_readPwrMonitor =     {.period = {15, 0}, 
+static DX_TIMER_BINDING tmr_readPwrMonitor =     {.period = {CURRENT_POLL_PERIOD_SECONDS, 0}, 
                                                   .name = "tmr_read_power_monitor", 
                                                   .handler = powerMonitorReadData};
+static DX_TIMER_BINDING tmr_sendSummary =        {.period = {SUMMARY_PERIOD_SECONDS, 0}, 
+                                                  .name = "tmr_send_summary", 
+                                                  .handler = send_summary_handler};
+static DX_TIMER_BINDING tmr_pollFleet =          {.period = {NETBOOTER_FLEET_CYCLE_SECONDS, 0}, 
+                                                  .name = "tmr_poll_fleet", 
+                                                  .handler = poll_fleet_handler};
+static DX_TIMER_BINDING tmr_flushNetBooter =     {.period = {0, 0}, 
+                                                  .name = "tmr_flush_netbooter", 
+                                                  .handler = flush_netbooter_handler};
 static DX_TIMER_BINDING tmr_buttonPress =        {.period = {0, ONE_MS*10}, 
                                                   .name = "buttonPressCheckTimer", 
                                                   .handler = ButtonPressCheckHandler};
@@ -149,6 +204,16 @@ static DX_DEVICE_TWIN_BINDING dt_telemetry_period = {.propertyName = "telemetryP
                                                      .twinType = DX_DEVICE_TWIN_INT, 
                                                      .handler = dt_telemetry_period_handler}; 
 
+static DX_DEVICE_TWIN_BINDING dt_dev1_threshold =   {.propertyName = "port1CurrentThreshold", 
+                                                     .twinType = DX_DEVICE_TWIN_FLOAT, 
+                                                     .handler = dt_current_threshold_handler, 
+                                                     .context = &(int){1}};
+
+static DX_DEVICE_TWIN_BINDING dt_dev2_threshold =   {.propertyName = "port2CurrentThreshold", 
+                                                     .twinType = DX_DEVICE_TWIN_FLOAT, 
+                                                     .handler = dt_current_threshold_handler, 
+                                                     .context = &(int){2}};
+
 static DX_DEVICE_TWIN_BINDING dt_relay1 =           {.propertyName = "clickBoardRelay1", 
                                                      .twinType = DX_DEVICE_TWIN_BOOL,  
                                                      .handler = dt_gpio_handler, 
@@ -164,7 +229,11 @@ static DX_DEVICE_TWIN_BINDING dt_relay2 =           {.propertyName = "clickBoard
 // TODO: Update each binding set below with the bindings defined above.  Add bindings by reference, i.e., &dt_desired_sample_rate
 // These sets are used by the initailization code.
 
-DX_DEVICE_TWIN_BINDING *device_twin_bindings[] = {&dt_dev1_enabled, &dt_dev2_enabled, &dt_telemetry_period, &dt_relay1, &dt_relay2};
+DX_DEVICE_TWIN_BINDING *device_twin_bindings[] = {&dt_dev1_enabled, &dt_dev2_enabled, &dt_telemetry_period, &dt_dev1_threshold, &dt_dev2_threshold, &dt_relay1, &dt_relay2};
 DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {};
 DX_GPIO_BINDING *gpio_bindings[] = {&red_led, &green_led, &blue_led, &buttonA, &buttonB, &clickRelay1, &clickRelay2};
-DX_TIMER_BINDING *timer_bindings[] = {&tmr_update_network_led, &tmr_networkReady, &tmr_readPwrMonitor, &tmr_buttonPress};
+DX_TIMER_BINDING *timer_bindings[] = {&tmr_update_network_led, &tmr_networkReady, &tmr_readPwrMonitor, &tmr_sendSummary, &tmr_flushNetBooter, &tmr_buttonPress
+#ifdef USE_NETBOOTER_FLEET
+                                      , &tmr_pollFleet
+#endif
+};
@@ -0,0 +1,285 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "mem_pool.h"
+
+#include <applibs/log.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct FREE_BLOCK {
+    struct FREE_BLOCK *next;
+} FREE_BLOCK;
+
+typedef struct {
+    MEM_POOL_STATS stats;
+    uint8_t *base;
+    FREE_BLOCK *freeList;
+    size_t *requested; // Bytes asked for, per block
+} POOL_CLASS;
+
+static POOL_CLASS classes[MEM_POOL_MAX_CLASSES];
+static size_t class_count;
+static uint8_t *arena;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t round_up(size_t size, size_t multiple)
+{
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+bool mem_pool_init(const MEM_POOL_CLASS config[], size_t classCount)
+{
+    size_t arenaBytes = 0;
+
+    if (arena != NULL || classCount == 0 || classCount > MEM_POOL_MAX_CLASSES) {
+        return false;
+    }
+
+    for (size_t i = 0; i < classCount; i++) {
+        size_t blockSize = round_up(config[i].blockSize, sizeof(max_align_t));
+        if (blockSize < sizeof(FREE_BLOCK) ||
+            (i > 0 && blockSize <= classes[i - 1].stats.blockSize)) {
+            Log_Debug("ERROR: mem_pool class %zu is not larger than the one before\n", i);
+            return false;
+        }
+        classes[i] = (POOL_CLASS){.stats = {.blockSize = blockSize, .blockCount = config[i].blockCount}};
+        arenaBytes += blockSize * config[i].blockCount + sizeof(size_t) * config[i].blockCount;
+    }
+
+    arena = malloc(arenaBytes);
+    if (arena == NULL) {
+        Log_Debug("ERROR: mem_pool arena of %zu bytes could not be allocated\n", arenaBytes);
+        return false;
+    }
+
+    // Blocks for every class first so they keep the arena's alignment, bookkeeping after
+    uint8_t *next = arena;
+    for (size_t i = 0; i < classCount; i++) {
+        POOL_CLASS *poolClass = &classes[i];
+        poolClass->base = next;
+        next += poolClass->stats.blockSize * poolClass->stats.blockCount;
+
+        // Build the free list back to front so blocks are handed out in address order
+        for (size_t block = poolClass->stats.blockCount; block-- > 0;) {
+            FREE_BLOCK *freeBlock = (FREE_BLOCK *)(poolClass->base + block * poolClass->stats.blockSize);
+            freeBlock->next = poolClass->freeList;
+            poolClass->freeList = freeBlock;
+        }
+    }
+    for (size_t i = 0; i < classCount; i++) {
+        classes[i].requested = (size_t *)next;
+        next += sizeof(size_t) * classes[i].stats.blockCount;
+    }
+
+    class_count = classCount;
+    Log_Debug("mem_pool: %zu classes in a %zu byte arena\n", classCount, arenaBytes);
+    return true;
+}
+
+void mem_pool_close(void)
+{
+    mem_pool_log_stats();
+
+    pthread_mutex_lock(&lock);
+    free(arena);
+    arena = NULL;
+    class_count = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+// The class holding block and the block's index in it, NULL if block is not from the pool
+static POOL_CLASS *find_class(const void *block, size_t *index)
+{
+    const uint8_t *address = block;
+
+    for (size_t i = 0; i < class_count; i++) {
+        POOL_CLASS *poolClass = &classes[i];
+        size_t classBytes = poolClass->stats.blockSize * poolClass->stats.blockCount;
+
+        if (address >= poolClass->base && address < poolClass->base + classBytes) {
+            size_t offset = (size_t)(address - poolClass->base);
+            if (offset % poolClass->stats.blockSize != 0) {
+                return NULL;
+            }
+            *index = offset / poolClass->stats.blockSize;
+            return poolClass;
+        }
+    }
+    return NULL;
+}
+
+// Called with lock held
+static void *take_block(size_t size)
+{
+    POOL_CLASS *fitting = NULL;
+
+    for (size_t i = 0; i < class_count; i++) {
+        POOL_CLASS *poolClass = &classes[i];
+
+        if (poolClass->stats.blockSize < size) {
+            continue;
+        }
+        if (fitting == NULL) {
+            fitting = poolClass;
+        }
+        if (poolClass->freeList == NULL) {
+            continue;
+        }
+
+        FREE_BLOCK *block = poolClass->freeList;
+        poolClass->freeList = block->next;
+
+        size_t index = (size_t)((uint8_t *)block - poolClass->base) / poolClass->stats.blockSize;
+        poolClass->requested[index] = size;
+
+        MEM_POOL_STATS *stats = &poolClass->stats;
+        stats->allocations++;
+        stats->requestedBytes += size;
+        stats->grantedBytes += stats->blockSize;
+        if (poolClass != fitting) {
+            stats->spills++;
+        }
+        if (++stats->inUse > stats->peakInUse) {
+            stats->peakInUse = stats->inUse;
+        }
+        return block;
+    }
+
+    // Requests larger than every class are counted against the largest
+    if (fitting == NULL && class_count > 0) {
+        fitting = &classes[class_count - 1];
+    }
+    if (fitting != NULL) {
+        fitting->stats.failures++;
+    }
+    return NULL;
+}
+
+// Called with lock held
+static void release_block(POOL_CLASS *poolClass, void *block)
+{
+    FREE_BLOCK *freeBlock = block;
+    freeBlock->next = poolClass->freeList;
+    poolClass->freeList = freeBlock;
+    poolClass->stats.inUse--;
+}
+
+void *mem_pool_alloc(size_t size)
+{
+    pthread_mutex_lock(&lock);
+    void *block = take_block(size == 0 ? 1 : size);
+    pthread_mutex_unlock(&lock);
+
+    if (block == NULL) {
+        Log_Debug("ERROR: mem_pool has no free block for %zu bytes\n", size);
+    }
+    return block;
+}
+
+void *mem_pool_resize(void *block, size_t size)
+{
+    size_t index;
+
+    if (block == NULL) {
+        return mem_pool_alloc(size);
+    }
+
+    pthread_mutex_lock(&lock);
+
+    POOL_CLASS *poolClass = find_class(block, &index);
+    if (poolClass == NULL) {
+        pthread_mutex_unlock(&lock);
+        Log_Debug("ERROR: mem_pool_resize of a block the pool does not own\n");
+        return NULL;
+    }
+
+    if (size <= poolClass->stats.blockSize) {
+        // The block is still the same allocation, count what it holds now
+        poolClass->stats.requestedBytes = poolClass->stats.requestedBytes - poolClass->requested[index] + size;
+        poolClass->requested[index] = size;
+        pthread_mutex_unlock(&lock);
+        return block;
+    }
+
+    void *larger = take_block(size);
+    if (larger != NULL) {
+        memcpy(larger, block, poolClass->stats.blockSize);
+        release_block(poolClass, block);
+        poolClass->stats.moves++;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    if (larger == NULL) {
+        Log_Debug("ERROR: mem_pool has no free block to grow to %zu bytes\n", size);
+    }
+    return larger;
+}
+
+void mem_pool_free(void *block)
+{
+    size_t index;
+
+    if (block == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    POOL_CLASS *poolClass = find_class(block, &index);
+    if (poolClass != NULL) {
+        release_block(poolClass, block);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    if (poolClass == NULL) {
+        Log_Debug("ERROR: mem_pool_free of a block the pool does not own\n");
+    }
+}
+
+size_t mem_pool_capacity(const void *block)
+{
+    size_t index;
+
+    pthread_mutex_lock(&lock);
+    POOL_CLASS *poolClass = find_class(block, &index);
+    size_t capacity = poolClass == NULL ? 0 : poolClass->stats.blockSize;
+    pthread_mutex_unlock(&lock);
+
+    return capacity;
+}
+
+bool mem_pool_get_stats(size_t classIndex, MEM_POOL_STATS *stats)
+{
+    pthread_mutex_lock(&lock);
+    bool valid = classIndex < class_count;
+    if (valid) {
+        *stats = classes[classIndex].stats;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return valid;
+}
+
+void mem_pool_log_stats(void)
+{
+    MEM_POOL_STATS stats;
+
+    Log_Debug("mem_pool: block in use/peak/count | allocs spills moves failures | wasted\n");
+
+    for (size_t i = 0; mem_pool_get_stats(i, &stats); i++) {
+        // Internal fragmentation, the share of handed out bytes nobody asked for
+        unsigned long wastedPercent =
+            stats.grantedBytes == 0
+                ? 0
+                : (unsigned long)((stats.grantedBytes - stats.requestedBytes) * 100 / stats.grantedBytes);
+
+        Log_Debug("  %6zu %4zu/%4zu/%4zu | %8lu %6lu %5lu %8lu | %3lu%%\n", stats.blockSize,
+                  stats.inUse, stats.peakInUse, stats.blockCount, (unsigned long)stats.allocations,
+                  (unsigned long)stats.spills, (unsigned long)stats.moves,
+                  (unsigned long)stats.failures, wastedPercent);
+    }
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed block allocator for short lived message and response buffers. Every block is carved
+// out of one arena allocated by mem_pool_init(), so the heap the application needs for these
+// buffers is known at startup and does not fragment. A request is served from the smallest
+// size class that fits, or from a larger class when that one is empty. There is no fallback
+// to malloc, a request no class can serve fails and is counted.
+//
+// Safe to call from the event loop and from worker_pool jobs.
+
+#define MEM_POOL_MAX_CLASSES 8
+
+typedef struct {
+    size_t blockSize;  // Rounded up to a multiple of sizeof(max_align_t)
+    size_t blockCount;
+} MEM_POOL_CLASS;
+
+typedef struct {
+    size_t blockSize;
+    size_t blockCount;
+    size_t inUse;
+    size_t peakInUse;
+    uint32_t allocations;
+    uint32_t spills;   // Served by this class because the smaller classes were empty
+    uint32_t moves;    // mem_pool_resize() calls that had to copy into a larger block
+    uint32_t failures; // Requests this class and every larger one could not serve, the
+                       // largest class also counts requests bigger than any block
+    // Bytes asked for against bytes handed out, over every allocation since init
+    uint64_t requestedBytes;
+    uint64_t grantedBytes;
+} MEM_POOL_STATS;
+
+/// <summary>
+/// Allocate the arena. classes must be in ascending blockSize order.
+/// </summary>
+bool mem_pool_init(const MEM_POOL_CLASS classes[], size_t classCount);
+
+void mem_pool_close(void);
+
+/// <summary>
+/// A block of at least size bytes, NULL if no class can serve it.
+/// </summary>
+void *mem_pool_alloc(size_t size);
+
+/// <summary>
+/// Grow or shrink a block. The same block is returned while size still fits in it, only
+/// crossing its class boundary moves the data. A NULL block allocates, and on failure the
+/// original block is left untouched.
+/// </summary>
+void *mem_pool_resize(void *block, size_t size);
+
+void mem_pool_free(void *block);
+
+/// <summary>
+/// Usable bytes in block.
+/// </summary>
+size_t mem_pool_capacity(const void *block);
+
+/// <returns>false once classIndex is past the last class</returns>
+bool mem_pool_get_stats(size_t classIndex, MEM_POOL_STATS *stats);
+
+/// <summary>
+/// Log usage, peaks, failures and internal fragmentation for every class.
+/// </summary>
+void mem_pool_log_stats(void);
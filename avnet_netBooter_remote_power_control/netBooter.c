@@ -25,27 +25,63 @@
 #include <applibs/storage.h>
 
 #include "netBooter.h"
+#include "current_monitor.h"
+#include "netBooterParser.h"
+#include "worker_pool.h"
 #include "dx_avnet_iot_connect.h"
 //#include "main.h"
 
 // Global variables to store and share telemetry/device twin data
 float dev1Current;
 float dev2Current;
-float dev1CurrentThreshold;
-float dev2CurrentThreshold;
 bool relay_1_enabled;
 bool relay_2_enabled;
 
+// Readings, edges and summary statistics per outlet, outlet #1 first
+static CURRENT_MONITOR outletMonitors[NETBOOTER_OUTLETS];
+
+// Relay states in the last message, a change is sent with the next outlet readings
+static bool sentRelay1Enabled;
+static bool sentRelay2Enabled;
+
+// Outlet changes and status reads held by the coalescer, bit 0 is outlet #1
+static uint32_t pendingCommandMask;
+static uint32_t pendingStates;
+static bool pendingPoll;
+
+// Held changes that could not be submitted, or whose command failed, go with the next poll
+static bool pendingRetry;
+
+// Outlets switched by a command job not yet completed and the states it sets. A status read can
+// be a poll period old, so only these are used to leave out a change as a duplicate.
+static uint32_t knownOutletState;
+static uint32_t knownOutletMask;
+static uint32_t commandSequence;
+static uint32_t lastCommand[NETBOOTER_OUTLETS]; // Sequence of the last job to switch each outlet
+static uint32_t foldedInto[NETBOOTER_OUTLETS];  // Job a duplicate was left out for, 0 for none
+
 /****************************************************************************************
  * Telemetry Details
  ****************************************************************************************/
 
 // Number of bytes to allocate for the JSON telemetry message for IoT Hub
-#define JSON_MESSAGE_BYTES 256
+#define JSON_MESSAGE_BYTES 512
 char msgBuffer[JSON_MESSAGE_BYTES] = {0};
 
-// Define telemetry message format
-const char netBooterTelemetry[] = "{\"port_1_enabled\": %s, \"port_1_current\":\"%.2f\", \"port_2_enabled\":%s, \"port_2_current\":\"%.2f\", \"relay_1_enabled\": %s, \"relay_2_enabled\":%s}";
+// Room for the names of every CURRENT_EVENT bit
+#define EVENT_NAMES_BYTES 96
+
+// Define telemetry message formats. An event message goes up when an outlet switches, its load
+// starts or stops, its current crosses the threshold or a relay changes. The rolling average is
+// over the last CURRENT_MONITOR_RING_SAMPLES readings.
+const char netBooterEventTelemetry[] = "{\"port_1_enabled\": %s, \"port_1_current\":\"%.2f\", \"port_1_rolling_avg\":\"%.2f\", \"port_1_events\":\"%s\", "
+                                       "\"port_2_enabled\":%s, \"port_2_current\":\"%.2f\", \"port_2_rolling_avg\":\"%.2f\", \"port_2_events\":\"%s\", "
+                                       "\"relay_1_enabled\": %s, \"relay_2_enabled\":%s}";
+
+// The summary covers the readings since the previous one
+const char netBooterSummaryTelemetry[] = "{\"port_1_enabled\": %s, \"port_1_current\":\"%.2f\", \"port_1_current_min\":\"%.2f\", \"port_1_current_max\":\"%.2f\", \"port_1_current_avg\":\"%.2f\", \"port_1_events_count\":%lu, "
+                                         "\"port_2_enabled\":%s, \"port_2_current\":\"%.2f\", \"port_2_current_min\":\"%.2f\", \"port_2_current_max\":\"%.2f\", \"port_2_current_avg\":\"%.2f\", \"port_2_events_count\":%lu, "
+                                         "\"samples\":%lu, \"relay_1_enabled\": %s, \"relay_2_enabled\":%s}";
 
 DX_MESSAGE_PROPERTY *messageProperties[] = {&(DX_MESSAGE_PROPERTY){.key = "appid", .value = "netBoot"}, &(DX_MESSAGE_PROPERTY){.key = "type", .value = "telemetry"},
                                                    &(DX_MESSAGE_PROPERTY){.key = "schema", .value = "1"}};
@@ -59,37 +95,23 @@ extern char deviceIpAddress[];
 void SendBooleanTelemetry(const unsigned char* key, const bool value);
 
 /// <summary>
-///     Data pointer and size of a block of memory allocated on the heap.
-/// </summary>
-typedef struct {
-    char* data;
-    size_t size;
-} MemoryBlock;
-
-/// <summary>
-///     Callback for curl_easy_perform() that copies all the downloaded chunks in a single memory
-///     block.
+///     Callback for curl_easy_perform() that parses each downloaded chunk as it arrives, nothing
+///     is copied.
 /// <param name="chunks">The pointer to the chunks array</param>
 /// <param name="chunkSize">The size of each chunk</param>
 /// <param name="chunksCount">The count of the chunks</param>
-/// <param name="memoryBlock">The pointer where all the downloaded chunks are aggregated</param>
+/// <param name="parser">The NETBOOTER_PARSER for the response</param>
 /// </summary>
-static size_t StoreDownloadedDataCallback(void* chunks, size_t chunkSize, size_t chunksCount,
-    void* memoryBlock)
+static size_t ParseDownloadedDataCallback(void* chunks, size_t chunkSize, size_t chunksCount,
+    void* parser)
 {
-    MemoryBlock* block = (MemoryBlock*)memoryBlock;
-
     size_t additionalDataSize = chunkSize * chunksCount;
-    block->data = realloc(block->data, block->size + additionalDataSize + 1);
-    if (block->data == NULL) {
-        Log_Debug("Out of memory, realloc returned NULL: errno=%d (%s)'n", errno, strerror(errno));
-        abort();
-    }
-
-    memcpy(block->data + block->size, chunks, additionalDataSize);
-    block->size += additionalDataSize;
-    block->data[block->size] = 0; // Ensure the block of memory is null terminated.
 
+    // Anything other than additionalDataSize fails the transfer with CURLE_WRITE_ERROR, so an
+    // invalid response is not downloaded any further
+    if (!NetBooterParserFeed((NETBOOTER_PARSER*)parser, (const char*)chunks, additionalDataSize)) {
+        return 0;
+    }
     return additionalDataSize;
 }
 
@@ -106,30 +128,44 @@ static void LogCurlError(const char* message, int curlErrCode)
 
 
 /// <summary>
-///   Enable/Disable netBoot devices over HTTP protocol using cURL./// </summary>
-bool EnableDisableNetBooterDevice(int devNum, bool newState)
+///     cURL progress callback, abort the transfer when the application is shutting down.
+/// </summary>
+static int TransferProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow,
+    curl_off_t ultotal, curl_off_t ulnow)
+{
+    return worker_pool_closing() ? 1 : 0;
+}
+
+/// <summary>
+///     Let the worker pool cancel a transfer that is in progress.
+/// </summary>
+static CURLcode SetCancellable(CURL* curlHandle)
+{
+    CURLcode res;
+
+    if ((res = curl_easy_setopt(curlHandle, CURLOPT_XFERINFOFUNCTION, TransferProgressCallback)) != CURLE_OK) {
+        return res;
+    }
+    return curl_easy_setopt(curlHandle, CURLOPT_NOPROGRESS, 0L);
+}
+
+/// <summary>
+///   Send one netBooter command over HTTP protocol using cURL. Runs on the worker thread.
+/// </summary>
+/// <param name="command">The command with its arguments, spaces encoded as %20</param>
+static bool SendNetBooterCommand(const char* command)
 {
 
     CURL* curlHandle = NULL;
     CURLcode res = 0;
-    MemoryBlock block = { .data = NULL, .size = 0 };
+    NETBOOTER_PARSER parser;
 
     bool returnVal = false;
 
-    bool isNetworkingReady = false;
-    if ((Networking_IsNetworkingReady(&isNetworkingReady) < 0) || !isNetworkingReady) {
-        Log_Debug("\nNot doing download because there is no internet connectivity.\n");
-        goto exitLabel;
-    }
+    NetBooterParserInit(&parser, NETBOOTER_PARSE_CODE_ONLY);
 
     //    Log_Debug("Send curl message\n");
 
-    // Init the cURL library.
-    if ((res = curl_global_init(CURL_GLOBAL_ALL)) != CURLE_OK) {
-        LogCurlError("curl_global_init", res);
-        goto exitLabel;
-    }
-
     if ((curlHandle = curl_easy_init()) == NULL) {
         Log_Debug("curl_easy_init() failed\n");
         goto cleanupLabel;
@@ -137,9 +173,9 @@ bool EnableDisableNetBooterDevice(int devNum, bool newState)
 
     // Construct the Url + command
     static char url[64] = { 0 };
-    static const char* URLMsgTemplate = "http://%s/cmd.cgi?$A3%%20%d%%20%d";
-    int len = snprintf(url, sizeof(url), URLMsgTemplate, deviceIpAddress, devNum, newState);
-    if (len < 0) {
+    static const char* URLMsgTemplate = "http://%s/cmd.cgi?%s";
+    int len = snprintf(url, sizeof(url), URLMsgTemplate, deviceIpAddress, command);
+    if (len < 0 || len >= (int)sizeof(url)) {
         Log_Debug("call to snprintf failed!\n");
         goto cleanupLabel;
     }
@@ -169,96 +205,87 @@ bool EnableDisableNetBooterDevice(int devNum, bool newState)
     }
 
     // Set up callback for cURL to use when downloading data.
-    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, StoreDownloadedDataCallback)) != CURLE_OK) {
+    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, ParseDownloadedDataCallback)) != CURLE_OK) {
         LogCurlError("curl_easy_setopt CURLOPT_FOLLOWLOCATION", res);
         goto cleanupLabel;
     }
 
-    // Set the custom parameter of the callback to the memory block.
-    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, (void*)&block)) != CURLE_OK) {
+    // Set the custom parameter of the callback to the parser.
+    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, (void*)&parser)) != CURLE_OK) {
         LogCurlError("curl_easy_setopt CURLOPT_WRITEDATA", res);
         goto cleanupLabel;
     }
 
+    if ((res = SetCancellable(curlHandle)) != CURLE_OK) {
+        LogCurlError("curl_easy_setopt CURLOPT_XFERINFOFUNCTION", res);
+        goto cleanupLabel;
+    }
+
     // Perform the download of the web page.
     if ((res = curl_easy_perform(curlHandle)) != CURLE_OK) {
         LogCurlError("curl_easy_perform", res);
     }
     else {
 
-                // Set the delimiter for the strtok routine
-        char delim[] = ",";
-
-        // block.data contains the comma delimited response.  Pull each pice of 
-        // data in the order it's supplied using he strtok function
-        // 1: Response Code
-
-        // Pull the response Code from the data
-        char* ptr = strtok(block.data, delim);
-
-        // Verify the strtok returned data
-        if (ptr == NULL) {
-            Log_Debug("Call to strtok(blick.data) returned NULL\n");
-            goto cleanupLabel;
-        }
-
         // Check to make sure we have a valid response
-        if (strncmp(ptr, "$A0", 3) != 0) {
+        if (!NetBooterParserFinish(&parser)) {
             Log_Debug("Invalid response from NetBoot device\n");
         }
         else {
             returnVal = true;
         }
-
     }
 
 cleanupLabel:
-    // Clean up allocated memory.
-    free(block.data);
-
     // Clean up sample's cURL resources.
     curl_easy_cleanup(curlHandle);
 
-    // Clean up cURL library's resources.
-    curl_global_cleanup();
-
-exitLabel:
-    
-    // We just changed the state of one of the outlets, send up current status.
-    pollNetBooterCurrentData();
-    
     return returnVal;
 }
 
 /// <summary>
-///   Pull netBoot data over HTTP protocol using cURL.
+///   Switch the outlets in commandMask to their bit in newStates. When every outlet goes the
+///   same way that is one "$A7" (all outlets) request, otherwise one "$A3" request per outlet.
+///   Runs on the worker thread.
 /// </summary>
-void pollNetBooterCurrentData(void)
+static bool SendNetBooterCommands(uint32_t commandMask, uint32_t newStates)
+{
+    char command[16];
+
+    if (commandMask == ALL_OUTLETS_MASK && (newStates == 0 || newStates == ALL_OUTLETS_MASK)) {
+        snprintf(command, sizeof(command), "$A7%%20%d", newStates != 0);
+        return SendNetBooterCommand(command);
+    }
+
+    bool allSucceeded = true;
+    for (int devNum = 1; devNum <= NETBOOTER_OUTLETS && !worker_pool_closing(); devNum++) {
+        uint32_t outletMask = 1u << (devNum - 1);
+        if ((commandMask & outletMask) == 0) {
+            continue;
+        }
+        snprintf(command, sizeof(command), "$A3%%20%d%%20%d", devNum, (newStates & outletMask) != 0);
+        if (!SendNetBooterCommand(command)) {
+            Log_Debug("netBooter device %d command failed\n", devNum);
+            allSucceeded = false;
+        }
+    }
+    return allSucceeded;
+}
+
+/// <summary>
+///   Pull netBoot data over HTTP protocol using cURL. Runs on the worker thread.
+/// </summary>
+static bool ReadNetBooterStatus(NETBOOTER_STATUS* status)
 {
 
 #define ENABLE_NETBOOTER_DEBUG 
 
     CURL* curlHandle = NULL;
     CURLcode res = 0;
-    MemoryBlock block = { .data = NULL, .size = 0 };
-
-    // Variables to keep track of when the current exceeds the on/off threshold 
-    static bool dev1On = false;
-//    static bool dev1OnLast = false;
-    static bool dev2On = false;
-//    static bool dev2OnLast = false;
-
-    bool isNetworkingReady = false;
-    if ((Networking_IsNetworkingReady(&isNetworkingReady) < 0) || !isNetworkingReady) {
-        Log_Debug("\nNot doing download because there is no internet connectivity.\n");
-        goto exitLabel;
-    }
+    NETBOOTER_PARSER parser;
+    bool returnVal = false;
 
-    // Init the cURL library.
-    if ((res = curl_global_init(CURL_GLOBAL_ALL)) != CURLE_OK) {
-        LogCurlError("curl_global_init", res);
-        goto exitLabel;
-    }
+    NetBooterParserInit(&parser, NETBOOTER_OUTLETS);
 
     if ((curlHandle = curl_easy_init()) == NULL) {
         Log_Debug("curl_easy_init() failed\n");
@@ -313,13 +340,13 @@ void pollNetBooterCurrentData(void)
     }
 
     // Set up callback for cURL to use when downloading data.
-    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, StoreDownloadedDataCallback)) != CURLE_OK) {
+    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, ParseDownloadedDataCallback)) != CURLE_OK) {
         LogCurlError("curl_easy_setopt CURLOPT_FOLLOWLOCATION", res);
         goto cleanupLabel;
     }
 
-    // Set the custom parameter of the callback to the memory block.
-    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, (void*)&block)) != CURLE_OK) {
+    // Set the custom parameter of the callback to the parser.
+    if ((res = curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, (void*)&parser)) != CURLE_OK) {
         LogCurlError("curl_easy_setopt CURLOPT_WRITEDATA", res);
         goto cleanupLabel;
     }
@@ -336,118 +363,320 @@ void pollNetBooterCurrentData(void)
         goto cleanupLabel;
     }
 
+    if ((res = SetCancellable(curlHandle)) != CURLE_OK) {
+        LogCurlError("curl_easy_setopt CURLOPT_XFERINFOFUNCTION", res);
+        goto cleanupLabel;
+    }
+
     // Perform the download of the web page.
     if ((res = curl_easy_perform(curlHandle)) != CURLE_OK) {
         LogCurlError("curl_easy_perform", res);
     }
     else {
 
-#ifdef  ENABLE_NETBOOTER_DEBUG
-        Log_Debug("%s\n", block.data);
-#endif 
-
-        // The strtok() routine will modify the data buffer, since we don't own
-        // this memory we'll make a local copy before processing the response.
-        char* messageBuffer = malloc(block.size);
-        memcpy(messageBuffer, block.data, block.size);
-        if (messageBuffer == NULL) {
-            Log_Debug("memory allocation failed\n");
-            goto mallocErrorLabel;
-        }
-        
-    // Set the delimiter for the strtok routine
-        char delim[] = ",";
-
-        // block.data contains the comma delimited response.  Pull each pice of 
-        // data in the order it's supplied using he strtok() function
+        // The response was parsed as it arrived
         // 1: Response Code
         // 2: Outlet State 
         // 3: Current device #2
         // 4: Current device #1
-
-        // Pull the response Code from the data
-        char* ptr = strtok(messageBuffer, delim);
-
-        // Verify the strtok returned data
-        if (ptr == NULL) {
-            Log_Debug("Call to strtok(blick.data) returned NULL\n");
-            goto mallocErrorLabel;
-        }
-
-#ifdef ENABLE_NETBOOTER_DEBUG
-        Log_Debug("Response: %s\n", ptr);
-#endif 
-
-        // Check to make sure we have a valid response
-        if (strcmp(ptr, "$A0") == 0) {
-
-            // Pull the On/Off state from the data
-            ptr = strtok(NULL, delim);
-            int outletState = atoi(ptr);
-#ifdef ENABLE_NETBOOTER_DEBUG
-            // Parse out the device status enabled/disabled
-            Log_Debug("Device #2 is ");
-            if (outletState & DEVICE_TWO_MASK) {
-                Log_Debug("Enabled\n");
-                dev2On = true;
-            }
-            else {
-                Log_Debug("Disabled\n");
-                dev2On = false;
-            }
-            
-            // Parse out the device status enabled/disabled
-            Log_Debug("Device #1 is ");
-            if (outletState & DEVICE_ONE_MASK) {
-                Log_Debug("Enabled\n");
-                dev1On = true;
-            }
-            else {
-                Log_Debug("Disabled\n");
-                dev1On = false;
-            }
-#endif 
-            // Pull outlet #2 Current
-            ptr = strtok(NULL, delim);
-            dev2Current = (float)atof(ptr);
+        if (NetBooterParserFinish(&parser)) {
+            status->outletState = (int)parser.outletMask;
+            status->dev1Current = parser.current[0];
+            status->dev2Current = parser.current[1];
 #ifdef ENABLE_NETBOOTER_DEBUG
-            Log_Debug("Outlet #2 Current: %.02f\n", dev2Current);
+            Log_Debug("Device #2 is %s\n", (status->outletState & DEVICE_TWO_MASK) ? "Enabled" : "Disabled");
+            Log_Debug("Device #1 is %s\n", (status->outletState & DEVICE_ONE_MASK) ? "Enabled" : "Disabled");
+            Log_Debug("Outlet #2 Current: %.02f\n", status->dev2Current);
+            Log_Debug("Outlet #1 Current: %.02f\n", status->dev1Current);
 #endif 
-            // Pull outlet #1 Current
-            ptr = strtok(NULL, delim);
-            dev1Current = (float)atof(ptr);
-
-            // Set the flag stating that we read fresh data
-//            isFreshData = true;
-#ifdef ENABLE_NETBOOTER_DEBUG
-            Log_Debug("Outlet #1 Current: %.02f\n", dev1Current);
-#endif 
-            if(dx_isAvnetConnected()){
-                // construct and send the telemetry message
-                snprintf(msgBuffer, JSON_MESSAGE_BYTES, netBooterTelemetry, (dev1On ? "true" : "false"), dev1Current, (dev2On ? "true" : "false"), dev2Current, (relay_1_enabled ? "true" : "false"), (relay_2_enabled ? "true" : "false"));
-                dx_avnetPublish(msgBuffer, strlen(msgBuffer), messageProperties, NELEMS(messageProperties), &contentProperties, NULL);
-            }
+            returnVal = true;
         }
         else {
             Log_Debug("Invalid response from NetBoot device\n");
         }
 
-mallocErrorLabel:
-        free(messageBuffer);
     }
  
 cleanupLabel:
 
-    // Clean up allocated memory.
-    free(block.data);
-    
     // Clean up sample's cURL resources.
     curl_easy_cleanup(curlHandle);
 
-    // Clean up cURL library's resources.
+    return returnVal;
+}
+
+/// <summary>
+///   Worker pool job, send the outlet command if there is one then read back the status.
+/// </summary>
+static void NetBooterJob(void* context)
+{
+    NETBOOTER_JOB* job = (NETBOOTER_JOB*)context;
+
+    if (job->commandMask != 0) {
+        job->commandSucceeded = SendNetBooterCommands(job->commandMask, job->newStates);
+    }
+
+    // Skip the status read if the command was cancelled by shutdown
+    if (!worker_pool_closing()) {
+        job->status.valid = ReadNetBooterStatus(&job->status);
+    }
+}
+
+/// <summary>
+///   Worker pool completion, runs on the event loop thread. Update the current readings and
+///   send telemetry.
+/// </summary>
+static void NetBooterJobComplete(void* context, bool cancelled)
+{
+    NETBOOTER_JOB* job = (NETBOOTER_JOB*)context;
+
+    // A duplicate left out for a command that failed is sent after all
+    for (int outlet = 0; outlet < NETBOOTER_OUTLETS; outlet++) {
+        uint32_t outletMask = 1u << outlet;
+
+        if ((job->commandMask & outletMask) == 0) {
+            continue;
+        }
+        if (lastCommand[outlet] == job->sequence) {
+            knownOutletMask &= ~outletMask;
+        }
+        if (foldedInto[outlet] == job->sequence) {
+            foldedInto[outlet] = 0;
+            if (!cancelled && !job->commandSucceeded) {
+                pendingCommandMask |= outletMask;
+                pendingRetry = true;
+            }
+        }
+    }
+
+    if (cancelled || worker_pool_closing()) {
+        return;
+    }
+
+    if (job->commandMask != 0 && !job->commandSucceeded) {
+        Log_Debug("netBooter command failed\n");
+    }
+
+    if (!job->status.valid) {
+        return;
+    }
+
+    bool dev1On = (job->status.outletState & DEVICE_ONE_MASK) != 0;
+    bool dev2On = (job->status.outletState & DEVICE_TWO_MASK) != 0;
+    dev1Current = job->status.dev1Current;
+    dev2Current = job->status.dev2Current;
+
+    unsigned dev1Events = current_monitor_add_sample(&outletMonitors[0], dev1On, dev1Current);
+    unsigned dev2Events = current_monitor_add_sample(&outletMonitors[1], dev2On, dev2Current);
+    bool relaysChanged = relay_1_enabled != sentRelay1Enabled || relay_2_enabled != sentRelay2Enabled;
+
+    // Readings without an edge only go into the summary
+    if (dev1Events == 0 && dev2Events == 0 && !relaysChanged) {
+        return;
+    }
+
+    if(dx_isAvnetConnected()){
+        char dev1EventNames[EVENT_NAMES_BYTES];
+        char dev2EventNames[EVENT_NAMES_BYTES];
+        CURRENT_STATS dev1Rolling;
+        CURRENT_STATS dev2Rolling;
+
+        current_monitor_event_names(dev1Events, dev1EventNames, sizeof(dev1EventNames));
+        current_monitor_event_names(dev2Events, dev2EventNames, sizeof(dev2EventNames));
+        current_monitor_rolling_stats(&outletMonitors[0], &dev1Rolling);
+        current_monitor_rolling_stats(&outletMonitors[1], &dev2Rolling);
+
+        // construct and send the telemetry message
+        int len = snprintf(msgBuffer, JSON_MESSAGE_BYTES, netBooterEventTelemetry, (dev1On ? "true" : "false"), dev1Current, dev1Rolling.mean, dev1EventNames,
+                           (dev2On ? "true" : "false"), dev2Current, dev2Rolling.mean, dev2EventNames, (relay_1_enabled ? "true" : "false"), (relay_2_enabled ? "true" : "false"));
+        if (len < 0 || len >= JSON_MESSAGE_BYTES) {
+            Log_Debug("netBooter event message does not fit in %d bytes\n", JSON_MESSAGE_BYTES);
+            return;
+        }
+        dx_avnetPublish(msgBuffer, (size_t)len, messageProperties, NELEMS(messageProperties), &contentProperties, NULL);
+        sentRelay1Enabled = relay_1_enabled;
+        sentRelay2Enabled = relay_2_enabled;
+    }
+}
+
+static bool SubmitNetBooterJob(const NETBOOTER_JOB* job)
+{
+    bool isNetworkingReady = false;
+    if ((Networking_IsNetworkingReady(&isNetworkingReady) < 0) || !isNetworkingReady) {
+        Log_Debug("\nNot doing download because there is no internet connectivity.\n");
+        return false;
+    }
+
+    if (!worker_pool_submit(NetBooterJob, NetBooterJobComplete, job, sizeof(*job))) {
+        Log_Debug("netBooter request queue full, request dropped\n");
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+///   Queue a status read, telemetry is sent when it completes. Held changes waiting for a retry
+///   go with it.
+/// </summary>
+void pollNetBooterCurrentData(void)
+{
+    if (pendingRetry) {
+        FlushNetBooterCommands();
+        return;
+    }
+
+    NETBOOTER_JOB job = { .commandMask = 0 };
+    SubmitNetBooterJob(&job);
+}
+
+/// <summary>
+///   Hold an outlet change until FlushNetBooterCommands(), a later change to the same outlet
+///   replaces it.
+/// </summary>
+void QueueNetBooterCommand(int devNum, bool newState)
+{
+    if (devNum < 1 || devNum > NETBOOTER_OUTLETS) {
+        return;
+    }
+    uint32_t outletMask = 1u << (devNum - 1);
+    pendingCommandMask |= outletMask;
+    pendingStates = newState ? (pendingStates | outletMask) : (pendingStates & ~outletMask);
+}
+
+/// <summary>
+///   Hold a status read until FlushNetBooterCommands(), it is shared with any commands.
+/// </summary>
+void QueueNetBooterPoll(void)
+{
+    pendingPoll = true;
+}
+
+bool NetBooterCommandsPending(void)
+{
+    return pendingCommandMask != 0 || pendingPoll;
+}
+
+/// <summary>
+///   Send the held outlet changes and one status read to verify them in a single job. A change
+///   is only left out when a command still in flight sets the outlet to the same state. The
+///   changes stay held if the job cannot be submitted.
+/// </summary>
+void FlushNetBooterCommands(void)
+{
+    uint32_t duplicates = pendingCommandMask & knownOutletMask & ~(pendingStates ^ knownOutletState);
+    uint32_t commandMask = pendingCommandMask & ~duplicates;
+    bool poll = pendingPoll || commandMask != 0;
+
+    if (commandMask != 0 || poll) {
+        NETBOOTER_JOB job = { .commandMask = commandMask,
+                              .newStates = pendingStates & commandMask,
+                              .sequence = commandMask != 0 ? commandSequence + 1 : 0 };
+
+        if (!SubmitNetBooterJob(&job)) {
+            pendingRetry = true;
+            return;
+        }
+        commandSequence += commandMask != 0;
+        knownOutletMask |= commandMask;
+        knownOutletState = (knownOutletState & ~commandMask) | job.newStates;
+    }
+
+    for (int outlet = 0; outlet < NETBOOTER_OUTLETS; outlet++) {
+        uint32_t outletMask = 1u << outlet;
+
+        if (commandMask & outletMask) {
+            lastCommand[outlet] = commandSequence;
+            foldedInto[outlet] = 0;
+        } else if (duplicates & outletMask) {
+            foldedInto[outlet] = lastCommand[outlet];
+        }
+    }
+
+    pendingCommandMask = 0;
+    pendingPoll = false;
+    pendingRetry = false;
+}
+
+/// <summary>
+///   Set up cURL once for every request the application makes, call before the worker pool
+///   starts any. curl_global_init is not thread safe and is costly on every request.
+/// </summary>
+bool InitNetBooterCurl(void)
+{
+    CURLcode res = curl_global_init(CURL_GLOBAL_ALL);
+
+    if (res != CURLE_OK) {
+        LogCurlError("curl_global_init", res);
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+///   Call after worker_pool_close(), once no request can be running.
+/// </summary>
+void CloseNetBooterCurl(void)
+{
     curl_global_cleanup();
+}
 
-exitLabel:
+/// <summary>
+///   Reset the outlet monitors, call before the first status read.
+/// </summary>
+void InitNetBooterCurrentMonitors(void)
+{
+    for (size_t i = 0; i < NETBOOTER_OUTLETS; i++) {
+        current_monitor_init(&outletMonitors[i]);
+    }
+    sentRelay1Enabled = relay_1_enabled;
+    sentRelay2Enabled = relay_2_enabled;
+}
 
-    return;
+/// <summary>
+///   Set the current in amps above which an outlet sends an event, 0 for none.
+/// </summary>
+void SetNetBooterCurrentThreshold(int devNum, float amps)
+{
+    if (devNum < 1 || devNum > NETBOOTER_OUTLETS) {
+        return;
+    }
+    current_monitor_set_threshold(&outletMonitors[devNum - 1], amps);
+}
+
+/// <summary>
+///   Send the min, max and average current of each outlet since the last summary, instead of
+///   every reading.
+/// </summary>
+void SendNetBooterSummary(void)
+{
+    CURRENT_STATS dev1Stats;
+    CURRENT_STATS dev2Stats;
+    uint32_t dev1Events;
+    uint32_t dev2Events;
+
+    // Both outlets come from the same status reads, so they have the same number of readings
+    bool haveReadings = current_monitor_take_summary(&outletMonitors[0], &dev1Stats, &dev1Events);
+    current_monitor_take_summary(&outletMonitors[1], &dev2Stats, &dev2Events);
+
+    if (!haveReadings) {
+        Log_Debug("No netBooter readings since the last summary\n");
+        return;
+    }
+
+    if(dx_isAvnetConnected()){
+        const CURRENT_MONITOR *dev1 = &outletMonitors[0];
+        const CURRENT_MONITOR *dev2 = &outletMonitors[1];
+
+        int len = snprintf(msgBuffer, JSON_MESSAGE_BYTES, netBooterSummaryTelemetry,
+                           (dev1->outletOn ? "true" : "false"), dev1->last, dev1Stats.min, dev1Stats.max, dev1Stats.mean, (unsigned long)dev1Events,
+                           (dev2->outletOn ? "true" : "false"), dev2->last, dev2Stats.min, dev2Stats.max, dev2Stats.mean, (unsigned long)dev2Events,
+                           (unsigned long)dev1Stats.samples, (relay_1_enabled ? "true" : "false"), (relay_2_enabled ? "true" : "false"));
+        if (len < 0 || len >= JSON_MESSAGE_BYTES) {
+            Log_Debug("netBooter summary message does not fit in %d bytes\n", JSON_MESSAGE_BYTES);
+            return;
+        }
+        dx_avnetPublish(msgBuffer, (size_t)len, messageProperties, NELEMS(messageProperties), &contentProperties, NULL);
+        sentRelay1Enabled = relay_1_enabled;
+        sentRelay2Enabled = relay_2_enabled;
+    }
 }
@@ -1,9 +1,48 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
+// cURL is set up once for the netBooter requests and the fleet
+bool InitNetBooterCurl(void);
+void CloseNetBooterCurl(void);
+
+// Queues a status read on the worker pool and returns straight away, telemetry is sent from
+// the event loop when the request completes
 void pollNetBooterCurrentData(void);
-bool EnableDisableNetBooterDevice(int, bool);
+
+// Outlet changes and status reads are held until FlushNetBooterCommands(), which sends them
+// as one worker pool job: the outlet commands, then a single status read to verify them. If
+// the job cannot be submitted they stay held and go with the next pollNetBooterCurrentData()
+void QueueNetBooterCommand(int, bool);
+void QueueNetBooterPoll(void);
+bool NetBooterCommandsPending(void);
+void FlushNetBooterCommands(void);
+
+// Readings only go up as telemetry when an outlet switches, its load starts or stops or its
+// current crosses the threshold, the rest are summarized by SendNetBooterSummary()
+void InitNetBooterCurrentMonitors(void);
+void SetNetBooterCurrentThreshold(int, float);
+void SendNetBooterSummary(void);
+
+typedef struct {
+    bool valid;
+    int outletState;
+    float dev1Current;
+    float dev2Current;
+} NETBOOTER_STATUS;
+
+typedef struct {
+    uint32_t commandMask; // Outlets to switch, bit 0 is outlet #1
+    uint32_t newStates;
+    uint32_t sequence;    // Of the command job, 0 without a command
+    bool commandSucceeded;
+    NETBOOTER_STATUS status;
+} NETBOOTER_JOB;
 
 #define RESPONSE_OK "$A0"
 #define DEVICE_ONE_MASK 0x01
-#define DEVICE_TWO_MASK 0x02
\ No newline at end of file
+#define DEVICE_TWO_MASK 0x02
+#define NETBOOTER_OUTLETS 2
+#define ALL_OUTLETS_MASK ((1u << NETBOOTER_OUTLETS) - 1)
\ No newline at end of file
@@ -0,0 +1,420 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "netBooterFleet.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <curl/curl.h>
+
+#include "applibs_versions.h"
+#include <applibs/log.h>
+#include <applibs/networking.h>
+
+#include "netBooter.h"
+#include "netBooterParser.h"
+#include "worker_pool.h"
+#include "mem_pool.h"
+#include "dx_avnet_iot_connect.h"
+
+// Room kept at the end of the message for the closing fields
+#define MESSAGE_TAIL_BYTES 64
+
+typedef struct {
+    int64_t nextPollMs;
+    uint32_t failures;  // In a row
+    bool polled;        // In the last cycle
+    bool ok;
+    uint32_t outletMask; // Bit 0 is outlet 1
+    float current[NETBOOTER_MAX_OUTLETS];
+} CONTROLLER_STATE;
+
+// One transfer in flight, only used on the worker thread
+typedef struct {
+    CURL *easy;
+    size_t controller;
+    char url[96];
+    NETBOOTER_PARSER parser;
+} FLEET_TRANSFER;
+
+// worker_pool job context
+typedef struct {
+    int64_t startMs;
+    int64_t durationMs;
+    size_t deferred; // Due but not started before NETBOOTER_FLEET_MAX_CYCLE_MS
+} FLEET_CYCLE;
+
+static const NETBOOTER_CONTROLLER *controllers;
+static size_t controllerCount;
+
+// Written by the cycle on the worker thread, read by its completion on the event loop thread.
+// cycleRunning keeps the next cycle from starting in between.
+static CONTROLLER_STATE controllerStates[NETBOOTER_FLEET_MAX_CONTROLLERS];
+static FLEET_TRANSFER transfers[NETBOOTER_FLEET_MAX_CONNECTIONS];
+static bool cycleRunning;
+
+static DX_MESSAGE_PROPERTY *fleetMessageProperties[] = {&(DX_MESSAGE_PROPERTY){.key = "appid", .value = "netBoot"},
+                                                        &(DX_MESSAGE_PROPERTY){.key = "type", .value = "telemetry"},
+                                                        &(DX_MESSAGE_PROPERTY){.key = "schema", .value = "1"}};
+
+static DX_MESSAGE_CONTENT_PROPERTIES fleetContentProperties = {.contentEncoding = "utf-8", .contentType = "application/json"};
+
+static int64_t MonotonicMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+bool InitNetBooterFleet(const NETBOOTER_CONTROLLER list[], size_t count)
+{
+    if (count > NETBOOTER_FLEET_MAX_CONTROLLERS) {
+        Log_Debug("ERROR: at most %d netBooter controllers can be polled\n", NETBOOTER_FLEET_MAX_CONTROLLERS);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const NETBOOTER_CONTROLLER *controller = &list[i];
+
+        if (controller->name == NULL || controller->address == NULL || controller->outlets < 1 ||
+            controller->outlets > NETBOOTER_MAX_OUTLETS || controller->pollPeriodSeconds < 1 ||
+            controller->timeoutMs < 1 || strlen(controller->address) > sizeof(transfers[0].url) - 32) {
+            Log_Debug("ERROR: netBooter controller %zu is not valid\n", i);
+            return false;
+        }
+    }
+
+    controllers = list;
+    controllerCount = count;
+    cycleRunning = false;
+    memset(controllerStates, 0, sizeof(controllerStates));
+    return true;
+}
+
+/// <summary>
+///     cURL write callback, parse each chunk as it arrives.
+/// </summary>
+static size_t ParseResponseCallback(void *chunks, size_t chunkSize, size_t chunksCount, void *context)
+{
+    FLEET_TRANSFER *transfer = (FLEET_TRANSFER *)context;
+    size_t size = chunkSize * chunksCount;
+
+    // Anything other than size fails the transfer with CURLE_WRITE_ERROR
+    return NetBooterParserFeed(&transfer->parser, (const char *)chunks, size) ? size : 0;
+}
+
+/// <summary>
+///     Record the result of one poll and work out when the controller is due again.
+/// </summary>
+static void FinishPoll(size_t index, bool ok, int64_t cycleStartMs)
+{
+    const NETBOOTER_CONTROLLER *controller = &controllers[index];
+    CONTROLLER_STATE *state = &controllerStates[index];
+    int64_t periodMs = (int64_t)controller->pollPeriodSeconds * 1000;
+
+    state->polled = true;
+    state->ok = ok;
+
+    if (ok) {
+        state->failures = 0;
+        state->nextPollMs = cycleStartMs + periodMs;
+        return;
+    }
+
+    // Exponential backoff, twice the poll period after the first failure
+    state->failures++;
+    int64_t delayMs = periodMs << (state->failures < 10 ? state->failures : 10);
+    if (delayMs > NETBOOTER_FLEET_MAX_BACKOFF_SECONDS * 1000) {
+        delayMs = NETBOOTER_FLEET_MAX_BACKOFF_SECONDS * 1000;
+    }
+    state->nextPollMs = cycleStartMs + delayMs;
+}
+
+static bool StartTransfer(CURLM *multi, FLEET_TRANSFER *transfer, size_t index)
+{
+    const NETBOOTER_CONTROLLER *controller = &controllers[index];
+    CURL *easy = curl_easy_init();
+
+    if (easy == NULL) {
+        Log_Debug("curl_easy_init() failed\n");
+        return false;
+    }
+
+    transfer->controller = index;
+    NetBooterParserInit(&transfer->parser, controller->outlets);
+    snprintf(transfer->url, sizeof(transfer->url), "http://%s/cmd.cgi?$A5", controller->address);
+
+    // An empty body, without one a POST reads it from stdin
+    if (curl_easy_setopt(easy, CURLOPT_URL, transfer->url) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, "") != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_USERNAME, controller->username) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_PASSWORD, controller->password) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, ParseResponseCallback) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, (void *)transfer) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, (void *)transfer) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, (long)controller->timeoutMs) != CURLE_OK ||
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L) != CURLE_OK ||
+        curl_multi_add_handle(multi, easy) != CURLM_OK) {
+        Log_Debug("netBooter %s: transfer could not be set up\n", controller->name);
+        curl_easy_cleanup(easy);
+        return false;
+    }
+
+    transfer->easy = easy;
+    return true;
+}
+
+static void EndTransfer(CURLM *multi, FLEET_TRANSFER *transfer)
+{
+    curl_multi_remove_handle(multi, transfer->easy);
+    curl_easy_cleanup(transfer->easy);
+    transfer->easy = NULL;
+}
+
+/// <summary>
+///   Worker pool job, read every controller that is due, NETBOOTER_FLEET_MAX_CONNECTIONS at a time.
+/// </summary>
+static void FleetCycleJob(void *context)
+{
+    FLEET_CYCLE *cycle = (FLEET_CYCLE *)context;
+    size_t due[NETBOOTER_FLEET_MAX_CONTROLLERS];
+    size_t dueCount = 0;
+    size_t started = 0;
+    size_t active = 0;
+    CURLM *multi = NULL;
+
+    // Longest overdue first, so the controllers a cycle runs out of time for go first in the next
+    for (size_t i = 0; i < controllerCount; i++) {
+        controllerStates[i].polled = false;
+        if (controllerStates[i].nextPollMs <= cycle->startMs) {
+            size_t at = dueCount++;
+            while (at > 0 && controllerStates[due[at - 1]].nextPollMs > controllerStates[i].nextPollMs) {
+                due[at] = due[at - 1];
+                at--;
+            }
+            due[at] = i;
+        }
+    }
+
+    if (dueCount == 0) {
+        return;
+    }
+
+    if ((multi = curl_multi_init()) == NULL) {
+        Log_Debug("ERROR: cURL multi could not be initialized\n");
+        goto cleanupLabel;
+    }
+
+    while ((started < dueCount || active > 0) && !worker_pool_closing()) {
+
+        // No new transfers after NETBOOTER_FLEET_MAX_CYCLE_MS, the rest stay due
+        if (started < dueCount && MonotonicMs() - cycle->startMs >= NETBOOTER_FLEET_MAX_CYCLE_MS) {
+            cycle->deferred = dueCount - started;
+            dueCount = started;
+        }
+
+        // Top up the transfers in flight
+        for (size_t slot = 0; slot < NETBOOTER_FLEET_MAX_CONNECTIONS && started < dueCount; slot++) {
+            if (transfers[slot].easy != NULL) {
+                continue;
+            }
+            if (StartTransfer(multi, &transfers[slot], due[started])) {
+                active++;
+            } else {
+                FinishPoll(due[started], false, cycle->startMs);
+            }
+            started++;
+        }
+
+        int running;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(multi, &queued)) != NULL) {
+            FLEET_TRANSFER *transfer = NULL;
+            long httpStatus = 0;
+
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &httpStatus);
+
+            const NETBOOTER_CONTROLLER *controller = &controllers[transfer->controller];
+            bool ok = msg->data.result == CURLE_OK && httpStatus == 200 && NetBooterParserFinish(&transfer->parser);
+
+            if (ok) {
+                CONTROLLER_STATE *state = &controllerStates[transfer->controller];
+                state->outletMask = transfer->parser.outletMask;
+                memcpy(state->current, transfer->parser.current, sizeof(state->current));
+            }
+
+            if (msg->data.result != CURLE_OK) {
+                Log_Debug("netBooter %s: %s\n", controller->name, curl_easy_strerror(msg->data.result));
+            } else if (!ok) {
+                Log_Debug("netBooter %s: invalid response, HTTP status %ld\n", controller->name, httpStatus);
+            }
+
+            FinishPoll(transfer->controller, ok, cycle->startMs);
+            EndTransfer(multi, transfer);
+            active--;
+        }
+
+        if (active > 0) {
+            curl_multi_wait(multi, NULL, 0, 100, NULL);
+        }
+    }
+
+cleanupLabel:
+
+    // Only left over when the application is shutting down
+    for (size_t slot = 0; slot < NETBOOTER_FLEET_MAX_CONNECTIONS; slot++) {
+        if (transfers[slot].easy != NULL) {
+            EndTransfer(multi, &transfers[slot]);
+        }
+    }
+
+    if (multi != NULL) {
+        curl_multi_cleanup(multi);
+    }
+
+    cycle->durationMs = MonotonicMs() - cycle->startMs;
+}
+
+/// <summary>
+///     vsnprintf onto the end of buffer, false and *len unchanged if it does not fit.
+/// </summary>
+static bool AppendJson(char *buffer, size_t size, size_t *len, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + *len, size - *len, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= size - *len) {
+        buffer[*len] = '\0';
+        return false;
+    }
+    *len += (size_t)written;
+    return true;
+}
+
+/// <summary>
+///     One controller's entry in the fleet message, false if it does not fit.
+/// </summary>
+static bool AppendController(char *buffer, size_t size, size_t *len, size_t index, bool first)
+{
+    const NETBOOTER_CONTROLLER *controller = &controllers[index];
+    const CONTROLLER_STATE *state = &controllerStates[index];
+    char outletState[NETBOOTER_MAX_OUTLETS + 1];
+    size_t start = *len;
+
+    if (!state->ok) {
+        return AppendJson(buffer, size, len, "%s{\"name\":\"%s\",\"ok\":false,\"failures\":%lu}", first ? "" : ",",
+                          controller->name, (unsigned long)state->failures);
+    }
+
+    // One digit per outlet, outlet 1 last, as the netBooter reports it
+    for (int outlet = 0; outlet < controller->outlets; outlet++) {
+        outletState[controller->outlets - 1 - outlet] = (state->outletMask & (1u << outlet)) ? '1' : '0';
+    }
+    outletState[controller->outlets] = '\0';
+
+    bool fits = AppendJson(buffer, size, len, "%s{\"name\":\"%s\",\"ok\":true,\"outlets\":\"%s\",\"current\":[",
+                           first ? "" : ",", controller->name, outletState);
+
+    for (int outlet = 0; fits && outlet < controller->outlets; outlet++) {
+        fits = AppendJson(buffer, size, len, "%s%.2f", outlet == 0 ? "" : ",", state->current[outlet]);
+    }
+    fits = fits && AppendJson(buffer, size, len, "]}");
+
+    if (!fits) {
+        *len = start;
+        buffer[start] = '\0';
+    }
+    return fits;
+}
+
+/// <summary>
+///   Worker pool completion, runs on the event loop thread. Send the readings of the cycle, and
+///   the controllers that are still backing off, in one message.
+/// </summary>
+static void FleetCycleComplete(void *context, bool cancelled)
+{
+    FLEET_CYCLE *cycle = (FLEET_CYCLE *)context;
+    size_t listed = 0;
+    size_t omitted = 0;
+    size_t len = 0;
+
+    cycleRunning = false;
+
+    if (cancelled || worker_pool_closing() || !dx_isAvnetConnected()) {
+        return;
+    }
+
+    char *message = mem_pool_alloc(NETBOOTER_FLEET_MESSAGE_BYTES);
+    if (message == NULL) {
+        return;
+    }
+
+    AppendJson(message, NETBOOTER_FLEET_MESSAGE_BYTES, &len, "{\"netBooters\":[");
+
+    for (size_t i = 0; i < controllerCount; i++) {
+        const CONTROLLER_STATE *state = &controllerStates[i];
+
+        if (!state->polled && state->failures == 0) {
+            continue;
+        }
+        if (AppendController(message, NETBOOTER_FLEET_MESSAGE_BYTES - MESSAGE_TAIL_BYTES, &len, i, listed == 0)) {
+            listed++;
+        } else {
+            omitted++;
+        }
+    }
+
+    if (omitted > 0) {
+        Log_Debug("netBooter fleet message full, %zu controllers omitted\n", omitted);
+    }
+
+    if (cycle->deferred > 0) {
+        Log_Debug("netBooter fleet cycle out of time, %zu controllers deferred\n", cycle->deferred);
+    }
+
+    AppendJson(message, NETBOOTER_FLEET_MESSAGE_BYTES, &len, "],\"omitted\":%zu,\"deferred\":%zu,\"cycleMs\":%lld}",
+               omitted, cycle->deferred, (long long)cycle->durationMs);
+
+    if (listed > 0 || omitted > 0 || cycle->deferred > 0) {
+        dx_avnetPublish(message, len, fleetMessageProperties, NELEMS(fleetMessageProperties), &fleetContentProperties, NULL);
+    }
+
+    mem_pool_free(message);
+}
+
+void PollNetBooterFleet(void)
+{
+    bool isNetworkingReady = false;
+
+    if (controllerCount == 0 || cycleRunning) {
+        return;
+    }
+
+    if ((Networking_IsNetworkingReady(&isNetworkingReady) < 0) || !isNetworkingReady) {
+        return;
+    }
+
+    // Set first, the completion clears it
+    cycleRunning = true;
+
+    FLEET_CYCLE cycle = {.startMs = MonotonicMs()};
+    if (!worker_pool_submit(FleetCycleJob, FleetCycleComplete, &cycle, sizeof(cycle))) {
+        Log_Debug("netBooter fleet cycle dropped, request queue full\n");
+        cycleRunning = false;
+    }
+}
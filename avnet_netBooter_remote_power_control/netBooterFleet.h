@@ -0,0 +1,55 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Polls a list of netBooter power controllers besides the one on DEVICE_IP. Each cycle the
+// controllers that are due are read concurrently with the cURL multi interface, at most
+// NETBOOTER_FLEET_MAX_CONNECTIONS at a time, and their readings go up in one telemetry message.
+// A controller that cannot be read is retried after twice its poll period, then four times and
+// so on up to NETBOOTER_FLEET_MAX_BACKOFF_SECONDS.
+//
+// A cycle runs as one worker_pool job, so it holds up outlet commands to the DEVICE_IP netBooter
+// while it runs. With every controller timing out, reading them all would take
+// ceil(due / NETBOOTER_FLEET_MAX_CONNECTIONS) times the timeout, so a cycle starts no transfers
+// after NETBOOTER_FLEET_MAX_CYCLE_MS. It lasts at most that plus the longest timeoutMs in the
+// list, and the controllers it did not start are polled first by the next cycle.
+
+#define NETBOOTER_FLEET_MAX_CONTROLLERS 64
+
+// Transfers in flight at once
+#define NETBOOTER_FLEET_MAX_CONNECTIONS 6
+
+#define NETBOOTER_FLEET_MAX_BACKOFF_SECONDS 300
+
+// No transfers are started after this long into a cycle
+#define NETBOOTER_FLEET_MAX_CYCLE_MS 2000
+
+// The telemetry message comes from the largest mem_pool class, controllers that do not fit are
+// counted as omitted
+#define NETBOOTER_FLEET_MESSAGE_BYTES 4096
+
+typedef struct {
+    const char *name;
+    const char *address;   // Host name or IP address, with :port if not 80
+    int outlets;           // Up to NETBOOTER_MAX_OUTLETS
+    const char *username;
+    const char *password;
+    int pollPeriodSeconds; // Rounded up to whole cycles
+    int timeoutMs;         // For the whole transfer, connecting included
+} NETBOOTER_CONTROLLER;
+
+/// <summary>
+/// Keep a reference to the list, it must stay valid until the application exits.
+/// </summary>
+/// <returns>false if the list is too long or an entry is invalid</returns>
+bool InitNetBooterFleet(const NETBOOTER_CONTROLLER controllers[], size_t count);
+
+/// <summary>
+/// Queue a poll of the controllers that are due, telemetry is sent when it completes. Skipped
+/// while the previous cycle is still running.
+/// </summary>
+void PollNetBooterFleet(void);
@@ -0,0 +1,162 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "netBooterParser.h"
+
+#include <string.h>
+
+static const char responseOk[] = "$A0";
+
+// Larger readings are not a netBooter current, and keep the sums well inside uint32_t
+#define MAX_WHOLE_AMPS 100000
+#define MAX_SCALE 1000000
+
+void NetBooterParserInit(NETBOOTER_PARSER *parser, int outlets)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->outlets = outlets;
+    parser->scale = 1;
+    if (outlets < NETBOOTER_PARSE_CODE_ONLY || outlets > NETBOOTER_MAX_OUTLETS) {
+        parser->step = NETBOOTER_PARSE_ERROR;
+    }
+}
+
+static void StartField(NETBOOTER_PARSER *parser, NETBOOTER_PARSE_STEP step)
+{
+    parser->step = step;
+    parser->fieldLength = 0;
+    parser->whole = 0;
+    parser->fraction = 0;
+    parser->scale = 1;
+    parser->point = false;
+    parser->digits = false;
+}
+
+static bool EndState(NETBOOTER_PARSER *parser)
+{
+    if (parser->fieldLength == 0) {
+        return false;
+    }
+    if (parser->outlets == 0) {
+        parser->outlets = (int)parser->fieldLength;
+    }
+    return parser->fieldLength == (size_t)parser->outlets;
+}
+
+static bool EndCurrent(NETBOOTER_PARSER *parser)
+{
+    if (!parser->digits) {
+        return false;
+    }
+
+    // The last outlet comes first
+    parser->current[parser->outlets - 1 - parser->currents] =
+        (float)parser->whole + (float)parser->fraction / (float)parser->scale;
+    parser->currents++;
+    return true;
+}
+
+static bool ParseChar(NETBOOTER_PARSER *parser, char c)
+{
+    switch (parser->step) {
+    case NETBOOTER_PARSE_CODE:
+        if (c == ',') {
+            if (!parser->codeOk) {
+                return false;
+            }
+            StartField(parser, parser->outlets == NETBOOTER_PARSE_CODE_ONLY ? NETBOOTER_PARSE_DONE : NETBOOTER_PARSE_STATE);
+            return true;
+        }
+        if (parser->fieldLength >= sizeof(responseOk) - 1 || c != responseOk[parser->fieldLength]) {
+            parser->codeOk = false;
+            return false;
+        }
+        parser->fieldLength++;
+        parser->codeOk = parser->fieldLength == sizeof(responseOk) - 1;
+        return true;
+
+    case NETBOOTER_PARSE_STATE:
+        if (c == ',') {
+            if (!EndState(parser)) {
+                return false;
+            }
+            StartField(parser, NETBOOTER_PARSE_CURRENT);
+            return true;
+        }
+        if ((c != '0' && c != '1') || parser->fieldLength == NETBOOTER_MAX_OUTLETS) {
+            return false;
+        }
+        // Outlet 1 comes last and ends up in bit 0
+        parser->outletMask = (parser->outletMask << 1) | (uint32_t)(c - '0');
+        parser->fieldLength++;
+        return true;
+
+    case NETBOOTER_PARSE_CURRENT:
+        if (c == ',') {
+            if (!EndCurrent(parser)) {
+                return false;
+            }
+            StartField(parser, parser->currents == parser->outlets ? NETBOOTER_PARSE_DONE : NETBOOTER_PARSE_CURRENT);
+            return true;
+        }
+        if (c == '.') {
+            if (parser->point) {
+                return false;
+            }
+            parser->point = true;
+            return true;
+        }
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        parser->digits = true;
+        if (!parser->point) {
+            parser->whole = parser->whole * 10 + (uint32_t)(c - '0');
+            return parser->whole < MAX_WHOLE_AMPS;
+        }
+        // Digits past the float's precision are dropped
+        if (parser->scale < MAX_SCALE) {
+            parser->fraction = parser->fraction * 10 + (uint32_t)(c - '0');
+            parser->scale *= 10;
+        }
+        return true;
+
+    case NETBOOTER_PARSE_DONE:
+        return true;
+
+    case NETBOOTER_PARSE_ERROR:
+    default:
+        return false;
+    }
+}
+
+bool NetBooterParserFeed(NETBOOTER_PARSER *parser, const char *data, size_t length)
+{
+    for (size_t i = 0; i < length && parser->step != NETBOOTER_PARSE_ERROR; i++) {
+        char c = data[i];
+
+        // Line endings and padding can appear around any field
+        if (c == '\r' || c == '\n' || c == ' ' || c == '\t') {
+            continue;
+        }
+        if (!ParseChar(parser, c)) {
+            parser->step = NETBOOTER_PARSE_ERROR;
+        }
+    }
+    return parser->step != NETBOOTER_PARSE_ERROR;
+}
+
+bool NetBooterParserFinish(NETBOOTER_PARSER *parser)
+{
+    if (parser->outlets == NETBOOTER_PARSE_CODE_ONLY && parser->step == NETBOOTER_PARSE_CODE && parser->codeOk) {
+        parser->step = NETBOOTER_PARSE_DONE;
+    }
+
+    // The last current ends with the response
+    if (parser->step == NETBOOTER_PARSE_CURRENT && parser->digits) {
+        if (EndCurrent(parser) && parser->currents == parser->outlets) {
+            parser->step = NETBOOTER_PARSE_DONE;
+        }
+    }
+    return parser->step == NETBOOTER_PARSE_DONE;
+}
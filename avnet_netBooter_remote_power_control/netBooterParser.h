@@ -0,0 +1,67 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Parses a netBooter response as cURL hands it over, a chunk at a time, without keeping a copy
+// of it. A status response is
+//
+//   $A0,<state>,<current>,...
+//
+// where the state has one '0' or '1' per outlet, outlet 1 last, and the currents in amps follow
+// from the last outlet down to outlet 1. A command response is just the response code. Anything
+// after the last current is ignored.
+
+#define NETBOOTER_MAX_OUTLETS 8
+
+// Outlet count for a command response, anything after the response code is ignored
+#define NETBOOTER_PARSE_CODE_ONLY -1
+
+typedef enum {
+    NETBOOTER_PARSE_CODE,
+    NETBOOTER_PARSE_STATE,
+    NETBOOTER_PARSE_CURRENT,
+    NETBOOTER_PARSE_DONE, // Every current read, the rest is skipped
+    NETBOOTER_PARSE_ERROR
+} NETBOOTER_PARSE_STEP;
+
+typedef struct {
+    NETBOOTER_PARSE_STEP step;
+    int outlets;   // Expected, 0 to take the count from the state
+    bool codeOk;   // The response code was "$A0"
+
+    size_t fieldLength;
+    uint32_t outletMask; // Bit 0 is outlet 1
+    float current[NETBOOTER_MAX_OUTLETS]; // Outlet 1 first
+    int currents;        // Read so far
+
+    // The current being read
+    uint32_t whole;
+    uint32_t fraction;
+    uint32_t scale;
+    bool point;
+    bool digits;
+} NETBOOTER_PARSER;
+
+/// <summary>
+/// Start a response. outlets is the number the controller has, 0 if it is not known, or
+/// NETBOOTER_PARSE_CODE_ONLY.
+/// </summary>
+void NetBooterParserInit(NETBOOTER_PARSER *parser, int outlets);
+
+/// <summary>
+/// Parse the next chunk, it can end anywhere in a field.
+/// </summary>
+/// <returns>false once the response is known to be invalid</returns>
+bool NetBooterParserFeed(NETBOOTER_PARSER *parser, const char *data, size_t length);
+
+/// <summary>
+/// End of the response.
+/// </summary>
+/// <returns>true if it was a complete status response, or for NETBOOTER_PARSE_CODE_ONLY a
+/// "$A0" response code</returns>
+bool NetBooterParserFinish(NETBOOTER_PARSER *parser);
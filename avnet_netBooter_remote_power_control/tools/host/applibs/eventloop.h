@@ -0,0 +1,19 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory. Each tool defines
+// the functions itself.
+
+#pragma once
+
+typedef struct EventLoop EventLoop;
+typedef struct EventRegistration EventRegistration;
+typedef unsigned int EventLoop_IoEvents;
+
+#define EventLoop_Input 0x1u
+
+typedef void EventLoopIoCallback(EventLoop *el, int fd, EventLoop_IoEvents events, void *context);
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context);
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg);
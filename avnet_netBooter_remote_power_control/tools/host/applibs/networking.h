@@ -0,0 +1,25 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory
+
+#pragma once
+
+#include <net/if.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint8_t Networking_IpType;
+typedef uint8_t Networking_InterfaceMedium_Type;
+
+// Laid out as the SDK header lays it out, 32 bytes
+typedef struct {
+    uint32_t z__magicAndVersion;
+    bool isEnabled;
+    char interfaceName[IF_NAMESIZE];
+    uint32_t interfaceNameLength;
+    Networking_IpType ipConfigurationType;
+    Networking_InterfaceMedium_Type interfaceMediumType;
+} Networking_NetworkInterface;
+
+int Networking_IsNetworkingReady(bool *isNetworkingReady);
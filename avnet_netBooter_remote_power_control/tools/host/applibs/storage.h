@@ -0,0 +1,7 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory. Nothing from it is
+// used by the files the tools build.
+
+#pragma once
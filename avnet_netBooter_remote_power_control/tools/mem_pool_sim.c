@@ -0,0 +1,238 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host simulation of mem_pool.c over SIMULATED_DAYS of the application, with the classes main.h
+   gives it when USE_NETBOOTER_FLEET is defined. It makes the allocations main.c and
+   netBooterFleet.c make, on a simulated clock of one second steps:
+
+   - CheckNetworkStatus() every second until the network is ready after NETWORK_READY_SECONDS,
+     then one list of the given number of interfaces. A list of up to NETWORK_INTERFACES_POOLED
+     comes from the pool, a longer one from the heap.
+   - a fleet telemetry message every NETBOOTER_FLEET_CYCLE_SECONDS for the two netBooters in
+     main.h, built in the block the way FleetCycleComplete() builds it
+   - the rest of the application, HELD_BLOCKS long lived heap blocks of 32 to 431 bytes, one of
+     them replaced every second
+
+   The run is made twice, each in its own process so each starts with a fresh heap, once with
+   the pool and once with every buffer from malloc as before the pool. Both report the heap
+   calls the buffers made and the heap arena and free bytes in it at the end, from mallinfo2().
+   The pool run also reports each class's peak, spills, failures and wasted bytes. Last, every
+   list length from 0 to MAX_INTERFACES interfaces is allocated the way CheckNetworkStatus()
+   allocates it.
+
+   Build: gcc -O2 -I host -I .. -o mem_pool_sim mem_pool_sim.c ../mem_pool.c -lpthread
+   Usage: mem_pool_sim [interfaces]
+*/
+
+#include "mem_pool.h"
+
+#include <applibs/networking.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SIMULATED_DAYS 30
+#define NETWORK_READY_SECONDS 20
+#define HELD_BLOCKS 32
+#define MAX_INTERFACES 8
+
+// As main.h and netBooterFleet.h set them
+#define NETWORK_INTERFACES_POOLED 4
+#define NETWORK_INTERFACES_BYTES (NETWORK_INTERFACES_POOLED * sizeof(Networking_NetworkInterface))
+#define NETBOOTER_FLEET_CYCLE_SECONDS 10
+#define NETBOOTER_FLEET_MESSAGE_BYTES 4096
+
+static const MEM_POOL_CLASS mem_pool_classes[] = {{.blockSize = NETWORK_INTERFACES_BYTES, .blockCount = 2},
+                                                  {.blockSize = NETBOOTER_FLEET_MESSAGE_BYTES, .blockCount = 1}};
+
+static const struct {
+    const char *name;
+    int outlets;
+} fleet[] = {{"rack1", 2}, {"rack2", 8}};
+
+static bool usePool;
+static unsigned long heapCalls;
+static unsigned long messages;
+static size_t maxMessageBytes;
+static uint64_t randomState = 88172645463325252ull;
+
+static uint32_t Random(uint32_t range)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return (uint32_t)(randomState % range);
+}
+
+static void *BufferAlloc(size_t size)
+{
+    if (usePool) {
+        return mem_pool_alloc(size);
+    }
+    heapCalls++;
+    return malloc(size);
+}
+
+static void BufferFree(void *block)
+{
+    if (usePool) {
+        mem_pool_free(block);
+    } else {
+        heapCalls++;
+        free(block);
+    }
+}
+
+// The allocation CheckNetworkStatus() makes, false if the list could not be allocated
+static bool ReadInterfaces(size_t count, bool *pooled)
+{
+    size_t bytesRequired = count * sizeof(Networking_NetworkInterface);
+    Networking_NetworkInterface *interfaces;
+
+    *pooled = usePool && count <= NETWORK_INTERFACES_POOLED;
+    if (*pooled) {
+        interfaces = mem_pool_alloc(bytesRequired);
+    } else {
+        heapCalls++;
+        interfaces = malloc(bytesRequired);
+    }
+    if (interfaces == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        interfaces[i] = (Networking_NetworkInterface){.isEnabled = true, .interfaceName = "wlan0"};
+    }
+
+    if (*pooled) {
+        mem_pool_free(interfaces);
+    } else {
+        heapCalls++;
+        free(interfaces);
+    }
+    return true;
+}
+
+// The message FleetCycleComplete() builds with every netBooter polled
+static void SendFleetMessage(void)
+{
+    char *message = BufferAlloc(NETBOOTER_FLEET_MESSAGE_BYTES);
+    int len;
+
+    if (message == NULL) {
+        return;
+    }
+
+    len = snprintf(message, NETBOOTER_FLEET_MESSAGE_BYTES, "{\"netBooters\":[");
+    for (size_t i = 0; i < sizeof(fleet) / sizeof(fleet[0]); i++) {
+        len += snprintf(message + len, NETBOOTER_FLEET_MESSAGE_BYTES - (size_t)len,
+                        "%s{\"name\":\"%s\",\"ok\":true,\"outlets\":\"%0*d\",\"current\":[", i == 0 ? "" : ",",
+                        fleet[i].name, fleet[i].outlets, 0);
+        for (int outlet = 0; outlet < fleet[i].outlets; outlet++) {
+            len += snprintf(message + len, NETBOOTER_FLEET_MESSAGE_BYTES - (size_t)len, "%s%.2f",
+                            outlet == 0 ? "" : ",", (double)Random(1600) / 100);
+        }
+        len += snprintf(message + len, NETBOOTER_FLEET_MESSAGE_BYTES - (size_t)len, "]}");
+    }
+    len += snprintf(message + len, NETBOOTER_FLEET_MESSAGE_BYTES - (size_t)len,
+                    "],\"omitted\":0,\"deferred\":0,\"cycleMs\":%u}", 40 + Random(200));
+
+    messages++;
+    if ((size_t)len > maxMessageBytes) {
+        maxMessageBytes = (size_t)len;
+    }
+    BufferFree(message);
+}
+
+static int Run(bool pool, size_t interfaceCount)
+{
+    static char *held[HELD_BLOCKS];
+    const long seconds = SIMULATED_DAYS * 24L * 60 * 60;
+    bool networkReady = false;
+    bool pooled = false;
+    bool listRead = true;
+
+    usePool = pool;
+    if (usePool && !mem_pool_init(mem_pool_classes, sizeof(mem_pool_classes) / sizeof(mem_pool_classes[0]))) {
+        printf("mem_pool_init failed\n");
+        return 1;
+    }
+
+    for (long second = 0; second < seconds; second++) {
+        // The rest of the application, outside the pool either way
+        uint32_t h = Random(HELD_BLOCKS);
+        free(held[h]);
+        held[h] = malloc(32 + Random(400));
+
+        if (!networkReady && second >= NETWORK_READY_SECONDS) {
+            networkReady = true;
+            listRead = ReadInterfaces(interfaceCount, &pooled);
+        }
+        if (networkReady && second % NETBOOTER_FLEET_CYCLE_SECONDS == 0) {
+            SendFleetMessage();
+        }
+    }
+
+    struct mallinfo2 heap = mallinfo2();
+    printf("%s: %lu fleet messages of up to %zu bytes, interface list %s, %lu heap calls for them, "
+           "heap arena %zu bytes, %zu free\n",
+           usePool ? "pool" : "heap", messages, maxMessageBytes,
+           !listRead ? "FAILED" : (pooled ? "from the pool" : "from the heap"), heapCalls, heap.arena, heap.fordblks);
+
+    if (usePool) {
+        MEM_POOL_STATS stats;
+        size_t arenaBytes = 0;
+
+        for (size_t i = 0; mem_pool_get_stats(i, &stats); i++) {
+            unsigned long wastedPercent =
+                stats.grantedBytes == 0
+                    ? 0
+                    : (unsigned long)((stats.grantedBytes - stats.requestedBytes) * 100 / stats.grantedBytes);
+
+            printf("  class %4zu x %zu: %lu allocations, peak %zu, spills %lu, failures %lu, wasted %lu%%\n",
+                   stats.blockSize, stats.blockCount, (unsigned long)stats.allocations, stats.peakInUse,
+                   (unsigned long)stats.spills, (unsigned long)stats.failures, wastedPercent);
+            arenaBytes += stats.blockSize * stats.blockCount + sizeof(size_t) * stats.blockCount;
+        }
+        printf("  arena %zu bytes\n", arenaBytes);
+
+        for (size_t count = 0; count <= MAX_INTERFACES; count++) {
+            bool ok = ReadInterfaces(count, &pooled);
+            printf("  %zu interfaces, %3zu bytes: %s\n", count, count * sizeof(Networking_NetworkInterface),
+                   !ok ? "FAILED" : (pooled ? "pool" : "heap"));
+            listRead = listRead && ok;
+        }
+        mem_pool_close();
+    }
+    return listRead ? 0 : 1;
+}
+
+// Each run in a child process, so both start with an untouched heap
+static int RunInChild(bool pool, size_t interfaceCount)
+{
+    int status;
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        exit(Run(pool, interfaceCount));
+    }
+    if (child < 0 || waitpid(child, &status, 0) != child) {
+        return 1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t interfaceCount = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 3;
+
+    printf("%d simulated days, %zu interfaces, %zu bytes each\n", SIMULATED_DAYS, interfaceCount,
+           sizeof(Networking_NetworkInterface));
+
+    int failed = RunInChild(true, interfaceCount);
+    failed |= RunInChild(false, interfaceCount);
+    return failed;
+}
@@ -0,0 +1,162 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, runs netBooterFleet.c's poll cycles against netbooter_standin.py's fleet mode and
+   reports how long each cycle holds the worker thread, which is how long an outlet command to
+   the DEVICE_IP netBooter can wait behind it. Real libcurl and mem_pool.c, the worker pool runs
+   each job straight away and publishing is counted instead of sent.
+
+   Build: gcc -O2 -I host -I .. -o netbooter_fleet_bench netbooter_fleet_bench.c
+              ../netBooterFleet.c ../netBooterParser.c ../mem_pool.c -lcurl -lpthread
+   Usage: python3 netbooter_standin.py fleet 9000 50 20 1 &
+          netbooter_fleet_bench <basePort> <count> <cycles> <timeoutMs> [-v]
+*/
+
+#include "dx_avnet_iot_connect.h"
+#include "mem_pool.h"
+#include "netBooterFleet.h"
+#include "worker_pool.h"
+
+#include <applibs/networking.h>
+#include <curl/curl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static long messages;
+static long maxMessageBytes;
+static long polledOk;
+static long polledFailed;
+static long deferred;
+static long lastCycleMs;
+static bool verbose;
+
+int Networking_IsNetworkingReady(bool *isNetworkingReady)
+{
+    *isNetworkingReady = true;
+    return 0;
+}
+
+bool worker_pool_closing(void)
+{
+    return false;
+}
+
+bool worker_pool_submit(WORKER_POOL_JOB job, WORKER_POOL_COMPLETION completion, const void *context,
+                        size_t contextSize)
+{
+    static max_align_t copy[256 / sizeof(max_align_t)];
+
+    if (contextSize > sizeof(copy)) {
+        return false;
+    }
+    memcpy(copy, context, contextSize);
+    job(copy);
+    completion(copy, false);
+    return true;
+}
+
+bool dx_isAvnetConnected(void)
+{
+    return true;
+}
+
+bool dx_avnetPublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties,
+                     void *timestamp)
+{
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+    (void)timestamp;
+
+    const char *found;
+
+    messages++;
+    if ((long)messageLength > maxMessageBytes) {
+        maxMessageBytes = (long)messageLength;
+    }
+    for (found = message; (found = strstr(found, "\"ok\":true")) != NULL; found++) {
+        polledOk++;
+    }
+    for (found = message; (found = strstr(found, "\"ok\":false")) != NULL; found++) {
+        polledFailed++;
+    }
+    if ((found = strstr(message, "\"deferred\":")) != NULL) {
+        deferred += atol(found + strlen("\"deferred\":"));
+    }
+    if ((found = strstr(message, "\"cycleMs\":")) != NULL) {
+        lastCycleMs = atol(found + strlen("\"cycleMs\":"));
+    }
+    if (verbose) {
+        printf("%.*s\n", (int)messageLength, (const char *)message);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    static const MEM_POOL_CLASS classes[] = {{128, 2}, {NETBOOTER_FLEET_MESSAGE_BYTES, 1}};
+    static NETBOOTER_CONTROLLER list[NETBOOTER_FLEET_MAX_CONTROLLERS];
+    static char names[NETBOOTER_FLEET_MAX_CONTROLLERS][16];
+    static char addresses[NETBOOTER_FLEET_MAX_CONTROLLERS][32];
+
+    if (argc < 5) {
+        fprintf(stderr, "Usage: netbooter_fleet_bench <basePort> <count> <cycles> <timeoutMs> [-v]\n");
+        return 1;
+    }
+
+    int basePort = atoi(argv[1]);
+    int count = atoi(argv[2]);
+    int cycles = atoi(argv[3]);
+    int timeoutMs = atoi(argv[4]);
+    verbose = argc > 5 && strcmp(argv[5], "-v") == 0;
+
+    if (count < 1 || count > NETBOOTER_FLEET_MAX_CONTROLLERS || cycles < 1) {
+        fprintf(stderr, "1 to %d controllers and at least 1 cycle\n", NETBOOTER_FLEET_MAX_CONTROLLERS);
+        return 1;
+    }
+
+    // Every 5th has 8 outlets, as the stand-in serves them
+    for (int i = 0; i < count; i++) {
+        snprintf(names[i], sizeof(names[i]), "nb%d", i);
+        snprintf(addresses[i], sizeof(addresses[i]), "127.0.0.1:%d", basePort + i);
+        list[i] = (NETBOOTER_CONTROLLER){.name = names[i],
+                                         .address = addresses[i],
+                                         .outlets = i % 5 == 4 ? 8 : 2,
+                                         .username = "admin",
+                                         .password = "admin",
+                                         .pollPeriodSeconds = 1,
+                                         .timeoutMs = timeoutMs};
+    }
+
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK || !mem_pool_init(classes, NELEMS(classes)) ||
+        !InitNetBooterFleet(list, (size_t)count)) {
+        fprintf(stderr, "Initialization failed\n");
+        return 1;
+    }
+
+    long totalMs = 0;
+    long worstMs = 0;
+
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        lastCycleMs = 0;
+        PollNetBooterFleet();
+        totalMs += lastCycleMs;
+        if (lastCycleMs > worstMs) {
+            worstMs = lastCycleMs;
+        }
+
+        // Every controller is due again
+        nanosleep(&(struct timespec){.tv_sec = 1}, NULL);
+    }
+
+    printf("%d controllers, %d cycles: mean %ld ms, worst %ld ms | ok %ld, failed %ld, deferred %ld, "
+           "%ld messages, largest %ld bytes\n",
+           count, cycles, totalMs / cycles, worstMs, polledOk, polledFailed, deferred, messages,
+           maxMessageBytes);
+
+    mem_pool_close();
+    curl_global_cleanup();
+    return 0;
+}
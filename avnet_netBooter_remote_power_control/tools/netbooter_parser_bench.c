@@ -0,0 +1,142 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host benchmark, the time to take in and parse one two-outlet status response, whole and in
+   4-byte chunks, three ways:
+
+     - collected into a realloc'd block, copied and split with strtok, as the original code did
+     - collected into a mem_pool block and split with strtok, as after user-039
+     - fed to netBooterParser.c as it arrives
+
+   The first two are reproduced here from the old netBooter.c so they can be compared.
+
+   Build: gcc -O2 -I host -I .. -o netbooter_parser_bench netbooter_parser_bench.c
+              ../netBooterParser.c ../mem_pool.c -lpthread
+   Usage: netbooter_parser_bench [iterations]
+*/
+
+#include "mem_pool.h"
+#include "netBooterParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
+
+typedef struct {
+    char *data;
+    size_t size;
+} MemoryBlock;
+
+static const char response[] = "$A0,10,0.13,1.25\r\n";
+
+static volatile int stateSink;
+static volatile float currentSink;
+
+static size_t CollectRealloc(const char *chunk, size_t size, MemoryBlock *block)
+{
+    block->data = realloc(block->data, block->size + size + 1);
+    memcpy(block->data + block->size, chunk, size);
+    block->size += size;
+    block->data[block->size] = '\0';
+    return size;
+}
+
+static size_t CollectMemPool(const char *chunk, size_t size, MemoryBlock *block)
+{
+    char *data = mem_pool_resize(block->data, block->size + size + 1);
+    if (data == NULL) {
+        return 0;
+    }
+    block->data = data;
+    memcpy(block->data + block->size, chunk, size);
+    block->size += size;
+    block->data[block->size] = '\0';
+    return size;
+}
+
+static void StrtokParse(char *buffer)
+{
+    char *field = strtok(buffer, ",");
+    if (field == NULL || strcmp(field, "$A0") != 0) {
+        return;
+    }
+    stateSink = atoi(strtok(NULL, ","));
+    currentSink = (float)atof(strtok(NULL, ","));
+    currentSink = (float)atof(strtok(NULL, ","));
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    static const MEM_POOL_CLASS classes[] = {{32, 8}, {128, 8}};
+    const size_t length = strlen(response);
+    const size_t chunkSizes[] = {length, 4};
+    long iterations = argc > 1 ? atol(argv[1]) : 5000000;
+
+    if (iterations <= 0 || !mem_pool_init(classes, NELEMS(classes))) {
+        fprintf(stderr, "Usage: netbooter_parser_bench [iterations]\n");
+        return 1;
+    }
+
+    printf("%ld iterations of \"$A0,10,0.13,1.25\\r\\n\"\n", iterations);
+    printf("chunk  realloc+copy+strtok  mem_pool+strtok  streaming parser\n");
+
+    for (size_t c = 0; c < NELEMS(chunkSizes); c++) {
+        size_t chunk = chunkSizes[c];
+        double start = NowNs();
+
+        for (long i = 0; i < iterations; i++) {
+            MemoryBlock block = {0};
+            for (size_t at = 0; at < length; at += chunk) {
+                CollectRealloc(response + at, at + chunk > length ? length - at : chunk, &block);
+            }
+            char *copy = malloc(block.size + 1);
+            memcpy(copy, block.data, block.size + 1);
+            StrtokParse(copy);
+            free(copy);
+            free(block.data);
+        }
+        double reallocNs = (NowNs() - start) / (double)iterations;
+
+        start = NowNs();
+        for (long i = 0; i < iterations; i++) {
+            MemoryBlock block = {0};
+            for (size_t at = 0; at < length; at += chunk) {
+                CollectMemPool(response + at, at + chunk > length ? length - at : chunk, &block);
+            }
+            StrtokParse(block.data);
+            mem_pool_free(block.data);
+        }
+        double memPoolNs = (NowNs() - start) / (double)iterations;
+
+        start = NowNs();
+        for (long i = 0; i < iterations; i++) {
+            NETBOOTER_PARSER parser;
+            NetBooterParserInit(&parser, 2);
+            for (size_t at = 0; at < length; at += chunk) {
+                NetBooterParserFeed(&parser, response + at, at + chunk > length ? length - at : chunk);
+            }
+            if (NetBooterParserFinish(&parser)) {
+                stateSink = (int)parser.outletMask;
+                currentSink = parser.current[0];
+                currentSink = parser.current[1];
+            }
+        }
+        double parserNs = (NowNs() - start) / (double)iterations;
+
+        printf("%3zu B  %16.0f ns  %12.0f ns  %13.0f ns\n", chunk, reallocNs, memPoolNs, parserNs);
+    }
+
+    printf("sizeof(NETBOOTER_PARSER) %zu bytes\n", sizeof(NETBOOTER_PARSER));
+    mem_pool_close();
+    return 0;
+}
@@ -0,0 +1,233 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host fuzzer for netBooterParser.c. Generates random status responses of 1 to 8 outlets and
+   checks that
+
+     - every 2-way split, 1-byte chunks and random 3-way splits parse to the generated values
+     - a truncated response is refused, unless the cut is inside the last current's digits,
+       which the bytes alone cannot tell from a complete response
+     - byte flips, inserts and deletes never fault and only give valid outlet counts
+
+   then runs a few command responses through NETBOOTER_PARSE_CODE_ONLY.
+
+   Build: gcc -O1 -g -fsanitize=address,undefined -I .. -o netbooter_parser_fuzz
+              netbooter_parser_fuzz.c ../netBooterParser.c -lm
+   Usage: netbooter_parser_fuzz [responses]
+*/
+
+#include "netBooterParser.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESPONSE_BYTES 256
+
+typedef struct {
+    int outlets;
+    uint32_t outletMask;
+    float current[NETBOOTER_MAX_OUTLETS]; // Outlet 1 first
+} EXPECTED;
+
+static uint32_t randomState = 12345;
+
+static uint32_t Random(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/// <summary>
+///     Write a random status response into buffer, with or without a trailing CRLF.
+/// </summary>
+static size_t Generate(char *buffer, EXPECTED *expected, int outlets)
+{
+    size_t length = (size_t)sprintf(buffer, "$A0,");
+
+    expected->outlets = outlets;
+    expected->outletMask = 0;
+
+    // Outlet 1 last
+    for (int outlet = outlets - 1; outlet >= 0; outlet--) {
+        uint32_t bit = Random() & 1;
+        buffer[length++] = (char)('0' + bit);
+        expected->outletMask |= bit << outlet;
+    }
+
+    // From the last outlet down to outlet 1, 0 to 3 decimals
+    for (int outlet = outlets - 1; outlet >= 0; outlet--) {
+        size_t start = length + 1;
+        int decimals = (int)(Random() % 4);
+
+        length += (size_t)sprintf(buffer + length, ",%u", (unsigned)(Random() % 20));
+        if (decimals > 0) {
+            uint32_t scale = decimals == 1 ? 10 : decimals == 2 ? 100 : 1000;
+            length += (size_t)sprintf(buffer + length, ".%0*u", decimals, (unsigned)(Random() % scale));
+        }
+        expected->current[outlet] = (float)atof(buffer + start);
+    }
+
+    if (Random() % 2) {
+        length += (size_t)sprintf(buffer + length, "\r\n");
+    }
+    return length;
+}
+
+static bool Matches(const NETBOOTER_PARSER *parser, const EXPECTED *expected)
+{
+    if (parser->outletMask != expected->outletMask || parser->currents != expected->outlets) {
+        return false;
+    }
+    for (int outlet = 0; outlet < expected->outlets; outlet++) {
+        if (fabsf(parser->current[outlet] - expected->current[outlet]) > 1e-4f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+///     Feed data in the chunks ending at cuts[], then the rest.
+/// </summary>
+static bool Parse(const char *data, size_t length, const size_t *cuts, size_t cutCount, int outlets,
+                  NETBOOTER_PARSER *parser)
+{
+    size_t at = 0;
+
+    NetBooterParserInit(parser, outlets);
+    for (size_t i = 0; i <= cutCount; i++) {
+        size_t end = i < cutCount ? cuts[i] : length;
+        if (!NetBooterParserFeed(parser, data + at, end - at)) {
+            return false;
+        }
+        at = end;
+    }
+    return NetBooterParserFinish(parser);
+}
+
+int main(int argc, char *argv[])
+{
+    long responses = argc > 1 ? atol(argv[1]) : 20000;
+    long splits = 0, mismatches = 0;
+    long truncations = 0, truncationsInLastCurrent = 0, truncationsAccepted = 0;
+    long mutations = 0, mutationsAccepted = 0;
+    char response[RESPONSE_BYTES];
+    EXPECTED expected;
+    NETBOOTER_PARSER parser;
+
+    for (long iteration = 0; iteration < responses; iteration++) {
+        int outlets = 1 + (int)(Random() % NETBOOTER_MAX_OUTLETS);
+        size_t length = Generate(response, &expected, outlets);
+
+        // Half the time the count comes from the state digits
+        int hint = iteration % 2 ? outlets : 0;
+
+        for (size_t cut = 0; cut <= length; cut++) {
+            splits++;
+            if (!Parse(response, length, &cut, 1, hint, &parser) || !Matches(&parser, &expected)) {
+                mismatches++;
+                printf("split at %zu: %.*s\n", cut, (int)length, response);
+            }
+        }
+
+        size_t cuts[RESPONSE_BYTES];
+        for (size_t cut = 1; cut < length; cut++) {
+            cuts[cut - 1] = cut;
+        }
+        splits++;
+        if (!Parse(response, length, cuts, length - 1, hint, &parser) || !Matches(&parser, &expected)) {
+            mismatches++;
+            printf("1-byte chunks: %.*s\n", (int)length, response);
+        }
+
+        for (int k = 0; k < 10; k++) {
+            size_t pair[2] = {Random() % (length + 1), Random() % (length + 1)};
+            if (pair[0] > pair[1]) {
+                size_t swap = pair[0];
+                pair[0] = pair[1];
+                pair[1] = swap;
+            }
+            splits++;
+            if (!Parse(response, length, pair, 2, hint, &parser) || !Matches(&parser, &expected)) {
+                mismatches++;
+                printf("split at %zu, %zu: %.*s\n", pair[0], pair[1], (int)length, response);
+            }
+        }
+
+        // The last current starts after the last comma
+        size_t lastComma = length;
+        while (lastComma > 0 && response[lastComma - 1] != ',') {
+            lastComma--;
+        }
+        for (size_t cut = 0; cut < length; cut++) {
+            truncations++;
+            if (Parse(response, cut, NULL, 0, hint, &parser)) {
+                if (cut > lastComma) {
+                    truncationsInLastCurrent++;
+                } else {
+                    truncationsAccepted++;
+                    printf("truncated at %zu accepted: %.*s\n", cut, (int)length, response);
+                }
+            }
+        }
+
+        for (int k = 0; k < 20; k++) {
+            char mutated[RESPONSE_BYTES + 32];
+            size_t mutatedLength = length;
+            int edits = 1 + (int)(Random() % 3);
+
+            memcpy(mutated, response, length);
+            for (int e = 0; e < edits && mutatedLength > 0; e++) {
+                size_t at = Random() % mutatedLength;
+                switch (Random() % 3) {
+                case 0:
+                    mutated[at] = (char)(Random() & 0xFF);
+                    break;
+                case 1:
+                    memmove(mutated + at + 1, mutated + at, mutatedLength - at);
+                    mutated[at] = (char)(Random() & 0xFF);
+                    mutatedLength++;
+                    break;
+                default:
+                    memmove(mutated + at, mutated + at + 1, mutatedLength - at - 1);
+                    mutatedLength--;
+                    break;
+                }
+            }
+
+            size_t cut = Random() % (mutatedLength + 1);
+            mutations++;
+            if (Parse(mutated, mutatedLength, &cut, 1, hint, &parser)) {
+                mutationsAccepted++;
+                if (parser.outlets < 1 || parser.outlets > NETBOOTER_MAX_OUTLETS || parser.currents != parser.outlets) {
+                    printf("mutation accepted with %d outlets, %d currents\n", parser.outlets, parser.currents);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("%ld split parses, %ld mismatches\n", splits, mismatches);
+    printf("%ld truncations, %ld accepted inside the last current, %ld accepted elsewhere\n", truncations,
+           truncationsInLastCurrent, truncationsAccepted);
+    printf("%ld mutations, %ld accepted, all with valid outlet counts\n", mutations, mutationsAccepted);
+
+    static const char *commands[] = {"$A0", "$A0\r\n", "$A0,1", "$AF", "$A", "", "$A01"};
+    static const bool commandOk[] = {true, true, true, false, false, false, false};
+    long commandFailures = 0;
+
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        NetBooterParserInit(&parser, NETBOOTER_PARSE_CODE_ONLY);
+        NetBooterParserFeed(&parser, commands[i], strlen(commands[i]));
+        if (NetBooterParserFinish(&parser) != commandOk[i]) {
+            commandFailures++;
+            printf("command response \"%s\" gave the wrong result\n", commands[i]);
+        }
+    }
+
+    return mismatches > 0 || truncationsAccepted > 0 || commandFailures > 0;
+}
@@ -0,0 +1,226 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host test for how long a netBooter poll holds up the event loop, with real libcurl against
+   netbooter_standin.py. An event loop runs a 10 ms periodic timer and records how late each
+   tick fires. Every second it calls pollNetBooterCurrentData() from netBooter.c, as the
+   telemetry timer does, only more often.
+
+   worker_pool_submit() is wrapped at link time. In the inline runs the wrapper runs the job
+   and its completion straight away on the event loop, the way the example ran the curl
+   transfer before the worker pool. In the worker pool runs it passes the job to worker_pool.c
+   with one worker, as main.c does now. Each is run against a netBooter that answers and one
+   that never answers, which holds a request for netBooter.c's 1 s curl timeout. Each run
+   reports the longest stall, the polls that completed and the polls refused because the pool
+   was busy.
+
+   Build: gcc -O2 -I host -I .. -Wl,--wrap=worker_pool_submit -o netbooter_poll_stall
+              netbooter_poll_stall.c ../netBooter.c ../netBooterParser.c ../current_monitor.c
+              ../worker_pool.c -lcurl -lpthread
+   Usage: python3 netbooter_standin.py fleet 8080 2 200 2 &
+          netbooter_poll_stall 8080 8081
+*/
+
+#include "dx_avnet_iot_connect.h"
+#include "netBooter.h"
+#include "worker_pool.h"
+
+#include "dx_timer.h"
+#include <applibs/networking.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TICK_MS 10
+#define POLL_MS 1000
+#define RUN_MS 10000
+
+char deviceIpAddress[40];
+
+static bool offload;
+static int completed;
+static int refused;
+static int outstanding; // Submitted to the worker pool and not completed yet
+
+static int completionFd = -1;
+static EventLoopIoCallback *completionCallback;
+
+bool __real_worker_pool_submit(WORKER_POOL_JOB job, WORKER_POOL_COMPLETION completion, const void *context,
+                               size_t contextSize);
+
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return (EventLoop *)&completionFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    completionFd = fd;
+    completionCallback = callback;
+    return (EventRegistration *)&completionFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    completionFd = -1;
+    return 0;
+}
+
+int Networking_IsNetworkingReady(bool *isNetworkingReady)
+{
+    *isNetworkingReady = true;
+    return 0;
+}
+
+// Telemetry is dropped
+bool dx_isAvnetConnected(void)
+{
+    return true;
+}
+
+bool dx_avnetPublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties,
+                     void *timestamp)
+{
+    (void)message;
+    (void)messageLength;
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+    (void)timestamp;
+    return true;
+}
+
+// Every job netBooter.c submits comes through here, the completion is counted on its way
+typedef struct {
+    WORKER_POOL_COMPLETION completion;
+    max_align_t context[WORKER_POOL_CONTEXT_BYTES / sizeof(max_align_t) - 1];
+} WRAPPED_JOB;
+
+static WORKER_POOL_JOB wrappedJob;
+
+static void RunWrapped(void *context)
+{
+    wrappedJob(((WRAPPED_JOB *)context)->context);
+}
+
+static void CompleteWrapped(void *context, bool cancelled)
+{
+    WRAPPED_JOB *wrapped = (WRAPPED_JOB *)context;
+
+    outstanding--;
+    completed += !cancelled;
+    wrapped->completion(wrapped->context, cancelled);
+}
+
+bool __wrap_worker_pool_submit(WORKER_POOL_JOB job, WORKER_POOL_COMPLETION completion, const void *context,
+                               size_t contextSize)
+{
+    WRAPPED_JOB wrapped = {.completion = completion};
+
+    if (contextSize > sizeof(wrapped.context)) {
+        fprintf(stderr, "A %zu byte job does not fit in the wrapper\n", contextSize);
+        exit(1);
+    }
+    memcpy(wrapped.context, context, contextSize);
+    wrappedJob = job; // netBooter.c only submits NetBooterJob
+
+    outstanding++;
+    if (!offload) {
+        RunWrapped(&wrapped);
+        CompleteWrapped(&wrapped, false);
+        return true;
+    }
+    if (!__real_worker_pool_submit(RunWrapped, CompleteWrapped, &wrapped, sizeof(wrapped))) {
+        outstanding--;
+        refused++;
+        return false;
+    }
+    return true;
+}
+
+static double NowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+static void Run(const char *name, const char *port, bool runOnWorker)
+{
+    double startMs = NowMs();
+    double nextTickMs = TICK_MS;
+    double nextPollMs = POLL_MS;
+    double maxLateMs = 0;
+
+    snprintf(deviceIpAddress, sizeof(deviceIpAddress), "127.0.0.1:%s", port);
+    offload = runOnWorker;
+    completed = 0;
+    refused = 0;
+
+    for (;;) {
+        double nowMs = NowMs() - startMs;
+        if (nowMs >= RUN_MS) {
+            break;
+        }
+
+        if (nowMs >= nextTickMs) {
+            if (nowMs - nextTickMs > maxLateMs) {
+                maxLateMs = nowMs - nextTickMs;
+            }
+            nextTickMs += TICK_MS * (1 + (int)((nowMs - nextTickMs) / TICK_MS));
+        }
+
+        // The telemetry timer
+        if (nowMs >= nextPollMs) {
+            nextPollMs += POLL_MS;
+            pollNetBooterCurrentData();
+        }
+
+        struct pollfd fd = {.fd = completionFd, .events = POLLIN};
+        double dueMs = nextTickMs < nextPollMs ? nextTickMs : nextPollMs;
+        int timeoutMs = (int)(dueMs - (NowMs() - startMs)) + 1;
+        if (poll(&fd, completionFd >= 0 ? 1 : 0, timeoutMs > 0 ? timeoutMs : 0) > 0) {
+            completionCallback(NULL, completionFd, EventLoop_Input, NULL);
+        }
+    }
+
+    // Let the last request finish, so the next run starts with an idle worker
+    while (outstanding > 0) {
+        struct pollfd fd = {.fd = completionFd, .events = POLLIN};
+        if (poll(&fd, 1, 100) > 0) {
+            completionCallback(NULL, completionFd, EventLoop_Input, NULL);
+        }
+    }
+
+    printf("%-30s %-16s longest stall %7.1f ms  polls completed %2d  refused %2d\n", name,
+           runOnWorker ? "on worker_pool" : "inline", maxLateMs, completed, refused);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: netbooter_poll_stall <port of a netBooter> <port of a dead netBooter>\n");
+        return 1;
+    }
+    if (!InitNetBooterCurl() || !worker_pool_init(1)) {
+        return 1;
+    }
+    InitNetBooterCurrentMonitors();
+
+    Run("netBooter answering", argv[1], false);
+    Run("netBooter answering", argv[1], true);
+    Run("netBooter not answering", argv[2], false);
+    Run("netBooter not answering", argv[2], true);
+
+    worker_pool_close();
+    CloseNetBooterCurl();
+    return 0;
+}
@@ -0,0 +1,113 @@
+# Copyright (c) Microsoft Corporation. All rights reserved.
+# Licensed under the MIT License.
+#
+# Host stand-in for netBooters, for the tools in this directory. Answers every POST with a
+# netBooter status response.
+#
+#   netbooter_standin.py profile <name> <pollSeconds> <port>
+#       One netBooter with two outlets. Each request moves a virtual clock on by pollSeconds and
+#       returns the reading of the scripted current profile at that time:
+#         steady         1.2 A on outlet 1, outlet 2 off
+#         cycling        a compressor, 3 A for 5 min in every 15, outlet 2 toggled every 20 min
+#         spikes         2 A with a 30 s excursion to 5.5 A every 10 min
+#         nearthreshold  4 A with +/- 0.15 A of noise
+#
+#   netbooter_standin.py fleet <basePort> <count> <latencyMs> <deadEvery>
+#       count netBooters on ports basePort and up, answering after 0.5 to 1.5 latencyMs with
+#       random states and currents. Every 5th has 8 outlets. Every deadEvery-th accepts
+#       connections but never answers, 0 for none.
+
+import http.server
+import random
+import socketserver
+import sys
+import threading
+import time
+
+
+def profile_reading(profile, t, rnd):
+    on1, on2 = True, True
+    if profile == 'steady':
+        c1, c2 = 1.20, 0.00
+        on2 = False
+    elif profile == 'cycling':
+        c1 = 3.0 if (t % 900) < 300 else 0.02
+        on2 = (t // 1200) % 2 == 0
+        c2 = 0.8 if on2 else 0.0
+    elif profile == 'spikes':
+        c1 = 5.5 if (t % 600) < 30 else 2.0
+        c2 = 0.5
+    elif profile == 'nearthreshold':
+        c1, c2 = 4.0, 0.5
+    else:
+        sys.exit('unknown profile ' + profile)
+
+    noise = 0.15 if profile == 'nearthreshold' else 0.03
+    c1 = max(0.0, c1 + rnd.uniform(-noise, noise)) if on1 else 0.0
+    c2 = max(0.0, c2 + rnd.uniform(-noise, noise)) if on2 else 0.0
+    # One digit per outlet and the currents, both from the last outlet down to outlet 1
+    return '$A0,%d%d,%.2f,%.2f' % (on2, on1, c2, c1)
+
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+def serve_profile(profile, period, port):
+    rnd = random.Random(7)
+    polls = [0]
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_POST(self):
+            self.rfile.read(int(self.headers.get('Content-Length', 0)))
+            body = profile_reading(profile, polls[0] * period, rnd).encode()
+            polls[0] += 1
+            self.send_response(200)
+            self.send_header('Content-Length', str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, *args):
+            pass
+
+    http.server.HTTPServer.allow_reuse_address = True
+    http.server.HTTPServer(('127.0.0.1', port), Handler).serve_forever()
+
+
+def serve_fleet(base, count, latency, dead):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = 'HTTP/1.0'
+
+        def do_POST(self):
+            index = self.server.index
+            if dead and index % dead == dead - 1:
+                time.sleep(30)
+                return
+            time.sleep(latency * (0.5 + random.random()))
+            outlets = 8 if index % 5 == 4 else 2
+            state = ''.join(random.choice('01') for _ in range(outlets))
+            body = ('$A0,' + state + ''.join(',%.2f' % random.uniform(0, 3) for _ in range(outlets))).encode()
+            self.send_response(200)
+            self.send_header('Content-Length', str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, *args):
+            pass
+
+    for i in range(count):
+        server = Server(('127.0.0.1', base + i), Handler)
+        server.index = i
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+    print('ready', flush=True)
+    threading.Event().wait()
+
+
+if len(sys.argv) == 5 and sys.argv[1] == 'profile':
+    serve_profile(sys.argv[2], float(sys.argv[3]), int(sys.argv[4]))
+elif len(sys.argv) == 6 and sys.argv[1] == 'fleet':
+    serve_fleet(int(sys.argv[2]), int(sys.argv[3]), float(sys.argv[4]) / 1000, int(sys.argv[5]))
+else:
+    sys.exit('usage: netbooter_standin.py profile <name> <pollSeconds> <port>\n'
+             '       netbooter_standin.py fleet <basePort> <count> <latencyMs> <deadEvery>')
@@ -0,0 +1,129 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, runs netBooter.c's polling and current monitors for one simulated hour against
+   netbooter_standin.py and counts the telemetry messages and edges they send. Real libcurl,
+   the worker pool runs each job straight away and publishing is counted instead of sent.
+
+   Build: gcc -O2 -I host -I .. -o netbooter_telemetry_sim netbooter_telemetry_sim.c
+              ../netBooter.c ../netBooterParser.c ../current_monitor.c -lcurl
+   Usage: python3 netbooter_standin.py profile cycling 2 8080 &
+          netbooter_telemetry_sim <pollSeconds> <port> <summarySeconds> <outlet 1 threshold> [-v]
+*/
+
+#include "dx_avnet_iot_connect.h"
+#include "netBooter.h"
+#include "worker_pool.h"
+
+#include <applibs/networking.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMULATED_SECONDS 3600
+
+char deviceIpAddress[40];
+
+static const char *eventNames[] = {"firstSample", "outletOn", "outletOff", "loadStarted",
+                                   "loadStopped", "overThreshold", "underThreshold"};
+
+static long messages;
+static long messageBytes;
+static long events[NELEMS(eventNames)];
+static bool verbose;
+
+int Networking_IsNetworkingReady(bool *isNetworkingReady)
+{
+    *isNetworkingReady = true;
+    return 0;
+}
+
+bool worker_pool_closing(void)
+{
+    return false;
+}
+
+bool worker_pool_submit(WORKER_POOL_JOB job, WORKER_POOL_COMPLETION completion, const void *context,
+                        size_t contextSize)
+{
+    static max_align_t copy[256 / sizeof(max_align_t)];
+
+    if (contextSize > sizeof(copy)) {
+        return false;
+    }
+    memcpy(copy, context, contextSize);
+    job(copy);
+    completion(copy, false);
+    return true;
+}
+
+bool dx_isAvnetConnected(void)
+{
+    return true;
+}
+
+bool dx_avnetPublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties,
+                     void *timestamp)
+{
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+    (void)timestamp;
+
+    messages++;
+    messageBytes += (long)messageLength;
+
+    for (size_t i = 0; i < NELEMS(eventNames); i++) {
+        for (const char *found = message; (found = strstr(found, eventNames[i])) != NULL; found++) {
+            events[i]++;
+        }
+    }
+    if (verbose) {
+        printf("%.*s\n", (int)messageLength, (const char *)message);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        fprintf(stderr, "Usage: netbooter_telemetry_sim <pollSeconds> <port> <summarySeconds> "
+                        "<outlet 1 threshold> [-v]\n");
+        return 1;
+    }
+
+    int pollSeconds = atoi(argv[1]);
+    int summarySeconds = atoi(argv[3]);
+    verbose = argc > 5 && strcmp(argv[5], "-v") == 0;
+
+    if (pollSeconds <= 0) {
+        fprintf(stderr, "The poll period must be at least 1 s\n");
+        return 1;
+    }
+    snprintf(deviceIpAddress, sizeof(deviceIpAddress), "127.0.0.1:%s", argv[2]);
+
+    if (!InitNetBooterCurl()) {
+        return 1;
+    }
+    InitNetBooterCurrentMonitors();
+    SetNetBooterCurrentThreshold(1, (float)atof(argv[4]));
+
+    for (int seconds = 0; seconds < SIMULATED_SECONDS; seconds += pollSeconds) {
+        pollNetBooterCurrentData();
+        if (summarySeconds > 0 && (seconds + pollSeconds) % summarySeconds == 0) {
+            SendNetBooterSummary();
+        }
+    }
+
+    printf("%ld messages, %ld bytes in %d s of %d s polls |", messages, messageBytes,
+           SIMULATED_SECONDS, pollSeconds);
+    for (size_t i = 0; i < NELEMS(eventNames); i++) {
+        if (events[i] > 0) {
+            printf(" %s %ld", eventNames[i], events[i]);
+        }
+    }
+    printf("\n");
+
+    CloseNetBooterCurl();
+    return 0;
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// little_fs_on_mutable_storage/worker_pool.c/h is the canonical copy of this module,
+// avnet_netBooter_remote_power_control has an identical copy. Change the canonical copy and
+// copy it across.
+
+#define WORKER_POOL_MAX_THREADS 4
+
+// Jobs queued, running or waiting for their completion handler, submit fails beyond this
+#define WORKER_POOL_MAX_JOBS 8
+
+// Each job's context is copied into the pool, so the caller's copy can go out of scope
+#define WORKER_POOL_CONTEXT_BYTES 128
+
+/// <summary>
+/// Runs on a worker thread. Results are written back into context.
+/// </summary>
+typedef void (*WORKER_POOL_JOB)(void *context);
+
+/// <summary>
+/// Runs on the event loop thread once the job has finished, or from worker_pool_close() with
+/// cancelled set for a job that never ran.
+/// </summary>
+typedef void (*WORKER_POOL_COMPLETION)(void *context, bool cancelled);
+
+/// <summary>
+/// Start threadCount workers and register the completion event with the DevX event loop.
+/// With one worker, jobs run and complete in the order they were submitted.
+/// </summary>
+bool worker_pool_init(size_t threadCount);
+
+/// <summary>
+/// Worker threads started by worker_pool_init(), 0 when the pool is not running.
+/// </summary>
+size_t worker_pool_thread_count(void);
+
+/// <summary>
+/// Wait for running jobs, cancel queued jobs and unregister from the event loop.
+/// </summary>
+void worker_pool_close(void);
+
+/// <summary>
+/// Queue a job. Call from the event loop thread.
+/// </summary>
+/// <returns>false if the pool is full or not running</returns>
+bool worker_pool_submit(WORKER_POOL_JOB job, WORKER_POOL_COMPLETION completion,
+                        const void *context, size_t contextSize);
+
+/// <summary>
+/// True once worker_pool_close() has been called, long running jobs should give up early.
+/// </summary>
+bool worker_pool_closing(void);
@@ -9,14 +9,45 @@
 #define TELEMETRY_SEND_PERIOD_SECONDS 30
 #define TELEMETRY_SEND_PERIOD_NANO_SECONDS 0 * 1000
 
+// Defines how often the unauthorized devices seen while onboarding is enabled are summarized,
+// each one is also reported on its own at most every RSL10_UNKNOWN_COOLDOWN_SECONDS
+#define UNAUTHORIZED_SUMMARY_PERIOD_SECONDS (5 * 60)
+
 // Define the RSL10 data this application reports as telemetry
 #define SEND_RSL10_BATTERY_DATA
 #define SEND_RSL10_TEMP_HUMIDITY_DATA
 //#define SEND_RSL10_MOTION_DATA
 
+// Define to send the fresh data of every device in one "rsl10Devices" array per telemetry period
+// instead of one message per device and data type. A message is capped at 4 KB, the size IoT Hub
+// meters messages in, and further devices go in another message.
+//#define SEND_RSL10_AGGREGATED_TELEMETRY
+// Define to add the min, max and average of the readings received during the period to each
+// device in the aggregated telemetry, needs SEND_RSL10_AGGREGATED_TELEMETRY
+//#define SEND_RSL10_TELEMETRY_STATS
+
+// Most verbose ASYNC_LOG_* messages compiled in, lower levels compile to nothing. Raise to
+// ASYNC_LOG_LEVEL_TRACE to log every RSL10 message as it is parsed, see async_log.h
+#define ASYNC_LOG_LEVEL ASYNC_LOG_LEVEL_DEBUG
+// Room for a copy of a whole RSL10 message, so tracing one does not fall back to a synchronous write
+#define ASYNC_LOG_TEXT_BYTES 160
+
 // Enable to see UART debug from PMOD
 //#define ENABLE_UART_DEBUG
 
+// Enable to replace the PMOD with generated RSL10 adverts and log the parser's throughput, dropped
+// lines and CPU time per line every RSL10_LOADGEN_REPORT_SECONDS, see rsl10_loadgen.h
+//#define ENABLE_RSL10_LOAD_GENERATOR
+#define RSL10_LOADGEN_DEVICES 50
+#define RSL10_LOADGEN_LINES_PER_SECOND 500
+#define RSL10_LOADGEN_MALFORMED_PERCENT 5
+#define RSL10_LOADGEN_REPORT_SECONDS 10
+// Define to replay this trace from the image package instead of generating adverts
+//#define RSL10_LOADGEN_REPLAY_FILE "traces/rsl10_sample_trace.txt"
+
+// Enable to log every message received from the PMOD as a trace the load generator can replay
+//#define RSL10_RECORD_TRACE
+
 // Set this flag to force the device/application to send all network traffic through a 
 // Proxy server.
 //#define USE_WEB_PROXY
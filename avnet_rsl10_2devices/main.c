@@ -56,33 +56,23 @@ static DX_DEVICE_TWIN_HANDLER(rsl10AuthorizedDTFunction, deviceTwinBinding)
     // Cast the context pointer so we can update the MAC in the structure
     RSL10Device_t *rsl10_device = (RSL10Device_t*) deviceTwinBinding->context;
 
-    size_t propertyLen = strnlen(property_value, RSL10_ADDRESS_LEN);
-
     //  Verify that the context pointer is valid
     if(rsl10_device == NULL){
         Log_Debug("Invalid context pointer\n");
         return;
     }
 
-    // Check to see if the incomming string is empty ""
-    if((propertyLen == 0) || (property_value == NULL)){                
-                
-        // This authorizedMac entry was just removed, update the authorized address with "", and mark it inactive
-        strcpy(rsl10_device->authorizedBdAddress, "");
-        
-    }
+    size_t propertyLen = (property_value == NULL) ? 0 : strnlen(property_value, RSL10_ADDRESS_LEN);
+    int8_t deviceIndex = (int8_t)(rsl10_device - Rsl10DeviceList);
+    uint64_t newKey = 0;
 
-    // The propery value is not NULL, validate the data
-    else if ((deviceTwinBinding->twinType == DX_DEVICE_TWIN_STRING) &&
-            (propertyLen == RSL10_ADDRESS_LEN-1) && 
-            (dx_isStringPrintable(property_value)))
-    {
-
-        // Update the structure with the new MAC address
-        strncpy(rsl10_device->authorizedBdAddress, property_value, RSL10_ADDRESS_LEN);
-
-    }
-    else{
+    // Validate the new value before the old address is touched, so an invalid update leaves
+    // the device authorized as it was. An empty string "" removes this authorizedMac entry.
+    if((propertyLen != 0) &&
+       ((deviceTwinBinding->twinType != DX_DEVICE_TWIN_STRING) ||
+        (propertyLen != RSL10_ADDRESS_LEN-1) ||
+        (!dx_isStringPrintable(property_value)) ||
+        (!rsl10ParseAddressKey(property_value, &newKey)))){
 
         Log_Debug("Local copy failed. String too long or invalid data\n");
         return;
@@ -90,6 +80,33 @@ static DX_DEVICE_TWIN_HANDLER(rsl10AuthorizedDTFunction, deviceTwinBinding)
 
     // Control gets here if the incomming data is valid.
 
+    // Take the old address off this slot. It stays allowed if knownMacs lists it, or moves to
+    // another slot authorized for the same address.
+    uint64_t oldKey;
+    if(rsl10ParseAddressKey(rsl10_device->authorizedBdAddress, &oldKey)){
+        rsl10AllowlistRemoveDevice(oldKey, deviceIndex);
+
+        for(int8_t i = 0; i < MAX_RSL10_DEVICES; i++){
+            uint64_t otherKey;
+            if((i != deviceIndex) &&
+               rsl10ParseAddressKey(Rsl10DeviceList[i].authorizedBdAddress, &otherKey) &&
+               (otherKey == oldKey)){
+                rsl10AllowlistAdd(oldKey, i);
+                break;
+            }
+        }
+    }
+
+    if(propertyLen == 0){
+        // This authorizedMac entry was just removed, update the authorized address with "", and mark it inactive
+        strcpy(rsl10_device->authorizedBdAddress, "");
+    }
+    else{
+        // Update the structure with the new MAC address
+        strncpy(rsl10_device->authorizedBdAddress, property_value, RSL10_ADDRESS_LEN);
+        rsl10AllowlistAdd(newKey, deviceIndex);
+    }
+
     // Mark this device as inactive, this will be updated when we receive the next message from the device
     rsl10_device->isActive = false;
     Log_Debug("Received device update. New %s is %s\n", deviceTwinBinding->propertyName, rsl10_device->authorizedBdAddress);
@@ -109,6 +126,52 @@ static DX_DEVICE_TWIN_HANDLER(enableOnboardingDTFunction, deviceTwinBinding)
 DX_DEVICE_TWIN_HANDLER_END
 
 
+// Comma separated MACs of devices that are expected nearby but have no telemetry slot, they are
+// not reported as unauthorized
+static DX_DEVICE_TWIN_HANDLER(knownMacsDTFunction, deviceTwinBinding)
+{
+    const char *next = (const char *)deviceTwinBinding->propertyValue;
+    char address[RSL10_ADDRESS_LEN];
+    size_t invalid = 0;
+
+    rsl10AllowlistClearKnown();
+
+    while (next != NULL && *next != '\0') {
+        // Skip the separator and any spaces around the entry
+        while (*next == ',' || *next == ' ') {
+            next++;
+        }
+        size_t entryLen = strcspn(next, ", ");
+        if (entryLen == 0) {
+            break;
+        }
+
+        uint64_t addressKey;
+        if (entryLen != RSL10_ADDRESS_LEN - 1) {
+            invalid++;
+        } else {
+            memcpy(address, next, entryLen);
+            address[entryLen] = '\0';
+
+            // An address with a telemetry slot keeps it
+            if (!rsl10ParseAddressKey(address, &addressKey)) {
+                invalid++;
+            } else if (!rsl10AllowlistAdd(addressKey, RSL10_NO_DEVICE_INDEX)) {
+                Log_Debug("ERROR: allowlist is full, ignoring the rest of %s\n", deviceTwinBinding->propertyName);
+                break;
+            }
+        }
+        next += entryLen;
+    }
+
+    if (invalid > 0) {
+        Log_Debug("Ignored %zu invalid entries in %s\n", invalid, deviceTwinBinding->propertyName);
+    }
+    Log_Debug("Received device update. %zu addresses are allowed\n", rsl10AllowlistCount());
+    dx_deviceTwinReportValue(deviceTwinBinding, deviceTwinBinding->propertyValue);
+}
+DX_DEVICE_TWIN_HANDLER_END
+
 static DX_DEVICE_TWIN_HANDLER(telemetryTimerDTFunction, deviceTwinBinding)
 {
 
@@ -146,144 +209,157 @@ static DX_TIMER_HANDLER(send_telemetry_handler)
 }
 DX_TIMER_HANDLER_END
 
+// Summarize the unauthorized devices seen since the last summary
+static DX_TIMER_HANDLER(send_unauthorized_summary_handler)
+{
+    // Nothing is counted while onboarding is off, every device is accepted
+    if (!enableRSL10Onboarding) {
+        return;
+    }
+
+#ifdef USE_IOT_CONNECT
+    if(!dx_isAvnetConnected()){
+#else  // !IoT Connect 
+    if (!dx_isAzureConnected()) {
+#endif 
+        // Keep counting, the summary goes out with the next period
+        return;
+    }
+
+    rsl10SendUnauthorizedSummary();
+}
+DX_TIMER_HANDLER_END
+
 /// <summary>
 ///     Handle UART event: Read data from the PMOD
 /// </summary>
 static void uartEventHandler(DX_UART_BINDING *uartBinding)
 {
-    // Uncomment for circular queue debug
-//    #define ENABLE_UART_DEBUG
-
-#define RX_BUFFER_SIZE 512
-#define DATA_BUFFER_SIZE 512
-#define DATA_BUFFER_MASK (DATA_BUFFER_SIZE - 1)
-
     // Buffer for incomming data
-    uint8_t receiveBuffer[RX_BUFFER_SIZE];
-
-    // Buffer for persistant data.  Sometimes we don't receive all the
-    // data at once so we need to store it in a persistant buffer before processing.
-    static uint8_t dataBuffer[DATA_BUFFER_SIZE];
+    uint8_t receiveBuffer[RSL10_RX_BUFFER_SIZE];
 
-    // The index into the dataBuffer to write the next piece of RX data
-    static int nextData = 0;
+    // Read the uart
+    ssize_t bytesRead = dx_uartRead(uartBinding, receiveBuffer, RSL10_RX_BUFFER_SIZE);
 
-    // The index to the head of the valid/current data, this is the beginning
-    // of the next response
-    static int currentData = 0;
+    rsl10Receive(receiveBuffer, bytesRead);
+}
 
-    // The number of btyes in the dataBuffer, used to make sure we don't overflow the buffer
-    static int bytesInBuffer = 0;
+#ifdef ENABLE_RSL10_LOAD_GENERATOR
+static Rsl10LoadGen_t loadGenerator;
 
-    ssize_t bytesRead;
+// Milliseconds on a clock that does not jump when the system time is set
+static int64_t monotonicMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-    // Read the uart
-    bytesRead = dx_uartRead(uartBinding, receiveBuffer, RX_BUFFER_SIZE);
+// Counters at the last load generator report
+static struct {
+    int64_t timeMs;
+    uint64_t lines;
+    uint64_t malformed;
+    uint32_t decoded;
+    uint32_t discarded;
+    unsigned long purged;
+} lastLoadReport;
 
-#ifdef ENABLE_UART_DEBUG
-    Log_Debug("Enter: bytesInBuffer: %d\n", bytesInBuffer);
-    Log_Debug("Enter: bytesRead: %d\n", bytesRead);
-    Log_Debug("Enter: nextData: %d\n", nextData);
-    Log_Debug("Enter: currentData: %d\n", currentData);
-#endif
+// CPU time spent parsing generated lines since the last report
+static int64_t loadCpuNs = 0;
 
-    // Check to make sure we're not going to over run the buffer
-    if ((bytesInBuffer + bytesRead) > DATA_BUFFER_SIZE) {
+static int64_t threadCpuNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
 
-        // The buffer is full, attempt to recover by emptying the buffer!
-        Log_Debug("Buffer Full!  Purging\n");
+static void logLoadReport(int64_t nowMs)
+{
+    uint64_t lines = loadGenerator.lines - lastLoadReport.lines;
+    uint32_t decoded = rsl10MessagesDecoded - lastLoadReport.decoded;
+    uint32_t discarded = rsl10MessagesDiscarded - lastLoadReport.discarded;
+
+    // Lines that never reached the parser, lost in a purge or run into the line after them.
+    // A line split across two reports can make this one off either way.
+    int64_t dropped = (int64_t)lines - decoded - discarded;
+
+    Log_Debug("Load generator: %.0f lines/s, %llu sent (%llu malformed), %lu decoded, %lu discarded, "
+              "%lld dropped, %lu bytes purged, %.2f us CPU per line\n",
+              (double)lines * 1000.0 / (double)(nowMs - lastLoadReport.timeMs),
+              (unsigned long long)lines,
+              (unsigned long long)(loadGenerator.malformed - lastLoadReport.malformed),
+              (unsigned long)decoded, (unsigned long)discarded, (long long)dropped,
+              rsl10BytesPurged - lastLoadReport.purged,
+              lines == 0 ? 0.0 : (double)loadCpuNs / 1000.0 / (double)lines);
+
+    lastLoadReport.timeMs = nowMs;
+    lastLoadReport.lines = loadGenerator.lines;
+    lastLoadReport.malformed = loadGenerator.malformed;
+    lastLoadReport.decoded = rsl10MessagesDecoded;
+    lastLoadReport.discarded = rsl10MessagesDiscarded;
+    lastLoadReport.purged = rsl10BytesPurged;
+    loadCpuNs = 0;
+}
 
-        nextData = 0;
-        currentData = 0;
-        bytesInBuffer = 0;
-        return;
+/// <summary>
+///     Feed the lines that are due from the load generator through the UART receive path, as if
+///     the PMOD had sent them
+/// </summary>
+static DX_TIMER_HANDLER(load_generator_handler)
+{
+    static char stream[4096];
+    int64_t nowMs = monotonicMs();
+    size_t length = rsl10LoadGenFill(&loadGenerator, nowMs, stream, sizeof(stream));
+
+    int64_t cpuStart = threadCpuNs();
+
+    // Hand the stream over in reads of random size so messages are split across reads, as they
+    // are on the real UART
+    for (size_t offset = 0; offset < length;) {
+        size_t chunk = 1 + (size_t)rand() % RSL10_RX_BUFFER_SIZE;
+        if (chunk > length - offset) {
+            chunk = length - offset;
+        }
+        rsl10Receive((const uint8_t *)stream + offset, (ssize_t)chunk);
+        offset += chunk;
     }
 
-    // Move data from the receive Buffer into the Data Buffer.  We do this
-    // because sometimes we don't receive the entire message in one uart read.
-    for (int i = 0; i < bytesRead; i++) {
+    loadCpuNs += threadCpuNs() - cpuStart;
 
-        // Copy the data into the dataBuffer
-        dataBuffer[nextData] = receiveBuffer[i];
-#ifdef ENABLE_UART_DEBUG
-//        Log_Debug("dataBuffer[%d] = %c\n", nextData, receiveBuffer[i]);
-#endif
-        // Increment the bytes count
-        bytesInBuffer++;
-
-        // Increment the nextData pointer and adjust for wrap around
-        nextData = ((nextData + 1) & DATA_BUFFER_MASK);
+    if (nowMs - lastLoadReport.timeMs >= RSL10_LOADGEN_REPORT_SECONDS * 1000) {
+        logLoadReport(nowMs);
     }
+}
+DX_TIMER_HANDLER_END
 
-    // Check to see if we can find a response.  A response will end with a '\n' character
-    // Start looking at the beginning of the first non-processed message @ currentData
-
-    // Use a temp buffer pointer in case we don't find a message
-    int tempCurrentData = currentData;
-
-    // Iterate over the valid data from currentData to nextData locations in the buffer
-    while (tempCurrentData != nextData) {
-        if (dataBuffer[tempCurrentData] == '\n') {
-
-#ifdef ENABLE_UART_DEBUG
-            // Found a message from index currentData to tempNextData
-            Log_Debug("Found message from %d to %d\n", currentData, tempCurrentData);
-#endif
-            // Determine the size of the new message we just found, account for the case
-            // where the message wraps from the end of the buffer to the beginning
-            int responseMsgSize = 0;
-            if (currentData > tempCurrentData) {
-                responseMsgSize = (DATA_BUFFER_SIZE - currentData) + tempCurrentData;
-            } else {
-                responseMsgSize = tempCurrentData - currentData;
-            }
-
-            // Declare a new buffer to hold the response we just found
-            uint8_t responseMsg[responseMsgSize + 1];
-
-            // Copy the response from the buffer, do it one byte at a time
-            // since the message may wrap in the data buffer
-            for (int j = 0; j < responseMsgSize; j++) {
-                responseMsg[j] = dataBuffer[(currentData + j) & DATA_BUFFER_MASK];
-                bytesInBuffer--;
-            }
-
-            // Decrement the bytesInBuffer one more time to account for the '\n' charcter
-            bytesInBuffer--;
-
-            // Null terminate the message and print it out to debug
-            responseMsg[responseMsgSize] = '\0';
-#ifdef ENABLE_MSG_DEBUG            
-            Log_Debug("\nRX: %s\n", responseMsg);
-#endif 
-            // Call the routine that knows how to parse the response and send data to Azure
-            parseRsl10Message(responseMsg);
-
-            // Update the currentData index and adjust for the '\n' character
-            currentData = tempCurrentData + 1;
-            // Overwrite the '\n' character so we don't accidently find it and think
-            // we found a new mssage
-            dataBuffer[tempCurrentData] = '\0';
-        }
-
-        else if (tempCurrentData == nextData) {
+// Set up the load generator, from the trace in the image package if one is configured
+static void loadGeneratorInit(void)
+{
+    lastLoadReport.timeMs = monotonicMs();
 
-#ifdef ENABLE_UART_DEBUG
-            Log_Debug("No message found, exiting . . . \n");
-#endif
-            return;
-        }
+#ifdef RSL10_LOADGEN_REPLAY_FILE
+    int traceFd = Storage_OpenFileInImagePackage(RSL10_LOADGEN_REPLAY_FILE);
+    bool traceRead = traceFd >= 0 && rsl10LoadGenInitReplay(&loadGenerator, traceFd, lastLoadReport.timeMs);
 
-        // Increment the temp CurrentData pointer and let it wrap if needed
-        tempCurrentData = ((tempCurrentData + 1) & DATA_BUFFER_MASK);
+    if (traceFd >= 0) {
+        close(traceFd);
     }
-
-#ifdef ENABLE_UART_DEBUG
-    Log_Debug("Exit: nextData: %d\n", nextData);
-    Log_Debug("Exit: currentData: %d\n", currentData);
-    Log_Debug("Exit: bytesInBuffer: %d\n", bytesInBuffer);
-#endif
+    if (!traceRead) {
+        Log_Debug("ERROR: could not read a trace from %s\n", RSL10_LOADGEN_REPLAY_FILE);
+        dx_terminate(APP_ExitCode_LoadGen_Trace_Read);
+        return;
+    }
+    Log_Debug("Load generator replaying %s\n", RSL10_LOADGEN_REPLAY_FILE);
+#else
+    rsl10LoadGenInit(&loadGenerator, RSL10_LOADGEN_DEVICES, RSL10_LOADGEN_LINES_PER_SECOND,
+                     RSL10_LOADGEN_MALFORMED_PERCENT, lastLoadReport.timeMs);
+    Log_Debug("Load generator sending %d lines/s from %d devices, %d%% malformed\n",
+              RSL10_LOADGEN_LINES_PER_SECOND, RSL10_LOADGEN_DEVICES, RSL10_LOADGEN_MALFORMED_PERCENT);
+#endif // RSL10_LOADGEN_REPLAY_FILE
 }
+#endif // ENABLE_RSL10_LOAD_GENERATOR
 
 // Using the networkStatus value, turn on/off the connection status LEDs
 static void setConnectionStatusLed(RGB_Status newNetworkStatus)
@@ -341,6 +417,8 @@ DX_TIMER_HANDLER_END
 /// </summary>
 static void InitPeripheralsAndHandlers(void)
 {
+    // Handlers log through the writer thread, if it cannot start they log synchronously
+    async_log_init();
 
 #ifdef USE_WEB_PROXY
     // Configure and enable the web proxy feature
@@ -356,6 +434,11 @@ static void InitPeripheralsAndHandlers(void)
 #endif     
     
     dx_gpioSetOpen(gpio_bindings, NELEMS(gpio_bindings));
+
+#ifdef ENABLE_RSL10_LOAD_GENERATOR
+    loadGeneratorInit();
+#endif // ENABLE_RSL10_LOAD_GENERATOR
+
     dx_timerSetStart(timer_bindings, NELEMS(timer_bindings));
     dx_deviceTwinSubscribe(device_twin_bindings, NELEMS(device_twin_bindings));
     dx_directMethodSubscribe(direct_method_bindings, NELEMS(direct_method_bindings));
@@ -377,6 +460,10 @@ static void ClosePeripheralsAndHandlers(void)
     dx_uartSetClose(uart_bindings, NELEMS(uart_bindings));    
     dx_gpioSetClose(gpio_bindings, NELEMS(gpio_bindings));
     dx_timerEventLoopStop();
+#ifdef ENABLE_RSL10_LOAD_GENERATOR
+    rsl10LoadGenClose(&loadGenerator);
+#endif // ENABLE_RSL10_LOAD_GENERATOR
+    async_log_close();
 }
 
 int main(int argc, char *argv[])
@@ -1,6 +1,7 @@
 
 #include "hw/sample_appliance.h" // Hardware definition
 #include "app_exit_codes.h"
+#include "async_log.h"
 #include "dx_azure_iot.h"
 #include "dx_config.h"
 #include "dx_json_serializer.h"
@@ -13,6 +14,11 @@
 #include <applibs/log.h>
 #include <applibs/applications.h>
 #include "rsl10.h"
+#include "rsl10_loadgen.h"
+#include "rsl10_receive.h"
+#include <applibs/storage.h>
+#include <time.h>
+#include <unistd.h>
 #include "build_options.h"
 #ifdef USE_IOT_CONNECT
 #include "dx_avnet_iot_connect.h"
@@ -61,11 +67,16 @@ typedef enum {
 // Declare device twin handlers
 static DX_DECLARE_DEVICE_TWIN_HANDLER(rsl10AuthorizedDTFunction);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(enableOnboardingDTFunction);
+static DX_DECLARE_DEVICE_TWIN_HANDLER(knownMacsDTFunction);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(telemetryTimerDTFunction);
 
 // Declare timer handlers
 static DX_DECLARE_TIMER_HANDLER(send_telemetry_handler);
 static DX_DECLARE_TIMER_HANDLER(update_network_led_handler);
+static DX_DECLARE_TIMER_HANDLER(send_unauthorized_summary_handler);
+#ifdef ENABLE_RSL10_LOAD_GENERATOR
+static DX_DECLARE_TIMER_HANDLER(load_generator_handler);
+#endif // ENABLE_RSL10_LOAD_GENERATOR
 
 // Uart handler
 static void uartEventHandler(DX_UART_BINDING *uartBinding);
@@ -92,6 +103,10 @@ static DX_DEVICE_TWIN_BINDING dt_enable_onboarding_rsl10 = {.propertyName = "ena
                                                   .twinType = DX_DEVICE_TWIN_BOOL,
                                                   .handler = enableOnboardingDTFunction}; 
 
+static DX_DEVICE_TWIN_BINDING dt_known_macs = {.propertyName = "knownMacs",
+                                                  .twinType = DX_DEVICE_TWIN_STRING,
+                                                  .handler = knownMacsDTFunction}; 
+
 static DX_DEVICE_TWIN_BINDING dt_telemetry_polltime = {.propertyName = "telemetryPollPeriod",
                                                   .twinType = DX_DEVICE_TWIN_INT,
                                                   .handler = telemetryTimerDTFunction}; 
@@ -105,6 +120,16 @@ static DX_TIMER_BINDING tmr_update_network_led = {.period = {2, 0},
                                               .name = "tmr_send_telemetry", 
                                               .handler = update_network_led_handler};
 
+static DX_TIMER_BINDING tmr_send_unauthorized_summary = {.period = {UNAUTHORIZED_SUMMARY_PERIOD_SECONDS, 0}, 
+                                              .name = "tmr_send_unauthorized_summary", 
+                                              .handler = send_unauthorized_summary_handler};
+
+#ifdef ENABLE_RSL10_LOAD_GENERATOR
+static DX_TIMER_BINDING tmr_load_generator = {.period = {0, 10 * 1000 * 1000}, 
+                                              .name = "tmr_load_generator", 
+                                              .handler = load_generator_handler};
+#endif // ENABLE_RSL10_LOAD_GENERATOR
+
 /****************************************************************************************
  * UART Peripherals
  ****************************************************************************************/
@@ -141,8 +166,15 @@ static DX_GPIO_BINDING blue_led = {.pin = SAMPLE_RGBLED_BLUE,
 DX_DEVICE_TWIN_BINDING *device_twin_bindings[] = {&dt_inside_rsl10, 
                                                   &dt_outside_rsl10, 
                                                   &dt_enable_onboarding_rsl10 , 
+                                                  &dt_known_macs, 
                                                   &dt_telemetry_polltime};
 DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {};
 DX_GPIO_BINDING *gpio_bindings[] = {&red_led, &green_led, &blue_led};
-DX_TIMER_BINDING *timer_bindings[] = {&tmr_send_telemetry, &tmr_update_network_led};
-DX_UART_BINDING *uart_bindings[] = {&pmodUart};  
+#ifdef ENABLE_RSL10_LOAD_GENERATOR
+// The load generator stands in for the PMOD, so the two don't mix
+DX_TIMER_BINDING *timer_bindings[] = {&tmr_send_telemetry, &tmr_update_network_led, &tmr_send_unauthorized_summary, &tmr_load_generator};
+DX_UART_BINDING *uart_bindings[] = {};
+#else
+DX_TIMER_BINDING *timer_bindings[] = {&tmr_send_telemetry, &tmr_update_network_led, &tmr_send_unauthorized_summary};
+DX_UART_BINDING *uart_bindings[] = {&pmodUart};
+#endif // ENABLE_RSL10_LOAD_GENERATOR  
@@ -25,6 +25,7 @@ SOFTWARE.
 
 */
 #include "rsl10.h"
+#include <stdarg.h>
 
 /****************************************************************************************
  * Telemetry message buffer property sets
@@ -42,14 +43,15 @@ static DX_MESSAGE_PROPERTY *messageProperties[] = {&(DX_MESSAGE_PROPERTY){.key =
 
 static DX_MESSAGE_CONTENT_PROPERTIES contentProperties = {.contentEncoding = "utf-8", .contentType = "application/json"};
 
-// Forward declaration
-bool isValidMsgHeader(char* messageID);
-
 // Global variables
 RSL10Device_t Rsl10DeviceList[MAX_RSL10_DEVICES];
 int8_t currentRsl10DeviceIndex = -1;
 int8_t numRsl10DevicesInList = 0;
 
+// Messages decoded and discarded as malformed
+uint32_t rsl10MessagesDecoded = 0;
+uint32_t rsl10MessagesDiscarded = 0;
+
 // Flag to control how RSL10s are allowed to connect
 // enableRSL10Onboarding = false: The Authorized field is not consulted before adding device to active list
 // enableRSL10Onboarding = true:  Only Authorized RSL10 will be allowed to send temlemetry, as set by device twins
@@ -60,72 +62,84 @@ bool enableRSL10Onboarding = true;
 bool enableRSL10Onboarding = false;
 #endif 
 
+// Seconds on a clock that does not jump when the system time is set
+static int64_t monotonicSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec;
+}
+
 /// <summary>
-///     Function to parse UART Rx messages and update global structures
+///     Send the MAC of a device that is not authorized up as telemetry so an admin can authorize
+///     it. A device in range advertises several times a second, so each address is only sent once
+///     per RSL10_UNKNOWN_COOLDOWN_SECONDS and the rest of its adverts are counted for the
+///     periodic summary, see rsl10SendUnauthorizedSummary().
 /// </summary>
-/// <param name="msgToParse">The message received from the UART</param>
-void parseRsl10Message(char *msgToParse)
+static void reportUnauthorizedDevice(uint64_t addressKey, const char *bdAddress)
 {
+    int8_t deviceIndex;
 
-    char bdAddress[] = "  :  :  :  :  :  \0";
-    
-    #define MIN_RSL10_MSG_LENGTH 25
+    // Listed in knownMacs, allowed nearby but without a telemetry slot
+    if (rsl10AllowlistFind(addressKey, &deviceIndex)) {
+        return;
+    }
 
-    // Do a sanity check to make sure that the message is large enough to be a valid message.
-    // The battery message is the smallest message we expect, if this message is smaller than that,
-    // then exit without doing any processing.
-    if(strlen(msgToParse) < MIN_RSL10_MSG_LENGTH){
-        Log_Debug("RSL10 message is not valid, message length = %d, minimum valid length is %d.\n", strlen(msgToParse), MIN_RSL10_MSG_LENGTH);
+    if (!rsl10UnknownSeen(addressKey, monotonicSeconds())) {
         return;
     }
 
-    // Variable to hold the message identifier "ESD", "MSD" or "BAT"
-    char messageID[3];
+    ASYNC_LOG_WARNING("Device %s is not authorized, discarding message data\n", bdAddress);
+    ASYNC_LOG_WARNING("To onboard the device add it's MAC address to the insideMac or outsideMax device twin\n");
 
-    // Generic message pointer for message ID and BdAddress
-    RSL10MessageHeader_t *msgPtr;
-    msgPtr = (RSL10MessageHeader_t*)msgToParse;
+    // Allocate a buffer to send the telemetry
+    char telemetryBuffer[128];
 
-    // Index into device list for this message, set to invalid
-    int8_t  Rsl10Index = -1;
+    // Define the Json string format for movement messages, the
+    // actual telemetry data is inserted as the last string argument
+    static const char Rsl10UnauthorizedTelemetryJson[] = "{\"unauthorizedMac\":\"%s\"}";
 
-    // Pull the RSL10 ID from the message
-    getBdMessageID(messageID, msgPtr);
+    snprintf(telemetryBuffer, sizeof(telemetryBuffer), Rsl10UnauthorizedTelemetryJson, bdAddress);
+    // Send the telemetry message
+    dx_azurePublish(telemetryBuffer, strnlen(telemetryBuffer, JSON_BUFFER_SIZE),
+                            messageProperties, NELEMS(messageProperties),
+                            &contentProperties);
+}
 
-    // If the message does not have one of the expected message IDs, then discard it
-    if(!isValidMsgHeader(messageID)){
+/// <summary>
+///     Function to parse UART Rx messages and update global structures
+/// </summary>
+/// <param name="msgToParse">The message received from the UART</param>
+void parseRsl10Message(char *msgToParse)
+{
+    char bdAddress[RSL10_ADDRESS_TEXT_LEN];
+    Rsl10Advert_t advert;
+
+    // Decode and validate the whole message up front, anything malformed is discarded here
+    Rsl10DecodeResult_t result = rsl10DecodeAdvert(msgToParse, strlen(msgToParse), &advert);
+    if (result != RSL10_DECODE_OK) {
+        ASYNC_LOG_DEBUG("RSL10 message discarded, %s\n", rsl10DecodeResultText(result));
+        rsl10MessagesDiscarded++;
         return;
     }
+    rsl10MessagesDecoded++;
+
+    rsl10FormatAddress(advert.address, bdAddress);
 
-    // Pull the RSL10 address from the message
-    getBdAddress(bdAddress, msgPtr);
+    uint64_t addressKey = rsl10AddressKey(advert.address);
+
+    // Index into device list for this message, set to invalid
+    int8_t  Rsl10Index = -1;
 
     // Check to see if this devcice's MAC address has been white listed
     // if the call returns -1, then either the device is not authorized, or
     // the list is full.
-    Rsl10Index = getDeviceIndex(bdAddress);
+    Rsl10Index = getDeviceIndex(bdAddress, addressKey);
 
     if( Rsl10Index == -1){
 
         if(enableRSL10Onboarding){
-            Log_Debug("Device %s is not authorized, discarding message data\n", bdAddress);
-            Log_Debug("To onboard the device add it's MAC address to the insideMac or outsideMax device twin\n");
-
-            // Send the unauthorized MAC up as telemetry so an admin can authorize the sensor
-
-            // Allocate a buffer to send the telemetry
-            char telemetryBuffer[128];
-
-            // Define the Json string format for movement messages, the
-            // actual telemetry data is inserted as the last string argument
-            static const char Rsl10UnauthorizedTelemetryJson[] = "{\"unauthorizedMac\":\"%s\"}";
-
-            snprintf(telemetryBuffer, sizeof(telemetryBuffer), Rsl10UnauthorizedTelemetryJson, bdAddress);
-            // Send the telemetry message
-            dx_azurePublish(telemetryBuffer, strnlen(telemetryBuffer, JSON_BUFFER_SIZE),
-                                    messageProperties, NELEMS(messageProperties),
-                                    &contentProperties);
-
+            reportUnauthorizedDevice(addressKey, bdAddress);
         }
         return;
         
@@ -150,259 +164,124 @@ void parseRsl10Message(char *msgToParse)
     // Next determine which message we received and call the appropriate rouitine to pull data 
     // from the message and copy that data to this RSL10's data structure
     
-    // Is this a Movement message?
-    if (strcmp(messageID, "MSD") == 0) {
-        rsl10ProcessMovementMessage(msgToParse, Rsl10Index);
-    } 
-
-    // Is this a Environmental message?
-    else if (strcmp(messageID, "ESD") == 0) {
-        rsl10ProcessEnvironmentalMessage(msgToParse, Rsl10Index);
-    }
-
-    // Is this a Battery message?
-    else if (strcmp(messageID, "BAT") == 0) {
-        rsl10ProcessBatteryMessage(msgToParse, Rsl10Index);
-    }
-
-    else{
-        Log_Debug("Unknown message ID\n");
+    switch (advert.type) {
+    case RSL10_MSG_MOTION:
+        rsl10ProcessMovementMessage(&advert, Rsl10Index);
+        break;
+    case RSL10_MSG_ENVIRONMENTAL:
+        rsl10ProcessEnvironmentalMessage(&advert, Rsl10Index);
+        break;
+    case RSL10_MSG_BATTERY:
+        rsl10ProcessBatteryMessage(&advert, Rsl10Index);
+        break;
     }
-    return;
-}
-
-// Worker routine to convert a string to an integer
-int stringToInt(char *stringData, size_t stringLength)
-{
-
-    char tempString[64];
-    strncpy(tempString, stringData, stringLength);
-    tempString[stringLength] = '\0';
-    return (int)(strtol(tempString, NULL, 16));
 }
 
-// Worker routine to convert hex data to it's string representation
-void textFromHexString(char *hex, char *result, int strLength)
+#ifdef SEND_RSL10_TELEMETRY_STATS
+// Add a reading to the statistics of the current telemetry period
+static void statAdd(Rsl10Stat_t *stat, float value)
 {
-    char temp[3];
-
-    temp[2] = '\0';
-    for (int i = 0; i < strLength; i += 2) {
-        strncpy(temp, &hex[i], 2);
-        *result = (char)strtol(temp, NULL, 16);
-        result++;
+    if (stat->count == 0 || value < stat->min) {
+        stat->min = value;
     }
-    *result = '\0';
+    if (stat->count == 0 || value > stat->max) {
+        stat->max = value;
+    }
+    stat->sum += value;
+    stat->count++;
 }
+#endif // SEND_RSL10_TELEMETRY_STATS
 
 // Process a RSL10 Movement message
-void rsl10ProcessMovementMessage(char* rxMessage, int8_t currentRsl10DeviceIndex)
+void rsl10ProcessMovementMessage(const Rsl10Advert_t *advert, int8_t currentRsl10DeviceIndex)
 {
+    #define RAW_TO_MPS_SQUARED 32768*9.81f
+    #define MPS_SQUARED_TO_G 0.102f
+    #define ORIENTATION_DIVISOR 128.0f
 
-    // Cast the pointer to reference this messages data structure
-    Rsl10MotionMessage_t* msgPtr = (Rsl10MotionMessage_t*) rxMessage;
+    RSL10Device_t *device = &Rsl10DeviceList[currentRsl10DeviceIndex];
 
-    // Call the routines to pull the data from the message.  This devices global structure is updated
-    // by each routine.
-    getRxRssi(&Rsl10DeviceList[currentRsl10DeviceIndex].lastRssi, &msgPtr->rssi[0]); 
-    getSensorSettings(&Rsl10DeviceList[currentRsl10DeviceIndex], msgPtr);
-    getAccelReadings(&Rsl10DeviceList[currentRsl10DeviceIndex], msgPtr);
-    getOrientation(&Rsl10DeviceList[currentRsl10DeviceIndex], msgPtr);
+    device->lastRssi = advert->rssi;
+    device->lastSampleIndex = advert->motion.sampleIndex;
 
-    // Set the flag so we know that we have fresh data to send to IoTConnect
-    Rsl10DeviceList[currentRsl10DeviceIndex].movementDataRefreshed = true;
-
-#ifdef ENABLE_MSG_DEBUG
-    Log_Debug("Rssi: %d\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastRssi);
-    Log_Debug("accel: %.4f, %.4f, %.4f\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastAccel_raw_x, 
-                                        Rsl10DeviceList[currentRsl10DeviceIndex].lastAccel_raw_y, 
-                                        Rsl10DeviceList[currentRsl10DeviceIndex].lastAccel_raw_z);
-    Log_Debug("Orientation: %.4f, %.4f, %.4f, %.4f\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastOrientation_x, 
-                                                       Rsl10DeviceList[currentRsl10DeviceIndex].lastOrientation_y,      
-                                                       Rsl10DeviceList[currentRsl10DeviceIndex].lastOrientation_z,      
-                                                       Rsl10DeviceList[currentRsl10DeviceIndex].lastOrientation_w);      
-#endif 
-}
+    // Sample rate, accelerometer range and data type are packed in the sensor setting byte
+    device->lastsampleRate = advert->motion.sensorSetting >> 4 & 0x0F;
+    device->lastAccelRange = advert->motion.sensorSetting >> 2 & 0x03;
+    device->lastDataType = advert->motion.sensorSetting & 0x03;
 
-// Process a RSL10 Environmental message
-void rsl10ProcessEnvironmentalMessage(char* rxMessage, int8_t currentRsl10DeviceIndex)
-{
+    float accelScale = (float)(device->lastAccelRange * 4) * MPS_SQUARED_TO_G;
+    device->lastAccel_raw_x = (float)advert->motion.accel[0] / RAW_TO_MPS_SQUARED * accelScale;
+    device->lastAccel_raw_y = (float)advert->motion.accel[1] / RAW_TO_MPS_SQUARED * accelScale;
+    device->lastAccel_raw_z = (float)advert->motion.accel[2] / RAW_TO_MPS_SQUARED * accelScale;
 
-    // Cast the pointer to reference this messages data structure
-    Rsl10EnvironmentalMessage_t* msgPtr = (Rsl10EnvironmentalMessage_t*) rxMessage;
+    device->lastOrientation_x = (float)advert->motion.orientation[0] / ORIENTATION_DIVISOR;
+    device->lastOrientation_y = (float)advert->motion.orientation[1] / ORIENTATION_DIVISOR;
+    device->lastOrientation_z = (float)advert->motion.orientation[2] / ORIENTATION_DIVISOR;
+    device->lastOrientation_w = (float)advert->motion.orientation[3] / ORIENTATION_DIVISOR;
 
-    // Call the routines to pull the data from the message.  This devices global structure is updated
-    // by each routine.
-    getRxRssi(&Rsl10DeviceList[currentRsl10DeviceIndex].lastRssi, msgPtr->rssi);
-    getTemperature(&Rsl10DeviceList[currentRsl10DeviceIndex].lastTemperature, msgPtr);
-    getHumidity(&Rsl10DeviceList[currentRsl10DeviceIndex].lastHumidity, msgPtr);
-    getPressure(&Rsl10DeviceList[currentRsl10DeviceIndex].lastPressure, msgPtr);
-    getAmbiantLight(&Rsl10DeviceList[currentRsl10DeviceIndex].lastAmbiantLight, msgPtr);
+#ifdef SEND_RSL10_TELEMETRY_STATS
+    statAdd(&device->rssiStats, device->lastRssi);
+#endif
 
     // Set the flag so we know that we have fresh data to send to IoTConnect
-    Rsl10DeviceList[currentRsl10DeviceIndex].environmentalDataRefreshed = true;
-
-#ifdef ENABLE_MSG_DEBUG
-            Log_Debug("RX rssi    : %d\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastRssi);
-            Log_Debug("Temperature: %.2f\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastTemperature);
-            Log_Debug("Humidity   : %.2f\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastHumidity);
-            Log_Debug("Pressure   : %.2f\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastPressure);
-#endif 
+    device->movementDataRefreshed = true;
 
+    ASYNC_LOG_TRACE("Rssi: %d\n", device->lastRssi);
+    ASYNC_LOG_TRACE("accel: %.4f, %.4f, %.4f\n", device->lastAccel_raw_x, device->lastAccel_raw_y,
+                    device->lastAccel_raw_z);
+    ASYNC_LOG_TRACE("Orientation: %.4f, %.4f, %.4f, %.4f\n", device->lastOrientation_x,
+                    device->lastOrientation_y, device->lastOrientation_z, device->lastOrientation_w);
 }
 
-// Process a RSL10 Battery message
-void rsl10ProcessBatteryMessage(char* rxMessage, int8_t currentRsl10DeviceIndex)
+// Process a RSL10 Environmental message
+void rsl10ProcessEnvironmentalMessage(const Rsl10Advert_t *advert, int8_t currentRsl10DeviceIndex)
 {
+    RSL10Device_t *device = &Rsl10DeviceList[currentRsl10DeviceIndex];
 
-    // Cast the pointer to reference this messages data structure
-    Rsl10BatteryMessage_t* msgPtr = (Rsl10BatteryMessage_t*) rxMessage;
-
-    // Call the routines to pull the data from the message.  This devices global structure is updated
-    // by each routine.
-    getRxRssi(&Rsl10DeviceList[currentRsl10DeviceIndex].lastRssi, &msgPtr->rssi[0]);
-    getBattery(&Rsl10DeviceList[currentRsl10DeviceIndex].lastBattery, msgPtr);
-
-    // Set the flag so we know that we have fresh data to send to IoTConnect
-    Rsl10DeviceList[currentRsl10DeviceIndex].batteryDataRefreshed = true;
-
-
-#ifdef ENABLE_MSG_DEBUG
-    Log_Debug("RX rssi    : %d\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastRssi);
-    Log_Debug("Battery    : %.2f V\n", Rsl10DeviceList[currentRsl10DeviceIndex].lastBattery);
-#endif 
-}
+    device->lastRssi = advert->rssi;
+    device->lastTemperature = (float)(advert->environmental.temperature / 100.0);
+    device->lastHumidity = (float)(advert->environmental.humidity / 100.0);
+    device->lastPressure = (float)(advert->environmental.pressure / 100.0);
 
+    // The device will send 0xFFFF if it does not have the ambiant light sensor, report 0
+    device->lastAmbiantLight =
+        advert->environmental.ambientLight == 0xFFFF ? 0 : advert->environmental.ambientLight;
 
-void getBdMessageID(char *messageID, RSL10MessageHeader_t *rxMessage){
+#ifdef SEND_RSL10_TELEMETRY_STATS
+    statAdd(&device->rssiStats, device->lastRssi);
+    statAdd(&device->temperatureStats, device->lastTemperature);
+    statAdd(&device->humidityStats, device->lastHumidity);
+    statAdd(&device->pressureStats, device->lastPressure);
+#endif
 
-    messageID[0] = rxMessage->msgSendRxId[0];
-    messageID[1] = rxMessage->msgSendRxId[1];
-    messageID[2] = rxMessage->msgSendRxId[2];
-    messageID[3] = '\0';
-}
+    // Set the flag so we know that we have fresh data to send to IoTConnect
+    device->environmentalDataRefreshed = true;
 
-// Set the global RSL10 address variable
-void getBdAddress(char *bdAddress, RSL10MessageHeader_t *rxMessage)
-{
-    bdAddress[0] = rxMessage->BdAddress[10];
-    bdAddress[1] = rxMessage->BdAddress[11];
-    bdAddress[3] = rxMessage->BdAddress[8];
-    bdAddress[4] = rxMessage->BdAddress[9];
-    bdAddress[6] = rxMessage->BdAddress[6];
-    bdAddress[7] = rxMessage->BdAddress[7];
-    bdAddress[9] = rxMessage->BdAddress[4];
-    bdAddress[10] = rxMessage->BdAddress[5];
-    bdAddress[12] = rxMessage->BdAddress[2];
-    bdAddress[13] = rxMessage->BdAddress[3];
-    bdAddress[15] = rxMessage->BdAddress[0];
-    bdAddress[16] = rxMessage->BdAddress[1];
+    ASYNC_LOG_TRACE("RX rssi    : %d\n", device->lastRssi);
+    ASYNC_LOG_TRACE("Temperature: %.2f\n", device->lastTemperature);
+    ASYNC_LOG_TRACE("Humidity   : %.2f\n", device->lastHumidity);
+    ASYNC_LOG_TRACE("Pressure   : %.2f\n", device->lastPressure);
 }
 
-// Set the global rssi variable from the end of the message
-void getRxRssi(int16_t* rssiVariable, char *rxMessage)
+// Process a RSL10 Battery message
+void rsl10ProcessBatteryMessage(const Rsl10Advert_t *advert, int8_t currentRsl10DeviceIndex)
 {
-    char tempRssi[3];
-    tempRssi[0] = rxMessage[0];
-    tempRssi[1] = rxMessage[1];
-    tempRssi[2] = rxMessage[2];
-    *rssiVariable  = (int16_t)atoi(tempRssi);
-}
-
-void getTemperature(float *temperature, Rsl10EnvironmentalMessage_t *rxMessage){
-
-    uint16_t temp =  (uint16_t)((stringToInt(&rxMessage->temperature[2], 2) << 8) |
-                                (stringToInt(&rxMessage->temperature[0], 2) << 0));
-    *temperature = (float)(temp / 100.0);
-    return;
-}
-
-void getHumidity(float *humidity, Rsl10EnvironmentalMessage_t *rxMessage){
-
-    uint16_t temp =  (uint16_t)((stringToInt(&rxMessage->humidity[2], 2) << 8) |
-                                (stringToInt(&rxMessage->humidity[0], 2) << 0));
-    *humidity = (float)(temp / 100.0);
-
-    return;
-}
-void getPressure(float *pressure, Rsl10EnvironmentalMessage_t *rxMessage){
-    
-    uint32_t temp =  (uint32_t)((stringToInt(&rxMessage->pressure[4], 2) << 16) |
-                                (stringToInt(&rxMessage->pressure[2], 2) << 8) |
-                                (stringToInt(&rxMessage->pressure[0], 2) << 0));
-    *pressure = (float)(temp / 100.0);
-    return;
-
-}
-void getAmbiantLight(uint16_t *ambiantLight, Rsl10EnvironmentalMessage_t *rxMessage){
-
-    uint16_t temp =  (uint16_t)((stringToInt(&rxMessage->ambiantLight[2], 2) << 8) |
-                                (stringToInt(&rxMessage->ambiantLight[0], 2) << 0));
-
-    // Check to see if the current RLS10 device supports the ambian light sensor
-    // The device will send 0xFFFF (65535) if the sensor is not supported.  In this case
-    // just return 0.
-    if(temp == 65535){
-        *ambiantLight = 0;
-    }
-    else{
-    *ambiantLight = temp;
-    }
-
-    return;
-}
-
-void getBattery(float *battery, Rsl10BatteryMessage_t *rxMessage){
-
-    // Read the voltage level and covert it to Volts
-    *battery =  (float)(((stringToInt(&rxMessage->battery[0], 2) << 8) |
-                        (stringToInt(&rxMessage->battery[2], 2) << 0)))/1000;
-}
-
-void getSensorSettings(RSL10Device_t* currentDevPtr, Rsl10MotionMessage_t* rxMessage){
-
-    uint8_t sensorSettings = 0;
-    sensorSettings = (uint8_t)stringToInt((char*)&rxMessage->SensorSetting, 2);
-    currentDevPtr->lastsampleRate = sensorSettings >> 4 & 0x0F;
-    currentDevPtr->lastAccelRange = sensorSettings >> 2 & 0x03;
-    currentDevPtr->lastDataType = sensorSettings & 0x03;
-}
+    RSL10Device_t *device = &Rsl10DeviceList[currentRsl10DeviceIndex];
 
-void getAccelReadings(RSL10Device_t* currentDevPtr, Rsl10MotionMessage_t* rxMessage){
+    device->lastRssi = advert->rssi;
 
-    #define RAW_TO_MPS_SQUARED 32768*9.81f
-    #define MPS_SQUARED_TO_G 0.102f
-
-    int16_t rawAccel;
-
-    // Read and calculate the x component
-    rawAccel =  (int16_t)(stringToInt(&rxMessage->accel_raw_x[2], 2) << 8) | (int16_t)(stringToInt(&rxMessage->accel_raw_x[0], 2) << 0);
-    currentDevPtr->lastAccel_raw_x = (float)rawAccel/RAW_TO_MPS_SQUARED*(float)(currentDevPtr->lastAccelRange*4)*MPS_SQUARED_TO_G;
-
-    // Read and calculate the y component
-    rawAccel =  (int16_t)(stringToInt(&rxMessage->accel_raw_y[2], 2) << 8) | (int16_t)(stringToInt(&rxMessage->accel_raw_y[0], 2) << 0);
-    currentDevPtr->lastAccel_raw_y = (float)rawAccel/RAW_TO_MPS_SQUARED*(float)(currentDevPtr->lastAccelRange*4)*MPS_SQUARED_TO_G;
-
-    // Read and calculate the z component
-    rawAccel =  (int16_t)(stringToInt(&rxMessage->accel_raw_z[2], 2) << 8) | (int16_t)(stringToInt(&rxMessage->accel_raw_z[0], 2) << 0);
-    currentDevPtr->lastAccel_raw_z = (float)rawAccel/RAW_TO_MPS_SQUARED*(float)(currentDevPtr->lastAccelRange*4)*MPS_SQUARED_TO_G;
-}
-
-void getOrientation(RSL10Device_t* currentDevPtr, Rsl10MotionMessage_t* rxMessage){
-
-    #define ORIENTATION_DIVISOR 128.0f
-
-    // Read and calculate the x component
-    currentDevPtr->lastOrientation_x = (float)((int8_t)(stringToInt(&rxMessage->orientation_x[0], 2) << 0))/ORIENTATION_DIVISOR;
+    // Convert the battery level to Volts
+    device->lastBattery = (float)advert->battery.millivolts / 1000;
 
-    // Read and calculate the y component
-    currentDevPtr->lastOrientation_y = (float)((int8_t)(stringToInt(&rxMessage->orientation_y[0], 2) << 0))/ORIENTATION_DIVISOR;
+#ifdef SEND_RSL10_TELEMETRY_STATS
+    statAdd(&device->rssiStats, device->lastRssi);
+#endif
 
-    // Read and calculate the z component
-    currentDevPtr->lastOrientation_z = (float)((int8_t)(stringToInt(&rxMessage->orientation_z[0], 2) << 0))/ORIENTATION_DIVISOR;
+    // Set the flag so we know that we have fresh data to send to IoTConnect
+    device->batteryDataRefreshed = true;
 
-    // Read and calculate the z component
-    currentDevPtr->lastOrientation_w = (float)((int8_t)(stringToInt(&rxMessage->orientation_w[0], 2) << 0))/ORIENTATION_DIVISOR;
+    ASYNC_LOG_TRACE("RX rssi    : %d\n", device->lastRssi);
+    ASYNC_LOG_TRACE("Battery    : %.2f V\n", device->lastBattery);
 }
 
 bool addRsl10DeviceToList(char *newRsl10Address, int8_t currentIndex)
@@ -432,17 +311,16 @@ bool addRsl10DeviceToList(char *newRsl10Address, int8_t currentIndex)
 }
 
 // Check to see if the devices MAC has been authorized
-int8_t getDeviceIndex(char* deviceToCheck){
+int8_t getDeviceIndex(char* deviceToCheck, uint64_t addressKey){
 
     int8_t i;
     // Check to see which mode we're in
     if(enableRSL10Onboarding){
 
-        // Search the lsit for this MAC in the authorized field
-        for(i = 0; i < MAX_RSL10_DEVICES; i++){
-            if(strncmp((char*)Rsl10DeviceList[i].authorizedBdAddress, deviceToCheck, RSL10_ADDRESS_LEN) == 0){
-                return i;
-            }
+        // The authorized addresses are kept in the allowlist with their index, known devices
+        // without a slot come back as RSL10_NO_DEVICE_INDEX
+        if(rsl10AllowlistFind(addressKey, &i)){
+            return i;
         }
     }
     else{
@@ -467,12 +345,195 @@ int8_t getDeviceIndex(char* deviceToCheck){
     return -1;
 }    
 
+// Send a JSON telemetry message
+static void publishTelemetry(char *json, size_t length)
+{
+    Log_Debug("Send telemetry: %s\n", json);
+
+#ifdef USE_IOT_CONNECT
+
+    dx_avnetPublish(json, length, messageProperties, NELEMS(messageProperties), &contentProperties, NULL);
+
+#else // !USE_IOT_CONNECT
+
+    dx_azurePublish(json, length, messageProperties, NELEMS(messageProperties), &contentProperties);
+
+#endif
+}
+
+#ifdef SEND_RSL10_AGGREGATED_TELEMETRY
+
+// Largest aggregated message. IoT Hub meters messages in 4 KB blocks.
+#define AGGREGATED_BUFFER_SIZE 4096
+
+// Largest entry for one device, all data types and statistics included
+#define AGGREGATED_DEVICE_SIZE 640
+
+static const char aggregatedHeader[] = "{\"rsl10Devices\":[";
+static const char aggregatedFooter[] = "]}";
+
+// snprintf onto the end of buffer. Once something does not fit *len is left at or past size.
+static void appendJson(char *buffer, size_t size, size_t *len, const char *format, ...)
+{
+    if (*len >= size) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + *len, size - *len, format, args);
+    va_end(args);
+
+    *len += written < 0 ? size : (size_t)written;
+}
+
+#ifdef SEND_RSL10_TELEMETRY_STATS
+// "name":[min,max,avg], nothing when there were no readings
+static void appendStat(char *buffer, size_t size, size_t *len, const char *name, const Rsl10Stat_t *stat)
+{
+    if (stat->count == 0) {
+        return;
+    }
+    appendJson(buffer, size, len, "\"%s\":[%0.2f,%0.2f,%0.2f],", name, stat->min, stat->max,
+               stat->sum / stat->count);
+}
+#endif // SEND_RSL10_TELEMETRY_STATS
+
+/// <summary>
+///     Format the fresh data of one device as a JSON object and clear its refreshed flags
+/// </summary>
+/// <returns>Length of the object, 0 when the device has no fresh data</returns>
+static size_t formatAggregatedDevice(RSL10Device_t *device, char *buffer, size_t size)
+{
+    size_t len = 0;
+    bool fresh = false;
+
+    appendJson(buffer, size, &len, "{\"device\":\"%s\",\"address\":\"%s\",\"rssi\":%d",
+               device->telemetryKey, device->bdAddress, device->lastRssi);
+
+#ifdef SEND_RSL10_MOTION_DATA
+    if (device->movementDataRefreshed) {
+        appendJson(buffer, size, &len,
+                   ",\"acc\":[%0.4f,%0.4f,%0.4f],\"orient\":[%0.4f,%0.4f,%0.4f,%0.4f]",
+                   device->lastAccel_raw_x, device->lastAccel_raw_y, device->lastAccel_raw_z,
+                   device->lastOrientation_x, device->lastOrientation_y, device->lastOrientation_z,
+                   device->lastOrientation_w);
+        device->movementDataRefreshed = false;
+        fresh = true;
+    }
+#endif // SEND_RSL10_MOTION_DATA
+#ifdef SEND_RSL10_TEMP_HUMIDITY_DATA
+    if (device->environmentalDataRefreshed) {
+        appendJson(buffer, size, &len, ",\"temp\":%0.2f,\"humidity\":%0.2f,\"pressure\":%0.2f",
+                   device->lastTemperature, device->lastHumidity, device->lastPressure);
+        device->environmentalDataRefreshed = false;
+        fresh = true;
+    }
+#endif // SEND_RSL10_TEMP_HUMIDITY_DATA
+#ifdef SEND_RSL10_BATTERY_DATA
+    if (device->batteryDataRefreshed) {
+        appendJson(buffer, size, &len, ",\"bat\":%0.2f", device->lastBattery);
+        device->batteryDataRefreshed = false;
+        fresh = true;
+    }
+#endif // SEND_RSL10_BATTERY_DATA
+
+#ifdef SEND_RSL10_TELEMETRY_STATS
+    if (device->rssiStats.count > 0) {
+        appendJson(buffer, size, &len, ",\"stats\":{\"samples\":%lu,", (unsigned long)device->rssiStats.count);
+        appendStat(buffer, size, &len, "rssi", &device->rssiStats);
+        appendStat(buffer, size, &len, "temp", &device->temperatureStats);
+        appendStat(buffer, size, &len, "humidity", &device->humidityStats);
+        appendStat(buffer, size, &len, "pressure", &device->pressureStats);
+
+        // Replace the trailing ',' of the last entry
+        if (len < size) {
+            len--;
+        }
+        appendJson(buffer, size, &len, "}");
+    }
+
+    // Start the next period
+    memset(&device->rssiStats, 0, sizeof(device->rssiStats));
+    memset(&device->temperatureStats, 0, sizeof(device->temperatureStats));
+    memset(&device->humidityStats, 0, sizeof(device->humidityStats));
+    memset(&device->pressureStats, 0, sizeof(device->pressureStats));
+#endif // SEND_RSL10_TELEMETRY_STATS
+
+    appendJson(buffer, size, &len, "}");
+
+    if (!fresh) {
+        return 0;
+    }
+    if (len >= size) {
+        Log_Debug("ERROR: telemetry for %s does not fit, discarding it\n", device->bdAddress);
+        return 0;
+    }
+    return len;
+}
+
+/// <summary>
+///     Send the fresh data of every active device as one "rsl10Devices" array. Devices are
+///     added until the next one would take the message past AGGREGATED_BUFFER_SIZE, the rest
+///     go in further messages.
+/// </summary>
+static void sendAggregatedTelemetry(void)
+{
+    static char aggregatedBuffer[AGGREGATED_BUFFER_SIZE];
+    char deviceBuffer[AGGREGATED_DEVICE_SIZE];
+    size_t devicesInMessage = 0;
+    size_t len = 0;
+
+    for (int currentDevice = 0; currentDevice < MAX_RSL10_DEVICES; currentDevice++) {
+
+        if (!Rsl10DeviceList[currentDevice].isActive) {
+            continue;
+        }
+
+        size_t deviceLen = formatAggregatedDevice(&Rsl10DeviceList[currentDevice], deviceBuffer, sizeof(deviceBuffer));
+        if (deviceLen == 0) {
+            continue;
+        }
+
+        // Send what we have if this device, its separator and the footer do not fit
+        if (devicesInMessage > 0 &&
+            len + 1 + deviceLen + sizeof(aggregatedFooter) > sizeof(aggregatedBuffer)) {
+            memcpy(aggregatedBuffer + len, aggregatedFooter, sizeof(aggregatedFooter));
+            publishTelemetry(aggregatedBuffer, len + sizeof(aggregatedFooter) - 1);
+            devicesInMessage = 0;
+        }
+
+        if (devicesInMessage == 0) {
+            memcpy(aggregatedBuffer, aggregatedHeader, sizeof(aggregatedHeader) - 1);
+            len = sizeof(aggregatedHeader) - 1;
+        } else {
+            aggregatedBuffer[len++] = ',';
+        }
+
+        memcpy(aggregatedBuffer + len, deviceBuffer, deviceLen);
+        len += deviceLen;
+        devicesInMessage++;
+    }
+
+    if (devicesInMessage > 0) {
+        memcpy(aggregatedBuffer + len, aggregatedFooter, sizeof(aggregatedFooter));
+        publishTelemetry(aggregatedBuffer, len + sizeof(aggregatedFooter) - 1);
+    }
+}
+
+#endif // SEND_RSL10_AGGREGATED_TELEMETRY
+
 void rsl10SendTelemetry(void) {
 
     // Set the telemetry keys    
     strncpy(Rsl10DeviceList[0].telemetryKey, "InsideDevice", 15);
     strncpy(Rsl10DeviceList[1].telemetryKey, "OutsideDevice", 15);
 
+#ifdef SEND_RSL10_AGGREGATED_TELEMETRY
+    sendAggregatedTelemetry();
+    return;
+#endif // SEND_RSL10_AGGREGATED_TELEMETRY
+
     // Iterate over the device list and if active send telemetry
     for(int currentDevice = 0; currentDevice < MAX_RSL10_DEVICES; currentDevice++){
 
@@ -596,16 +657,19 @@ void rsl10SendTelemetry(void) {
     }
 }
 
-bool isValidMsgHeader(char* messageID){
+/// <summary>
+///     Send one message summarizing the unauthorized devices seen since the last summary,
+///     nothing when there were none.
+/// </summary>
+void rsl10SendUnauthorizedSummary(void) {
 
-    if(strncmp(messageID, "MSD", 3)== 0){
-        return true;
-    }
-    else if(strncmp(messageID, "BAT", 3) == 0){
-        return true;
-    }
-    else if(strncmp(messageID, "ESD", 3) == 0){
-        return true;
+    // Up to RSL10_UNKNOWN_SUMMARY_DEVICES entries of at most 67 bytes each and the counts
+    static char summaryBuffer[1280];
+
+    size_t summaryLength = rsl10UnknownSummary(summaryBuffer, sizeof(summaryBuffer));
+    if (summaryLength == 0) {
+        return;
     }
-    return false;
-}
\ No newline at end of file
+
+    publishTelemetry(summaryBuffer, summaryLength);
+}
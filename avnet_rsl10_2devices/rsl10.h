@@ -38,7 +38,11 @@ This file implements routines requied to parse RSL10 advertisement messages rece
 #include "signal.h"
 #include "dx_azure_iot.h"
 #include "build_options.h"
+#include "async_log.h"
+#include "rsl10_decode.h"
+#include "rsl10_onboarding.h"
 #include "math.h"
+#include <time.h>
 
 // Send the telemetry message
 #ifdef USE_IOT_CONNECT
@@ -49,14 +53,16 @@ This file implements routines requied to parse RSL10 advertisement messages rece
 // Enable this define to send test messages to the parser from main.c line ~1190
 //#define ENABLE_MESSAGE_TESTING
 
-// Enable this define to see more debug around the message parsing
-//#define ENABLE_MSG_DEBUG
+// Debug around the message parsing is logged with ASYNC_LOG_TRACE(), set ASYNC_LOG_LEVEL in
+// build_options.h to ASYNC_LOG_LEVEL_TRACE to see it
 
 extern volatile sig_atomic_t exitCode;
 
 // Allow other files to access the global variable
 extern bool enableRSL10Onboarding;
 extern int8_t numRsl10DevicesInList;
+extern uint32_t rsl10MessagesDecoded;
+extern uint32_t rsl10MessagesDiscarded;
 
 // Define the Json string for reporting RSL10 telemetry data
 static const char rsl10TelemetryJsonObject[] = "{\"temp%s\":%2.2f, \"humidity%s\":%2.2f, \"pressure%s\":%2.2f}";
@@ -64,62 +70,29 @@ static const char rsl10TelemetryJsonObject[] = "{\"temp%s\":%2.2f, \"humidity%s\
 // Initial device twin message with device details captured
 static const char rsl10DeviceTwinsonObject[] = "{\"mac%s\":\"%s\",\"Version%s\":\"%s\"}";
 
-// Define a generic message structure.  We'll use this to extract the BdAddress and message ID
-// to determine if and how to process the message
-typedef struct RSL10MessageHeader {
-    char msgSendRxId[3]; // ESD
-    uint8_t BdAddress[7 * 2];
-} RSL10MessageHeader_t;
-
-
-// Define the content of the environmental message from the RSL10.
-// ESD 00AB8967452301 00 CC09 4F12 B8069B FFFF -50
-typedef struct RSL10EnvironmentalMessage {
-    char msgSendRxId[3]; // ESD
-    uint8_t BdAddress[7 * 2];
-    uint8_t version[1 * 2];
-    uint8_t temperature[2 * 2];
-    uint8_t humidity[2 * 2];
-    uint8_t pressure[3 * 2];
-    uint8_t ambiantLight[2 * 2];
-    char blankSpace[1];
-    char rssi[3];
-} Rsl10EnvironmentalMessage_t;
-
-// Define the content of the environmental message from the RSL10.
-// MSD 00AB8967452301 00 01 64 F9FF 1300 D9FF 00FC 5 9 5 B -49
-typedef struct RSL10MotionMessage {
-    char msgSendRxId[3]; // MSD
-    uint8_t BdAddress[7 * 2];
-    uint8_t version[1 * 2];
-    uint8_t sampleIndex[1 * 2];
-    uint8_t SensorSetting[1 * 2];
-    uint8_t accel_raw_x[2 * 2];
-    uint8_t accel_raw_y[2 * 2];
-    uint8_t accel_raw_z[2 * 2];
-    uint8_t orientation_x[1 * 2];
-    uint8_t orientation_y[1 * 2];
-    uint8_t orientation_z[1 * 2];
-    uint8_t orientation_w[1 * 2];
-    char blankSpace[1];
-    char rssi[3];
-} Rsl10MotionMessage_t;
-
-// Define the content of the battery data message from the RSL10.
-// BAT 00AB8967452301 0ABD -52
-typedef struct RSL10BatteryMessage {
-    char msgSendRxId[3]; // MSD
-    uint8_t BdAddress[7 * 2];
-    uint8_t battery[2 * 2];
-    char blankSpace[1];
-    char rssi[3];
-} Rsl10BatteryMessage_t;
-
+// Device indexes are int8_t, tools/rsl10_telemetry_sim.c sets this on its command line
+#ifndef MAX_RSL10_DEVICES
 #define MAX_RSL10_DEVICES 2
+#endif
+#if MAX_RSL10_DEVICES > 127
+#error "MAX_RSL10_DEVICES does not fit the int8_t device indexes"
+#endif
 #define RSL10_ADDRESS_LEN 18
 
 // RSL10 Global variables
 
+#if defined(SEND_RSL10_TELEMETRY_STATS) && !defined(SEND_RSL10_AGGREGATED_TELEMETRY)
+#error "SEND_RSL10_TELEMETRY_STATS needs SEND_RSL10_AGGREGATED_TELEMETRY, the stats are sent and reset with it"
+#endif
+
+// Min, max and average of the readings received during a telemetry period
+typedef struct {
+    float min;
+    float max;
+    double sum;
+    uint32_t count;
+} Rsl10Stat_t;
+
 // Array to hold specific data for each RSL10 detected by the system
 typedef struct RSL10Device {
     // Common data for all message types
@@ -155,36 +128,30 @@ typedef struct RSL10Device {
     // Battery data
     float lastBattery;
     bool batteryDataRefreshed;
+
+#ifdef SEND_RSL10_TELEMETRY_STATS
+    // Readings received since the last telemetry was sent
+    Rsl10Stat_t rssiStats;
+    Rsl10Stat_t temperatureStats;
+    Rsl10Stat_t humidityStats;
+    Rsl10Stat_t pressureStats;
+#endif // SEND_RSL10_TELEMETRY_STATS
 } RSL10Device_t;
 
 extern RSL10Device_t Rsl10DeviceList[MAX_RSL10_DEVICES];
 extern char authorizedDeviceList[MAX_RSL10_DEVICES][RSL10_ADDRESS_LEN];
 
 // RSL10 Specific routines
-int stringToInt(char *, size_t);
-void textFromHexString(char *, char *, int);
-void getBdMessageID(char *, RSL10MessageHeader_t *);
-void getBdAddress(char *, RSL10MessageHeader_t *);
-
-void rsl10ProcessMovementMessage(char*, int8_t);
-void rsl10ProcessEnvironmentalMessage(char*, int8_t);
-void rsl10ProcessBatteryMessage(char*, int8_t);
-
-void getRxRssi(int16_t *, char * );
-void getTemperature(float *, Rsl10EnvironmentalMessage_t *);
-void getHumidity(float *, Rsl10EnvironmentalMessage_t *);
-void getPressure(float *, Rsl10EnvironmentalMessage_t *);
-void getAmbiantLight(uint16_t *, Rsl10EnvironmentalMessage_t *);
-void getBattery(float *, Rsl10BatteryMessage_t *);
-void getSensorSettings(RSL10Device_t*, Rsl10MotionMessage_t*);
-void getAccelReadings(RSL10Device_t*, Rsl10MotionMessage_t*);
-void getOrientation(RSL10Device_t*, Rsl10MotionMessage_t*);
+void rsl10ProcessMovementMessage(const Rsl10Advert_t *, int8_t);
+void rsl10ProcessEnvironmentalMessage(const Rsl10Advert_t *, int8_t);
+void rsl10ProcessBatteryMessage(const Rsl10Advert_t *, int8_t);
 
 int8_t getRsl10DeviceIndex(char *);
 bool addRsl10DeviceToList(char *, int8_t);
-int8_t getDeviceIndex(char* deviceToCheck);
+int8_t getDeviceIndex(char* deviceToCheck, uint64_t addressKey);
 void processData(int, int);
 void rsl10SendTelemetry(void);
+void rsl10SendUnauthorizedSummary(void);
 
 void parseRsl10Message(char *msgToParse);
 
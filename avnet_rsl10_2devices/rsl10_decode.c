@@ -0,0 +1,221 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "rsl10_decode.h"
+
+#include <string.h>
+
+#define ID_LEN 3
+
+// Largest advert of any message type
+#define MAX_ADVERT_BYTES RSL10_MSD_BYTES
+
+// Every character maps to HEX_VALID | its value when it is a hex digit and 0 otherwise, so a
+// run of digits can be decoded without branching and checked once at the end by ANDing the
+// entries together
+#define HEX_VALID 0x10
+
+#define HEX_DIGIT(c, value) [c] = HEX_VALID | (value)
+
+static const uint8_t hexTable[256] = {
+    HEX_DIGIT('0', 0),   HEX_DIGIT('1', 1),   HEX_DIGIT('2', 2),   HEX_DIGIT('3', 3),
+    HEX_DIGIT('4', 4),   HEX_DIGIT('5', 5),   HEX_DIGIT('6', 6),   HEX_DIGIT('7', 7),
+    HEX_DIGIT('8', 8),   HEX_DIGIT('9', 9),   HEX_DIGIT('A', 0xA), HEX_DIGIT('B', 0xB),
+    HEX_DIGIT('C', 0xC), HEX_DIGIT('D', 0xD), HEX_DIGIT('E', 0xE), HEX_DIGIT('F', 0xF),
+    HEX_DIGIT('a', 0xA), HEX_DIGIT('b', 0xB), HEX_DIGIT('c', 0xC), HEX_DIGIT('d', 0xD),
+    HEX_DIGIT('e', 0xE), HEX_DIGIT('f', 0xF)};
+
+static const char upperHex[] = "0123456789ABCDEF";
+
+static const struct {
+    char id[ID_LEN];
+    Rsl10MessageType_t type;
+    size_t bytes;
+} layouts[] = {{{'E', 'S', 'D'}, RSL10_MSG_ENVIRONMENTAL, RSL10_ESD_BYTES},
+               {{'M', 'S', 'D'}, RSL10_MSG_MOTION, RSL10_MSD_BYTES},
+               {{'B', 'A', 'T'}, RSL10_MSG_BATTERY, RSL10_BAT_BYTES}};
+
+// Decode count bytes of hex, false if any character is not a hex digit
+static bool decodeHex(const uint8_t *hex, uint8_t *bytes, size_t count)
+{
+    uint8_t valid = HEX_VALID;
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t high = hexTable[hex[2 * i]];
+        uint8_t low = hexTable[hex[2 * i + 1]];
+
+        valid &= high & low;
+        bytes[i] = (uint8_t)((high & 0x0F) << 4 | (low & 0x0F));
+    }
+    return valid != 0;
+}
+
+static uint16_t littleEndian16(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | bytes[1] << 8);
+}
+
+static uint16_t bigEndian16(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] << 8 | bytes[1]);
+}
+
+static uint32_t littleEndian24(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16;
+}
+
+// "-50", "-100", "0". Up to three digits with an optional minus sign, nothing else.
+static bool decodeRssi(const uint8_t *text, size_t length, int16_t *rssi)
+{
+    bool negative = length > 0 && text[0] == '-';
+    size_t digits = length - (negative ? 1 : 0);
+    int value = 0;
+
+    if (digits == 0 || digits > 3) {
+        return false;
+    }
+    for (size_t i = length - digits; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (text[i] - '0');
+    }
+
+    *rssi = (int16_t)(negative ? -value : value);
+    return true;
+}
+
+Rsl10DecodeResult_t rsl10DecodeAdvert(const char *line, size_t length, Rsl10Advert_t *advert)
+{
+    const uint8_t *text = (const uint8_t *)line;
+    uint8_t bytes[MAX_ADVERT_BYTES];
+    size_t layout;
+
+    if (length > 0 && text[length - 1] == '\r') {
+        length--;
+    }
+    if (length < ID_LEN) {
+        return RSL10_DECODE_UNKNOWN_ID;
+    }
+
+    for (layout = 0; layout < sizeof(layouts) / sizeof(layouts[0]); layout++) {
+        if (memcmp(line, layouts[layout].id, ID_LEN) == 0) {
+            break;
+        }
+    }
+    if (layout == sizeof(layouts) / sizeof(layouts[0])) {
+        return RSL10_DECODE_UNKNOWN_ID;
+    }
+
+    size_t hexEnd = ID_LEN + 2 * layouts[layout].bytes;
+    if (length <= hexEnd || text[hexEnd] != ' ') {
+        return RSL10_DECODE_BAD_LENGTH;
+    }
+    if (!decodeHex(text + ID_LEN, bytes, layouts[layout].bytes)) {
+        return RSL10_DECODE_BAD_HEX;
+    }
+    if (!decodeRssi(text + hexEnd + 1, length - hexEnd - 1, &advert->rssi)) {
+        return RSL10_DECODE_BAD_RSSI;
+    }
+
+    advert->type = layouts[layout].type;
+    memcpy(advert->address, bytes, RSL10_ADDRESS_BYTES);
+
+    const uint8_t *payload = bytes + RSL10_ADDRESS_BYTES;
+
+    switch (advert->type) {
+    case RSL10_MSG_ENVIRONMENTAL:
+        advert->environmental.version = payload[0];
+        advert->environmental.temperature = littleEndian16(&payload[1]);
+        advert->environmental.humidity = littleEndian16(&payload[3]);
+        advert->environmental.pressure = littleEndian24(&payload[5]);
+        advert->environmental.ambientLight = littleEndian16(&payload[8]);
+        break;
+    case RSL10_MSG_MOTION:
+        advert->motion.version = payload[0];
+        advert->motion.sampleIndex = payload[1];
+        advert->motion.sensorSetting = payload[2];
+        for (int axis = 0; axis < 3; axis++) {
+            advert->motion.accel[axis] = (int16_t)littleEndian16(&payload[3 + 2 * axis]);
+        }
+        for (int i = 0; i < 4; i++) {
+            advert->motion.orientation[i] = (int8_t)payload[9 + i];
+        }
+        break;
+    case RSL10_MSG_BATTERY:
+        // The battery level is the one big endian field
+        advert->battery.millivolts = bigEndian16(&payload[0]);
+        break;
+    }
+    return RSL10_DECODE_OK;
+}
+
+void rsl10FormatAddress(const uint8_t address[RSL10_ADDRESS_BYTES], char text[RSL10_ADDRESS_TEXT_LEN])
+{
+    rsl10FormatAddressKey(rsl10AddressKey(address), text);
+}
+
+uint64_t rsl10AddressKey(const uint8_t address[RSL10_ADDRESS_BYTES])
+{
+    // The first six bytes, last first. The seventh is not part of the name.
+    uint64_t key = 0;
+
+    for (int i = 5; i >= 0; i--) {
+        key = key << 8 | address[i];
+    }
+    return key;
+}
+
+bool rsl10ParseAddressKey(const char *text, uint64_t *key)
+{
+    const uint8_t *name = (const uint8_t *)text;
+    uint8_t valid = HEX_VALID;
+    uint64_t parsed = 0;
+
+    for (int i = 0; i < 6; i++) {
+        // Each pair is followed by a ':', the last one by the end of the string
+        if (name[3 * i] == '\0' || name[3 * i + 1] == '\0' || name[3 * i + 2] != (i < 5 ? ':' : '\0')) {
+            return false;
+        }
+
+        uint8_t high = hexTable[name[3 * i]];
+        uint8_t low = hexTable[name[3 * i + 1]];
+        valid &= high & low;
+        parsed = parsed << 8 | (uint8_t)((high & 0x0F) << 4 | (low & 0x0F));
+    }
+
+    if (valid == 0) {
+        return false;
+    }
+    *key = parsed;
+    return true;
+}
+
+void rsl10FormatAddressKey(uint64_t key, char text[RSL10_ADDRESS_TEXT_LEN])
+{
+    for (int i = 0; i < 6; i++) {
+        uint8_t byte = (uint8_t)(key >> (40 - 8 * i));
+        text[3 * i] = upperHex[byte >> 4];
+        text[3 * i + 1] = upperHex[byte & 0x0F];
+        text[3 * i + 2] = ':';
+    }
+    text[RSL10_ADDRESS_TEXT_LEN - 1] = '\0';
+}
+
+const char *rsl10DecodeResultText(Rsl10DecodeResult_t result)
+{
+    switch (result) {
+    case RSL10_DECODE_OK:
+        return "ok";
+    case RSL10_DECODE_UNKNOWN_ID:
+        return "unknown message ID";
+    case RSL10_DECODE_BAD_LENGTH:
+        return "wrong length";
+    case RSL10_DECODE_BAD_HEX:
+        return "invalid hex";
+    case RSL10_DECODE_BAD_RSSI:
+        return "invalid RSSI";
+    }
+    return "?";
+}
@@ -0,0 +1,92 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Decodes one RSL10 advert line from the UART into a binary struct in a single pass. A line is
+// a three character message ID, the advert bytes in hex, a space and the decimal RSSI:
+//
+//   ESD 00AB8967452301 00 CC09 4F12 B8069B FFFF -50            (spaces added for readability)
+//   MSD 00AB8967452301 00 01 64 F9FF 1300 D9FF 00FC 5 9 5 B -49
+//   BAT 00AB8967452301 0ABD -52
+//
+// Every hex character is checked and the advert must have exactly the length its message ID
+// calls for, so a corrupted or truncated line is rejected rather than decoded into garbage.
+
+// Bytes in the hex part of each message, the 7 byte address included
+#define RSL10_ESD_BYTES 17
+#define RSL10_MSD_BYTES 20
+#define RSL10_BAT_BYTES 9
+
+#define RSL10_ADDRESS_BYTES 7
+
+// Length of a formatted address, "AA:BB:CC:DD:EE:FF" and the terminator
+#define RSL10_ADDRESS_TEXT_LEN 18
+
+typedef enum {
+    RSL10_MSG_ENVIRONMENTAL, // ESD
+    RSL10_MSG_MOTION,        // MSD
+    RSL10_MSG_BATTERY        // BAT
+} Rsl10MessageType_t;
+
+typedef enum {
+    RSL10_DECODE_OK,
+    RSL10_DECODE_UNKNOWN_ID,
+    RSL10_DECODE_BAD_LENGTH, // Hex part missing, too short or too long for the message ID
+    RSL10_DECODE_BAD_HEX,
+    RSL10_DECODE_BAD_RSSI
+} Rsl10DecodeResult_t;
+
+typedef struct {
+    Rsl10MessageType_t type;
+    uint8_t address[RSL10_ADDRESS_BYTES]; // As sent, see rsl10FormatAddress()
+    int16_t rssi;
+    union {
+        struct {
+            uint8_t version;
+            uint16_t temperature; // Hundredths of a degree C
+            uint16_t humidity;    // Hundredths of a percent
+            uint32_t pressure;    // Hundredths of a Pa
+            uint16_t ambientLight; // 0xFFFF when the device has no light sensor
+        } environmental;
+        struct {
+            uint8_t version;
+            uint8_t sampleIndex;
+            uint8_t sensorSetting;
+            int16_t accel[3]; // Raw x, y, z
+            int8_t orientation[4]; // Quaternion x, y, z, w in 1/128ths
+        } motion;
+        struct {
+            uint16_t millivolts;
+        } battery;
+    };
+} Rsl10Advert_t;
+
+/// <summary>
+/// Decode one advert line. line does not need to be terminated, a trailing '\r' is ignored.
+/// advert is only valid when RSL10_DECODE_OK is returned.
+/// </summary>
+Rsl10DecodeResult_t rsl10DecodeAdvert(const char *line, size_t length, Rsl10Advert_t *advert);
+
+/// <summary>
+/// Format a decoded address the way devices are named in the authorized device twins.
+/// </summary>
+void rsl10FormatAddress(const uint8_t address[RSL10_ADDRESS_BYTES], char text[RSL10_ADDRESS_TEXT_LEN]);
+
+/// <summary>
+/// The six bytes of a decoded address that make up its name, as one integer for table lookups.
+/// </summary>
+uint64_t rsl10AddressKey(const uint8_t address[RSL10_ADDRESS_BYTES]);
+
+/// <summary>
+/// Parse an "AA:BB:CC:DD:EE:FF" name, in either case, into the key of the same address.
+/// </summary>
+bool rsl10ParseAddressKey(const char *text, uint64_t *key);
+
+void rsl10FormatAddressKey(uint64_t key, char text[RSL10_ADDRESS_TEXT_LEN]);
+
+const char *rsl10DecodeResultText(Rsl10DecodeResult_t result);
@@ -0,0 +1,258 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "rsl10_loadgen.h"
+#include "rsl10_decode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// The ways a generated line is broken, each is caught by a different check in the parser
+typedef enum {
+    MALFORMED_TRUNCATED,  // Hex part two characters short
+    MALFORMED_BAD_HEX,    // A hex digit replaced with 'G'
+    MALFORMED_UNKNOWN_ID, // First letter of the message ID replaced with 'X'
+    MALFORMED_BAD_RSSI,   // RSSI with a letter in it
+    MALFORMED_NO_NEWLINE, // Runs into the next line, so both are lost
+    MALFORMED_KINDS
+} Malformed_t;
+
+static uint32_t nextRandom(Rsl10LoadGen_t *gen)
+{
+    // xorshift32, repeatable from run to run
+    gen->random ^= gen->random << 13;
+    gen->random ^= gen->random >> 17;
+    gen->random ^= gen->random << 5;
+    return gen->random;
+}
+
+void rsl10LoadGenInit(Rsl10LoadGen_t *gen, uint32_t devices, uint32_t linesPerSecond,
+                      uint32_t malformedPercent, int64_t nowMs)
+{
+    *gen = (Rsl10LoadGen_t){.devices = devices == 0 ? 1 : devices,
+                            .linesPerSecond = linesPerSecond,
+                            .malformedPercent = malformedPercent,
+                            .random = 0x2545F491,
+                            .startMs = nowMs};
+}
+
+// The next advert, in the wire format rsl10DecodeAdvert() takes
+static size_t generateLine(Rsl10LoadGen_t *gen, char *line)
+{
+    uint32_t device = (uint32_t)(gen->lines % gen->devices);
+    uint32_t round = (uint32_t)(gen->lines / gen->devices);
+    uint8_t bytes[RSL10_MSD_BYTES];
+    size_t count;
+    const char *id;
+
+    // The address as sent, see rsl10AddressKey()
+    const uint8_t address[RSL10_ADDRESS_BYTES] = {0x00, 0xAB, 0x89, 0x67, (uint8_t)(device >> 8),
+                                                  (uint8_t)device, 0x01};
+    memcpy(bytes, address, sizeof(address));
+    uint8_t *payload = bytes + RSL10_ADDRESS_BYTES;
+
+    switch (round % 3) {
+    case 0: {
+        uint16_t temperature = (uint16_t)(2000 + nextRandom(gen) % 500);
+        uint16_t humidity = (uint16_t)(3500 + nextRandom(gen) % 2000);
+        uint32_t pressure = 10130000 + nextRandom(gen) % 10000;
+
+        id = "ESD";
+        count = RSL10_ESD_BYTES;
+        payload[0] = 0;
+        payload[1] = (uint8_t)temperature;
+        payload[2] = (uint8_t)(temperature >> 8);
+        payload[3] = (uint8_t)humidity;
+        payload[4] = (uint8_t)(humidity >> 8);
+        payload[5] = (uint8_t)pressure;
+        payload[6] = (uint8_t)(pressure >> 8);
+        payload[7] = (uint8_t)(pressure >> 16);
+        payload[8] = 0xFF; // No light sensor
+        payload[9] = 0xFF;
+        break;
+    }
+    case 1:
+        id = "MSD";
+        count = RSL10_MSD_BYTES;
+        payload[0] = 0;
+        payload[1] = (uint8_t)round;
+        payload[2] = 0x64;
+        for (int i = 3; i < 13; i++) {
+            payload[i] = (uint8_t)nextRandom(gen);
+        }
+        break;
+    default: {
+        uint16_t millivolts = (uint16_t)(2800 + nextRandom(gen) % 400);
+
+        id = "BAT";
+        count = RSL10_BAT_BYTES;
+        payload[0] = (uint8_t)(millivolts >> 8);
+        payload[1] = (uint8_t)millivolts;
+        break;
+    }
+    }
+
+    size_t length = 0;
+    memcpy(line, id, 3);
+    length += 3;
+    for (size_t i = 0; i < count; i++) {
+        line[length++] = hexDigits[bytes[i] >> 4];
+        line[length++] = hexDigits[bytes[i] & 0x0F];
+    }
+    length += (size_t)sprintf(line + length, " %d\n", -40 - (int)(nextRandom(gen) % 50));
+
+    if (nextRandom(gen) % 100 >= gen->malformedPercent) {
+        return length;
+    }
+
+    gen->malformed++;
+
+    switch ((Malformed_t)(nextRandom(gen) % MALFORMED_KINDS)) {
+    case MALFORMED_TRUNCATED:
+        // Drop the last byte of hex, the space and RSSI move up
+        memmove(line + 3 + 2 * count - 2, line + 3 + 2 * count, length - 3 - 2 * count);
+        length -= 2;
+        break;
+    case MALFORMED_BAD_HEX:
+        line[3 + 2 * (nextRandom(gen) % count)] = 'G';
+        break;
+    case MALFORMED_UNKNOWN_ID:
+        line[0] = 'X';
+        break;
+    case MALFORMED_BAD_RSSI:
+        line[length - 2] = 'x';
+        break;
+    case MALFORMED_NO_NEWLINE:
+    case MALFORMED_KINDS:
+        length--;
+        break;
+    }
+    return length;
+}
+
+bool rsl10LoadGenInitReplay(Rsl10LoadGen_t *gen, int fd, int64_t nowMs)
+{
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *text = malloc(capacity);
+
+    *gen = (Rsl10LoadGen_t){.startMs = nowMs, .loopStartMs = nowMs};
+
+    while (text != NULL) {
+        if (length == capacity) {
+            char *larger = realloc(text, capacity * 2);
+            if (larger == NULL) {
+                break;
+            }
+            text = larger;
+            capacity *= 2;
+        }
+
+        ssize_t bytesRead = read(fd, text + length, capacity - length);
+        if (bytesRead < 0) {
+            break;
+        }
+        if (bytesRead == 0) {
+            // Make sure the last line ends, so every line can be found with memchr
+            if (length == 0 || text[length - 1] != '\n') {
+                if (length == capacity) {
+                    continue;
+                }
+                text[length++] = '\n';
+            }
+
+            if (memchr(text, ' ', length) == NULL) {
+                break;
+            }
+            gen->text = text;
+            gen->textLength = length;
+            return true;
+        }
+        length += (size_t)bytesRead;
+    }
+
+    free(text);
+    return false;
+}
+
+// The next trace line if it is due by nowMs, NULL otherwise. *after is the offset of the line
+// that follows it.
+static const char *peekTraceLine(Rsl10LoadGen_t *gen, int64_t nowMs, size_t *length, size_t *after)
+{
+    // Bounded so a trace of nothing but comments cannot loop forever
+    for (int skipped = 0; skipped < 1000; skipped++) {
+        if (gen->next == gen->textLength) {
+            gen->next = 0;
+            gen->loopStartMs = nowMs;
+            gen->loops++;
+        }
+
+        const char *line = gen->text + gen->next;
+        const char *end = memchr(line, '\n', gen->textLength - gen->next);
+        *after = (size_t)(end - gen->text) + 1;
+
+        if (end - line > 6 && strncmp(line, "TRACE ", 6) == 0) {
+            line += 6;
+        }
+
+        const char *advert = line;
+        int64_t offsetMs = 0;
+        while (advert < end && *advert >= '0' && *advert <= '9') {
+            offsetMs = offsetMs * 10 + (*advert++ - '0');
+        }
+
+        // Comments, blank lines and anything else without a time stamp
+        if (advert == line || advert == end || *advert != ' ') {
+            gen->next = *after;
+            continue;
+        }
+
+        if (gen->loopStartMs + offsetMs > nowMs) {
+            return NULL;
+        }
+        advert++;
+        *length = (size_t)(end - advert);
+        return advert;
+    }
+    return NULL;
+}
+
+size_t rsl10LoadGenFill(Rsl10LoadGen_t *gen, int64_t nowMs, char *buffer, size_t size)
+{
+    size_t used = 0;
+
+    if (gen->text != NULL) {
+        const char *advert;
+        size_t length;
+        size_t after;
+
+        // A line that does not fit is handed out next time
+        while ((advert = peekTraceLine(gen, nowMs, &length, &after)) != NULL &&
+               used + length + 1 <= size) {
+            memcpy(buffer + used, advert, length);
+            used += length;
+            buffer[used++] = '\n';
+            gen->next = after;
+            gen->lines++;
+        }
+        return used;
+    }
+
+    uint64_t due = (uint64_t)(nowMs - gen->startMs) * gen->linesPerSecond / 1000;
+
+    while (gen->lines < due && used + RSL10_LOADGEN_MAX_LINE <= size) {
+        used += generateLine(gen, buffer + used);
+        gen->lines++;
+    }
+    return used;
+}
+
+void rsl10LoadGenClose(Rsl10LoadGen_t *gen)
+{
+    free(gen->text);
+    gen->text = NULL;
+}
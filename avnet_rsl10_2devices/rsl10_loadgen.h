@@ -0,0 +1,65 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Synthetic RSL10 UART traffic, so the parser can be exercised and measured without RSL10s or the
+// BLE PMOD. Either generates adverts for a number of virtual devices at a fixed rate, a share of
+// them malformed, or replays a captured trace with its original timing.
+//
+// A trace is a text file with one advert per line, prefixed with the milliseconds since the trace
+// started:
+//
+//   1250 BAT00AB8967452301 0ABD -52
+//
+// Lines starting with '#' are comments. Define RSL10_RECORD_TRACE in build_options.h to log every
+// line received from the UART in this format with a "TRACE " prefix, the replay accepts the prefix
+// so a capture can be pasted from the debug output as is.
+
+// Longest line generated, the newline included
+#define RSL10_LOADGEN_MAX_LINE 80
+
+typedef struct {
+    // Generator
+    uint32_t devices;
+    uint32_t linesPerSecond;
+    uint32_t malformedPercent;
+    uint32_t random;
+
+    // Replay, text is NULL when generating
+    char *text;
+    size_t textLength;
+    size_t next;        // Offset of the next trace line
+    int64_t loopStartMs;
+
+    int64_t startMs;
+    uint64_t lines;     // Lines handed out
+    uint64_t malformed; // Of which malformed on purpose
+    uint32_t loops;     // Times the trace was replayed from the start
+} Rsl10LoadGen_t;
+
+/// <summary>
+/// Generate adverts from the given number of virtual RSL10s at linesPerSecond, each device in turn
+/// and each device going through environmental, motion and battery messages.
+/// </summary>
+void rsl10LoadGenInit(Rsl10LoadGen_t *gen, uint32_t devices, uint32_t linesPerSecond,
+                      uint32_t malformedPercent, int64_t nowMs);
+
+/// <summary>
+/// Replay the trace read from fd, over and over. fd is not closed.
+/// </summary>
+/// <returns>false if the trace cannot be read or has no lines</returns>
+bool rsl10LoadGenInitReplay(Rsl10LoadGen_t *gen, int fd, int64_t nowMs);
+
+/// <summary>
+/// Write the lines that are due by nowMs to buffer as a UART byte stream. Lines that do not fit
+/// stay due for the next call.
+/// </summary>
+/// <returns>Bytes written</returns>
+size_t rsl10LoadGenFill(Rsl10LoadGen_t *gen, int64_t nowMs, char *buffer, size_t size);
+
+void rsl10LoadGenClose(Rsl10LoadGen_t *gen);
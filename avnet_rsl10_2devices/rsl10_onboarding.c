@@ -0,0 +1,278 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "rsl10_onboarding.h"
+#include "rsl10_decode.h"
+
+#include <stdio.h>
+
+/****************************************************************************************
+ * Allowlist, open addressing with linear probing
+ ****************************************************************************************/
+
+#define ALLOWLIST_MASK (RSL10_ALLOWLIST_SLOTS - 1)
+
+static uint64_t allowKeys[RSL10_ALLOWLIST_SLOTS];
+static int8_t allowIndex[RSL10_ALLOWLIST_SLOTS];
+static bool allowUsed[RSL10_ALLOWLIST_SLOTS];
+static bool allowKnown[RSL10_ALLOWLIST_SLOTS]; // Listed in knownMacs
+static size_t allowCount;
+
+static size_t homeSlot(uint64_t key)
+{
+    // Fibonacci hashing, addresses from one vendor differ mostly in their low bytes
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & ALLOWLIST_MASK;
+}
+
+// The slot holding key, or the empty slot where it would go
+static size_t findSlot(uint64_t key)
+{
+    size_t slot = homeSlot(key);
+
+    while (allowUsed[slot] && allowKeys[slot] != key) {
+        slot = (slot + 1) & ALLOWLIST_MASK;
+    }
+    return slot;
+}
+
+bool rsl10AllowlistAdd(uint64_t key, int8_t deviceIndex)
+{
+    size_t slot = findSlot(key);
+
+    if (!allowUsed[slot]) {
+        if (allowCount == RSL10_ALLOWLIST_SLOTS / 2) {
+            return false;
+        }
+        allowUsed[slot] = true;
+        allowKeys[slot] = key;
+        allowIndex[slot] = RSL10_NO_DEVICE_INDEX;
+        allowKnown[slot] = false;
+        allowCount++;
+    }
+
+    // An address with a telemetry slot keeps it when knownMacs lists it too
+    if (deviceIndex == RSL10_NO_DEVICE_INDEX) {
+        allowKnown[slot] = true;
+    } else {
+        allowIndex[slot] = deviceIndex;
+    }
+    return true;
+}
+
+static void removeSlot(size_t hole)
+{
+    // Shift later entries of the same probe run back so no lookup stops early at the hole
+    for (size_t next = (hole + 1) & ALLOWLIST_MASK; allowUsed[next]; next = (next + 1) & ALLOWLIST_MASK) {
+        size_t home = homeSlot(allowKeys[next]);
+
+        // The entry can fill the hole unless its home lies cyclically in (hole, next]
+        bool homeAfterHole = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!homeAfterHole) {
+            allowKeys[hole] = allowKeys[next];
+            allowIndex[hole] = allowIndex[next];
+            allowKnown[hole] = allowKnown[next];
+            hole = next;
+        }
+    }
+
+    allowUsed[hole] = false;
+    allowCount--;
+}
+
+void rsl10AllowlistRemoveDevice(uint64_t key, int8_t deviceIndex)
+{
+    size_t slot = findSlot(key);
+
+    if (!allowUsed[slot] || allowIndex[slot] != deviceIndex) {
+        return;
+    }
+
+    if (allowKnown[slot]) {
+        allowIndex[slot] = RSL10_NO_DEVICE_INDEX;
+    } else {
+        removeSlot(slot);
+    }
+}
+
+void rsl10AllowlistClearKnown(void)
+{
+    static uint64_t keepKeys[RSL10_ALLOWLIST_SLOTS / 2];
+    static int8_t keepIndex[RSL10_ALLOWLIST_SLOTS / 2];
+    size_t keep = 0;
+
+    // Rebuilding is simpler than removing entries while walking the table
+    for (size_t slot = 0; slot < RSL10_ALLOWLIST_SLOTS; slot++) {
+        if (allowUsed[slot] && allowIndex[slot] != RSL10_NO_DEVICE_INDEX) {
+            keepKeys[keep] = allowKeys[slot];
+            keepIndex[keep++] = allowIndex[slot];
+        }
+        allowUsed[slot] = false;
+    }
+
+    allowCount = 0;
+    for (size_t i = 0; i < keep; i++) {
+        rsl10AllowlistAdd(keepKeys[i], keepIndex[i]);
+    }
+}
+
+bool rsl10AllowlistFind(uint64_t key, int8_t *deviceIndex)
+{
+    size_t slot = findSlot(key);
+
+    if (!allowUsed[slot]) {
+        return false;
+    }
+    *deviceIndex = allowIndex[slot];
+    return true;
+}
+
+size_t rsl10AllowlistCount(void)
+{
+    return allowCount;
+}
+
+/****************************************************************************************
+ * Unauthorized devices seen recently
+ ****************************************************************************************/
+
+typedef struct {
+    uint64_t key;
+    int64_t lastSeen;
+    int64_t lastReported;
+    uint32_t periodAdverts; // Since the last summary
+    bool newInPeriod;
+    bool used;
+} UnknownDevice_t;
+
+static UnknownDevice_t unknownDevices[RSL10_UNKNOWN_CACHE_SIZE];
+
+// Addresses with adverts in this period that were forgotten before the summary
+static uint32_t periodForgotten;
+
+// Reports sent in the current minute
+static int64_t reportWindowStart;
+static uint32_t reportWindowCount;
+
+static bool takeReport(int64_t nowSeconds)
+{
+    if (nowSeconds - reportWindowStart >= 60) {
+        reportWindowStart = nowSeconds;
+        reportWindowCount = 0;
+    }
+    if (reportWindowCount == RSL10_UNKNOWN_REPORTS_PER_MINUTE) {
+        return false;
+    }
+    reportWindowCount++;
+    return true;
+}
+
+// The entry for key, a new one replacing the least recently seen if it is not cached
+static UnknownDevice_t *findDevice(uint64_t key, int64_t nowSeconds)
+{
+    UnknownDevice_t *oldest = &unknownDevices[0];
+
+    for (size_t i = 0; i < RSL10_UNKNOWN_CACHE_SIZE; i++) {
+        UnknownDevice_t *device = &unknownDevices[i];
+
+        if (device->used && device->key == key) {
+            return device;
+        }
+
+        // Prefer a free entry, otherwise the least recently seen
+        if (oldest->used && (!device->used || device->lastSeen < oldest->lastSeen)) {
+            oldest = device;
+        }
+    }
+
+    if (oldest->used && oldest->periodAdverts > 0) {
+        periodForgotten++;
+    }
+
+    // Due for a report straight away
+    *oldest = (UnknownDevice_t){.key = key,
+                                .lastReported = nowSeconds - RSL10_UNKNOWN_COOLDOWN_SECONDS,
+                                .newInPeriod = true,
+                                .used = true};
+    return oldest;
+}
+
+bool rsl10UnknownSeen(uint64_t key, int64_t nowSeconds)
+{
+    UnknownDevice_t *device = findDevice(key, nowSeconds);
+
+    device->lastSeen = nowSeconds;
+    device->periodAdverts++;
+
+    // A device that misses out on the rate limit is retried on its next advert
+    if (nowSeconds - device->lastReported < RSL10_UNKNOWN_COOLDOWN_SECONDS || !takeReport(nowSeconds)) {
+        return false;
+    }
+    device->lastReported = nowSeconds;
+    return true;
+}
+
+// Append one device to the summary, false if it does not fit
+static bool appendDevice(char *buffer, size_t size, size_t *len, const UnknownDevice_t *device, bool first)
+{
+    char address[RSL10_ADDRESS_TEXT_LEN];
+    rsl10FormatAddressKey(device->key, address);
+
+    int written = snprintf(buffer + *len, size - *len, "%s{\"mac\":\"%s\",\"adverts\":%lu,\"new\":%s}",
+                           first ? "" : ",", address, (unsigned long)device->periodAdverts,
+                           device->newInPeriod ? "true" : "false");
+    if (written < 0 || (size_t)written >= size - *len) {
+        return false;
+    }
+    *len += (size_t)written;
+    return true;
+}
+
+size_t rsl10UnknownSummary(char *buffer, size_t size)
+{
+    size_t listed = 0;
+    size_t unlisted = 0;
+    size_t len = 0;
+    bool fits = true;
+
+    int written = snprintf(buffer, size, "{\"unauthorizedDevices\":[");
+    if (written < 0 || (size_t)written >= size) {
+        fits = false;
+    } else {
+        len = (size_t)written;
+    }
+
+    // Newly seen addresses first, they are the ones an admin may want to authorize
+    for (int newPass = 1; newPass >= 0; newPass--) {
+        for (size_t i = 0; i < RSL10_UNKNOWN_CACHE_SIZE; i++) {
+            const UnknownDevice_t *device = &unknownDevices[i];
+
+            if (!device->used || device->periodAdverts == 0 || device->newInPeriod != (newPass == 1)) {
+                continue;
+            }
+            if (listed < RSL10_UNKNOWN_SUMMARY_DEVICES && fits) {
+                fits = appendDevice(buffer, size, &len, device, listed == 0);
+                listed++;
+            } else {
+                unlisted++;
+            }
+        }
+    }
+
+    bool empty = listed == 0 && periodForgotten == 0;
+
+    if (fits) {
+        written = snprintf(buffer + len, size - len, "],\"unlistedDevices\":%zu,\"forgottenDevices\":%lu}",
+                           unlisted, (unsigned long)periodForgotten);
+        fits = written >= 0 && (size_t)written < size - len;
+        len += fits ? (size_t)written : 0;
+    }
+
+    // Start the next period
+    for (size_t i = 0; i < RSL10_UNKNOWN_CACHE_SIZE; i++) {
+        unknownDevices[i].periodAdverts = 0;
+        unknownDevices[i].newInPeriod = false;
+    }
+    periodForgotten = 0;
+
+    return empty || !fits ? 0 : len;
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Which RSL10 addresses are allowed, and reporting of the ones that are not. Addresses are the
+// keys from rsl10AddressKey().
+
+/****************************************************************************************
+ * Allowlist
+ ****************************************************************************************/
+
+// Hash table slots, a power of two. Lookups stay short while it is at most half full, so this
+// holds up to RSL10_ALLOWLIST_SLOTS / 2 addresses.
+#define RSL10_ALLOWLIST_SLOTS 512
+
+// Device index of an address that is allowed but has no telemetry slot, see knownMacs
+#define RSL10_NO_DEVICE_INDEX -1
+
+/// <summary>
+/// Add or update an address. deviceIndex is its entry in Rsl10DeviceList, or RSL10_NO_DEVICE_INDEX
+/// for a knownMacs address, which leaves any telemetry slot the address already has in place.
+/// </summary>
+/// <returns>false when the list is full</returns>
+bool rsl10AllowlistAdd(uint64_t key, int8_t deviceIndex);
+
+/// <summary>
+/// Take an address off telemetry slot deviceIndex. Nothing changes unless the address is on that
+/// slot, and an address knownMacs lists stays allowed without a slot.
+/// </summary>
+void rsl10AllowlistRemoveDevice(uint64_t key, int8_t deviceIndex);
+
+/// <summary>
+/// Forget the knownMacs list before a new one is loaded, addresses without a telemetry slot are
+/// removed.
+/// </summary>
+void rsl10AllowlistClearKnown(void);
+
+/// <returns>false when the address is not allowed</returns>
+bool rsl10AllowlistFind(uint64_t key, int8_t *deviceIndex);
+
+size_t rsl10AllowlistCount(void);
+
+/****************************************************************************************
+ * Unauthorized devices seen recently
+ ****************************************************************************************/
+
+// Addresses remembered, the least recently seen is forgotten to make room for a new one
+#define RSL10_UNKNOWN_CACHE_SIZE 64
+
+// An unauthorized address is reported on its own at most once per cooldown, its other adverts
+// are only counted for the summary
+#define RSL10_UNKNOWN_COOLDOWN_SECONDS (10 * 60)
+
+// Individual reports across all addresses per minute. With more addresses in range than the
+// cache holds each one is forgotten before its next advert and would look new every time.
+#define RSL10_UNKNOWN_REPORTS_PER_MINUTE 10
+
+// Addresses listed in one summary, the rest are only counted
+#define RSL10_UNKNOWN_SUMMARY_DEVICES 16
+
+/// <summary>
+/// Count an advert from an unauthorized address.
+/// </summary>
+/// <returns>true when the address should be reported now, the first time it is seen and
+/// again after each cooldown, as long as RSL10_UNKNOWN_REPORTS_PER_MINUTE allows</returns>
+bool rsl10UnknownSeen(uint64_t key, int64_t nowSeconds);
+
+/// <summary>
+/// JSON summary of the unauthorized addresses seen since the last summary, newly seen first,
+/// with their advert counts. Starts a new summary period.
+/// </summary>
+/// <returns>Length written, 0 when nothing was seen or the summary does not fit</returns>
+size_t rsl10UnknownSummary(char *buffer, size_t size);
@@ -0,0 +1,155 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "rsl10_receive.h"
+#include "rsl10.h"
+
+#include <time.h>
+
+#ifdef RSL10_RECORD_TRACE
+// Milliseconds on a clock that does not jump when the system time is set
+static int64_t monotonicMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+#endif // RSL10_RECORD_TRACE
+
+// Uncomment for circular queue debug
+//    #define ENABLE_UART_DEBUG
+
+// Room for a whole RSL10_RX_BUFFER_SIZE read on top of the start of a message from the read before, a power of two
+#define DATA_BUFFER_SIZE 1024
+#define DATA_BUFFER_MASK (DATA_BUFFER_SIZE - 1)
+
+unsigned long rsl10BytesPurged = 0;
+
+void rsl10Receive(const uint8_t *receiveBuffer, ssize_t bytesRead)
+{
+    // Buffer for persistant data.  Sometimes we don't receive all the
+    // data at once so we need to store it in a persistant buffer before processing.
+    static uint8_t dataBuffer[DATA_BUFFER_SIZE];
+
+    // The index into the dataBuffer to write the next piece of RX data
+    static int nextData = 0;
+
+    // The index to the head of the valid/current data, this is the beginning
+    // of the next response
+    static int currentData = 0;
+
+    // The number of btyes in the dataBuffer, used to make sure we don't overflow the buffer
+    static int bytesInBuffer = 0;
+
+#ifdef ENABLE_UART_DEBUG
+    Log_Debug("Enter: bytesInBuffer: %d\n", bytesInBuffer);
+    Log_Debug("Enter: bytesRead: %d\n", bytesRead);
+    Log_Debug("Enter: nextData: %d\n", nextData);
+    Log_Debug("Enter: currentData: %d\n", currentData);
+#endif
+
+    // Check to make sure we're not going to over run the buffer. A completely full buffer has
+    // nextData == currentData and would look empty, so one byte always stays free.
+    if ((bytesInBuffer + bytesRead) >= DATA_BUFFER_SIZE) {
+
+        // The buffer is full, attempt to recover by emptying the buffer!
+        Log_Debug("Buffer Full!  Purging\n");
+        rsl10BytesPurged += (unsigned long)(bytesInBuffer + bytesRead);
+
+        nextData = 0;
+        currentData = 0;
+        bytesInBuffer = 0;
+        return;
+    }
+
+    // Move data from the receive Buffer into the Data Buffer.  We do this
+    // because sometimes we don't receive the entire message in one uart read.
+    for (int i = 0; i < bytesRead; i++) {
+
+        // Copy the data into the dataBuffer
+        dataBuffer[nextData] = receiveBuffer[i];
+#ifdef ENABLE_UART_DEBUG
+//        Log_Debug("dataBuffer[%d] = %c\n", nextData, receiveBuffer[i]);
+#endif
+        // Increment the bytes count
+        bytesInBuffer++;
+
+        // Increment the nextData pointer and adjust for wrap around
+        nextData = ((nextData + 1) & DATA_BUFFER_MASK);
+    }
+
+    // Check to see if we can find a response.  A response will end with a '\n' character
+    // Start looking at the beginning of the first non-processed message @ currentData
+
+    // Use a temp buffer pointer in case we don't find a message
+    int tempCurrentData = currentData;
+
+    // Iterate over the valid data from currentData to nextData locations in the buffer
+    while (tempCurrentData != nextData) {
+        if (dataBuffer[tempCurrentData] == '\n') {
+
+#ifdef ENABLE_UART_DEBUG
+            // Found a message from index currentData to tempNextData
+            Log_Debug("Found message from %d to %d\n", currentData, tempCurrentData);
+#endif
+            // Determine the size of the new message we just found, account for the case
+            // where the message wraps from the end of the buffer to the beginning
+            int responseMsgSize = 0;
+            if (currentData > tempCurrentData) {
+                responseMsgSize = (DATA_BUFFER_SIZE - currentData) + tempCurrentData;
+            } else {
+                responseMsgSize = tempCurrentData - currentData;
+            }
+
+            // Declare a new buffer to hold the response we just found
+            uint8_t responseMsg[responseMsgSize + 1];
+
+            // Copy the response from the buffer, do it one byte at a time
+            // since the message may wrap in the data buffer
+            for (int j = 0; j < responseMsgSize; j++) {
+                responseMsg[j] = dataBuffer[(currentData + j) & DATA_BUFFER_MASK];
+                bytesInBuffer--;
+            }
+
+            // Decrement the bytesInBuffer one more time to account for the '\n' charcter
+            bytesInBuffer--;
+
+            // Null terminate the message and print it out to debug
+            responseMsg[responseMsgSize] = '\0';
+            ASYNC_LOG_TRACE("\nRX: %s\n", (char *)responseMsg);
+#ifdef RSL10_RECORD_TRACE
+            // Capture the traffic in the format the load generator replays, see rsl10_loadgen.h
+            static int64_t traceStartMs = -1;
+            if (traceStartMs < 0) {
+                traceStartMs = monotonicMs();
+            }
+            Log_Debug("TRACE %lld %s\n", (long long)(monotonicMs() - traceStartMs), (char *)responseMsg);
+#endif // RSL10_RECORD_TRACE
+            // Call the routine that knows how to parse the response and send data to Azure
+            parseRsl10Message(responseMsg);
+
+            // Update the currentData index and adjust for the '\n' character
+            currentData = ((tempCurrentData + 1) & DATA_BUFFER_MASK);
+            // Overwrite the '\n' character so we don't accidently find it and think
+            // we found a new mssage
+            dataBuffer[tempCurrentData] = '\0';
+        }
+
+        else if (tempCurrentData == nextData) {
+
+#ifdef ENABLE_UART_DEBUG
+            Log_Debug("No message found, exiting . . . \n");
+#endif
+            return;
+        }
+
+        // Increment the temp CurrentData pointer and let it wrap if needed
+        tempCurrentData = ((tempCurrentData + 1) & DATA_BUFFER_MASK);
+    }
+
+#ifdef ENABLE_UART_DEBUG
+    Log_Debug("Exit: nextData: %d\n", nextData);
+    Log_Debug("Exit: currentData: %d\n", currentData);
+    Log_Debug("Exit: bytesInBuffer: %d\n", bytesInBuffer);
+#endif
+}
@@ -0,0 +1,18 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// Assembles the byte stream from the PMOD UART, or the load generator, into lines and hands
+// each one to parseRsl10Message(). A line can be split across any number of reads.
+
+// Largest read passed to rsl10Receive()
+#define RSL10_RX_BUFFER_SIZE 512
+
+// Bytes thrown away because the line buffer filled up without a complete line
+extern unsigned long rsl10BytesPurged;
+
+void rsl10Receive(const uint8_t *receiveBuffer, ssize_t bytesRead);
@@ -0,0 +1,10 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory
+
+#pragma once
+
+#include <stdio.h>
+
+#define Log_Debug(...) ((void)0)
@@ -0,0 +1,119 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, times rsl10DecodeAdvert() plus address formatting on an ESD line against the
+   per-field strtol path rsl10.c used before it, and checks both decode the same values.
+
+   Build: gcc -O2 -I .. -o rsl10_decode_bench rsl10_decode_bench.c ../rsl10_decode.c
+   Usage: rsl10_decode_bench [iterations]
+*/
+
+#include "rsl10_decode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char esdLine[] = "ESD00AB896745230100CC094F12B8069BFFFF -50";
+
+typedef struct {
+    char address[RSL10_ADDRESS_TEXT_LEN];
+    uint16_t temperature;
+    uint16_t humidity;
+    uint32_t pressure;
+    uint16_t ambientLight;
+    int16_t rssi;
+} OLD_ESD;
+
+// The removed stringToInt(), every field was copied out and converted with strtol
+static int oldStringToInt(const char *text, size_t length)
+{
+    char field[64];
+    strncpy(field, text, length);
+    field[length] = '\0';
+    return (int)strtol(field, NULL, 16);
+}
+
+// The removed ESD path: ID compare, address shuffle, one strtol per byte, atoi for the RSSI
+static bool oldDecodeEsd(const char *line, OLD_ESD *esd)
+{
+    if (strlen(line) < 25 || strncmp(line, "ESD", 3) != 0) {
+        return false;
+    }
+
+    const char *address = line + 3;
+    strcpy(esd->address, "  :  :  :  :  :  ");
+    for (int i = 0; i < 6; i++) {
+        esd->address[i * 3] = address[10 - i * 2];
+        esd->address[i * 3 + 1] = address[11 - i * 2];
+    }
+
+    const char *field = line + 3 + 14 + 2;
+    esd->temperature = (uint16_t)(oldStringToInt(field + 2, 2) << 8 | oldStringToInt(field, 2));
+    field += 4;
+    esd->humidity = (uint16_t)(oldStringToInt(field + 2, 2) << 8 | oldStringToInt(field, 2));
+    field += 4;
+    esd->pressure = (uint32_t)(oldStringToInt(field + 4, 2) << 16 |
+                               oldStringToInt(field + 2, 2) << 8 | oldStringToInt(field, 2));
+    field += 6;
+    esd->ambientLight = (uint16_t)(oldStringToInt(field + 2, 2) << 8 | oldStringToInt(field, 2));
+    field += 4;
+
+    char rssi[4] = {field[1], field[2], field[3], '\0'};
+    esd->rssi = (int16_t)atoi(rssi);
+    return true;
+}
+
+static double now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 2000000;
+    Rsl10Advert_t advert;
+    OLD_ESD old;
+    char address[RSL10_ADDRESS_TEXT_LEN];
+    volatile int sink = 0;
+
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: rsl10_decode_bench [iterations]\n");
+        return 1;
+    }
+
+    if (rsl10DecodeAdvert(esdLine, strlen(esdLine), &advert) != RSL10_DECODE_OK ||
+        !oldDecodeEsd(esdLine, &old)) {
+        fprintf(stderr, "The sample line does not decode\n");
+        return 1;
+    }
+    rsl10FormatAddress(advert.address, address);
+
+    if (strcmp(address, old.address) != 0 || advert.environmental.temperature != old.temperature ||
+        advert.environmental.humidity != old.humidity ||
+        advert.environmental.pressure != old.pressure ||
+        advert.environmental.ambientLight != old.ambientLight || advert.rssi != old.rssi) {
+        fprintf(stderr, "The old and new paths disagree\n");
+        return 1;
+    }
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        sink += oldDecodeEsd(esdLine, &old);
+    }
+    double oldNs = (now_ns() - start) / (double)iterations;
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        sink += (int)rsl10DecodeAdvert(esdLine, sizeof(esdLine) - 1, &advert);
+        rsl10FormatAddress(advert.address, address);
+    }
+    double newNs = (now_ns() - start) / (double)iterations;
+
+    printf("ESD old %.1f ns (%.1f M msg/s), new %.1f ns (%.1f M msg/s)\n", oldNs, 1e3 / oldNs,
+           newNs, 1e3 / newNs);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, feeds rsl10DecodeAdvert() mutated ESD, MSD and BAT lines and checks every result
+   against a separate implementation of the line grammar. Each line is in a heap block of
+   exactly its length, so the sanitizers catch a read past the end.
+
+   Build: gcc -O1 -g -fsanitize=address,undefined -I .. -o rsl10_decode_fuzz rsl10_decode_fuzz.c ../rsl10_decode.c
+   Usage: rsl10_decode_fuzz [iterations] [seed]
+*/
+
+#include "rsl10_decode.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 96
+
+static const char *seeds[] = {"ESD00AB896745230100CC094F12B8069BFFFF -50",
+                              "MSD00AB896745230100016400F9FF1300D9FF00FC595B -49",
+                              "BAT00AB89674523010ABD -52\r", "BAT00ab89674523010abd -100"};
+
+// The grammar from rsl10_decode.h, written out the slow way
+static bool well_formed(const char *line, size_t length)
+{
+    size_t bytes = 0;
+
+    if (length > 0 && line[length - 1] == '\r') {
+        length--;
+    }
+    if (length < 3) {
+        return false;
+    }
+
+    if (memcmp(line, "ESD", 3) == 0) {
+        bytes = RSL10_ESD_BYTES;
+    } else if (memcmp(line, "MSD", 3) == 0) {
+        bytes = RSL10_MSD_BYTES;
+    } else if (memcmp(line, "BAT", 3) == 0) {
+        bytes = RSL10_BAT_BYTES;
+    } else {
+        return false;
+    }
+
+    size_t i = 3;
+    for (size_t digit = 0; digit < bytes * 2; digit++, i++) {
+        if (i >= length || !isxdigit((unsigned char)line[i])) {
+            return false;
+        }
+    }
+    if (i >= length || line[i++] != ' ') {
+        return false;
+    }
+    if (i < length && line[i] == '-') {
+        i++;
+    }
+
+    size_t digits = 0;
+    while (i < length && isdigit((unsigned char)line[i])) {
+        i++;
+        digits++;
+    }
+    return i == length && digits >= 1 && digits <= 3;
+}
+
+static size_t mutate(char *line, size_t length)
+{
+    int mutations = rand() % 4;
+
+    for (int m = 0; m < mutations; m++) {
+        switch (rand() % 4) {
+        case 0: // Flip a byte
+            if (length > 0) {
+                line[(size_t)rand() % length] = (char)(rand() % 256);
+            }
+            break;
+        case 1: // Truncate
+            if (length > 0) {
+                length = (size_t)rand() % length;
+            }
+            break;
+        case 2: // Insert a character the grammar uses
+            if (length < MAX_LINE - 1) {
+                size_t at = (size_t)rand() % (length + 1);
+                memmove(line + at + 1, line + at, length - at);
+                line[at] = "0123456789ABCDEF -\r"[rand() % 19];
+                length++;
+            }
+            break;
+        default: // Delete
+            if (length > 0) {
+                size_t at = (size_t)rand() % length;
+                memmove(line + at, line + at + 1, length - at - 1);
+                length--;
+            }
+            break;
+        }
+    }
+    return length;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 5000000;
+    unsigned seed = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 7;
+    unsigned long results[RSL10_DECODE_BAD_RSSI + 1] = {0};
+    unsigned long disagreements = 0;
+
+    srand(seed);
+
+    for (long i = 0; i < iterations; i++) {
+        char buffer[MAX_LINE];
+        const char *seedLine = seeds[(size_t)rand() % (sizeof(seeds) / sizeof(seeds[0]))];
+        size_t length = strlen(seedLine);
+
+        memcpy(buffer, seedLine, length);
+        length = mutate(buffer, length);
+
+        char *line = malloc(length == 0 ? 1 : length);
+        if (line == NULL) {
+            return 1;
+        }
+        memcpy(line, buffer, length);
+
+        Rsl10Advert_t advert;
+        Rsl10DecodeResult_t result = rsl10DecodeAdvert(line, length, &advert);
+        results[result]++;
+
+        if ((result == RSL10_DECODE_OK) != well_formed(line, length)) {
+            if (disagreements++ < 5) {
+                printf("Disagreement, %s: '%.*s'\n", rsl10DecodeResultText(result), (int)length,
+                       line);
+            }
+        }
+        free(line);
+    }
+
+    printf("%ld lines: %lu decoded, rejected %lu unknown ID, %lu length, %lu hex, %lu RSSI. "
+           "%lu disagreements\n",
+           iterations, results[RSL10_DECODE_OK], results[RSL10_DECODE_UNKNOWN_ID],
+           results[RSL10_DECODE_BAD_LENGTH], results[RSL10_DECODE_BAD_HEX],
+           results[RSL10_DECODE_BAD_RSSI], disagreements);
+    return disagreements == 0 ? 0 : 1;
+}
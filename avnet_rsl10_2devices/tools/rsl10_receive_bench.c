@@ -0,0 +1,224 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, drives rsl10Receive() and parseRsl10Message() with the load generator the way the
+   application does with ENABLE_RSL10_LOAD_GENERATOR, and reports lines sent, decoded,
+   discarded and dropped and the CPU time per line:
+
+   - in process, 50 devices as fast as possible, 0% and 5% malformed, in reads of random size
+   - through a raw pseudo-terminal like the PMOD UART, 2000 lines/s for 3 s
+   - a trace written in the RSL10_RECORD_TRACE format, replayed and compared with the original
+
+   Build: gcc -O2 -I host -I .. -o rsl10_receive_bench rsl10_receive_bench.c ../rsl10_receive.c
+              ../rsl10.c ../rsl10_decode.c ../rsl10_onboarding.c ../rsl10_loadgen.c -lm -lutil
+   Usage: rsl10_receive_bench
+*/
+
+#include "rsl10.h"
+#include "rsl10_loadgen.h"
+#include "rsl10_receive.h"
+
+#include <fcntl.h>
+#include <pty.h>
+#include <stdarg.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define DEVICES 50
+#define TRACE_FILE "rsl10_receive_bench_trace.txt"
+
+static char stream[4096];
+
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties)
+{
+    (void)message;
+    (void)messageLength;
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+    return true;
+}
+
+void async_log_write(ASYNC_LOG_SITE *site, const char *format, ...)
+{
+    (void)site;
+    (void)format;
+}
+
+static int64_t clock_ns(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void reset_counters(void)
+{
+    rsl10MessagesDecoded = 0;
+    rsl10MessagesDiscarded = 0;
+    rsl10BytesPurged = 0;
+}
+
+static void report(const char *name, const Rsl10LoadGen_t *gen, int64_t cpuNs, int64_t wallNs)
+{
+    // Lines that never reached the parser, lost in a purge or run into the line after them
+    long long dropped = (long long)gen->lines - rsl10MessagesDecoded - rsl10MessagesDiscarded;
+
+    printf("%-24s %8llu sent (%6llu malformed) %8lu decoded %6lu discarded %6lld dropped "
+           "%7lu bytes purged, %.0f ns CPU per line, %.0f lines/s\n",
+           name, (unsigned long long)gen->lines, (unsigned long long)gen->malformed,
+           (unsigned long)rsl10MessagesDecoded, (unsigned long)rsl10MessagesDiscarded, dropped,
+           rsl10BytesPurged, (double)cpuNs / (double)gen->lines,
+           (double)gen->lines * 1e9 / (double)wallNs);
+}
+
+// Hand the stream over in reads of random size, as load_generator_handler() does
+static void receive_in_random_reads(const char *data, size_t length)
+{
+    for (size_t offset = 0; offset < length;) {
+        size_t chunk = 1 + (size_t)rand() % RSL10_RX_BUFFER_SIZE;
+        if (chunk > length - offset) {
+            chunk = length - offset;
+        }
+        rsl10Receive((const uint8_t *)data + offset, (ssize_t)chunk);
+        offset += chunk;
+    }
+}
+
+static void run_in_process(uint32_t malformedPercent)
+{
+    Rsl10LoadGen_t gen;
+    char name[32];
+
+    rsl10LoadGenInit(&gen, DEVICES, 200000, malformedPercent, 0);
+    reset_counters();
+    srand(1);
+
+    int64_t start = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    // 10 s of generator time in 10 ms ticks
+    for (int64_t nowMs = 10; nowMs <= 10000; nowMs += 10) {
+        receive_in_random_reads(stream, rsl10LoadGenFill(&gen, nowMs, stream, sizeof(stream)));
+    }
+    int64_t cpuNs = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - start;
+
+    snprintf(name, sizeof(name), "in process, %u%% bad", (unsigned)malformedPercent);
+    report(name, &gen, cpuNs, cpuNs);
+}
+
+static void drain(int fd)
+{
+    uint8_t received[RSL10_RX_BUFFER_SIZE];
+    ssize_t bytesRead;
+
+    while ((bytesRead = read(fd, received, sizeof(received))) > 0) {
+        rsl10Receive(received, bytesRead);
+    }
+}
+
+static bool run_pty(void)
+{
+    int master;
+    int slave;
+    struct termios settings;
+    Rsl10LoadGen_t gen;
+
+    if (openpty(&master, &slave, NULL, NULL, NULL) != 0) {
+        perror("openpty");
+        return false;
+    }
+    tcgetattr(slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+    fcntl(slave, F_SETFL, O_NONBLOCK);
+
+    rsl10LoadGenInit(&gen, DEVICES, 2000, 5, 0);
+    reset_counters();
+
+    int64_t wallStart = clock_ns(CLOCK_MONOTONIC);
+    int64_t cpuStart = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    int64_t elapsedMs;
+
+    while ((elapsedMs = (clock_ns(CLOCK_MONOTONIC) - wallStart) / 1000000) < 3000) {
+        size_t length = rsl10LoadGenFill(&gen, elapsedMs, stream, sizeof(stream));
+
+        for (size_t offset = 0; offset < length;) {
+            ssize_t written = write(master, stream + offset, length - offset);
+            if (written > 0) {
+                offset += (size_t)written;
+            }
+            drain(slave);
+        }
+        drain(slave);
+        usleep(10000);
+    }
+    usleep(20000);
+    drain(slave);
+
+    report("pty, 2000 lines/s, 5% bad", &gen, clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpuStart,
+           clock_ns(CLOCK_MONOTONIC) - wallStart);
+
+    close(slave);
+    close(master);
+    return true;
+}
+
+static bool run_replay(void)
+{
+    Rsl10LoadGen_t recorded;
+    Rsl10LoadGen_t replay;
+    static char original[4096];
+    static char replayed[8192];
+
+    // Record 100 lines 10 ms apart, as RSL10_RECORD_TRACE logs them
+    rsl10LoadGenInit(&recorded, 3, 100, 0, 0);
+    size_t length = rsl10LoadGenFill(&recorded, 1000, original, sizeof(original));
+
+    FILE *trace = fopen(TRACE_FILE, "w");
+    if (trace == NULL) {
+        perror(TRACE_FILE);
+        return false;
+    }
+    fprintf(trace, "# Written by rsl10_receive_bench\n");
+    int ms = 0;
+    for (char *line = original; line < original + length; ms += 10) {
+        char *end = memchr(line, '\n', (size_t)(original + length - line));
+        fprintf(trace, "TRACE %d %.*s\n", ms, (int)(end - line), line);
+        line = end + 1;
+    }
+    fclose(trace);
+
+    int fd = open(TRACE_FILE, O_RDONLY);
+    bool read = fd >= 0 && rsl10LoadGenInitReplay(&replay, fd, 0);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!read) {
+        fprintf(stderr, "Cannot replay %s\n", TRACE_FILE);
+        return false;
+    }
+
+    // The replay starts over straight after its last line, so the next loop can begin in the
+    // same fill
+    size_t replayedLength = rsl10LoadGenFill(&replay, 995, replayed, sizeof(replayed));
+    bool identical = replayedLength >= length && memcmp(replayed, original, length) == 0;
+
+    printf("replay: %llu lines recorded, %s when replayed, %llu lines and %u loops by 995 ms\n",
+           (unsigned long long)recorded.lines, identical ? "identical" : "DIFFERENT",
+           (unsigned long long)replay.lines, (unsigned)replay.loops);
+
+    rsl10LoadGenClose(&replay);
+    unlink(TRACE_FILE);
+    return identical && replay.loops > 0;
+}
+
+int main(void)
+{
+    run_in_process(0);
+    run_in_process(5);
+
+    if (!run_pty() || !run_replay()) {
+        return 1;
+    }
+    return 0;
+}
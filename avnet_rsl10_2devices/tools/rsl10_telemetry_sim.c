@@ -0,0 +1,101 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, runs rsl10.c's telemetry against simulated devices and counts the messages and
+   payload bytes it publishes per period. Every period each device sends 30 environmental and 30
+   battery adverts. The options and device count come from the command line, e.g. for 50
+   devices with aggregation and stats:
+
+   Build: gcc -O2 -I host -I .. -DMAX_RSL10_DEVICES=50 -DSEND_RSL10_AGGREGATED_TELEMETRY
+              -DSEND_RSL10_TELEMETRY_STATS -o rsl10_telemetry_sim rsl10_telemetry_sim.c
+              ../rsl10.c ../rsl10_decode.c ../rsl10_onboarding.c -lm
+   Usage: rsl10_telemetry_sim [periods] [-v to print each message]
+*/
+
+#include "rsl10.h"
+
+#include <stdarg.h>
+
+#define ADVERTS_PER_PERIOD 30
+
+static long publishes;
+static long publishedBytes;
+static size_t largestMessage;
+static bool verbose;
+
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties)
+{
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+
+    if (verbose) {
+        printf("%.*s\n", (int)messageLength, (const char *)message);
+    }
+    publishes++;
+    publishedBytes += (long)messageLength;
+    if (messageLength > largestMessage) {
+        largestMessage = messageLength;
+    }
+    return true;
+}
+
+void async_log_write(ASYNC_LOG_SITE *site, const char *format, ...)
+{
+    (void)site;
+    (void)format;
+}
+
+static void send_adverts(int8_t device, int sample)
+{
+    Rsl10Advert_t environmental = {.type = RSL10_MSG_ENVIRONMENTAL,
+                                   .rssi = (int16_t)(-40 - (sample + device) % 30)};
+    environmental.environmental.temperature = (uint16_t)(2100 + sample * 3 + device);
+    environmental.environmental.humidity = (uint16_t)(4000 + sample);
+    environmental.environmental.pressure = 10132500u + (uint32_t)sample * 7;
+    rsl10ProcessEnvironmentalMessage(&environmental, device);
+
+    Rsl10Advert_t battery = {.type = RSL10_MSG_BATTERY, .rssi = -50};
+    battery.battery.millivolts = 3010;
+    rsl10ProcessBatteryMessage(&battery, device);
+}
+
+int main(int argc, char *argv[])
+{
+    long periods = 10;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            periods = strtol(argv[i], NULL, 10);
+        }
+    }
+    if (periods <= 0) {
+        fprintf(stderr, "Usage: rsl10_telemetry_sim [periods] [-v]\n");
+        return 1;
+    }
+
+    for (int8_t device = 0; device < MAX_RSL10_DEVICES; device++) {
+        Rsl10DeviceList[device].isActive = true;
+        snprintf(Rsl10DeviceList[device].bdAddress, sizeof(Rsl10DeviceList[device].bdAddress),
+                 "00:AB:89:67:%02X:01", (unsigned)device);
+        snprintf(Rsl10DeviceList[device].telemetryKey, sizeof(Rsl10DeviceList[device].telemetryKey),
+                 "Device%d", device);
+    }
+
+    for (long period = 0; period < periods; period++) {
+        for (int sample = 0; sample < ADVERTS_PER_PERIOD; sample++) {
+            for (int8_t device = 0; device < MAX_RSL10_DEVICES; device++) {
+                send_adverts(device, sample);
+            }
+        }
+        rsl10SendTelemetry();
+    }
+
+    printf("%d devices: %.1f messages and %.0f bytes per period, largest message %zu bytes\n",
+           MAX_RSL10_DEVICES, (double)publishes / (double)periods,
+           (double)publishedBytes / (double)periods, largestMessage);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "adaptive_sampler.h"
+
+#include <applibs/log.h>
+#include <math.h>
+
+// Upper bound on how much one sample can shrink the period, so a single spike does not
+// jump straight from the floor rate to the fastest rate
+#define MAX_SPEEDUP 4.0
+
+static int clamp_period(const ADAPTIVE_SAMPLER *sampler, double periodMs)
+{
+    if (periodMs < sampler->minPeriodMs) {
+        return sampler->minPeriodMs;
+    }
+    if (periodMs > sampler->maxPeriodMs) {
+        return sampler->maxPeriodMs;
+    }
+    return (int)periodMs;
+}
+
+int adaptive_sampler_update(ADAPTIVE_SAMPLER *sampler, const double values[], size_t count)
+{
+    double activity = 0;
+
+    if (count > sampler->channelCount) {
+        count = sampler->channelCount;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ADAPTIVE_SAMPLER_CHANNEL *channel = &sampler->channels[i];
+        double change = sampler->primed ? fabs(values[i] - channel->last) : 0;
+
+        channel->last = values[i];
+        channel->averageChange += ADAPTIVE_SAMPLER_SMOOTHING * (change - channel->averageChange);
+
+        // A large single step or a sustained wobble both count, relative to the threshold
+        double score = fmax(change, channel->averageChange) / channel->threshold;
+        if (score > activity) {
+            activity = score;
+        }
+    }
+
+    if (sampler->periodMs == 0) {
+        sampler->periodMs = sampler->maxPeriodMs;
+    }
+
+    if (sampler->primed) {
+        if (activity >= 1) {
+            double speedup = fmin(1 + sampler->aggressiveness * activity, MAX_SPEEDUP);
+            sampler->periodMs = clamp_period(sampler, sampler->periodMs / speedup);
+        } else {
+            // Back off gently so a signal that settles for one sample is still watched closely
+            double slowdown = 1 + sampler->aggressiveness / 4;
+            sampler->periodMs = clamp_period(sampler, sampler->periodMs * slowdown + 1);
+        }
+    }
+
+    sampler->primed = true;
+    return sampler->periodMs;
+}
+
+bool adaptive_sampler_configure(ADAPTIVE_SAMPLER *sampler, const JSON_Object *settings)
+{
+    int minPeriodMs = sampler->minPeriodMs;
+    int maxPeriodMs = sampler->maxPeriodMs;
+    double aggressiveness = sampler->aggressiveness;
+
+    if (settings == NULL) {
+        return false;
+    }
+
+    if (json_object_has_value_of_type(settings, "minPeriodMs", JSONNumber)) {
+        minPeriodMs = (int)json_object_get_number(settings, "minPeriodMs");
+    }
+    if (json_object_has_value_of_type(settings, "maxPeriodMs", JSONNumber)) {
+        maxPeriodMs = (int)json_object_get_number(settings, "maxPeriodMs");
+    }
+    if (json_object_has_value_of_type(settings, "aggressiveness", JSONNumber)) {
+        aggressiveness = json_object_get_number(settings, "aggressiveness");
+    }
+
+    // 100 ms to 12 hours, the same outer bounds the fixed poll period accepts
+    if (minPeriodMs < 100 || maxPeriodMs > 12 * 60 * 60 * 1000 || minPeriodMs > maxPeriodMs ||
+        !(aggressiveness > 0 && aggressiveness <= 1)) {
+        Log_Debug("Adaptive sampling settings rejected: min %d ms, max %d ms, aggressiveness %.2f\n",
+                  minPeriodMs, maxPeriodMs, aggressiveness);
+        return false;
+    }
+
+    sampler->minPeriodMs = minPeriodMs;
+    sampler->maxPeriodMs = maxPeriodMs;
+    sampler->aggressiveness = aggressiveness;
+    if (sampler->periodMs != 0) {
+        sampler->periodMs = clamp_period(sampler, sampler->periodMs);
+    }
+
+    if (json_object_has_value_of_type(settings, "enabled", JSONBoolean)) {
+        sampler->enabled = json_object_get_boolean(settings, "enabled") == 1;
+    }
+    return true;
+}
@@ -19,6 +19,6 @@ typedef enum {
     ExitCode_ConsumeEventButtonHandler   = 4,
     ExitCode_ReadButtonAError            = 5,
     ExitCode_ReadButtonBError            = 6,   
-    ExitCode_ConsumeEventOledHandler     = 7,
-    ExitCode_rtAppInitFailed             = 8 // Is the real time application sidloaded onto the device?
+    ExitCode_rtAppInitFailed             = 8, // Is the real time application sidloaded onto the device?
+    ExitCode_TimerWheelInitFailed        = 9
 } App_Exit_Code;
\ No newline at end of file
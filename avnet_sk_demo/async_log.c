@@ -0,0 +1,645 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "async_log.h"
+
+#include <applibs/log.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
+
+#define ASYNC_LOG_MASK (ASYNC_LOG_CAPACITY - 1)
+
+// Longest conversion specification the writer rebuilds, e.g. "%-+08.3lld"
+#define MAX_SPEC_BYTES 16
+
+// Longest line the writer formats, longer lines are cut short
+#define LINE_BYTES 512
+
+typedef enum {
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_DOUBLE,
+    ARG_STRING,      // Offset of the copy in the record's text
+    ARG_WIDE_STRING, // %ls, converted to multibyte when it is copied, then as ARG_STRING
+    ARG_WIDE_CHAR,   // %lc
+    ARG_POINTER
+} ARG_KIND;
+
+typedef union {
+    long long integer;
+    double real;
+    const void *pointer;
+} ARG_VALUE;
+
+typedef struct {
+    size_t length; // Characters from the '%' to the conversion character inclusive
+    int stars;     // '*' width and precision, each takes an int argument first
+    ARG_KIND kind;
+    bool literalPercent;
+} CONVERSION;
+
+typedef struct {
+    const char *format;
+    uint32_t suppressed; // Messages this call site held back before this one
+    uint8_t argCount;
+    ARG_VALUE values[ASYNC_LOG_MAX_ARGS];
+    char text[ASYNC_LOG_TEXT_BYTES];
+} ASYNC_LOG_MESSAGE;
+
+// Ring cell, sequence tells producers and the writer thread who owns the cell
+typedef struct {
+    atomic_size_t sequence;
+    ASYNC_LOG_MESSAGE message;
+} ASYNC_LOG_RECORD;
+
+static ASYNC_LOG_RECORD records[ASYNC_LOG_CAPACITY];
+static atomic_size_t enqueue_position;
+static size_t dequeue_position; // Only touched by the writer thread
+
+static atomic_bool running;
+static atomic_uint producers; // Callers between checking running and waking the writer
+static atomic_bool closing;
+static atomic_bool wakeup_pending;
+static int wakeup_fd = -1;
+static pthread_t writer_thread;
+
+static atomic_uint stat_written;
+static atomic_uint stat_dropped;
+static atomic_uint stat_suppressed;
+
+/// <summary>
+/// Parse the conversion specification at format, which points at a '%'.
+/// </summary>
+/// <returns>false for conversions the writer cannot rebuild, such as %n and long double</returns>
+static bool parse_conversion(const char *format, CONVERSION *conversion)
+{
+    const char *p = format + 1;
+    int longs = 0;
+
+    *conversion = (CONVERSION){.kind = ARG_INT};
+
+    if (*p == '%') {
+        conversion->literalPercent = true;
+        conversion->length = 2;
+        return true;
+    }
+
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+        p++;
+    }
+    if (*p == '*') {
+        conversion->stars++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            conversion->stars++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    switch (*p) {
+    case 'h':
+        while (*p == 'h') {
+            p++;
+        }
+        break;
+    case 'l':
+        while (*p == 'l') {
+            longs++;
+            p++;
+        }
+        conversion->kind = longs == 1 ? ARG_LONG : ARG_LONG_LONG;
+        break;
+    case 'j':
+        conversion->kind = ARG_INTMAX;
+        p++;
+        break;
+    case 'z':
+    case 't':
+        conversion->kind = ARG_SIZE;
+        p++;
+        break;
+    case 'L':
+        return false;
+    default:
+        break;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        break;
+    case 'c':
+        if (longs == 1) {
+            conversion->kind = ARG_WIDE_CHAR;
+        }
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        conversion->kind = ARG_DOUBLE;
+        break;
+    case 's':
+        conversion->kind = longs == 1 ? ARG_WIDE_STRING : ARG_STRING;
+        break;
+    case 'p':
+        conversion->kind = ARG_POINTER;
+        break;
+    default:
+        return false;
+    }
+
+    conversion->length = (size_t)(p - format) + 1;
+    return conversion->length < MAX_SPEC_BYTES;
+}
+
+/// <summary>
+/// Convert a %ls argument into the record's text.
+/// </summary>
+/// <returns>Bytes used including the NULL, 0 if it does not fit or cannot be converted</returns>
+static size_t copy_wide_string(const wchar_t *string, char *text, size_t room)
+{
+    mbstate_t state = {0};
+    const wchar_t *source;
+
+    if (string == NULL) {
+        string = L"(null)";
+    }
+
+    // Every wide character takes at least one byte, so this rules out most strings that will
+    // not fit before converting anything
+    if (wcslen(string) + 1 > room) {
+        return 0;
+    }
+
+    source = string;
+    size_t length = wcsrtombs(NULL, &source, 0, &state);
+    if (length == (size_t)-1 || length + 1 > room) {
+        return 0;
+    }
+
+    source = string;
+    memset(&state, 0, sizeof(state));
+    wcsrtombs(text, &source, length + 1, &state);
+    return length + 1;
+}
+
+/// <summary>
+/// Copy the arguments format consumes from args into the message.
+/// </summary>
+/// <returns>false if the message cannot be deferred and has to be written now</returns>
+static bool capture_args(ASYNC_LOG_MESSAGE *record, const char *format, va_list args)
+{
+    size_t textUsed = 0;
+    CONVERSION conversion;
+
+    record->argCount = 0;
+
+    for (const char *p = strchr(format, '%'); p != NULL; p = strchr(p, '%')) {
+        if (!parse_conversion(p, &conversion)) {
+            return false;
+        }
+        p += conversion.length;
+
+        if (conversion.literalPercent) {
+            continue;
+        }
+        if (record->argCount + conversion.stars + 1 > ASYNC_LOG_MAX_ARGS) {
+            return false;
+        }
+
+        // The writer parses the format again, so only the values are kept
+        for (int i = 0; i < conversion.stars; i++) {
+            record->values[record->argCount++].integer = va_arg(args, int);
+        }
+
+        ARG_VALUE *value = &record->values[record->argCount++];
+
+        switch (conversion.kind) {
+        case ARG_INT:
+            value->integer = va_arg(args, int);
+            break;
+        case ARG_LONG:
+            value->integer = va_arg(args, long);
+            break;
+        case ARG_LONG_LONG:
+            value->integer = va_arg(args, long long);
+            break;
+        case ARG_INTMAX:
+            value->integer = (long long)va_arg(args, intmax_t);
+            break;
+        case ARG_SIZE:
+            value->integer = (long long)va_arg(args, size_t);
+            break;
+        case ARG_DOUBLE:
+            value->real = va_arg(args, double);
+            break;
+        case ARG_POINTER:
+            value->pointer = va_arg(args, void *);
+            break;
+        case ARG_WIDE_CHAR:
+            value->integer = (long long)va_arg(args, wint_t);
+            break;
+        case ARG_WIDE_STRING: {
+            size_t length = copy_wide_string(va_arg(args, const wchar_t *), record->text + textUsed,
+                                             sizeof(record->text) - textUsed);
+            if (length == 0) {
+                return false;
+            }
+            value->integer = (long long)textUsed;
+            textUsed += length;
+            break;
+        }
+        case ARG_STRING: {
+            const char *string = va_arg(args, const char *);
+            size_t length = strlen(string == NULL ? "(null)" : string) + 1;
+
+            if (textUsed + length > sizeof(record->text)) {
+                return false;
+            }
+            memcpy(record->text + textUsed, string == NULL ? "(null)" : string, length);
+            value->integer = (long long)textUsed;
+            textUsed += length;
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Rebuild the message on the writer thread, one conversion at a time.
+/// </summary>
+static void format_message(const ASYNC_LOG_MESSAGE *record, char *line, size_t size)
+{
+    const char *format = record->format;
+    size_t used = 0;
+    size_t arg = 0;
+    CONVERSION conversion;
+    char spec[MAX_SPEC_BYTES];
+
+    if (record->suppressed != 0) {
+        int written = snprintf(line, size, "(%lu similar messages suppressed) ",
+                               (unsigned long)record->suppressed);
+        used = written > 0 && (size_t)written < size ? (size_t)written : 0;
+    }
+
+    while (*format != '\0' && used < size - 1) {
+        const char *percent = strchr(format, '%');
+        size_t literal = percent == NULL ? strlen(format) : (size_t)(percent - format);
+
+        if (literal > size - 1 - used) {
+            literal = size - 1 - used;
+        }
+        memcpy(line + used, format, literal);
+        used += literal;
+        format += literal;
+
+        if (percent == NULL || used >= size - 1) {
+            break;
+        }
+
+        // Already parsed once when the record was captured
+        parse_conversion(format, &conversion);
+        memcpy(spec, format, conversion.length);
+        spec[conversion.length] = '\0';
+        format += conversion.length;
+
+        // The copy is already multibyte, "%ls" becomes "%s"
+        if (conversion.kind == ARG_WIDE_STRING) {
+            spec[conversion.length - 2] = 's';
+            spec[conversion.length - 1] = '\0';
+        }
+
+        if (conversion.literalPercent) {
+            line[used++] = '%';
+            continue;
+        }
+
+        int width = conversion.stars > 0 ? (int)record->values[arg++].integer : 0;
+        int precision = conversion.stars > 1 ? (int)record->values[arg++].integer : 0;
+        const ARG_VALUE *value = &record->values[arg++];
+        char *out = line + used;
+        size_t room = size - used;
+        int written = 0;
+
+#define FORMAT_VALUE(v)                                                                            \
+    (conversion.stars == 0   ? snprintf(out, room, spec, v)                                        \
+     : conversion.stars == 1 ? snprintf(out, room, spec, width, v)                                 \
+                             : snprintf(out, room, spec, width, precision, v))
+
+        switch (conversion.kind) {
+        case ARG_INT:
+            written = FORMAT_VALUE((int)value->integer);
+            break;
+        case ARG_LONG:
+            written = FORMAT_VALUE((long)value->integer);
+            break;
+        case ARG_LONG_LONG:
+            written = FORMAT_VALUE(value->integer);
+            break;
+        case ARG_INTMAX:
+            written = FORMAT_VALUE((intmax_t)value->integer);
+            break;
+        case ARG_SIZE:
+            written = FORMAT_VALUE((size_t)value->integer);
+            break;
+        case ARG_DOUBLE:
+            written = FORMAT_VALUE(value->real);
+            break;
+        case ARG_STRING:
+        case ARG_WIDE_STRING:
+            written = FORMAT_VALUE(record->text + value->integer);
+            break;
+        case ARG_WIDE_CHAR:
+            written = FORMAT_VALUE((wint_t)value->integer);
+            break;
+        case ARG_POINTER:
+            written = FORMAT_VALUE(value->pointer);
+            break;
+        }
+#undef FORMAT_VALUE
+
+        if (written > 0) {
+            used += (size_t)written < room ? (size_t)written : room - 1;
+        }
+    }
+
+    line[used] = '\0';
+}
+
+static bool dequeue_and_write(void)
+{
+    ASYNC_LOG_RECORD *record = &records[dequeue_position & ASYNC_LOG_MASK];
+    char line[LINE_BYTES];
+
+    if (atomic_load_explicit(&record->sequence, memory_order_acquire) != dequeue_position + 1) {
+        return false; // Empty, or the producer has not finished writing the record
+    }
+
+    format_message(&record->message, line, sizeof(line));
+    atomic_store_explicit(&record->sequence, dequeue_position + ASYNC_LOG_CAPACITY,
+                          memory_order_release);
+    dequeue_position++;
+
+    Log_Debug("%s", line);
+    atomic_fetch_add_explicit(&stat_written, 1, memory_order_relaxed);
+    return true;
+}
+
+static void *writer(void *arg)
+{
+    uint64_t count;
+    unsigned reportedDrops = 0;
+
+#ifdef SCHED_IDLE
+    // Only run when nothing else wants the CPU, not supported everywhere so failure is ignored
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &(struct sched_param){0});
+#endif // SCHED_IDLE
+
+    for (;;) {
+        if (read(wakeup_fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+            Log_Debug("ERROR: async log eventfd read: errno=%d (%s)\n", errno, strerror(errno));
+            break;
+        }
+
+        // Clear before draining, any message queued from here on raises a new wake up
+        atomic_store(&wakeup_pending, false);
+
+        while (dequeue_and_write()) {
+        }
+
+        unsigned drops = atomic_load_explicit(&stat_dropped, memory_order_relaxed);
+        if (drops != reportedDrops) {
+            Log_Debug("WARNING: async log dropped %u messages, the ring was full\n",
+                      drops - reportedDrops);
+            reportedDrops = drops;
+        }
+
+        if (atomic_load(&closing)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void wake_writer(void)
+{
+    uint64_t one = 1;
+
+    if (!atomic_exchange(&wakeup_pending, true)) {
+        if (write(wakeup_fd, &one, sizeof(one)) < 0) {
+            Log_Debug("ERROR: async log eventfd write: errno=%d (%s)\n", errno, strerror(errno));
+        }
+    }
+}
+
+static int64_t now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Count the message against its call site's window, false if it should be suppressed
+static bool site_allows(ASYNC_LOG_SITE *site)
+{
+    int64_t now = now_ms();
+    int_fast64_t windowStart = atomic_load_explicit(&site->windowStartMs, memory_order_relaxed);
+
+    if (now - windowStart >= ASYNC_LOG_SITE_WINDOW_MS &&
+        atomic_compare_exchange_strong_explicit(&site->windowStartMs, &windowStart, now,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        atomic_store_explicit(&site->windowCount, 0, memory_order_relaxed);
+    }
+
+    if (atomic_fetch_add_explicit(&site->windowCount, 1, memory_order_relaxed) >=
+        ASYNC_LOG_SITE_BURST) {
+        atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stat_suppressed, 1, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// Producers register before checking running, so async_log_close() can wait for any that saw it
+// set to finish with the eventfd before closing it
+static bool producer_enter(void)
+{
+    atomic_fetch_add(&producers, 1);
+    if (atomic_load(&running)) {
+        return true;
+    }
+    atomic_fetch_sub(&producers, 1);
+    return false;
+}
+
+static void producer_leave(void)
+{
+    atomic_fetch_sub(&producers, 1);
+}
+
+static void write_now(uint32_t suppressed, const char *format, va_list args)
+{
+    if (suppressed != 0) {
+        Log_Debug("(%lu similar messages suppressed) ", (unsigned long)suppressed);
+    }
+    Log_DebugVarArgs(format, args);
+}
+
+void async_log_write(ASYNC_LOG_SITE *site, const char *format, ...)
+{
+    va_list args;
+    ASYNC_LOG_MESSAGE message;
+    ASYNC_LOG_RECORD *record = NULL;
+
+    if (!site_allows(site)) {
+        return;
+    }
+
+    uint32_t suppressed = atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+
+    va_start(args, format);
+
+    // Errors go out straight away, as does anything with too many arguments or strings too
+    // long to copy into a record
+    if (site->level == ASYNC_LOG_LEVEL_ERROR || !producer_enter()) {
+        write_now(suppressed, format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list capture;
+    va_copy(capture, args);
+    bool deferred = capture_args(&message, format, capture);
+    va_end(capture);
+
+    if (!deferred) {
+        producer_leave();
+        write_now(suppressed, format, args);
+        va_end(args);
+        return;
+    }
+    va_end(args);
+
+    message.format = format;
+    message.suppressed = suppressed;
+
+    size_t position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+    for (;;) {
+        ASYNC_LOG_RECORD *cell = &records[position & ASYNC_LOG_MASK];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                record = cell;
+                break;
+            }
+        } else if (difference < 0) {
+            break; // Full
+        } else {
+            position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+        }
+    }
+
+    if (record == NULL) {
+        // Still owed to the call site, the next message that gets into the ring reports it
+        atomic_fetch_add_explicit(&site->suppressed, suppressed, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stat_dropped, 1, memory_order_relaxed);
+    } else {
+        record->message = message;
+        atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+    }
+    wake_writer();
+    producer_leave();
+}
+
+bool async_log_init(void)
+{
+    for (size_t i = 0; i < ASYNC_LOG_CAPACITY; i++) {
+        atomic_init(&records[i].sequence, i);
+    }
+    atomic_init(&enqueue_position, 0);
+    dequeue_position = 0;
+    atomic_init(&wakeup_pending, false);
+    atomic_init(&producers, 0);
+    atomic_init(&closing, false);
+
+    wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (wakeup_fd == -1) {
+        Log_Debug("ERROR: async log eventfd: errno=%d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    if (pthread_create(&writer_thread, NULL, writer, NULL) != 0) {
+        Log_Debug("ERROR: async log writer thread could not be started\n");
+        close(wakeup_fd);
+        wakeup_fd = -1;
+        return false;
+    }
+
+    atomic_store(&running, true);
+    return true;
+}
+
+void async_log_close(void)
+{
+    uint64_t one = 1;
+
+    if (!atomic_exchange(&running, false)) {
+        return;
+    }
+
+    // New messages are now written synchronously, wait for any still queueing one
+    while (atomic_load(&producers) != 0) {
+        sched_yield();
+    }
+
+    // The writer drains the ring before it sees closing
+    atomic_store(&closing, true);
+    if (write(wakeup_fd, &one, sizeof(one)) < 0) {
+        Log_Debug("ERROR: async log eventfd write: errno=%d (%s)\n", errno, strerror(errno));
+    }
+    pthread_join(writer_thread, NULL);
+
+    close(wakeup_fd);
+    wakeup_fd = -1;
+}
+
+void async_log_get_stats(ASYNC_LOG_STATS *stats)
+{
+    stats->written = atomic_load(&stat_written);
+    stats->dropped = atomic_load(&stat_dropped);
+    stats->suppressed = atomic_load(&stat_suppressed);
+}
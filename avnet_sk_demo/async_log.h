@@ -0,0 +1,119 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Applications with a build_options.h set ASYNC_LOG_LEVEL there
+#if __has_include("build_options.h")
+#include "build_options.h"
+#endif
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Deferred debug logging. A log call copies the format string pointer and the raw argument
+// values into a lock free ring and returns. Number and text formatting, and the Log_Debug
+// write, happen later on a low priority writer thread. The format string is only scanned for
+// argument types at the call site, %s and %ls arguments are copied so the caller's buffer can
+// change, %ls converted to multibyte on the way.
+//
+// Calls below ASYNC_LOG_LEVEL compile to nothing. Each call site allows ASYNC_LOG_SITE_BURST
+// messages per ASYNC_LOG_SITE_WINDOW_MS, the rest are counted and reported with the next
+// message that gets through. Deferred messages are lost if the application crashes before
+// the writer thread catches up, so ASYNC_LOG_ERROR() writes synchronously.
+//
+// avnet_sk_demo holds the canonical copy of this module, timer_example and avnet_rsl10_2devices
+// identical ones. avnet_sk_demo/tools/async_log_bench.c measures what a call costs the caller.
+
+#define ASYNC_LOG_LEVEL_ERROR 0
+#define ASYNC_LOG_LEVEL_WARNING 1
+#define ASYNC_LOG_LEVEL_INFO 2
+#define ASYNC_LOG_LEVEL_DEBUG 3
+#define ASYNC_LOG_LEVEL_TRACE 4
+
+#ifndef ASYNC_LOG_LEVEL
+#define ASYNC_LOG_LEVEL ASYNC_LOG_LEVEL_DEBUG
+#endif
+
+// Messages waiting for the writer thread, must be a power of two. A full ring drops messages
+// and the writer reports how many.
+#ifndef ASYNC_LOG_CAPACITY
+#define ASYNC_LOG_CAPACITY 64
+#endif
+
+#define ASYNC_LOG_MAX_ARGS 8
+
+// Room in each record for copies of %s arguments. Messages whose strings do not fit are
+// written synchronously.
+#ifndef ASYNC_LOG_TEXT_BYTES
+#define ASYNC_LOG_TEXT_BYTES 96
+#endif
+
+#define ASYNC_LOG_SITE_BURST 10
+#define ASYNC_LOG_SITE_WINDOW_MS 1000
+
+typedef struct {
+    uint8_t level;
+    atomic_int_fast64_t windowStartMs;
+    atomic_uint windowCount;
+    atomic_uint suppressed;
+} ASYNC_LOG_SITE;
+
+typedef struct {
+    uint32_t written;    // Messages formatted and written by the writer thread
+    uint32_t dropped;    // Messages lost because the ring was full
+    uint32_t suppressed; // Messages held back by the per call site rate limit
+} ASYNC_LOG_STATS;
+
+/// <summary>
+/// Start the writer thread. Until then, and after async_log_close(), log calls fall back to a
+/// synchronous Log_Debug.
+/// </summary>
+bool async_log_init(void);
+
+/// <summary>
+/// Write everything still queued and stop the writer thread.
+/// </summary>
+void async_log_close(void);
+
+void async_log_get_stats(ASYNC_LOG_STATS *stats);
+
+void async_log_write(ASYNC_LOG_SITE *site, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#define ASYNC_LOG_AT(logLevel, ...)                                                                \
+    do {                                                                                           \
+        static ASYNC_LOG_SITE async_log_site_ = {.level = logLevel};                               \
+        async_log_write(&async_log_site_, __VA_ARGS__);                                            \
+    } while (0)
+
+#if ASYNC_LOG_LEVEL >= ASYNC_LOG_LEVEL_ERROR
+#define ASYNC_LOG_ERROR(...) ASYNC_LOG_AT(ASYNC_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define ASYNC_LOG_ERROR(...) ((void)0)
+#endif
+
+#if ASYNC_LOG_LEVEL >= ASYNC_LOG_LEVEL_WARNING
+#define ASYNC_LOG_WARNING(...) ASYNC_LOG_AT(ASYNC_LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define ASYNC_LOG_WARNING(...) ((void)0)
+#endif
+
+#if ASYNC_LOG_LEVEL >= ASYNC_LOG_LEVEL_INFO
+#define ASYNC_LOG_INFO(...) ASYNC_LOG_AT(ASYNC_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define ASYNC_LOG_INFO(...) ((void)0)
+#endif
+
+#if ASYNC_LOG_LEVEL >= ASYNC_LOG_LEVEL_DEBUG
+#define ASYNC_LOG_DEBUG(...) ASYNC_LOG_AT(ASYNC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define ASYNC_LOG_DEBUG(...) ((void)0)
+#endif
+
+#if ASYNC_LOG_LEVEL >= ASYNC_LOG_LEVEL_TRACE
+#define ASYNC_LOG_TRACE(...) ASYNC_LOG_AT(ASYNC_LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define ASYNC_LOG_TRACE(...) ((void)0)
+#endif
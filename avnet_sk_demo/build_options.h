@@ -51,6 +51,37 @@
 // Define how long after processing the haltApplication direct method before the application exits
 #define HALT_APPLICATION_DELAY_TIME_SECONDS 5
 
+// Run all application timers from one timerfd through a hierarchical timer wheel instead of
+// a kernel timer per DX_TIMER_BINDING, see timer_wheel.h
+//#define USE_TIMER_WHEEL
+
+// Run the timer wheel on a simulated clock and replace the event loop in main() with
+// virtual_clock_run(). Time jumps straight to the next due timer or injected event, so
+// SIMULATION_DURATION_SECONDS of operation runs in seconds. For soak testing on a Linux host,
+// see virtual_clock.h and tools/sk_demo_soak.c
+//#define USE_VIRTUAL_CLOCK
+#ifdef USE_VIRTUAL_CLOCK
+// The DevX timers only run on real time
+#ifndef USE_TIMER_WHEEL
+#define USE_TIMER_WHEEL
+#endif // USE_TIMER_WHEEL
+#define SIMULATION_DURATION_SECONDS (7 * 24 * 60 * 60)
+// How often, in simulated time, the run reports its progress and memory use
+#define SIMULATION_REPORT_PERIOD_SECONDS (60 * 60)
+#endif // USE_VIRTUAL_CLOCK
+
+// Record call counts, run times and timer fire latency for every handler. The worst offenders
+// are logged every PROFILER_REPORT_PERIOD_SECONDS and returned by the getHandlerProfile direct
+// method, see handler_profiler.h
+//#define ENABLE_HANDLER_PROFILER
+
+// Most verbose ASYNC_LOG_* messages compiled in, lower levels compile to nothing. The sensor and
+// telemetry traces are ASYNC_LOG_DEBUG, intercore heartbeats ASYNC_LOG_TRACE, see async_log.h
+#define ASYNC_LOG_LEVEL ASYNC_LOG_LEVEL_DEBUG
+// Room for the telemetry JSON the publish handlers echo, so it is copied rather than written
+// synchronously
+#define ASYNC_LOG_TEXT_BYTES 256
+
 // Enables I2C read/write debug
 //#define ENABLE_READ_WRITE_DEBUG
 
@@ -0,0 +1,257 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "handler_profiler.h"
+
+#ifdef ENABLE_HANDLER_PROFILER
+
+#include <applibs/log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Every handler that has run at least once, in first call order
+static PROFILER_ENTRY *entries = NULL;
+
+// The schedule of each DevX timer, by handler. Slots are never reused, entries keep a pointer.
+typedef struct PROFILER_TIMER {
+    const void *handler;
+    int64_t armedNs;  // When the timer was last started or set
+    int64_t delayNs;  // First expiry after armedNs
+    int64_t periodNs; // 0 for a one shot timer
+    bool pending;     // A one shot timer that has not expired yet
+} PROFILER_TIMER;
+
+static PROFILER_TIMER timers[PROFILER_MAX_TIMERS];
+static size_t timersUsed = 0;
+
+int64_t profiler_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void profiler_record(PROFILER_ENTRY *entry, int64_t runNs, int64_t latencyNs)
+{
+    if (!entry->registered) {
+        entry->registered = true;
+        entry->next = entries;
+        entries = entry;
+    }
+
+    entry->calls++;
+    entry->totalRunNs += (uint64_t)runNs;
+    if ((uint64_t)runNs > entry->maxRunNs) {
+        entry->maxRunNs = (uint64_t)runNs;
+    }
+
+    if (latencyNs >= 0) {
+        entry->latencySamples++;
+        entry->totalLatencyNs += (uint64_t)latencyNs;
+        if ((uint64_t)latencyNs > entry->maxLatencyNs) {
+            entry->maxLatencyNs = (uint64_t)latencyNs;
+        }
+    }
+}
+
+PROFILER_SCOPE profiler_scope_begin(PROFILER_ENTRY *entry)
+{
+    return (PROFILER_SCOPE){.entry = entry, .startNs = profiler_now_ns(), .latencyNs = -1};
+}
+
+void profiler_scope_end(PROFILER_SCOPE *scope)
+{
+    profiler_record(scope->entry, profiler_now_ns() - scope->startNs, scope->latencyNs);
+}
+
+static PROFILER_TIMER *find_timer(const void *handler)
+{
+    for (size_t i = 0; i < timersUsed; i++) {
+        if (timers[i].handler == handler) {
+            return &timers[i];
+        }
+    }
+    return NULL;
+}
+
+PROFILER_SCOPE profiler_timer_scope_begin(PROFILER_ENTRY *entry, const void *handler)
+{
+    PROFILER_SCOPE scope = profiler_scope_begin(entry);
+    PROFILER_TIMER *timer = entry->timer;
+
+    if (timer == NULL) {
+        timer = entry->timer = find_timer(handler);
+        if (timer == NULL) {
+            return scope;
+        }
+    }
+
+    int64_t sinceFirstNs = scope.startNs - timer->armedNs - timer->delayNs;
+    if (sinceFirstNs < 0) {
+        return scope;
+    }
+
+    if (timer->periodNs != 0) {
+        scope.latencyNs = sinceFirstNs % timer->periodNs;
+    } else if (timer->pending) {
+        scope.latencyNs = sinceFirstNs;
+        timer->pending = false;
+    }
+    return scope;
+}
+
+void profiler_timer_scheduled(const void *handler, int64_t delayNs, int64_t periodNs)
+{
+    PROFILER_TIMER *timer = find_timer(handler);
+
+    if (timer == NULL) {
+        if (timersUsed == PROFILER_MAX_TIMERS) {
+            Log_Debug("ERROR: profiler keeps %d timer schedules, raise PROFILER_MAX_TIMERS\n",
+                      PROFILER_MAX_TIMERS);
+            return;
+        }
+        timer = &timers[timersUsed++];
+        timer->handler = handler;
+    }
+
+    timer->armedNs = profiler_now_ns();
+    timer->delayNs = delayNs;
+    timer->periodNs = periodNs;
+    timer->pending = delayNs != 0;
+}
+
+#ifndef USE_TIMER_WHEEL
+static int64_t timespec_ns(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+void profiler_timer_set_start(DX_TIMER_BINDING *timerSet[], size_t timerCount)
+{
+    dx_timerSetStart(timerSet, timerCount);
+
+    // Timers with a zero period stay disarmed until profiler_timer_oneshot_set()
+    for (size_t i = 0; i < timerCount; i++) {
+        int64_t periodNs = timespec_ns(&timerSet[i]->period);
+        if (periodNs != 0) {
+            profiler_timer_scheduled((const void *)timerSet[i]->handler, periodNs, periodNs);
+        }
+    }
+}
+
+bool profiler_timer_change(DX_TIMER_BINDING *timer, const struct timespec *period)
+{
+    if (!dx_timerChange(timer, period)) {
+        return false;
+    }
+    profiler_timer_scheduled((const void *)timer->handler, timespec_ns(period), timespec_ns(period));
+    return true;
+}
+
+bool profiler_timer_oneshot_set(DX_TIMER_BINDING *timer, const struct timespec *delay)
+{
+    if (!dx_timerOneShotSet(timer, delay)) {
+        return false;
+    }
+    profiler_timer_scheduled((const void *)timer->handler, timespec_ns(delay), 0);
+    return true;
+}
+#endif // USE_TIMER_WHEEL
+
+// Fill worst[] with the entries that have the longest max run time, longest first
+static size_t worst_offenders(PROFILER_ENTRY *worst[PROFILER_REPORT_ENTRIES])
+{
+    size_t count = 0;
+
+    for (PROFILER_ENTRY *entry = entries; entry != NULL; entry = entry->next) {
+        size_t position = count;
+
+        if (entry->calls == 0) {
+            continue;
+        }
+
+        while (position > 0 && worst[position - 1]->maxRunNs < entry->maxRunNs) {
+            position--;
+        }
+
+        if (position < PROFILER_REPORT_ENTRIES) {
+            size_t last = count < PROFILER_REPORT_ENTRIES ? count : PROFILER_REPORT_ENTRIES - 1;
+            memmove(&worst[position + 1], &worst[position], (last - position) * sizeof(worst[0]));
+            worst[position] = entry;
+            if (count < PROFILER_REPORT_ENTRIES) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static unsigned long average_us(uint64_t totalNs, uint32_t samples)
+{
+    return samples == 0 ? 0 : (unsigned long)(totalNs / samples / 1000);
+}
+
+void profiler_log_report(void)
+{
+    PROFILER_ENTRY *worst[PROFILER_REPORT_ENTRIES];
+    size_t count = worst_offenders(worst);
+
+    Log_Debug("Handler profile, %zu slowest (us): calls avg max | late avg max\n", count);
+
+    for (size_t i = 0; i < count; i++) {
+        PROFILER_ENTRY *entry = worst[i];
+        Log_Debug("  %-32s %8lu %8lu %8lu | %8lu %8lu\n", entry->name, (unsigned long)entry->calls,
+                  average_us(entry->totalRunNs, entry->calls),
+                  (unsigned long)(entry->maxRunNs / 1000),
+                  average_us(entry->totalLatencyNs, entry->latencySamples),
+                  (unsigned long)(entry->maxLatencyNs / 1000));
+    }
+}
+
+char *profiler_report_json(void)
+{
+    static const char entryFormat[] =
+        "%s{\"name\":\"%s\",\"calls\":%lu,\"avgUs\":%lu,\"maxUs\":%lu,\"avgLateUs\":%lu,"
+        "\"maxLateUs\":%lu}";
+    PROFILER_ENTRY *worst[PROFILER_REPORT_ENTRIES];
+    size_t count = worst_offenders(worst);
+    size_t size = 32 + count * (sizeof(entryFormat) + 64 + 6 * 20);
+    char *json = malloc(size);
+
+    if (json == NULL) {
+        return NULL;
+    }
+
+    size_t len = (size_t)snprintf(json, size, "{\"handlers\":[");
+
+    for (size_t i = 0; i < count; i++) {
+        PROFILER_ENTRY *entry = worst[i];
+        int written = snprintf(json + len, size - len, entryFormat, i == 0 ? "" : ",",
+                               entry->name, (unsigned long)entry->calls,
+                               average_us(entry->totalRunNs, entry->calls),
+                               (unsigned long)(entry->maxRunNs / 1000),
+                               average_us(entry->totalLatencyNs, entry->latencySamples),
+                               (unsigned long)(entry->maxLatencyNs / 1000));
+        if (written < 0 || (size_t)written >= size - len) {
+            break;
+        }
+        len += (size_t)written;
+    }
+
+    snprintf(json + len, size - len, "]}");
+    return json;
+}
+
+void profiler_reset(void)
+{
+    for (PROFILER_ENTRY *entry = entries; entry != NULL; entry = entry->next) {
+        entry->calls = 0;
+        entry->totalRunNs = entry->maxRunNs = 0;
+        entry->latencySamples = 0;
+        entry->totalLatencyNs = entry->maxLatencyNs = 0;
+    }
+}
+
+#endif // ENABLE_HANDLER_PROFILER
@@ -0,0 +1,127 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "build_options.h"
+
+// Enable ENABLE_HANDLER_PROFILER in build_options.h to record how long every timer, async,
+// device twin, direct method and intercore handler runs, and how late timers and async events
+// are handled. The APP_*_HANDLER macros in main.h start each handler with PROFILE_HANDLER(), a
+// handler written with them is profiled without further changes. The timer wheel and the async
+// queue profile the handlers they dispatch. When it is not defined the PROFILE_* macros expand
+// to nothing and none of this file is compiled.
+//
+// The DevX timers do not say when a handler was due. Start and set them through the
+// profiler_timer_* calls below, the app_timer* aliases in main.h do, and PROFILE_TIMER_HANDLER()
+// works the due time out from the timer's schedule.
+//
+// Enabled cost per handler call, see avnet_sk_demo/tools/handler_profiler_bench.c: two
+// clock_gettime(CLOCK_MONOTONIC) calls and a handful of additions on the event loop thread, no
+// locks and no allocation.
+//
+// avnet_sk_demo holds the canonical copy of this module, async_example an identical one.
+
+#ifdef ENABLE_HANDLER_PROFILER
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How often the worst offenders are written to the debug log
+#define PROFILER_REPORT_PERIOD_SECONDS 60
+
+// Number of handlers listed in the log report and the getHandlerProfile response
+#define PROFILER_REPORT_ENTRIES 5
+
+// DevX timers whose schedule is kept, one per handler
+#define PROFILER_MAX_TIMERS 32
+
+struct PROFILER_TIMER;
+
+typedef struct PROFILER_ENTRY {
+    const char *name;
+    struct PROFILER_ENTRY *next;
+    struct PROFILER_TIMER *timer; // The DevX timer schedule, found on the first call
+    bool registered;
+    uint32_t calls;
+    uint64_t totalRunNs;
+    uint64_t maxRunNs;
+    uint32_t latencySamples;
+    uint64_t totalLatencyNs;
+    uint64_t maxLatencyNs;
+} PROFILER_ENTRY;
+
+typedef struct {
+    PROFILER_ENTRY *entry;
+    int64_t startNs;
+    int64_t latencyNs;
+} PROFILER_SCOPE;
+
+int64_t profiler_now_ns(void);
+
+/// <summary>
+/// Record one handler call. latencyNs is how long after its due time the handler started,
+/// pass a negative value when that is not known.
+/// </summary>
+void profiler_record(PROFILER_ENTRY *entry, int64_t runNs, int64_t latencyNs);
+
+PROFILER_SCOPE profiler_scope_begin(PROFILER_ENTRY *entry);
+void profiler_scope_end(PROFILER_SCOPE *scope);
+
+/// <summary>
+/// Begin a DevX timer handler. The latency is how long after the timer's last expiry the
+/// handler started, taken from the schedule profiler_timer_scheduled() recorded for handler.
+/// A periodic timer more than a period late shows the remainder, the kernel folds the missed
+/// expiries into one call.
+/// </summary>
+PROFILER_SCOPE profiler_timer_scope_begin(PROFILER_ENTRY *entry, const void *handler);
+
+/// <summary>
+/// Record that the timer running handler was armed now, to first expire after delayNs and then
+/// every periodNs, 0 for a one shot timer.
+/// </summary>
+void profiler_timer_scheduled(const void *handler, int64_t delayNs, int64_t periodNs);
+
+/// <summary>
+/// Log the handlers with the longest worst case run time.
+/// </summary>
+void profiler_log_report(void);
+
+/// <summary>
+/// The same report as JSON, allocated with malloc for a direct method response.
+/// </summary>
+char *profiler_report_json(void);
+
+void profiler_reset(void);
+
+// First statement of a handler body, records the handler until its scope exits
+#define PROFILE_HANDLER()                                                                          \
+    static PROFILER_ENTRY profiler_entry_ = {.name = __func__};                                    \
+    PROFILER_SCOPE profiler_scope_ __attribute__((cleanup(profiler_scope_end))) =                 \
+        profiler_scope_begin(&profiler_entry_)
+
+#else
+
+#define PROFILE_HANDLER()
+
+#endif // ENABLE_HANDLER_PROFILER
+
+// The timer wheel profiles timers as it dispatches them, the DevX timers are profiled by their
+// handler, passing the handler function
+#if defined(ENABLE_HANDLER_PROFILER) && !defined(USE_TIMER_WHEEL)
+
+#include "dx_timer.h"
+
+#define PROFILE_TIMER_HANDLER(handler)                                                             \
+    static PROFILER_ENTRY profiler_entry_ = {.name = __func__};                                    \
+    PROFILER_SCOPE profiler_scope_ __attribute__((cleanup(profiler_scope_end))) =                 \
+        profiler_timer_scope_begin(&profiler_entry_, (const void *)handler)
+
+// dx_timerSetStart(), dx_timerChange() and dx_timerOneShotSet() that record the schedule
+void profiler_timer_set_start(DX_TIMER_BINDING *timerSet[], size_t timerCount);
+bool profiler_timer_change(DX_TIMER_BINDING *timer, const struct timespec *period);
+bool profiler_timer_oneshot_set(DX_TIMER_BINDING *timer, const struct timespec *delay);
+
+#else
+#define PROFILE_TIMER_HANDLER(handler)
+#endif
@@ -60,6 +60,7 @@ Acknowledgment: Built from ST Micro samples
 */
 
 #include "i2c.h"
+#include "virtual_clock.h"
 
 typedef union {
     int16_t i16bit[3];
@@ -175,12 +176,17 @@ static int32_t platform_read(void *handle, uint8_t reg, uint8_t *bufp, uint16_t
  */
 static void platform_delay(uint32_t ms)
 {
+#ifdef USE_VIRTUAL_CLOCK
+    // The sensor hub waits pass on the simulated clock
+    virtual_clock_sleep((int64_t)ms * 1000000);
+#else
     struct timespec ts;
 
     ts.tv_sec = (long int)(ms / 1000u);
     ts.tv_nsec = (long int)((ms - ((long unsigned int)ts.tv_sec * 1000u)) * 1000000u);
 
     nanosleep(&ts, NULL);
+#endif // USE_VIRTUAL_CLOCK
 }
 
 /*
@@ -23,13 +23,13 @@
 
 #include "main.h"
 
-static DX_TIMER_HANDLER(monitor_wifi_network_handler)
+static APP_TIMER_HANDLER(monitor_wifi_network_handler)
 {
     ReadWifiConfig(true);
 }
-DX_TIMER_HANDLER_END
+APP_TIMER_HANDLER_END
 
-static DX_TIMER_HANDLER(read_sensors_handler)
+static APP_TIMER_HANDLER(read_sensors_handler)
 {
     static bool firstPass = true;
 
@@ -56,12 +56,12 @@ static DX_TIMER_HANDLER(read_sensors_handler)
 
 
     if(sensor_debug_enabled){
-        Log_Debug("\nLSM6DSO: Acceleration      [g]   : %.4lf, %.4lf, %.4lf\n", acceleration_g.x,
+        ASYNC_LOG_DEBUG("\nLSM6DSO: Acceleration      [g]   : %.4lf, %.4lf, %.4lf\n", acceleration_g.x,
                 acceleration_g.y, acceleration_g.z);
-        Log_Debug("LSM6DSO: Angular rate      [dps] : %4.2f, %4.2f, %4.2f\n", angular_rate_dps.x,
+        ASYNC_LOG_DEBUG("LSM6DSO: Angular rate      [dps] : %4.2f, %4.2f, %4.2f\n", angular_rate_dps.x,
                 angular_rate_dps.y, angular_rate_dps.z);
-        Log_Debug("LSM6DSO: Temperature1      [degC]: %.2f\n", lsm6dso_temperature);
-        Log_Debug("ALSPT19: Ambient Light     [Lux] : %.2f\n", light_sensor);
+        ASYNC_LOG_DEBUG("LSM6DSO: Temperature1      [degC]: %.2f\n", lsm6dso_temperature);
+        ASYNC_LOG_DEBUG("ALSPT19: Ambient Light     [Lux] : %.2f\n", light_sensor);
     }
   	if (lps22hhDetected) {
 
@@ -79,25 +79,45 @@ static DX_TIMER_HANDLER(read_sensors_handler)
         lps22hh_temperature = lp_get_temperature_lps22h();
         
         if(sensor_debug_enabled){
-            Log_Debug("LPS22HH: Pressure          [hPa] : %.2f\n", pressure_hPa);
-            Log_Debug("LPS22HH: Pressure Altitude [m]   : %.2f\n", altitude);
-            Log_Debug("LPS22HH: Temperature2      [degC]: %.2f\n", lps22hh_temperature);
+            ASYNC_LOG_DEBUG("LPS22HH: Pressure          [hPa] : %.2f\n", pressure_hPa);
+            ASYNC_LOG_DEBUG("LPS22HH: Pressure Altitude [m]   : %.2f\n", altitude);
+            ASYNC_LOG_DEBUG("LPS22HH: Temperature2      [degC]: %.2f\n", lps22hh_temperature);
         }
     }
     // LPS22HH was not detected
     else {
 
        if(sensor_debug_enabled){
-            Log_Debug("LPS22HH: Pressure          [hPa] : Not read!\n");
-            Log_Debug("LPS22HH: Pressure Altitude [m]   : Not calculated!\n");
-            Log_Debug("LPS22HH: Temperature       [degC]: Not read!\n");
+            ASYNC_LOG_DEBUG("LPS22HH: Pressure          [hPa] : Not read!\n");
+            ASYNC_LOG_DEBUG("LPS22HH: Pressure Altitude [m]   : Not calculated!\n");
+            ASYNC_LOG_DEBUG("LPS22HH: Temperature       [degC]: Not read!\n");
        }
     }
 
+    if (sensor_sampler.enabled) {
+        adapt_sensor_read_period();
+    }
+
     // Send the latest readings up as telemetry
     publish_message_handler();
 }
-DX_TIMER_HANDLER_END
+APP_TIMER_HANDLER_END
+
+/// <summary>
+/// Feed the latest readings to the adaptive sampler and move tmr_read_sensors to the period it picks
+/// </summary>
+static void adapt_sensor_read_period(void)
+{
+    double readings[] = {acceleration_g.x, acceleration_g.y, acceleration_g.z,
+                         angular_rate_dps.x, angular_rate_dps.y, angular_rate_dps.z,
+                         lsm6dso_temperature, pressure_hPa};
+    int previous_period_ms = sensor_sampler.periodMs;
+    int period_ms = adaptive_sampler_update(&sensor_sampler, readings, NELEMS(readings));
+
+    if (period_ms != previous_period_ms) {
+        app_timerChange(&tmr_read_sensors, &(struct timespec){period_ms / 1000, (period_ms % 1000) * ONE_MS});
+    }
+}
 
 static void publish_message_handler(void)
 {
@@ -127,7 +147,7 @@ static void publish_message_handler(void)
 
         if (serialization_result) {
 
-            Log_Debug("%s\n", msgBuffer);
+            ASYNC_LOG_DEBUG("%s\n", msgBuffer);
 
 #ifdef USE_IOT_CONNECT
 
@@ -138,6 +158,7 @@ static void publish_message_handler(void)
             dx_azurePublish(msgBuffer, strlen(msgBuffer), messageProperties, NELEMS(messageProperties), &contentProperties);
 
 #endif  // USE_IOT_CONNECT
+            telemetry_messages_sent++;
 
         } else {
             Log_Debug("JSON Serialization failed: Buffer too small\n");
@@ -152,7 +173,7 @@ static void publish_message_handler(void)
             angular_rate_dps.y, angular_rate_dps.z, pressure_hPa, light_sensor, altitude,
             lsm6dso_temperature, network_data.rssi);                
 
-        Log_Debug("%s\n", msgBuffer);
+        ASYNC_LOG_DEBUG("%s\n", msgBuffer);
 
 #ifdef USE_IOT_CONNECT
 
@@ -163,19 +184,23 @@ static void publish_message_handler(void)
             dx_azurePublish(msgBuffer, strlen(msgBuffer), messageProperties, NELEMS(messageProperties), &contentProperties);
 
 #endif // USE_IOT_CONNECT
+            telemetry_messages_sent++;
 #endif // // !USE_DEVX_SERIALIZATION                    
         }
 #endif // IOT_HUB_APPLICATION    
 }
 
-static DX_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler, deviceTwinBinding)
+static APP_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler, deviceTwinBinding)
 {
     int sample_rate_seconds = *(int *)deviceTwinBinding->propertyValue;
 
     // validate data is sensible range before applying
     if (IN_RANGE(sample_rate_seconds, 1, 12*60*60)){ // 1 second to 10 hours
 
-        dx_timerChange(&tmr_read_sensors, &(struct timespec){sample_rate_seconds, 0});
+        // A fixed period takes over from adaptive sampling
+        sensor_sampler.enabled = false;
+        sensor_read_period_seconds = sample_rate_seconds;
+        app_timerChange(&tmr_read_sensors, &(struct timespec){sample_rate_seconds, 0});
 
 #ifdef USE_PNP
         dx_deviceTwinAckDesiredValue(deviceTwinBinding, deviceTwinBinding->propertyValue, DX_DEVICE_TWIN_RESPONSE_COMPLETED);
@@ -190,9 +215,30 @@ static DX_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler, deviceTwinBinding)
 
     }
 }
-DX_DEVICE_TWIN_HANDLER_END
+APP_DEVICE_TWIN_HANDLER_END
 
-static DX_DEVICE_TWIN_HANDLER(dt_gpio_handler, deviceTwinBinding)
+//  name: adaptiveSampling
+//  payload: {"enabled": <bool>, "minPeriodMs": <int>, "maxPeriodMs": <int>, "aggressiveness": <0 to 1>}
+//  While enabled the sensor read period moves between minPeriodMs and maxPeriodMs depending on
+//  how much the readings change. Turning it off goes back to the sensorPollPeriod period.
+static APP_DEVICE_TWIN_HANDLER(dt_adaptive_sampling_handler, deviceTwinBinding)
+{
+    bool was_enabled = sensor_sampler.enabled;
+
+    if (!adaptive_sampler_configure(&sensor_sampler, (JSON_Object *)deviceTwinBinding->propertyValue)) {
+        return;
+    }
+
+    Log_Debug("Adaptive sampling %s: %d to %d ms, aggressiveness %.2f\n", sensor_sampler.enabled ? "on" : "off",
+              sensor_sampler.minPeriodMs, sensor_sampler.maxPeriodMs, sensor_sampler.aggressiveness);
+
+    if (was_enabled && !sensor_sampler.enabled) {
+        app_timerChange(&tmr_read_sensors, &(struct timespec){sensor_read_period_seconds, 0});
+    }
+}
+APP_DEVICE_TWIN_HANDLER_END
+
+static APP_DEVICE_TWIN_HANDLER(dt_gpio_handler, deviceTwinBinding)
 {
     bool gpio_level = *(bool *)deviceTwinBinding->propertyValue;
 
@@ -212,9 +258,9 @@ static DX_DEVICE_TWIN_HANDLER(dt_gpio_handler, deviceTwinBinding)
 #endif // USE_PNP
     }
 }
-DX_DEVICE_TWIN_HANDLER_END
+APP_DEVICE_TWIN_HANDLER_END
 
-static DX_DEVICE_TWIN_HANDLER(dt_oled_message_handler, deviceTwinBinding)
+static APP_DEVICE_TWIN_HANDLER(dt_oled_message_handler, deviceTwinBinding)
 {
     bool message_processed = true;
     
@@ -248,9 +294,9 @@ static DX_DEVICE_TWIN_HANDLER(dt_oled_message_handler, deviceTwinBinding)
 #endif // USE_PNP        
     }
 }
-DX_DEVICE_TWIN_HANDLER_END
+APP_DEVICE_TWIN_HANDLER_END
 
-static DX_DEVICE_TWIN_HANDLER(dt_debug_handler, deviceTwinBinding)
+static APP_DEVICE_TWIN_HANDLER(dt_debug_handler, deviceTwinBinding)
 {
     sensor_debug_enabled = *(bool*)deviceTwinBinding->propertyValue;
 #ifdef USE_PNP
@@ -260,7 +306,7 @@ static DX_DEVICE_TWIN_HANDLER(dt_debug_handler, deviceTwinBinding)
 #endif // USE_PNP
 
 }
-DX_DEVICE_TWIN_HANDLER_END
+APP_DEVICE_TWIN_HANDLER_END
 
 
 static void NetworkConnectionState(bool connected)
@@ -333,7 +379,7 @@ static void ReadWifiConfig(bool outputDebug){
 
                 // Since we're connected to a wifi network and have reported the details to the IoTHub
                 // modify the timer frequency from the default of 30 seconds to every 5 minutes
-                dx_timerChange(&tmr_monitor_wifi_network, &(struct timespec){60*5, 0});
+                app_timerChange(&tmr_monitor_wifi_network, &(struct timespec){60*5, 0});
             }
         }
     }
@@ -345,7 +391,7 @@ static void ReadWifiConfig(bool outputDebug){
 ///  Payload: {"delayTime": 0 < delay in seconds > 12*60*60}
 ///  Start Reboot Device Direct Method 'RebootDevice' {"delayTime":15}
 /// </summary>
-static DX_DIRECT_METHOD_HANDLER(dm_restart_device_handler, json, directMethodBinding, responseMsg)
+static APP_DIRECT_METHOD_HANDLER(dm_restart_device_handler, json, directMethodBinding, responseMsg)
 {    
     char delay_str[] = "delayTime";
     int requested_delay_seconds;
@@ -364,7 +410,7 @@ static DX_DIRECT_METHOD_HANDLER(dm_restart_device_handler, json, directMethodBin
     if (IN_RANGE(requested_delay_seconds, 1, (12*60*60))) {
 
         // Set the timer to fire after the requested delayTime
-        dx_timerOneShotSet(&tmr_reboot, &(struct timespec){requested_delay_seconds, 0});
+        app_timerOneShotSet(&tmr_reboot, &(struct timespec){requested_delay_seconds, 0});
         return DX_METHOD_SUCCEEDED;
     
     }
@@ -372,38 +418,38 @@ static DX_DIRECT_METHOD_HANDLER(dm_restart_device_handler, json, directMethodBin
         return DX_METHOD_FAILED;
     }
 }
-DX_DIRECT_METHOD_HANDLER_END
+APP_DIRECT_METHOD_HANDLER_END
 
 /// <summary>
 ///  Function for rebootDevice directMethod
 ///  name: haltApplication
 ///  Payload: None
 /// </summary>
-static DX_DIRECT_METHOD_HANDLER(dm_halt_device_handler, json, directMethodBinding, responseMsg)
+static APP_DIRECT_METHOD_HANDLER(dm_halt_device_handler, json, directMethodBinding, responseMsg)
 {
     
     int requested_delay_seconds = HALT_APPLICATION_DELAY_TIME_SECONDS;
 
     // Set the timer to fire after the requested delayTime
-    dx_timerOneShotSet(&tmr_reboot, &(struct timespec){requested_delay_seconds, 0});
+    app_timerOneShotSet(&tmr_reboot, &(struct timespec){requested_delay_seconds, 0});
     return DX_METHOD_SUCCEEDED;
 }
-DX_DIRECT_METHOD_HANDLER_END
+APP_DIRECT_METHOD_HANDLER_END
 
 /// <summary>
 /// Restart the Device
 /// </summary>
-static DX_TIMER_HANDLER(delay_restart_timer_handler)
+static APP_TIMER_HANDLER(delay_restart_timer_handler)
 {
     PowerManagement_ForceSystemReboot();
 }
-DX_TIMER_HANDLER_END
+APP_TIMER_HANDLER_END
 
 /// </summary>
 ///  name: setSensor
 ///  payload: {"pollTime": 0 > integer < 12 hours >}
 /// </summary>
-static DX_DIRECT_METHOD_HANDLER(dm_set_sensor_poll_period, json, directMethodBinding, responseMsg)
+static APP_DIRECT_METHOD_HANDLER(dm_set_sensor_poll_period, json, directMethodBinding, responseMsg)
 {    
     char poll_str[] = "pollTime";
     int requested_poll_time_seconds;
@@ -421,8 +467,10 @@ static DX_DIRECT_METHOD_HANDLER(dm_set_sensor_poll_period, json, directMethodBin
     requested_poll_time_seconds = (int)json_object_get_number(jsonObject, poll_str);
     if (IN_RANGE(requested_poll_time_seconds, 1, (12*60*60))) {
 
-        // Set the timer to fire after the requested delayTime
-        dx_timerChange(&tmr_read_sensors, &(struct timespec){requested_poll_time_seconds, 0});
+        // Set the timer to fire after the requested delayTime, a fixed period takes over from adaptive sampling
+        sensor_sampler.enabled = false;
+        sensor_read_period_seconds = requested_poll_time_seconds;
+        app_timerChange(&tmr_read_sensors, &(struct timespec){requested_poll_time_seconds, 0});
         return DX_METHOD_SUCCEEDED;
     
     }
@@ -430,12 +478,12 @@ static DX_DIRECT_METHOD_HANDLER(dm_set_sensor_poll_period, json, directMethodBin
         return DX_METHOD_FAILED;    
     }
 }
-DX_DIRECT_METHOD_HANDLER_END
+APP_DIRECT_METHOD_HANDLER_END
 
 /// <summary>
 /// Handler to check for Button Presses
 /// </summary>
-static DX_TIMER_HANDLER(ButtonPressCheckHandler)
+static APP_TIMER_HANDLER(ButtonPressCheckHandler)
 {
     // Assume the device comes up with the buttons at rest
     static GPIO_Value_Type buttonAState = GPIO_Value_High;
@@ -461,7 +509,7 @@ static DX_TIMER_HANDLER(ButtonPressCheckHandler)
     ProcessButtonState(button_a_state, &buttonAState, "buttonA");
     ProcessButtonState(button_b_state, &buttonBState, "buttonB");
 }
-DX_TIMER_HANDLER_END
+APP_TIMER_HANDLER_END
 
 static void ProcessButtonState(GPIO_Value_Type new_state, GPIO_Value_Type* old_state, const char* telemetry_key){
 
@@ -510,7 +558,7 @@ static void SendButtonTelemetry(const char* telemetry_key, GPIO_Value_Type butto
 
     if (serialization_result) {
 
-        Log_Debug("%s\n", msgBuffer);
+        ASYNC_LOG_DEBUG("%s\n", msgBuffer);
 
 #ifdef USE_IOT_CONNECT
 
@@ -521,6 +569,7 @@ static void SendButtonTelemetry(const char* telemetry_key, GPIO_Value_Type butto
         dx_azurePublish(msgBuffer, strlen(msgBuffer), messageProperties, NELEMS(messageProperties), &contentProperties);
 
 #endif // USE_IOT_CONNECT
+        telemetry_messages_sent++;
 
     } else {
         Log_Debug("JSON Serialization failed\n");
@@ -529,17 +578,12 @@ static void SendButtonTelemetry(const char* telemetry_key, GPIO_Value_Type butto
 #endif // IOT_HUB_APPLICATION
 
 #ifdef OLED_SD1306
-static void UpdateOledEventHandler(EventLoopTimer *eventLoopTimer)
+static APP_TIMER_HANDLER(UpdateOledEventHandler)
 {
-
-    if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
-        dx_terminate(ExitCode_ConsumeEventOledHandler);
-        return;
-    }
-
 	// Update/refresh the OLED data
 	update_oled();
 }
+APP_TIMER_HANDLER_END
 #endif 
 
 #ifdef M4_INTERCORE_COMMS
@@ -548,7 +592,7 @@ static void UpdateOledEventHandler(EventLoopTimer *eventLoopTimer)
 /// This handler is called when the high level application receives a raw data read response from the 
 /// AvnetAls-PT19 real time application.
 /// </summary>
-static void alsPt19_receive_msg_handler(void *data_block, ssize_t message_length)
+static APP_INTERCORE_HANDLER(alsPt19_receive_msg_handler, data_block, message_length)
 {
 
 // Cast the data block so we can index into the data
@@ -560,7 +604,7 @@ switch (messageData->cmd) {
         light_sensor = (float)messageData->lightSensorLuxData;
         break;
     case IC_HEARTBEAT:
-        Log_Debug("IC_HEARTBEAT\n");
+        ASYNC_LOG_TRACE("IC_HEARTBEAT\n");
         break;
     case IC_READ_SENSOR_RESPOND_WITH_TELEMETRY:
         Log_Debug("IC_READ_SENSOR_RESPOND_WITH_TELEMETRY\n");
@@ -577,6 +621,7 @@ switch (messageData->cmd) {
         dx_azurePublish(messageData->telemetryJSON, strlen(messageData->telemetryJSON), messageProperties, NELEMS(messageProperties), &contentProperties);
 
 #endif // USE_IOT_CONNECT
+        telemetry_messages_sent++;
 #endif // IOT_HUB_APPLICATION
 
         break;
@@ -588,12 +633,68 @@ switch (messageData->cmd) {
         break;
     }
 }
+APP_INTERCORE_HANDLER_END
 #endif // M4_INTERCORE_COMMS
+#ifdef ENABLE_HANDLER_PROFILER
+/// <summary>
+/// Log the handlers with the longest run times
+/// </summary>
+static APP_TIMER_HANDLER(profiler_report_handler)
+{
+    profiler_log_report();
+}
+APP_TIMER_HANDLER_END
+
+/// <summary>
+///  name: getHandlerProfile
+///  payload: {"reset": <bool>} optional, clear the counters after reporting
+///  Returns the handlers with the longest run times, the same list profiler_report_handler logs
+/// </summary>
+static APP_DIRECT_METHOD_HANDLER(dm_handler_profile_handler, json, directMethodBinding, responseMsg)
+{
+    JSON_Object *jsonObject = json_value_get_object(json);
+
+    *responseMsg = profiler_report_json();
+    if (*responseMsg == NULL) {
+        return DX_METHOD_FAILED;
+    }
+
+    if (jsonObject != NULL && json_object_get_boolean(jsonObject, "reset") == 1) {
+        profiler_reset();
+    }
+    return DX_METHOD_SUCCEEDED;
+}
+APP_DIRECT_METHOD_HANDLER_END
+#endif // ENABLE_HANDLER_PROFILER
+
+#ifdef USE_VIRTUAL_CLOCK
+/// <summary>
+/// Log simulated progress, published message count and memory use so growth over a long
+/// simulated run shows up in the debug log
+/// </summary>
+static APP_TIMER_HANDLER(simulation_report_handler)
+{
+    VIRTUAL_CLOCK_STATS stats;
+    virtual_clock_get_stats(&stats);
+
+    Log_Debug("Simulated %lld s: timer wakeups %llu, injected events %llu, slept %lld ms, telemetry sent %lu, "
+              "memory %lu KB, peak %lu KB\n",
+              (long long)(stats.elapsedNs / 1000000000), (unsigned long long)stats.timerWakeups,
+              (unsigned long long)stats.injectedEvents, (long long)(stats.sleptNs / 1000000),
+              (unsigned long)telemetry_messages_sent,
+              (unsigned long)Applications_GetTotalMemoryUsageInKB(),
+              (unsigned long)Applications_GetPeakUserModeMemoryUsageInKB());
+}
+APP_TIMER_HANDLER_END
+#endif // USE_VIRTUAL_CLOCK
+
 /// <summary>
 ///  Initialize peripherals, device twins, direct methods, timer_bindings.
 /// </summary>
 static void InitPeripheralsAndHandlers(void)
 {
+    // Handlers log through the writer thread, if it cannot start they log synchronously
+    async_log_init();
 
 #ifdef USE_WEB_PROXY
     // Configure and enable the web proxy feature
@@ -611,7 +712,12 @@ static void InitPeripheralsAndHandlers(void)
 #endif // USE_IOT_CONNECT    
 #endif // IOT_HUB_APPLICATION    
     dx_gpioSetOpen(gpio_bindings, NELEMS(gpio_bindings));
-    dx_timerSetStart(timer_bindings, NELEMS(timer_bindings));
+#ifdef USE_TIMER_WHEEL
+    if (!timer_wheel_init(dx_timerGetEventLoop())) {
+        dx_terminate(ExitCode_TimerWheelInitFailed);
+    }
+#endif // USE_TIMER_WHEEL
+    app_timerSetStart(timer_bindings, NELEMS(timer_bindings));
     dx_deviceTwinSubscribe(device_twin_bindings, NELEMS(device_twin_bindings));
     dx_directMethodSubscribe(direct_method_bindings, NELEMS(direct_method_bindings));
     dx_azureRegisterConnectionChangedNotification(NetworkConnectionState);
@@ -635,12 +741,16 @@ static void InitPeripheralsAndHandlers(void)
 /// </summary>
 static void ClosePeripheralsAndHandlers(void)
 {
-    dx_timerSetStop(timer_bindings, NELEMS(timer_bindings));
+    app_timerSetStop(timer_bindings, NELEMS(timer_bindings));
+#ifdef USE_TIMER_WHEEL
+    timer_wheel_close();
+#endif // USE_TIMER_WHEEL
     dx_deviceTwinUnsubscribe();
     dx_directMethodUnsubscribe();
     dx_gpioSetClose(gpio_bindings, NELEMS(gpio_bindings));
     dx_timerEventLoopStop();
     lp_imu_close();
+    async_log_close();
 
 }
 
@@ -655,6 +765,10 @@ int main(int argc, char *argv[])
 
     InitPeripheralsAndHandlers();
 
+#ifdef USE_VIRTUAL_CLOCK
+    // Simulated time, runs SIMULATION_DURATION_SECONDS of timers and injected events then exits
+    virtual_clock_run(dx_timerGetEventLoop(), (int64_t)SIMULATION_DURATION_SECONDS * 1000000000);
+#else
     // Main loop
     while (!dx_isTerminationRequired()) {
         int result = EventLoop_Run(dx_timerGetEventLoop(), -1, true);
@@ -663,6 +777,7 @@ int main(int argc, char *argv[])
             dx_terminate(DX_ExitCode_Main_EventLoopFail);
         }
     }
+#endif // USE_VIRTUAL_CLOCK
 
     ClosePeripheralsAndHandlers();
     Log_Debug("Application exiting.\n");
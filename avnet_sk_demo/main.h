@@ -24,10 +24,22 @@
 #include <applibs/log.h>
 #include <applibs/wificonfig.h>
 #include <applibs/powermanagement.h>
+#ifdef USE_VIRTUAL_CLOCK
+#include <applibs/applications.h>
+#endif // USE_VIRTUAL_CLOCK
 
 // Local header files
+#include "adaptive_sampler.h"
 #include "app_exit_codes.h"
+#include "async_log.h"
+#include "handler_profiler.h"
 #include "i2c.h"
+#ifdef USE_TIMER_WHEEL
+#include "timer_wheel.h"
+#endif // USE_TIMER_WHEEL
+#ifdef USE_VIRTUAL_CLOCK
+#include "virtual_clock.h"
+#endif // USE_VIRTUAL_CLOCK
 #ifdef OLED_SD1306
 #include "oled.h"
 #endif // OLED_SD1306
@@ -39,31 +51,83 @@
 #define SAMPLE_VERSION_NUMBER "1.0"
 #define ONE_MS 1000000
 
+// Application timers run on either the DevX timers or the timer wheel, see build_options.h
+#ifdef USE_TIMER_WHEEL
+#define APP_TIMER_BINDING TIMER_WHEEL_BINDING
+#define APP_TIMER_HANDLER(name) TIMER_WHEEL_HANDLER(name)
+#define APP_TIMER_HANDLER_END TIMER_WHEEL_HANDLER_END
+#define APP_DECLARE_TIMER_HANDLER(name) TIMER_WHEEL_DECLARE_HANDLER(name)
+#define app_timerChange timer_wheel_change
+#define app_timerOneShotSet timer_wheel_oneshot_set
+#define app_timerSetStart timer_wheel_set_start
+#define app_timerSetStop timer_wheel_set_stop
+#define APP_TIMER_SLACK(seconds, nanoseconds) .slack = {seconds, nanoseconds},
+#else
+#define APP_TIMER_BINDING DX_TIMER_BINDING
+#define APP_TIMER_HANDLER(name) DX_TIMER_HANDLER(name) PROFILE_TIMER_HANDLER(name);
+#define APP_TIMER_HANDLER_END DX_TIMER_HANDLER_END
+#define APP_DECLARE_TIMER_HANDLER(name) DX_DECLARE_TIMER_HANDLER(name)
+#ifdef ENABLE_HANDLER_PROFILER
+// The profiler keeps each timer's schedule to tell how late its handler runs
+#define app_timerChange profiler_timer_change
+#define app_timerOneShotSet profiler_timer_oneshot_set
+#define app_timerSetStart profiler_timer_set_start
+#else
+#define app_timerChange dx_timerChange
+#define app_timerOneShotSet dx_timerOneShotSet
+#define app_timerSetStart dx_timerSetStart
+#endif // ENABLE_HANDLER_PROFILER
+#define app_timerSetStop dx_timerSetStop
+#define APP_TIMER_SLACK(seconds, nanoseconds) // The DevX timers always run on time
+#endif // USE_TIMER_WHEEL
+
+// Every event handler is written with one of these, so ENABLE_HANDLER_PROFILER records all of
+// them. The timer macros above profile the DevX timers, the timer wheel profiles its own.
+#define APP_DEVICE_TWIN_HANDLER(name, deviceTwinBinding) DX_DEVICE_TWIN_HANDLER(name, deviceTwinBinding) PROFILE_HANDLER();
+#define APP_DEVICE_TWIN_HANDLER_END DX_DEVICE_TWIN_HANDLER_END
+#define APP_DIRECT_METHOD_HANDLER(name, json, directMethodBinding, responseMsg)                   \
+    DX_DIRECT_METHOD_HANDLER(name, json, directMethodBinding, responseMsg) PROFILE_HANDLER();
+#define APP_DIRECT_METHOD_HANDLER_END DX_DIRECT_METHOD_HANDLER_END
+#define APP_INTERCORE_HANDLER(name, dataBlock, messageLength)                                      \
+    void name(void *dataBlock, ssize_t messageLength)                                              \
+    {                                                                                              \
+        PROFILE_HANDLER();
+#define APP_INTERCORE_HANDLER_END }
+
 // Forward declarations
 //static DX_DIRECT_METHOD_RESPONSE_CODE LightControlHandler(JSON_Value *json, DX_DIRECT_METHOD_BINDING *directMethodBinding, char **responseMsg);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler);
+static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_adaptive_sampling_handler);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_gpio_handler);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_oled_message_handler);
 static DX_DECLARE_DIRECT_METHOD_HANDLER(dm_halt_device_handler);
 static DX_DECLARE_DIRECT_METHOD_HANDLER(dm_restart_device_handler);
 static DX_DECLARE_DIRECT_METHOD_HANDLER(dm_set_sensor_poll_period);
-static DX_DECLARE_TIMER_HANDLER(delay_restart_timer_handler);
-static DX_DECLARE_TIMER_HANDLER(monitor_wifi_network_handler);
-static DX_DECLARE_TIMER_HANDLER(read_sensors_handler);
+static APP_DECLARE_TIMER_HANDLER(delay_restart_timer_handler);
+static APP_DECLARE_TIMER_HANDLER(monitor_wifi_network_handler);
+static APP_DECLARE_TIMER_HANDLER(read_sensors_handler);
 static void publish_message_handler(void);
+static void adapt_sensor_read_period(void);
 #ifdef OLED_SD1306
-static DX_DECLARE_TIMER_HANDLER(UpdateOledEventHandler);
+static APP_DECLARE_TIMER_HANDLER(UpdateOledEventHandler);
 #endif // OLED_SD1306
 static void ReadWifiConfig(bool outputDebug);
-static DX_DECLARE_TIMER_HANDLER(ButtonPressCheckHandler);
+static APP_DECLARE_TIMER_HANDLER(ButtonPressCheckHandler);
 #ifdef IOT_HUB_APPLICATION
 static void SendButtonTelemetry(const char* telemetry_key, GPIO_Value_Type button_state);
 #endif // IOT_HUB_APPLICATION
 static void ProcessButtonState(GPIO_Value_Type new_state, GPIO_Value_Type* old_state, const char* telemetry_key);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_debug_handler);
+#ifdef ENABLE_HANDLER_PROFILER
+static DX_DECLARE_DIRECT_METHOD_HANDLER(dm_handler_profile_handler);
+static APP_DECLARE_TIMER_HANDLER(profiler_report_handler);
+#endif // ENABLE_HANDLER_PROFILER
 #ifdef M4_INTERCORE_COMMS
 static void alsPt19_receive_msg_handler(void *data_block, ssize_t message_length);
 #endif // M4_INTERCORE_COMMS
+#ifdef USE_VIRTUAL_CLOCK
+static APP_DECLARE_TIMER_HANDLER(simulation_report_handler);
+#endif // USE_VIRTUAL_CLOCK
 
 DX_USER_CONFIG dx_config;
 
@@ -119,6 +183,25 @@ float altitude;
 double light_sensor;
 network_var network_data;
 
+// The read period set through sensorPollPeriod or setSensorPollTime, used while adaptive sampling is off
+static int sensor_read_period_seconds = SENSOR_READ_PERIOD_SECONDS;
+
+// Adapts the tmr_read_sensors period to how much the readings are changing. Configured and
+// enabled through the adaptiveSampling device twin, see adaptive_sampler.h
+static ADAPTIVE_SAMPLER sensor_sampler = {.minPeriodMs = 1000, .maxPeriodMs = 60 * 1000, .aggressiveness = 0.5,
+                                          .channels = {{.name = "gX", .threshold = 0.05},
+                                                       {.name = "gY", .threshold = 0.05},
+                                                       {.name = "gZ", .threshold = 0.05},
+                                                       {.name = "aX", .threshold = 5.0},
+                                                       {.name = "aY", .threshold = 5.0},
+                                                       {.name = "aZ", .threshold = 5.0},
+                                                       {.name = "temp", .threshold = 0.5},
+                                                       {.name = "pressure", .threshold = 0.5}},
+                                          .channelCount = 8};
+
+// Telemetry messages handed to the IoT Hub or IoTConnect publish APIs
+uint32_t telemetry_messages_sent = 0;
+
 /****************************************************************************************
  * GPIO Peripherals
  ****************************************************************************************/
@@ -149,6 +232,7 @@ static DX_DEVICE_TWIN_BINDING dt_oled_line2 =          {.propertyName = "OledDis
 static DX_DEVICE_TWIN_BINDING dt_oled_line3 =          {.propertyName = "OledDisplayMsg3", .twinType = DX_DEVICE_TWIN_STRING, .handler = dt_oled_message_handler, .context = oled_ms3 };
 static DX_DEVICE_TWIN_BINDING dt_oled_line4 =          {.propertyName = "OledDisplayMsg4", .twinType = DX_DEVICE_TWIN_STRING, .handler = dt_oled_message_handler, .context = oled_ms4 };
 static DX_DEVICE_TWIN_BINDING dt_enable_debug =        {.propertyName = "enableDebug",     .twinType = DX_DEVICE_TWIN_BOOL,   .handler = dt_debug_handler};	
+static DX_DEVICE_TWIN_BINDING dt_adaptive_sampling =   {.propertyName = "adaptiveSampling", .twinType = DX_DEVICE_TWIN_JSON_OBJECT, .handler = dt_adaptive_sampling_handler};
 
 // Read only Device Twin Bindings
 static DX_DEVICE_TWIN_BINDING dt_version_string = {.propertyName = "versionString", .twinType = DX_DEVICE_TWIN_STRING};
@@ -164,17 +248,27 @@ static DX_DEVICE_TWIN_BINDING dt_bssid =          {.propertyName = "bssid", .twi
 static DX_DIRECT_METHOD_BINDING dm_sensor_poll_time = {.methodName = "setSensorPollTime", .handler = dm_set_sensor_poll_period}; // {"pollTime": <integer>}
 static DX_DIRECT_METHOD_BINDING dm_reboot_control =   {.methodName = "rebootDevice", .handler = dm_restart_device_handler};   // {"delayTime": <integer>}
 static DX_DIRECT_METHOD_BINDING dm_halt_control =     {.methodName = "haltApplication", .handler = dm_halt_device_handler};    // {}
+#ifdef ENABLE_HANDLER_PROFILER
+static DX_DIRECT_METHOD_BINDING dm_handler_profile =  {.methodName = "getHandlerProfile", .handler = dm_handler_profile_handler}; // {"reset": <bool>}
+#endif // ENABLE_HANDLER_PROFILER
 
 /****************************************************************************************
  * Timers
  ****************************************************************************************/
-static DX_TIMER_BINDING tmr_monitor_wifi_network = {.period = {30, 0}, .name = "tmr_monitor_wifi_network", .handler = monitor_wifi_network_handler};
-static DX_TIMER_BINDING tmr_read_sensors = {.period = {SENSOR_READ_PERIOD_SECONDS, 0}, .name = "tmr_read_sensors", .handler = read_sensors_handler};
-static DX_TIMER_BINDING tmr_reboot = {.period = {0, 0}, .name = "tmr_reboot", .handler = delay_restart_timer_handler};
-static DX_TIMER_BINDING buttonPressCheckTimer = {.period = {0, ONE_MS*10}, .name = "buttonPressCheckTimer", .handler = ButtonPressCheckHandler};
+// Timers with slack may run late by up to that much so they can share a wakeup with another timer
+static APP_TIMER_BINDING tmr_monitor_wifi_network = {.period = {30, 0}, APP_TIMER_SLACK(5, 0) .name = "tmr_monitor_wifi_network", .handler = monitor_wifi_network_handler};
+static APP_TIMER_BINDING tmr_read_sensors = {.period = {SENSOR_READ_PERIOD_SECONDS, 0}, APP_TIMER_SLACK(0, 500 * ONE_MS) .name = "tmr_read_sensors", .handler = read_sensors_handler};
+static APP_TIMER_BINDING tmr_reboot = {.period = {0, 0}, .name = "tmr_reboot", .handler = delay_restart_timer_handler};
+static APP_TIMER_BINDING buttonPressCheckTimer = {.period = {0, ONE_MS*10}, .name = "buttonPressCheckTimer", .handler = ButtonPressCheckHandler};
 #ifdef OLED_SD1306
-static DX_TIMER_BINDING oled_timer = {.period = {0, 100 * ONE_MS}, .name = "oledTimer", .handler = UpdateOledEventHandler};
+static APP_TIMER_BINDING oled_timer = {.period = {0, 100 * ONE_MS}, APP_TIMER_SLACK(0, 50 * ONE_MS) .name = "oledTimer", .handler = UpdateOledEventHandler};
 #endif 
+#ifdef ENABLE_HANDLER_PROFILER
+static APP_TIMER_BINDING tmr_profiler_report = {.period = {PROFILER_REPORT_PERIOD_SECONDS, 0}, APP_TIMER_SLACK(10, 0) .name = "tmr_profiler_report", .handler = profiler_report_handler};
+#endif // ENABLE_HANDLER_PROFILER
+#ifdef USE_VIRTUAL_CLOCK
+static APP_TIMER_BINDING tmr_simulation_report = {.period = {SIMULATION_REPORT_PERIOD_SECONDS, 0}, APP_TIMER_SLACK(60, 0) .name = "tmr_simulation_report", .handler = simulation_report_handler};
+#endif // USE_VIRTUAL_CLOCK
 
 #ifdef M4_INTERCORE_COMMS
 /****************************************************************************************
@@ -200,12 +294,22 @@ DX_DEVICE_TWIN_BINDING *device_twin_bindings[] = {&dt_user_led_red, &dt_user_led
                                                   &dt_app_led, &dt_relay1, &dt_relay2, &dt_desired_sample_rate, &dt_oled_line1, 
                                                   &dt_oled_line2, &dt_oled_line3, &dt_oled_line4, &dt_version_string, 
                                                   &dt_manufacturer, &dt_model, &dt_ssid, &dt_freq, &dt_bssid,
-                                                  &dt_enable_debug};
+                                                  &dt_enable_debug, &dt_adaptive_sampling};
 
-DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_reboot_control, &dm_sensor_poll_time, &dm_halt_control};
+DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_reboot_control, &dm_sensor_poll_time, &dm_halt_control,
+#ifdef ENABLE_HANDLER_PROFILER
+                                                      &dm_handler_profile,
+#endif // ENABLE_HANDLER_PROFILER
+};
 DX_GPIO_BINDING *gpio_bindings[] = {&buttonA, &buttonB, &userLedRed, &userLedGreen, &userLedBlue, &wifiLed, &appLed, &clickRelay1, &clickRelay2};
+APP_TIMER_BINDING *timer_bindings[] = {&tmr_monitor_wifi_network, &tmr_read_sensors, &tmr_reboot, &buttonPressCheckTimer,
 #ifdef OLED_SD1306
-DX_TIMER_BINDING *timer_bindings[] = {&tmr_monitor_wifi_network, &tmr_read_sensors, &tmr_reboot, &buttonPressCheckTimer, &oled_timer};
-#else
-DX_TIMER_BINDING *timer_bindings[] = {&tmr_monitor_wifi_network, &tmr_read_sensors, &tmr_reboot, &buttonPressCheckTimer};
-#endif 
+                                       &oled_timer,
+#endif // OLED_SD1306
+#ifdef ENABLE_HANDLER_PROFILER
+                                       &tmr_profiler_report,
+#endif // ENABLE_HANDLER_PROFILER
+#ifdef USE_VIRTUAL_CLOCK
+                                       &tmr_simulation_report,
+#endif // USE_VIRTUAL_CLOCK
+}; 
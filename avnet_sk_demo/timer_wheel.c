@@ -0,0 +1,627 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "timer_wheel.h"
+
+#include <applibs/log.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define SLOTS (1u << TIMER_WHEEL_BITS)
+#define SLOT_MASK (SLOTS - 1)
+#define OVERFLOW_LEVEL TIMER_WHEEL_LEVELS
+#define NO_DEADLINE UINT64_MAX
+
+// A timer at level L shares every bit above L's digit with current_tick, so its slot is
+// always ahead of current_tick's digit at that level and the wheel never wraps
+static TIMER_WHEEL_LINK wheel[TIMER_WHEEL_LEVELS][SLOTS];
+static uint64_t occupied[TIMER_WHEEL_LEVELS]; // One bit per non empty slot
+// Earliest expiry in each non empty slot. When the timer holding it leaves, the slot is marked
+// stale and rescanned the next time it is the first occupied slot at its level.
+static uint64_t earliest[TIMER_WHEEL_LEVELS][SLOTS];
+static uint64_t stale[TIMER_WHEEL_LEVELS]; // One bit per slot whose earliest expiry is stale
+static TIMER_WHEEL_LINK overflow;
+static TIMER_WHEEL_LINK slack_timers;
+
+static uint64_t current_tick = 0;
+static uint64_t armed_tick = NO_DEADLINE;
+static int64_t base_ns = 0;
+static bool dispatching = false;
+static bool initialized = false;
+static TIMER_WHEEL_STATS stats;
+#if TIMER_WHEEL_REPORT_SECONDS > 0
+static uint64_t report_tick = 0;
+#endif // TIMER_WHEEL_REPORT_SECONDS
+#ifdef USE_VIRTUAL_CLOCK
+static int64_t virtual_now_ns = 0;
+#endif // USE_VIRTUAL_CLOCK
+
+static EventLoop *event_loop = NULL;
+static int timer_fd = -1;
+static EventRegistration *timer_registration = NULL;
+
+static void list_init(TIMER_WHEEL_LINK *head)
+{
+    head->next = head->prev = head;
+}
+
+static bool list_empty(const TIMER_WHEEL_LINK *head)
+{
+    return head->next == head;
+}
+
+static void list_add_tail(TIMER_WHEEL_LINK *head, TIMER_WHEEL_LINK *node)
+{
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_unlink(TIMER_WHEEL_LINK *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node->prev = node;
+}
+
+static TIMER_WHEEL_BINDING *slack_timer(TIMER_WHEEL_LINK *node)
+{
+    return (TIMER_WHEEL_BINDING *)((char *)node - offsetof(TIMER_WHEEL_BINDING, slackLink));
+}
+
+// Move every node from source onto the empty list destination
+static void list_take(TIMER_WHEEL_LINK *destination, TIMER_WHEEL_LINK *source)
+{
+    list_init(destination);
+    if (!list_empty(source)) {
+        destination->next = source->next;
+        destination->prev = source->prev;
+        destination->next->prev = destination;
+        destination->prev->next = destination;
+        list_init(source);
+    }
+}
+
+static int64_t monotonic_ns(void)
+{
+#ifdef USE_VIRTUAL_CLOCK
+    return virtual_now_ns;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif // USE_VIRTUAL_CLOCK
+}
+
+static uint64_t now_tick(void)
+{
+    return (uint64_t)(monotonic_ns() - base_ns) / TIMER_WHEEL_TICK_NS;
+}
+
+// First tick boundary not before now. Deadlines count from here, counting from now_tick()
+// would let a timer fire up to a tick early.
+static uint64_t now_tick_ceil(void)
+{
+    return ((uint64_t)(monotonic_ns() - base_ns) + TIMER_WHEEL_TICK_NS - 1) / TIMER_WHEEL_TICK_NS;
+}
+
+static uint64_t timespec_to_ticks(const struct timespec *ts)
+{
+    uint64_t ns = (uint64_t)ts->tv_sec * 1000000000 + (uint64_t)ts->tv_nsec;
+    return (ns + TIMER_WHEEL_TICK_NS - 1) / TIMER_WHEEL_TICK_NS;
+}
+
+static void wheel_insert(TIMER_WHEEL_BINDING *timer)
+{
+    unsigned level;
+
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned shift = TIMER_WHEEL_BITS * (level + 1);
+        if ((timer->expires >> shift) == (current_tick >> shift)) {
+            break;
+        }
+    }
+
+    if (level == TIMER_WHEEL_LEVELS) {
+        timer->level = OVERFLOW_LEVEL;
+        list_add_tail(&overflow, &timer->link);
+    } else {
+        unsigned slot = (unsigned)(timer->expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+        timer->level = (uint8_t)level;
+        timer->slot = (uint8_t)slot;
+        list_add_tail(&wheel[level][slot], &timer->link);
+        if (!(occupied[level] & (1ull << slot)) || timer->expires < earliest[level][slot]) {
+            earliest[level][slot] = timer->expires;
+        }
+        occupied[level] |= 1ull << slot;
+    }
+    timer->armed = true;
+}
+
+static void wheel_remove(TIMER_WHEEL_BINDING *timer)
+{
+    list_unlink(&timer->link);
+
+    if (timer->level < TIMER_WHEEL_LEVELS) {
+        uint64_t bit = 1ull << timer->slot;
+
+        if (list_empty(&wheel[timer->level][timer->slot])) {
+            occupied[timer->level] &= ~bit;
+            stale[timer->level] &= ~bit;
+        } else if (timer->expires == earliest[timer->level][timer->slot]) {
+            stale[timer->level] |= bit;
+        }
+    }
+    timer->armed = false;
+}
+
+// Arm for the current due time, call with the timer out of the wheel
+static void timer_arm(TIMER_WHEEL_BINDING *timer)
+{
+    timer->expires = timer->due + timer->slackTicks;
+    wheel_insert(timer);
+
+    if (timer->slackTicks != 0) {
+        list_add_tail(&slack_timers, &timer->slackLink);
+    }
+}
+
+// Take an armed timer, or one already unlinked from an expired slot, off the wheel
+static void timer_disarm(TIMER_WHEEL_BINDING *timer)
+{
+    if (timer->armed) {
+        wheel_remove(timer);
+    }
+
+    // Bindings start zeroed, slackLink is only valid once the timer has been armed with slack
+    if (timer->slackLink.next != NULL) {
+        list_unlink(&timer->slackLink);
+    }
+}
+
+/// <summary>
+/// The next tick with work to do, either a timer expiring at level 0 or a higher level slot
+/// that needs to cascade down. O(levels).
+/// </summary>
+static uint64_t next_event_tick(void)
+{
+    uint64_t next = NO_DEADLINE;
+
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned shift = TIMER_WHEEL_BITS * level;
+        unsigned digit = (unsigned)(current_tick >> shift) & SLOT_MASK;
+        uint64_t pending = occupied[level];
+
+        if (level == 0) {
+            pending &= ~0ull << digit;
+        } else {
+            pending &= digit == SLOT_MASK ? 0 : ~0ull << (digit + 1);
+        }
+
+        if (pending != 0) {
+            unsigned upper = shift + TIMER_WHEEL_BITS;
+            uint64_t tick = ((current_tick >> upper) << upper) |
+                            ((uint64_t)__builtin_ctzll(pending) << shift);
+            if (tick < next) {
+                next = tick;
+            }
+        }
+    }
+
+    if (!list_empty(&overflow)) {
+        unsigned upper = TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS;
+        uint64_t tick = ((current_tick >> upper) + 1) << upper;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+static uint64_t earliest_expiry(const TIMER_WHEEL_LINK *list)
+{
+    uint64_t earliest = NO_DEADLINE;
+
+    for (const TIMER_WHEEL_LINK *node = list->next; node != list; node = node->next) {
+        const TIMER_WHEEL_BINDING *timer = (const TIMER_WHEEL_BINDING *)node;
+        if (timer->expires < earliest) {
+            earliest = timer->expires;
+        }
+    }
+    return earliest;
+}
+
+static uint64_t slot_earliest_expiry(unsigned level, unsigned slot)
+{
+    if (stale[level] & (1ull << slot)) {
+        earliest[level][slot] = earliest_expiry(&wheel[level][slot]);
+        stale[level] &= ~(1ull << slot);
+    }
+    return earliest[level][slot];
+}
+
+/// <summary>
+/// The next tick a timer actually expires. Unlike next_event_tick() this skips the ticks where
+/// a higher level slot only cascades down, so the event loop is not woken up for them. Slot
+/// ranges at one level do not overlap, so only the first occupied slot per level is looked at,
+/// and its earliest expiry is kept up to date as timers are added and removed.
+/// </summary>
+static uint64_t next_expiry_tick(void)
+{
+    uint64_t next = NO_DEADLINE;
+
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned shift = TIMER_WHEEL_BITS * level;
+        unsigned digit = (unsigned)(current_tick >> shift) & SLOT_MASK;
+        uint64_t pending = occupied[level];
+
+        if (level == 0) {
+            pending &= ~0ull << digit;
+        } else {
+            pending &= digit == SLOT_MASK ? 0 : ~0ull << (digit + 1);
+        }
+
+        if (pending != 0) {
+            uint64_t tick = slot_earliest_expiry(level, (unsigned)__builtin_ctzll(pending));
+            if (tick < next) {
+                next = tick;
+            }
+        }
+    }
+
+    uint64_t tick = earliest_expiry(&overflow);
+    return tick < next ? tick : next;
+}
+
+static void arm_timerfd(void)
+{
+    if (dispatching || timer_fd == -1) {
+        return;
+    }
+
+    uint64_t next = next_expiry_tick();
+    if (next == armed_tick) {
+        return;
+    }
+
+    struct itimerspec its = {0};
+    if (next != NO_DEADLINE) {
+        int64_t deadline = base_ns + (int64_t)(next * TIMER_WHEEL_TICK_NS);
+        its.it_value.tv_sec = deadline / 1000000000;
+        its.it_value.tv_nsec = deadline % 1000000000;
+    }
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        Log_Debug("ERROR: timer wheel timerfd_settime: errno=%d (%s)\n", errno, strerror(errno));
+        return;
+    }
+    armed_tick = next;
+}
+
+static void reinsert_all(TIMER_WHEEL_LINK *list)
+{
+    TIMER_WHEEL_LINK pending;
+    list_take(&pending, list);
+
+    while (!list_empty(&pending)) {
+        TIMER_WHEEL_BINDING *timer = (TIMER_WHEEL_BINDING *)pending.next;
+        list_unlink(&timer->link);
+        wheel_insert(timer);
+    }
+}
+
+static void run_expired(TIMER_WHEEL_LINK *expired, uint64_t tick)
+{
+    // Handlers may stop or restart any timer, including ones still on the expired list
+    while (!list_empty(expired)) {
+        TIMER_WHEEL_BINDING *timer = (TIMER_WHEEL_BINDING *)expired->next;
+        uint64_t due = timer->due;
+        bool coalesced = tick < timer->expires;
+
+        list_unlink(&timer->link);
+        timer->armed = false;
+        timer_disarm(timer);
+
+        if (timer->periodTicks != 0) {
+            // Stay on the original schedule, skipping periods missed while the loop was busy
+            timer->due += timer->periodTicks;
+            if (timer->due <= tick) {
+                timer->due = now_tick_ceil() + timer->periodTicks;
+            }
+            timer_arm(timer);
+        }
+
+        stats.handlerRuns++;
+        if (coalesced) {
+            stats.coalescedRuns++;
+        }
+
+        // Lateness is measured on the wheel's clock, which may be simulated
+        int64_t late = monotonic_ns() - (base_ns + (int64_t)(due * TIMER_WHEEL_TICK_NS));
+        if (late > 0 && (uint64_t)late > stats.maxLateNs) {
+            stats.maxLateNs = (uint64_t)late;
+        }
+
+#ifdef ENABLE_HANDLER_PROFILER
+        int64_t started = profiler_now_ns();
+        timer->handler(timer);
+        timer->profile.name = timer->name;
+        profiler_record(&timer->profile, profiler_now_ns() - started, late);
+#else
+        timer->handler(timer);
+#endif // ENABLE_HANDLER_PROFILER
+    }
+}
+
+// Timers past their due time but still inside their slack run now, while the loop is awake
+static void run_coalesced(uint64_t now)
+{
+    TIMER_WHEEL_LINK early;
+    list_init(&early);
+
+    for (TIMER_WHEEL_LINK *node = slack_timers.next; node != &slack_timers;) {
+        TIMER_WHEEL_BINDING *timer = slack_timer(node);
+        node = node->next;
+
+        if (timer->due <= now) {
+            timer_disarm(timer);
+            list_add_tail(&early, &timer->link);
+        }
+    }
+
+    run_expired(&early, now);
+}
+
+static void report_wakeups(uint64_t now)
+{
+#if TIMER_WHEEL_REPORT_SECONDS > 0
+    const uint64_t reportTicks = (uint64_t)TIMER_WHEEL_REPORT_SECONDS * (1000000000 / TIMER_WHEEL_TICK_NS);
+
+    if (now - report_tick >= reportTicks) {
+        Log_Debug("Timer wheel: %lu wakeups, %lu handler runs (%lu coalesced), max %lu ms late "
+                  "in the last %d s\n",
+                  (unsigned long)stats.wakeups, (unsigned long)stats.handlerRuns,
+                  (unsigned long)stats.coalescedRuns, (unsigned long)(stats.maxLateNs / 1000000),
+                  TIMER_WHEEL_REPORT_SECONDS);
+        memset(&stats, 0, sizeof(stats));
+        report_tick = now;
+    }
+#endif // TIMER_WHEEL_REPORT_SECONDS
+}
+
+static void process_tick(uint64_t tick)
+{
+    // Cascade every level whose slot starts at this tick, highest first so a timer can drop
+    // through more than one level
+    if ((tick & ((1ull << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)) == 0) {
+        reinsert_all(&overflow);
+    }
+
+    for (unsigned level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+        unsigned shift = TIMER_WHEEL_BITS * level;
+        unsigned slot = (unsigned)(tick >> shift) & SLOT_MASK;
+
+        if ((tick & ((1ull << shift) - 1)) == 0 && (occupied[level] & (1ull << slot))) {
+            occupied[level] &= ~(1ull << slot);
+            stale[level] &= ~(1ull << slot);
+            reinsert_all(&wheel[level][slot]);
+        }
+    }
+
+    unsigned slot = (unsigned)tick & SLOT_MASK;
+    TIMER_WHEEL_LINK expired;
+
+    list_take(&expired, &wheel[0][slot]);
+    occupied[0] &= ~(1ull << slot);
+    stale[0] &= ~(1ull << slot);
+    run_expired(&expired, tick);
+}
+
+// Run every tick with work to do up to and including now
+static void dispatch(uint64_t now)
+{
+    uint64_t next;
+
+    dispatching = true;
+    armed_tick = NO_DEADLINE;
+
+    while ((next = next_event_tick()) <= now) {
+        current_tick = next;
+        process_tick(next);
+    }
+    if (now > current_tick) {
+        current_tick = now;
+    }
+
+    run_coalesced(now);
+    report_wakeups(now);
+
+    dispatching = false;
+    arm_timerfd();
+}
+
+#ifndef USE_VIRTUAL_CLOCK
+static void timer_event_handler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    uint64_t expirations;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        Log_Debug("ERROR: timer wheel timerfd read: errno=%d (%s)\n", errno, strerror(errno));
+    }
+
+    stats.wakeups++;
+    dispatch(now_tick());
+}
+#endif // USE_VIRTUAL_CLOCK
+
+bool timer_wheel_init(EventLoop *eventLoop)
+{
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (unsigned slot = 0; slot < SLOTS; slot++) {
+            list_init(&wheel[level][slot]);
+        }
+        occupied[level] = 0;
+        stale[level] = 0;
+    }
+    list_init(&overflow);
+    list_init(&slack_timers);
+    memset(&stats, 0, sizeof(stats));
+#if TIMER_WHEEL_REPORT_SECONDS > 0
+    report_tick = 0;
+#endif // TIMER_WHEEL_REPORT_SECONDS
+
+    base_ns = monotonic_ns();
+    current_tick = 0;
+    armed_tick = NO_DEADLINE;
+    event_loop = eventLoop;
+
+    // With the simulated clock there is no timerfd, virtual_clock_run() polls for deadlines
+#ifndef USE_VIRTUAL_CLOCK
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        Log_Debug("ERROR: timer wheel timerfd_create: errno=%d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    timer_registration =
+        EventLoop_RegisterIo(event_loop, timer_fd, EventLoop_Input, timer_event_handler, NULL);
+    if (timer_registration == NULL) {
+        Log_Debug("ERROR: timer wheel EventLoop_RegisterIo failed\n");
+        timer_wheel_close();
+        return false;
+    }
+#endif // USE_VIRTUAL_CLOCK
+
+    initialized = true;
+    return true;
+}
+
+void timer_wheel_close(void)
+{
+    initialized = false;
+
+    if (timer_registration != NULL) {
+        EventLoop_UnregisterIo(event_loop, timer_registration);
+        timer_registration = NULL;
+    }
+
+    if (timer_fd != -1) {
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}
+
+static bool schedule(TIMER_WHEEL_BINDING *timer, uint64_t delayTicks, uint64_t periodTicks)
+{
+    if (timer->handler == NULL || !initialized) {
+        return false;
+    }
+
+    timer_disarm(timer);
+
+    timer->periodTicks = periodTicks;
+    timer->slackTicks = timespec_to_ticks(&timer->slack);
+    // Deadlines are measured from the real time now, not the wheel's last processed tick
+    timer->due = now_tick_ceil() + (delayTicks == 0 ? 1 : delayTicks);
+    timer_arm(timer);
+    arm_timerfd();
+    return true;
+}
+
+bool timer_wheel_start(TIMER_WHEEL_BINDING *timer)
+{
+    uint64_t period = timespec_to_ticks(&timer->period);
+
+    if (period == 0) {
+        return timer->handler != NULL;
+    }
+    return schedule(timer, period, period);
+}
+
+void timer_wheel_stop(TIMER_WHEEL_BINDING *timer)
+{
+    // The timerfd is left armed, an early wake up with nothing to do is cheaper than a
+    // syscall on every stop
+    timer_disarm(timer);
+}
+
+bool timer_wheel_change(TIMER_WHEEL_BINDING *timer, const struct timespec *period)
+{
+    uint64_t ticks = timespec_to_ticks(period);
+
+    timer->period = *period;
+    if (ticks == 0) {
+        timer_wheel_stop(timer);
+        return true;
+    }
+    return schedule(timer, ticks, ticks);
+}
+
+bool timer_wheel_oneshot_set(TIMER_WHEEL_BINDING *timer, const struct timespec *delay)
+{
+    return schedule(timer, timespec_to_ticks(delay), 0);
+}
+
+void timer_wheel_get_stats(TIMER_WHEEL_STATS *result, bool reset)
+{
+    *result = stats;
+    if (reset) {
+        memset(&stats, 0, sizeof(stats));
+    }
+}
+
+int64_t timer_wheel_now_ns(void)
+{
+    return monotonic_ns();
+}
+
+#ifdef USE_VIRTUAL_CLOCK
+int64_t timer_wheel_next_deadline_ns(void)
+{
+    uint64_t next = initialized ? next_expiry_tick() : NO_DEADLINE;
+
+    return next == NO_DEADLINE ? INT64_MAX : base_ns + (int64_t)(next * TIMER_WHEEL_TICK_NS);
+}
+
+void timer_wheel_advance(int64_t nowNs)
+{
+    if (nowNs > virtual_now_ns) {
+        virtual_now_ns = nowNs;
+    }
+
+    if (initialized) {
+        if (now_tick() >= next_expiry_tick()) {
+            stats.wakeups++;
+        }
+        dispatch(now_tick());
+    }
+}
+
+void timer_wheel_pass_time(int64_t durationNs)
+{
+    if (durationNs > 0) {
+        virtual_now_ns += durationNs;
+    }
+}
+#endif // USE_VIRTUAL_CLOCK
+
+void timer_wheel_set_start(TIMER_WHEEL_BINDING *timerSet[], size_t timerCount)
+{
+    for (size_t i = 0; i < timerCount; i++) {
+        if (!timer_wheel_start(timerSet[i])) {
+            Log_Debug("ERROR: timer wheel could not start %s\n", timerSet[i]->name);
+        }
+    }
+}
+
+void timer_wheel_set_stop(TIMER_WHEEL_BINDING *timerSet[], size_t timerCount)
+{
+    for (size_t i = 0; i < timerCount; i++) {
+        timer_wheel_stop(timerSet[i]);
+    }
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "handler_profiler.h"
+#include <applibs/eventloop.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Wheel resolution, periods and delays are rounded up to a whole number of ticks
+#define TIMER_WHEEL_TICK_NS 1000000
+
+// 5 levels of 64 slots cover 2^30 ticks (~12 days at 1 ms), later deadlines wait in an
+// overflow list until they come into range
+#define TIMER_WHEEL_LEVELS 5
+#define TIMER_WHEEL_BITS 6
+
+typedef struct TIMER_WHEEL_LINK {
+    struct TIMER_WHEEL_LINK *next;
+    struct TIMER_WHEEL_LINK *prev;
+} TIMER_WHEEL_LINK;
+
+// How often the wheel logs its wakeup rate, 0 to turn the report off
+#define TIMER_WHEEL_REPORT_SECONDS 60
+
+typedef struct TIMER_WHEEL_BINDING {
+    TIMER_WHEEL_LINK link; // Must be first
+    struct timespec period; // Repeat period, {0, 0} for a one shot timer
+    // How late the timer may run. Once due it runs at the next wakeup of any other timer,
+    // or at due + slack at the latest. Keep it well under the period, {0, 0} runs on time.
+    struct timespec slack;
+    const char *name;
+    void (*handler)(struct TIMER_WHEEL_BINDING *timerBinding);
+    // Managed by the wheel
+    uint64_t due;     // When the timer may first run
+    uint64_t expires; // due + slack, the deadline the timerfd is armed for
+    uint64_t periodTicks;
+    uint64_t slackTicks;
+    TIMER_WHEEL_LINK slackLink; // On the list of armed timers that have slack
+    uint8_t level;
+    uint8_t slot;
+    bool armed;
+#ifdef ENABLE_HANDLER_PROFILER
+    PROFILER_ENTRY profile;
+#endif // ENABLE_HANDLER_PROFILER
+} TIMER_WHEEL_BINDING;
+
+#define TIMER_WHEEL_HANDLER(name) void name(TIMER_WHEEL_BINDING *timerBinding)
+#define TIMER_WHEEL_HANDLER_END
+#define TIMER_WHEEL_DECLARE_HANDLER(name) void name(TIMER_WHEEL_BINDING *timerBinding)
+
+/// <summary>
+/// Create the single timerfd every wheel timer shares and register it with the event loop.
+/// </summary>
+bool timer_wheel_init(EventLoop *eventLoop);
+void timer_wheel_close(void);
+
+/// <summary>
+/// Start a periodic timer. Timers with a zero period stay disarmed until
+/// timer_wheel_oneshot_set() is called, matching dx_timerStart().
+/// Start, stop and re-arm are O(1).
+/// </summary>
+bool timer_wheel_start(TIMER_WHEEL_BINDING *timer);
+void timer_wheel_stop(TIMER_WHEEL_BINDING *timer);
+bool timer_wheel_change(TIMER_WHEEL_BINDING *timer, const struct timespec *period);
+bool timer_wheel_oneshot_set(TIMER_WHEEL_BINDING *timer, const struct timespec *delay);
+
+void timer_wheel_set_start(TIMER_WHEEL_BINDING *timerSet[], size_t timerCount);
+void timer_wheel_set_stop(TIMER_WHEEL_BINDING *timerSet[], size_t timerCount);
+
+typedef struct {
+    uint32_t wakeups;       // Timer wakeups of the event loop
+    uint32_t handlerRuns;   // Handlers run
+    uint32_t coalescedRuns; // Handlers run before their deadline, sharing another wakeup
+    uint64_t maxLateNs;     // Longest a handler started after it was due
+} TIMER_WHEEL_STATS;
+
+/// <summary>
+/// Counts since the last call with reset set, or since timer_wheel_init().
+/// </summary>
+void timer_wheel_get_stats(TIMER_WHEEL_STATS *stats, bool reset);
+
+/// <summary>
+/// The time the wheel schedules against, CLOCK_MONOTONIC or the simulated clock.
+/// </summary>
+int64_t timer_wheel_now_ns(void);
+
+#ifdef USE_VIRTUAL_CLOCK
+/// <summary>
+/// When the wheel next has work to do on the simulated clock, INT64_MAX when nothing is armed.
+/// </summary>
+int64_t timer_wheel_next_deadline_ns(void);
+
+/// <summary>
+/// Move the simulated clock forward to nowNs and run every timer due by then.
+/// </summary>
+void timer_wheel_advance(int64_t nowNs);
+
+/// <summary>
+/// Move the simulated clock forward by durationNs without running any timers, for a blocking
+/// wait. Timers that fall due run at the next timer_wheel_advance().
+/// </summary>
+void timer_wheel_pass_time(int64_t durationNs);
+#endif // USE_VIRTUAL_CLOCK
@@ -0,0 +1,223 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host replay of a sensor trace through adaptive_sampler.c, against fixed sampling rates. The
+   trace holds one row per second of the eight starter kit readings, in the order main.c feeds
+   them to the sampler. Each scheme samples the trace at the times it chooses, and between
+   samples the reading is taken to hold its last sampled value, as it does for anyone reading
+   the telemetry. For every scheme it reports:
+
+   - samples taken
+   - RMS and largest reconstruction error, each channel's error divided by its threshold so the
+     channels weigh the same
+   - the share of the trace where some channel is off by more than its threshold
+
+   The schemes are a fixed 5 s, the SENSOR_READ_PERIOD_SECONDS default, the sampler with the
+   settings main.h gives it, and a fixed period that takes the same number of samples as the
+   sampler.
+
+   Without a file it replays a synthetic day: a still board on a desk with sensor noise, the
+   temperature following the day and the pressure a slow weather change, and six 10 minute
+   disturbances. Two are the board being handled, two a window opening, two a pressure step.
+   A recorded trace is a CSV file of eight values per line, one line per second.
+
+   Build: gcc -O2 -I host -I .. -o adaptive_sampler_replay adaptive_sampler_replay.c
+              ../adaptive_sampler.c host/parson_host.c -lm
+   Usage: adaptive_sampler_replay [trace.csv]
+*/
+
+#include "adaptive_sampler.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHANNELS 8
+#define SYNTHETIC_SECONDS (24 * 60 * 60)
+#define DISTURBANCE_SECONDS 600
+#define FIXED_PERIOD_SECONDS 5
+
+typedef struct {
+    double values[CHANNELS];
+} TRACE_ROW;
+
+// The sampler as main.h configures it, with adaptive sampling turned on
+static const ADAPTIVE_SAMPLER starterKitSampler = {.enabled = true,
+                                                   .minPeriodMs = 1000,
+                                                   .maxPeriodMs = 60 * 1000,
+                                                   .aggressiveness = 0.5,
+                                                   .channels = {{.name = "gX", .threshold = 0.05},
+                                                                {.name = "gY", .threshold = 0.05},
+                                                                {.name = "gZ", .threshold = 0.05},
+                                                                {.name = "aX", .threshold = 5.0},
+                                                                {.name = "aY", .threshold = 5.0},
+                                                                {.name = "aZ", .threshold = 5.0},
+                                                                {.name = "temp", .threshold = 0.5},
+                                                                {.name = "pressure", .threshold = 0.5}},
+                                                   .channelCount = CHANNELS};
+
+static TRACE_ROW *trace;
+static size_t traceSeconds;
+static uint64_t randomState = 88172645463325252ull;
+
+// Roughly normal noise, the sum of four uniform draws
+static double Noise(double sigma)
+{
+    double sum = 0;
+
+    for (int i = 0; i < 4; i++) {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 7;
+        randomState ^= randomState << 17;
+        sum += (double)(randomState >> 11) / (double)(1ull << 53) - 0.5;
+    }
+    return sum * sigma * sqrt(3.0);
+}
+
+static void BuildSyntheticTrace(void)
+{
+    static const size_t starts[] = {2 * 3600, 7 * 3600, 11 * 3600, 14 * 3600, 18 * 3600, 21 * 3600};
+
+    traceSeconds = SYNTHETIC_SECONDS;
+    trace = calloc(traceSeconds, sizeof(TRACE_ROW));
+    if (trace == NULL) {
+        exit(1);
+    }
+
+    for (size_t t = 0; t < traceSeconds; t++) {
+        double day = 2 * M_PI * (double)t / SYNTHETIC_SECONDS;
+        double *v = trace[t].values;
+
+        v[0] = Noise(0.004);
+        v[1] = Noise(0.004);
+        v[2] = 1 + Noise(0.004);
+        v[3] = Noise(0.4);
+        v[4] = Noise(0.4);
+        v[5] = Noise(0.4);
+        v[6] = 22 - 3 * cos(day) + Noise(0.05);
+        v[7] = 1013 + 2 * sin(day / 2) + Noise(0.03);
+
+        for (size_t d = 0; d < sizeof(starts) / sizeof(starts[0]); d++) {
+            if (t < starts[d] || t >= starts[d] + DISTURBANCE_SECONDS) {
+                continue;
+            }
+            double phase = (double)(t - starts[d]);
+            if (d % 3 == 0) {
+                // Picked up and turned over
+                v[0] += 0.3 * sin(phase / 7);
+                v[1] += 0.2 * cos(phase / 11);
+                v[2] -= 0.5 * (1 - cos(phase / 13));
+                v[3] += 40 * sin(phase / 5);
+                v[4] += 25 * cos(phase / 3);
+                v[5] += 30 * sin(phase / 9);
+            } else if (d % 3 == 1) {
+                // A window open, the temperature falls and comes back
+                v[6] -= 4 * sin(M_PI * phase / DISTURBANCE_SECONDS);
+            } else {
+                // A pressure step as a front passes
+                v[7] -= 3 * phase / DISTURBANCE_SECONDS;
+            }
+        }
+        // The front stays through the rest of the day
+        for (size_t d = 2; d < sizeof(starts) / sizeof(starts[0]); d += 3) {
+            if (t >= starts[d] + DISTURBANCE_SECONDS) {
+                v[7] -= 3;
+            }
+        }
+    }
+}
+
+static void LoadTrace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    size_t capacity = 0;
+    TRACE_ROW row;
+
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    while (fscanf(file, "%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &row.values[0], &row.values[1], &row.values[2],
+                  &row.values[3], &row.values[4], &row.values[5], &row.values[6], &row.values[7]) == CHANNELS) {
+        if (traceSeconds == capacity) {
+            capacity = capacity == 0 ? 4096 : capacity * 2;
+            trace = realloc(trace, capacity * sizeof(TRACE_ROW));
+            if (trace == NULL) {
+                exit(1);
+            }
+        }
+        trace[traceSeconds++] = row;
+    }
+    fclose(file);
+}
+
+// Sample at fixed periods when periodSeconds is set, otherwise through the sampler
+static void Replay(const char *name, size_t periodSeconds, size_t *samplesTaken)
+{
+    ADAPTIVE_SAMPLER sampler = starterKitSampler;
+    const TRACE_ROW *held = NULL;
+    size_t nextSample = 0;
+    size_t samples = 0;
+    size_t offSeconds = 0;
+    double sumSquares = 0;
+    double maxError = 0;
+
+    for (size_t t = 0; t < traceSeconds; t++) {
+        if (t == nextSample) {
+            held = &trace[t];
+            samples++;
+            if (periodSeconds != 0) {
+                nextSample += periodSeconds;
+            } else {
+                int periodMs = adaptive_sampler_update(&sampler, held->values, CHANNELS);
+                nextSample += (size_t)(periodMs + 999) / 1000;
+            }
+        }
+
+        bool off = false;
+        for (size_t c = 0; c < CHANNELS; c++) {
+            double error = fabs(trace[t].values[c] - held->values[c]) / starterKitSampler.channels[c].threshold;
+            sumSquares += error * error;
+            maxError = fmax(maxError, error);
+            off |= error > 1;
+        }
+        offSeconds += off;
+    }
+
+    printf("%-28s samples %6zu  RMS error %6.3f  max error %7.2f  off by more than a threshold %5.2f %%\n", name,
+           samples, sqrt(sumSquares / (double)(traceSeconds * CHANNELS)), maxError,
+           100.0 * (double)offSeconds / (double)traceSeconds);
+    if (samplesTaken != NULL) {
+        *samplesTaken = samples;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t adaptiveSamples = 0;
+    char name[64];
+
+    if (argc > 1) {
+        LoadTrace(argv[1]);
+    } else {
+        BuildSyntheticTrace();
+    }
+    if (traceSeconds == 0) {
+        fprintf(stderr, "The trace is empty\n");
+        return 1;
+    }
+    printf("%zu s of trace\n", traceSeconds);
+
+    snprintf(name, sizeof(name), "fixed %d s", FIXED_PERIOD_SECONDS);
+    Replay(name, FIXED_PERIOD_SECONDS, NULL);
+    Replay("adaptive 1 to 60 s", 0, &adaptiveSamples);
+
+    size_t budgetPeriod = (traceSeconds + adaptiveSamples - 1) / adaptiveSamples;
+    snprintf(name, sizeof(name), "fixed %zu s, same budget", budgetPeriod);
+    Replay(name, budgetPeriod, NULL);
+
+    free(trace);
+    return 0;
+}
@@ -0,0 +1,127 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host benchmark of what a log call costs the caller, a synchronous Log_Debug against
+   async_log.c. Every call is timed on its own, less the cost of reading the clock, and each
+   case reports the median and 99th percentile of CALLS calls:
+
+   - Log_Debug with the sensor trace format main.c logs at DEBUG
+   - the same through async_log, in bursts the per site rate limit lets through, with a pause
+     after each burst for the writer thread to catch up
+   - async_log with a %s argument, which is copied into the record
+   - a call the rate limit suppresses
+
+   Log_Debug is the host stand-in that writes to stderr, so point stderr at whatever the
+   comparison should be made against. /dev/null measures only the formatting and the system
+   call, on the device Log_Debug also waits for the debugger socket.
+
+   Build: gcc -O2 -I host -I .. -o async_log_bench async_log_bench.c ../async_log.c -lpthread
+   Usage: async_log_bench 2>/dev/null
+*/
+
+#include "async_log.h"
+
+#include <applibs/log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CALLS 100000
+#define PAUSE_US 200
+
+static double samples[CALLS];
+static double clockNs;
+
+static double NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double difference = *(const double *)a - *(const double *)b;
+    return (difference > 0) - (difference < 0);
+}
+
+static double Percentile(double fraction)
+{
+    return samples[(size_t)(fraction * (CALLS - 1))];
+}
+
+static void Report(const char *name)
+{
+    qsort(samples, CALLS, sizeof(samples[0]), CompareDoubles);
+    printf("%-30s median %7.1f ns  p99 %7.1f ns\n", name, Percentile(0.5) - clockNs, Percentile(0.99) - clockNs);
+}
+
+static void MeasureClock(void)
+{
+    for (size_t i = 0; i < CALLS; i++) {
+        double start = NowNs();
+        samples[i] = NowNs() - start;
+    }
+    qsort(samples, CALLS, sizeof(samples[0]), CompareDoubles);
+    clockNs = Percentile(0.5);
+}
+
+int main(void)
+{
+    const char *label = "lsm6dso";
+    ASYNC_LOG_STATS stats;
+
+    MeasureClock();
+    printf("clock_gettime pair %.1f ns, taken off every figure\n", clockNs);
+
+    for (size_t i = 0; i < CALLS; i++) {
+        double start = NowNs();
+        Log_Debug("LSM6DSO: Acceleration [g]  : %.4lf, %.4lf, %.4lf\n", 0.01 * (double)i, 0.02, 1.0);
+        samples[i] = NowNs() - start;
+    }
+    Report("Log_Debug");
+
+    if (!async_log_init()) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < CALLS; i += ASYNC_LOG_SITE_BURST) {
+        ASYNC_LOG_SITE site = {.level = ASYNC_LOG_LEVEL_DEBUG};
+        for (size_t j = i; j < i + ASYNC_LOG_SITE_BURST && j < CALLS; j++) {
+            double start = NowNs();
+            async_log_write(&site, "LSM6DSO: Acceleration [g]  : %.4lf, %.4lf, %.4lf\n", 0.01 * (double)j, 0.02,
+                            1.0);
+            samples[j] = NowNs() - start;
+        }
+        usleep(PAUSE_US);
+    }
+    Report("async_log");
+
+    for (size_t i = 0; i < CALLS; i += ASYNC_LOG_SITE_BURST) {
+        ASYNC_LOG_SITE site = {.level = ASYNC_LOG_LEVEL_DEBUG};
+        for (size_t j = i; j < i + ASYNC_LOG_SITE_BURST && j < CALLS; j++) {
+            double start = NowNs();
+            async_log_write(&site, "%s: Temperature [degC]: %.2f\n", label, 0.01 * (double)j);
+            samples[j] = NowNs() - start;
+        }
+        usleep(PAUSE_US);
+    }
+    Report("async_log, one %s");
+
+    ASYNC_LOG_SITE limited = {.level = ASYNC_LOG_LEVEL_DEBUG};
+    for (size_t i = 0; i < ASYNC_LOG_SITE_BURST; i++) {
+        async_log_write(&limited, "LSM6DSO: Acceleration [g]  : %.4lf, %.4lf, %.4lf\n", 0.0, 0.02, 1.0);
+    }
+    for (size_t i = 0; i < CALLS; i++) {
+        double start = NowNs();
+        async_log_write(&limited, "LSM6DSO: Acceleration [g]  : %.4lf, %.4lf, %.4lf\n", 0.01 * (double)i, 0.02, 1.0);
+        samples[i] = NowNs() - start;
+    }
+    Report("async_log, rate limited");
+
+    async_log_close();
+    async_log_get_stats(&stats);
+    printf("async_log written %u, dropped %u, suppressed %u\n", stats.written, stats.dropped, stats.suppressed);
+    return 0;
+}
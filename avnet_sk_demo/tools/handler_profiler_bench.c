@@ -0,0 +1,259 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host benchmark for handler_profiler.c, built with ENABLE_HANDLER_PROFILER defined.
+
+   The overhead runs call a handler that increments a counter CALLS times, without profiling,
+   with PROFILE_HANDLER() and with PROFILE_TIMER_HANDLER(), and report the cost per call of each
+   against the plain handler. With the option off the PROFILE_* macros expand to nothing, so
+   the plain handler is also the disabled build.
+
+   The lateness run checks the latency PROFILE_TIMER_HANDLER() reports for DevX timers. The
+   dx_timer* functions below stand in for DevX with a timerfd per timer. A 20 ms periodic timer
+   and a one shot timer that sets itself again for 5 to 30 ms share the loop with a 50 ms timer
+   whose handler busy waits 0 to 15 ms. Each handler also works out its true lateness from the
+   kernel: a periodic timer from the time left to its next expiry, a one shot timer from the
+   expiry timerfd_gettime() gave when it was armed. The run prints the profiler's average and
+   maximum next to the true ones.
+
+   Build: gcc -O2 -DENABLE_HANDLER_PROFILER -I host -I .. -o handler_profiler_bench
+              handler_profiler_bench.c ../handler_profiler.c
+   Usage: handler_profiler_bench
+*/
+
+#include "handler_profiler.h"
+
+#include "dx_timer.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define CALLS 10000000
+#define LATENESS_SECONDS 10
+
+struct EventLoopTimer {
+    int fd;
+    int64_t dueNs; // The one shot expiry the kernel was given
+};
+
+typedef struct {
+    const char *name;
+    uint32_t calls;
+    int64_t totalLateNs;
+    int64_t maxLateNs;
+} TRUE_LATENESS;
+
+static volatile uint64_t counter;
+static uint64_t randomState = 88172645463325252ull;
+
+static DX_DECLARE_TIMER_HANDLER(PeriodicHandler);
+static DX_DECLARE_TIMER_HANDLER(OneShotHandler);
+static DX_DECLARE_TIMER_HANDLER(BusyHandler);
+
+static EventLoopTimer timerState[3];
+static DX_TIMER_BINDING periodicTimer = {.period = {0, 20000000}, .name = "periodic", .handler = PeriodicHandler};
+static DX_TIMER_BINDING oneShotTimer = {.name = "oneShot", .handler = OneShotHandler};
+static DX_TIMER_BINDING busyTimer = {.period = {0, 50000000}, .name = "busy", .handler = BusyHandler};
+static DX_TIMER_BINDING *timerSet[] = {&periodicTimer, &oneShotTimer, &busyTimer};
+
+static TRUE_LATENESS periodicLateness = {.name = "PeriodicHandler"};
+static TRUE_LATENESS oneShotLateness = {.name = "OneShotHandler"};
+
+static uint32_t Random(uint32_t low, uint32_t high)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return low + (uint32_t)(randomState % (high - low + 1));
+}
+
+static int64_t TimespecNs(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+// The DevX timers, a timerfd per binding
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return NULL;
+}
+
+int ConsumeEventLoopTimerEvent(EventLoopTimer *eventLoopTimer)
+{
+    uint64_t expirations;
+    return read(eventLoopTimer->fd, &expirations, sizeof(expirations)) == sizeof(expirations) ? 0 : -1;
+}
+
+static bool Arm(DX_TIMER_BINDING *timer, const struct timespec *delay, const struct timespec *period)
+{
+    struct itimerspec its = {.it_value = *delay, .it_interval = *period};
+
+    if (timerfd_settime(timer->eventLoopTimer->fd, 0, &its, NULL) == -1) {
+        return false;
+    }
+    timerfd_gettime(timer->eventLoopTimer->fd, &its);
+    timer->eventLoopTimer->dueNs = profiler_now_ns() + TimespecNs(&its.it_value);
+    return true;
+}
+
+void dx_timerSetStart(DX_TIMER_BINDING *timers[], size_t timerCount)
+{
+    for (size_t i = 0; i < timerCount; i++) {
+        timers[i]->eventLoopTimer = &timerState[i];
+        timerState[i].fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (TimespecNs(&timers[i]->period) != 0) {
+            Arm(timers[i], &timers[i]->period, &timers[i]->period);
+        }
+    }
+}
+
+bool dx_timerChange(DX_TIMER_BINDING *timer, const struct timespec *period)
+{
+    timer->period = *period;
+    return Arm(timer, period, period);
+}
+
+bool dx_timerOneShotSet(DX_TIMER_BINDING *timer, const struct timespec *delay)
+{
+    return Arm(timer, delay, &(struct timespec){0, 0});
+}
+
+static void RecordTrueLateness(TRUE_LATENESS *lateness, int64_t lateNs)
+{
+    lateness->calls++;
+    lateness->totalLateNs += lateNs;
+    if (lateNs > lateness->maxLateNs) {
+        lateness->maxLateNs = lateNs;
+    }
+}
+
+// Periodic: the last expiry was a period before the next one
+static DX_TIMER_HANDLER(PeriodicHandler)
+{
+    PROFILE_TIMER_HANDLER(PeriodicHandler);
+    struct itimerspec its;
+
+    timerfd_gettime(eventLoopTimer->fd, &its);
+    RecordTrueLateness(&periodicLateness, TimespecNs(&periodicTimer.period) - TimespecNs(&its.it_value));
+}
+DX_TIMER_HANDLER_END
+
+static DX_TIMER_HANDLER(OneShotHandler)
+{
+    PROFILE_TIMER_HANDLER(OneShotHandler);
+
+    RecordTrueLateness(&oneShotLateness, profiler_now_ns() - eventLoopTimer->dueNs);
+    uint32_t ms = Random(5, 30);
+    profiler_timer_oneshot_set(&oneShotTimer, &(struct timespec){0, (long)ms * 1000000});
+}
+DX_TIMER_HANDLER_END
+
+static DX_TIMER_HANDLER(BusyHandler)
+{
+    PROFILE_TIMER_HANDLER(BusyHandler);
+    int64_t until = profiler_now_ns() + (int64_t)Random(0, 15) * 1000000;
+
+    while (profiler_now_ns() < until) {
+    }
+}
+DX_TIMER_HANDLER_END
+
+// The handlers for the overhead runs
+static __attribute__((noinline)) void PlainHandler(void)
+{
+    counter++;
+}
+
+static __attribute__((noinline)) void ProfiledHandler(void)
+{
+    PROFILE_HANDLER();
+    counter++;
+}
+
+static __attribute__((noinline)) void ProfiledTimerHandler(void)
+{
+    PROFILE_TIMER_HANDLER(ProfiledTimerHandler);
+    counter++;
+}
+
+static double NsPerCall(void (*handler)(void))
+{
+    int64_t start = profiler_now_ns();
+
+    for (int i = 0; i < CALLS; i++) {
+        handler();
+    }
+    return (double)(profiler_now_ns() - start) / CALLS;
+}
+
+// Average and maximum lateness in us of one handler, from the getHandlerProfile JSON
+static bool ProfiledLateness(const char *json, const char *name, unsigned long *avgUs, unsigned long *maxUs)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "\"name\":\"%s\"", name);
+    const char *entry = strstr(json, key);
+
+    return entry != NULL && sscanf(strstr(entry, "\"avgLateUs\""), "\"avgLateUs\":%lu,\"maxLateUs\":%lu", avgUs,
+                                   maxUs) == 2;
+}
+
+static void PrintLateness(const char *json, const TRUE_LATENESS *lateness)
+{
+    unsigned long avgUs = 0, maxUs = 0;
+
+    ProfiledLateness(json, lateness->name, &avgUs, &maxUs);
+    printf("%-16s calls %4u  late avg %5lu us max %6lu us  true avg %5lld us max %6lld us\n", lateness->name,
+           lateness->calls, avgUs, maxUs, (long long)(lateness->totalLateNs / lateness->calls / 1000),
+           (long long)(lateness->maxLateNs / 1000));
+}
+
+int main(void)
+{
+    // A schedule for ProfiledTimerHandler so every call looks its due time up
+    profiler_timer_scheduled((const void *)ProfiledTimerHandler, 1000000, 1000000);
+
+    double plainNs = NsPerCall(PlainHandler);
+    double profiledNs = NsPerCall(ProfiledHandler);
+    double timerNs = NsPerCall(ProfiledTimerHandler);
+    int64_t start = profiler_now_ns();
+    for (int i = 0; i < CALLS; i++) {
+        counter += (uint64_t)profiler_now_ns();
+    }
+    double clockNs = (double)(profiler_now_ns() - start) / CALLS;
+
+    printf("-- overhead, %d calls\n", CALLS);
+    printf("plain handler          %6.1f ns/call\n", plainNs);
+    printf("PROFILE_HANDLER        %6.1f ns/call  +%5.1f ns\n", profiledNs, profiledNs - plainNs);
+    printf("PROFILE_TIMER_HANDLER  %6.1f ns/call  +%5.1f ns\n", timerNs, timerNs - plainNs);
+    printf("clock_gettime          %6.1f ns/call\n", clockNs);
+    profiler_reset();
+
+    printf("-- DevX timer lateness, %d s\n", LATENESS_SECONDS);
+    profiler_timer_set_start(timerSet, 3);
+    profiler_timer_oneshot_set(&oneShotTimer, &(struct timespec){0, 10000000});
+
+    int64_t end = profiler_now_ns() + (int64_t)LATENESS_SECONDS * 1000000000;
+    while (profiler_now_ns() < end) {
+        struct pollfd fds[3];
+
+        for (int i = 0; i < 3; i++) {
+            fds[i] = (struct pollfd){.fd = timerState[i].fd, .events = POLLIN};
+        }
+        if (poll(fds, 3, 100) > 0) {
+            for (int i = 0; i < 3; i++) {
+                if (fds[i].revents & POLLIN) {
+                    timerSet[i]->handler(timerSet[i]->eventLoopTimer);
+                }
+            }
+        }
+    }
+
+    char *json = profiler_report_json();
+    PrintLateness(json, &periodicLateness);
+    PrintLateness(json, &oneShotLateness);
+    free(json);
+    return 0;
+}
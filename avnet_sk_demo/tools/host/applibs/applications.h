@@ -0,0 +1,12 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for sk_demo_soak. The memory figures are the
+// host process's.
+
+#pragma once
+
+#include <stddef.h>
+
+size_t Applications_GetTotalMemoryUsageInKB(void);
+size_t Applications_GetPeakUserModeMemoryUsageInKB(void);
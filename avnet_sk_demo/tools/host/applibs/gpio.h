@@ -0,0 +1,17 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for sk_demo_soak
+
+#pragma once
+
+typedef int GPIO_Id;
+
+typedef enum {
+    GPIO_Value_Low = 0,
+    GPIO_Value_High = 1
+} GPIO_Value;
+
+typedef unsigned char GPIO_Value_Type;
+
+int GPIO_GetValue(int gpioFd, GPIO_Value_Type *outValue);
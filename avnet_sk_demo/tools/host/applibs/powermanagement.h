@@ -0,0 +1,8 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for sk_demo_soak
+
+#pragma once
+
+int PowerManagement_ForceSystemReboot(void);
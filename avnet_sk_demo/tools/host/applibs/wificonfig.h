@@ -0,0 +1,23 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for sk_demo_soak
+
+#pragma once
+
+#include <stdint.h>
+
+#define WIFICONFIG_SSID_MAX_LENGTH 32
+#define WIFICONFIG_BSSID_BUFFER_SIZE 6
+
+typedef struct {
+    uint32_t z__magicAndVersion;
+    uint8_t ssid[WIFICONFIG_SSID_MAX_LENGTH];
+    uint8_t bssid[WIFICONFIG_BSSID_BUFFER_SIZE];
+    uint8_t ssidLength;
+    uint8_t security;
+    uint32_t frequencyMHz;
+    int8_t signalRssi;
+} WifiConfig_ConnectedNetwork;
+
+int WifiConfig_GetCurrentNetwork(WifiConfig_ConnectedNetwork *connectedNetwork);
@@ -0,0 +1,15 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct {
+    const char *idScope;
+    const char *connectionString;
+} DX_USER_CONFIG;
+
+bool dx_configParseCmdLineArguments(int argc, char *argv[], DX_USER_CONFIG *userConfig);
@@ -0,0 +1,48 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include "parson.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    DX_DEVICE_TWIN_UNKNOWN,
+    DX_DEVICE_TWIN_BOOL,
+    DX_DEVICE_TWIN_FLOAT,
+    DX_DEVICE_TWIN_DOUBLE,
+    DX_DEVICE_TWIN_INT,
+    DX_DEVICE_TWIN_STRING,
+    DX_DEVICE_TWIN_JSON_OBJECT
+} DX_DEVICE_TWIN_TYPE;
+
+typedef enum {
+    DX_DEVICE_TWIN_RESPONSE_COMPLETED = 200,
+    DX_DEVICE_TWIN_RESPONSE_ERROR = 500,
+    DX_DEVICE_TWIN_RESPONSE_INVALID = 404
+} DX_DEVICE_TWIN_RESPONSE_CODE;
+
+typedef struct _deviceTwinBinding {
+    const char *propertyName;
+    void *propertyValue;
+    int propertyVersion;
+    bool propertyUpdated;
+    DX_DEVICE_TWIN_TYPE twinType;
+    void (*handler)(struct _deviceTwinBinding *deviceTwinBinding);
+    void *context;
+} DX_DEVICE_TWIN_BINDING;
+
+#define DX_DEVICE_TWIN_HANDLER(name, deviceTwinBinding)                                            \
+    void name(DX_DEVICE_TWIN_BINDING *deviceTwinBinding)                                           \
+    {
+#define DX_DEVICE_TWIN_HANDLER_END }
+#define DX_DECLARE_DEVICE_TWIN_HANDLER(name) void name(DX_DEVICE_TWIN_BINDING *deviceTwinBinding)
+
+void dx_deviceTwinSubscribe(DX_DEVICE_TWIN_BINDING *deviceTwins[], size_t deviceTwinCount);
+void dx_deviceTwinUnsubscribe(void);
+bool dx_deviceTwinReportValue(DX_DEVICE_TWIN_BINDING *deviceTwinBinding, const void *value);
+bool dx_deviceTwinAckDesiredValue(DX_DEVICE_TWIN_BINDING *deviceTwinBinding, void *state,
+                                  DX_DEVICE_TWIN_RESPONSE_CODE statusCode);
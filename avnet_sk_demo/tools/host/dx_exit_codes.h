@@ -0,0 +1,12 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak
+
+#pragma once
+
+typedef enum {
+    DX_ExitCode_Success = 0,
+    DX_ExitCode_TermHandler_SigTerm = 150,
+    DX_ExitCode_Main_EventLoopFail = 151
+} DX_ExitCode;
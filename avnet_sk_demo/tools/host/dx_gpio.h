@@ -0,0 +1,37 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include <applibs/gpio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    DX_DIRECTION_UNKNOWN,
+    DX_INPUT,
+    DX_OUTPUT
+} DX_GPIO_DIRECTION;
+
+typedef enum {
+    DX_GPIO_DETECT_LOW,
+    DX_GPIO_DETECT_HIGH,
+    DX_GPIO_DETECT_BOTH
+} DX_GPIO_INPUT_DETECT;
+
+typedef struct {
+    int fd;
+    int pin;
+    GPIO_Value initialState;
+    bool invertPin;
+    DX_GPIO_DIRECTION direction;
+    DX_GPIO_INPUT_DETECT detect;
+    char *name;
+} DX_GPIO_BINDING;
+
+void dx_gpioSetOpen(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount);
+void dx_gpioSetClose(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount);
+void dx_gpioOn(DX_GPIO_BINDING *peripheral);
+void dx_gpioOff(DX_GPIO_BINDING *peripheral);
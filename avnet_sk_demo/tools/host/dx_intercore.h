@@ -0,0 +1,22 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct {
+    bool nonblocking_io;
+    int sockFd;
+    const char *rtAppComponentId;
+    void (*interCoreCallback)(void *data_block, ssize_t message_length);
+    void *intercore_recv_block;
+    size_t intercore_recv_block_length;
+} DX_INTERCORE_BINDING;
+
+bool dx_intercoreConnect(DX_INTERCORE_BINDING *intercore_binding);
+bool dx_intercorePublish(DX_INTERCORE_BINDING *intercore_binding, void *control_block, size_t message_length);
@@ -0,0 +1,19 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    DX_JSON_INT = 0,
+    DX_JSON_FLOAT = 1,
+    DX_JSON_DOUBLE = 2,
+    DX_JSON_STRING = 3,
+    DX_JSON_BOOL = 4
+} DX_JSON_TYPE;
+
+bool dx_jsonSerialize(char *buffer, size_t bufferSize, int keyValueCount, ...);
@@ -0,0 +1,13 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+
+void dx_registerTerminationHandler(void);
+void dx_terminate(int exitCode);
+bool dx_isTerminationRequired(void);
+int dx_getTerminationExitCode(void);
@@ -0,0 +1,39 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. Each tool defines the
+// functions itself.
+
+#pragma once
+
+#include <applibs/eventloop.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+typedef struct EventLoopTimer EventLoopTimer;
+
+typedef struct {
+    void (*handler)(EventLoopTimer *eventLoopTimer);
+    struct timespec period;
+    EventLoopTimer *eventLoopTimer;
+    const char *name;
+} DX_TIMER_BINDING;
+
+int ConsumeEventLoopTimerEvent(EventLoopTimer *eventLoopTimer);
+
+#define DX_TIMER_HANDLER(name)                                                                     \
+    void name(EventLoopTimer *eventLoopTimer)                                                      \
+    {                                                                                              \
+        if (ConsumeEventLoopTimerEvent(eventLoopTimer) == 0) {
+#define DX_TIMER_HANDLER_END                                                                       \
+    }                                                                                              \
+    }
+#define DX_DECLARE_TIMER_HANDLER(name) void name(EventLoopTimer *eventLoopTimer)
+
+EventLoop *dx_timerGetEventLoop(void);
+void dx_timerSetStart(DX_TIMER_BINDING *timerSet[], size_t timerCount);
+bool dx_timerChange(DX_TIMER_BINDING *timer, const struct timespec *period);
+bool dx_timerOneShotSet(DX_TIMER_BINDING *timer, const struct timespec *delay);
+void dx_timerSetStop(DX_TIMER_BINDING *timerSet[], size_t timerCount);
+void dx_timerEventLoopStop(void);
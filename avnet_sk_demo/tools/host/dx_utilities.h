@@ -0,0 +1,14 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak. The tool defines the functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
+#define IN_RANGE(number, low, high) ((low) <= (number) && (number) <= (high))
+
+bool dx_isStringPrintable(char *data);
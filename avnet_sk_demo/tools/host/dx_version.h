@@ -0,0 +1,8 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for sk_demo_soak
+
+#pragma once
+
+#define AZURE_SPHERE_DEVX_VERSION 0
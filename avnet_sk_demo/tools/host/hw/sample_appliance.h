@@ -0,0 +1,18 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the hardware definition, for sk_demo_soak. The pins are only names to the
+// GPIO and I2C stand-ins.
+
+#pragma once
+
+#define SAMPLE_BUTTON_1 12
+#define SAMPLE_BUTTON_2 13
+#define SAMPLE_RGBLED_RED 8
+#define SAMPLE_RGBLED_GREEN 9
+#define SAMPLE_RGBLED_BLUE 10
+#define SAMPLE_WIFI_LED 17
+#define SAMPLE_APP_LED 4
+#define RELAY_CLICK2_RELAY1 0
+#define RELAY_CLICK2_RELAY2 1
+#define AVNET_MT3620_SK_ISU2_I2C 2
@@ -0,0 +1,42 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for parson, for sk_demo_soak. parson_host.c parses the objects, numbers,
+// strings and booleans of twin patches and direct method payloads, no arrays or escapes.
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct json_value_t JSON_Value;
+typedef struct json_object_t JSON_Object;
+
+enum json_value_type {
+    JSONError = -1,
+    JSONNull = 1,
+    JSONString = 2,
+    JSONNumber = 3,
+    JSONObject = 4,
+    JSONArray = 5,
+    JSONBoolean = 6
+};
+typedef int JSON_Value_Type;
+
+JSON_Value *json_parse_string(const char *string);
+void json_value_free(JSON_Value *value);
+
+JSON_Value_Type json_value_get_type(const JSON_Value *value);
+JSON_Object *json_value_get_object(const JSON_Value *value);
+const char *json_value_get_string(const JSON_Value *value);
+double json_value_get_number(const JSON_Value *value);
+int json_value_get_boolean(const JSON_Value *value);
+
+size_t json_object_get_count(const JSON_Object *object);
+const char *json_object_get_name(const JSON_Object *object, size_t index);
+JSON_Value *json_object_get_value_at(const JSON_Object *object, size_t index);
+JSON_Value *json_object_get_value(const JSON_Object *object, const char *name);
+JSON_Object *json_object_get_object(const JSON_Object *object, const char *name);
+int json_object_has_value_of_type(const JSON_Object *object, const char *name, JSON_Value_Type type);
+double json_object_get_number(const JSON_Object *object, const char *name);
+int json_object_get_boolean(const JSON_Object *object, const char *name);
+const char *json_object_get_string(const JSON_Object *object, const char *name);
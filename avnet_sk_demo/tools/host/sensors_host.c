@@ -0,0 +1,183 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the I2C bus, see applibs/i2c.h in this directory. It emulates the LSM6DSO
+// registers i2c.c uses and the LPS22HH behind the LSM6DSO sensor hub. The readings follow the
+// simulated clock: the accelerometer tilts a little, the temperature and pressure drift through
+// the day. The gyroscope reads constant, lp_calibrate_angular_rate() loops until two readings
+// calibrate to zero.
+//
+// Every transfer takes the time it would at 100 kHz, 9 bits a byte including the address, on
+// the simulated clock.
+
+#include "lps22hh_reg.h"
+#include "lsm6dso_reg.h"
+#include "timer_wheel.h"
+#include "virtual_clock.h"
+
+#include <applibs/i2c.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+
+#define LSM6DSO_ADDRESS 0x6A
+#define NS_PER_BYTE (9 * 1000000000LL / I2C_BUS_SPEED_STANDARD)
+#define SECONDS_PER_DAY (24.0 * 60 * 60)
+
+// The LSM6DSO user, sensor hub and embedded function register banks, and the LPS22HH registers
+static uint8_t lsm6dsoBanks[3][256];
+static uint8_t lps22hh[256];
+
+// /dev/null, so i2c.c can close it
+static int busFd = -1;
+
+static int16_t gyroRaw[3] = {12, -7, 3};
+
+static double SimulatedSeconds(void)
+{
+    return (double)timer_wheel_now_ns() / 1e9;
+}
+
+static void PutInt16(uint8_t *registers, int16_t value)
+{
+    registers[0] = (uint8_t)(value & 0xff);
+    registers[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+// Sample the outputs at the simulated time of the read
+static void UpdateOutputs(void)
+{
+    double seconds = SimulatedSeconds();
+    double day = 2 * M_PI * seconds / SECONDS_PER_DAY;
+    double temperature = 22.0 + 3.0 * sin(day) + 0.2 * sin(2 * M_PI * seconds / 600);
+    double pressure = 1013.25 + 4.0 * sin(day / 3) + 0.3 * sin(2 * M_PI * seconds / 1800);
+    uint8_t *user = lsm6dsoBanks[0];
+
+    // Accelerometer in 0.061 mg steps, near 1 g on z
+    PutInt16(&user[LSM6DSO_OUTX_L_A], (int16_t)(20 * sin(2 * M_PI * seconds / 300) / 0.061));
+    PutInt16(&user[LSM6DSO_OUTX_L_A + 2], (int16_t)(15 * cos(2 * M_PI * seconds / 420) / 0.061));
+    PutInt16(&user[LSM6DSO_OUTX_L_A + 4], (int16_t)(1000 / 0.061));
+    for (int i = 0; i < 3; i++) {
+        PutInt16(&user[LSM6DSO_OUTX_L_G + 2 * i], gyroRaw[i]);
+    }
+    PutInt16(&user[LSM6DSO_OUT_TEMP_L], (int16_t)((temperature - 25.0) * 256));
+
+    uint32_t pressureRaw = (uint32_t)(pressure * 4096);
+    lps22hh[LPS22HH_PRESS_OUT_XL] = (uint8_t)pressureRaw;
+    lps22hh[LPS22HH_PRESS_OUT_XL + 1] = (uint8_t)(pressureRaw >> 8);
+    lps22hh[LPS22HH_PRESS_OUT_XL + 2] = (uint8_t)(pressureRaw >> 16);
+    PutInt16(&lps22hh[LPS22HH_TEMP_OUT_L], (int16_t)(temperature * 100));
+}
+
+static uint8_t *CurrentBank(void)
+{
+    lsm6dso_func_cfg_access_t *access = (lsm6dso_func_cfg_access_t *)&lsm6dsoBanks[0][LSM6DSO_FUNC_CFG_ACCESS];
+
+    return lsm6dsoBanks[access->reg_access < 3 ? access->reg_access : 0];
+}
+
+// The sensor hub runs its slave 0 operation when the accelerometer starts with the master on
+static void RunSensorHub(void)
+{
+    uint8_t *hub = lsm6dsoBanks[LSM6DSO_SENSOR_HUB_BANK];
+    lsm6dso_master_config_t *master = (lsm6dso_master_config_t *)&hub[LSM6DSO_MASTER_CONFIG];
+    lsm6dso_slv0_add_t *slave = (lsm6dso_slv0_add_t *)&hub[LSM6DSO_SLV0_ADD];
+    lsm6dso_slv0_config_t *config = (lsm6dso_slv0_config_t *)&hub[LSM6DSO_SLV0_CONFIG];
+    lsm6dso_status_master_t *status = (lsm6dso_status_master_t *)&hub[LSM6DSO_STATUS_MASTER];
+    uint8_t subAddress = hub[LSM6DSO_SLV0_SUBADD];
+
+    if (!master->master_on || slave->slave0 != (LPS22HH_I2C_ADD_L & 0xFEU) >> 1) {
+        return;
+    }
+
+    if (slave->rw_0) {
+        UpdateOutputs();
+        for (uint8_t i = 0; i < config->slave0_numop; i++) {
+            hub[LSM6DSO_SENSOR_HUB_1 + i] = lps22hh[(uint8_t)(subAddress + i)];
+        }
+    } else {
+        // Resets finish at once
+        lps22hh[subAddress] = hub[LSM6DSO_DATAWRITE_SLV0];
+        ((lps22hh_ctrl_reg2_t *)&lps22hh[LPS22HH_CTRL_REG2])->swreset = 0;
+    }
+    status->sens_hub_endop = 1;
+}
+
+static void WriteRegisters(const uint8_t *data, size_t length)
+{
+    uint8_t *bank = CurrentBank();
+    uint8_t first = data[0];
+
+    for (size_t i = 1; i < length; i++) {
+        uint8_t address = (uint8_t)(first + i - 1);
+        // FUNC_CFG_ACCESS is the same register in every bank
+        (address == LSM6DSO_FUNC_CFG_ACCESS ? lsm6dsoBanks[0] : bank)[address] = data[i];
+    }
+
+    if (bank == lsm6dsoBanks[0]) {
+        ((lsm6dso_ctrl3_c_t *)&bank[LSM6DSO_CTRL3_C])->sw_reset = 0;
+        if (first <= LSM6DSO_CTRL1_XL && LSM6DSO_CTRL1_XL < first + length - 1 &&
+            ((lsm6dso_ctrl1_xl_t *)&bank[LSM6DSO_CTRL1_XL])->odr_xl != LSM6DSO_XL_ODR_OFF) {
+            RunSensorHub();
+        }
+    }
+}
+
+int I2CMaster_Open(I2C_InterfaceId id)
+{
+    (void)id;
+
+    lsm6dsoBanks[0][LSM6DSO_WHO_AM_I] = LSM6DSO_ID;
+    ((lsm6dso_status_reg_t *)&lsm6dsoBanks[0][LSM6DSO_STATUS_REG])->xlda = 1;
+    ((lsm6dso_status_reg_t *)&lsm6dsoBanks[0][LSM6DSO_STATUS_REG])->gda = 1;
+    ((lsm6dso_status_reg_t *)&lsm6dsoBanks[0][LSM6DSO_STATUS_REG])->tda = 1;
+    lps22hh[LPS22HH_WHO_AM_I] = LPS22HH_ID;
+    ((lps22hh_status_t *)&lps22hh[LPS22HH_STATUS])->p_da = 1;
+    ((lps22hh_status_t *)&lps22hh[LPS22HH_STATUS])->t_da = 1;
+    busFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return busFd;
+}
+
+int I2CMaster_SetBusSpeed(int fd, uint32_t speedInHz)
+{
+    (void)speedInHz;
+    return fd == busFd ? 0 : -1;
+}
+
+int I2CMaster_SetTimeout(int fd, uint32_t timeoutInMs)
+{
+    (void)timeoutInMs;
+    return fd == busFd ? 0 : -1;
+}
+
+ssize_t I2CMaster_Write(int fd, I2C_DeviceAddress address, const uint8_t *data, size_t length)
+{
+    if (fd != busFd || address != LSM6DSO_ADDRESS || length == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    virtual_clock_sleep((int64_t)(1 + length) * NS_PER_BYTE);
+    WriteRegisters(data, length);
+    return (ssize_t)length;
+}
+
+ssize_t I2CMaster_WriteThenRead(int fd, I2C_DeviceAddress address, const uint8_t *writeData, size_t lenWriteData,
+                                uint8_t *readData, size_t lenReadData)
+{
+    if (fd != busFd || address != LSM6DSO_ADDRESS || lenWriteData != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    virtual_clock_sleep((int64_t)(2 + lenWriteData + lenReadData) * NS_PER_BYTE);
+
+    uint8_t *bank = CurrentBank();
+    if (bank == lsm6dsoBanks[0]) {
+        UpdateOutputs();
+    }
+    for (size_t i = 0; i < lenReadData; i++) {
+        uint8_t address = (uint8_t)(writeData[0] + i);
+        readData[i] = (address == LSM6DSO_FUNC_CFG_ACCESS ? lsm6dsoBanks[0] : bank)[address];
+    }
+    return (ssize_t)(lenWriteData + lenReadData);
+}
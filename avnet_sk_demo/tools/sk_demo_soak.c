@@ -0,0 +1,605 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host soak test for the starter kit application. It builds main.c, i2c.c and the sensor
+   drivers unchanged with USE_VIRTUAL_CLOCK, IOT_HUB_APPLICATION and M4_INTERCORE_COMMS, and
+   runs SIMULATION_DURATION_SECONDS, a week, on the simulated clock.
+
+   The stand-ins below take the place of DevX and the Azure Sphere libraries. I2C goes to the
+   emulated LSM6DSO and LPS22HH in host/sensors_host.c, so read_sensors_handler runs every
+   register access and every sensor hub wait it runs on the device, on the simulated clock.
+   Inputs reach the application the way they do on the device:
+
+   - twin patches and direct method calls are written with virtual_clock_inject_bytes() to the
+     socket the DevX stand-in receives the cloud's messages on. It parses them and calls the
+     bindings' handlers as DevX does.
+   - each intercore read gets a reply from the emulated real time app 1 ms later, written to
+     the other end of the intercore socket.
+   - button A is pressed for 200 ms every hour.
+
+   Twin patches slow the sensor reads to a minute for day 2, turn adaptive sampling on for days
+   4 and 5 and set the LEDs and OLED lines. Direct methods set the poll time on day 7.
+
+   Each simulated day prints the telemetry, twin and intercore counts and the process memory.
+   The run ends with the real time it took, the simulated time slept in the sensor hub and a
+   digest of every message published, which two runs must agree on. The application's own
+   debug output goes to stderr.
+
+   main.h and i2c.c both define the sensor readings, which the device toolchain links as common
+   symbols. Newer host compilers need -fcommon for the same.
+
+   Build: gcc -O2 -fcommon -DUSE_VIRTUAL_CLOCK -DIOT_HUB_APPLICATION -DM4_INTERCORE_COMMS
+              -I host -I .. -o sk_demo_soak sk_demo_soak.c host/sensors_host.c host/parson_host.c
+              ../i2c.c ../lsm6dso_reg.c ../lps22hh_reg.c ../timer_wheel.c ../virtual_clock.c
+              ../adaptive_sampler.c ../async_log.c ../handler_profiler.c -lm -lpthread
+   Usage: sk_demo_soak 2>sk_demo_soak.log
+*/
+
+// The application, with its main() renamed so this file can drive it
+#define main sk_demo_main
+#include "main.c"
+#undef main
+
+#include <ctype.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+
+#define MAX_REGISTRATIONS 8
+#define INTERCORE_REPLIES 4
+#define ONE_SECOND_NS 1000000000LL
+#define ONE_HOUR_NS (60 * 60 * ONE_SECOND_NS)
+#define ONE_DAY_NS (24 * ONE_HOUR_NS)
+
+typedef struct {
+    int64_t atNs;
+    const char *message;
+} SCHEDULED_MESSAGE;
+
+// Twin patches and direct method calls, with the time the cloud sends each
+static const SCHEDULED_MESSAGE cloudMessages[] = {
+    {0, "{\"enableDebug\": false}"},
+    {2 * ONE_HOUR_NS, "{\"userLedRed\": true, \"OledDisplayMsg1\": \"Soak test\"}"},
+    {6 * ONE_HOUR_NS, "{\"userLedRed\": false, \"clickBoardRelay1\": true}"},
+    {ONE_DAY_NS, "{\"sensorPollPeriod\": 60}"},
+    {2 * ONE_DAY_NS, "{\"sensorPollPeriod\": 5}"},
+    {3 * ONE_DAY_NS, "{\"adaptiveSampling\": {\"enabled\": true, \"minPeriodMs\": 1000, \"maxPeriodMs\": 60000, "
+                     "\"aggressiveness\": 0.5}}"},
+    {5 * ONE_DAY_NS, "{\"adaptiveSampling\": {\"enabled\": false}}"},
+    {6 * ONE_DAY_NS, "{\"methodName\": \"setSensorPollTime\", \"payload\": {\"pollTime\": 10}}"},
+    {6 * ONE_DAY_NS + 12 * ONE_HOUR_NS, "{\"methodName\": \"setSensorPollTime\", \"payload\": {\"pollTime\": 5}}"},
+};
+
+typedef struct {
+    int fd;
+    EventLoopIoCallback *callback;
+    void *context;
+} REGISTRATION;
+
+struct EventLoop {
+    REGISTRATION registrations[MAX_REGISTRATIONS];
+    size_t count;
+};
+
+static EventLoop eventLoop;
+
+static struct {
+    uint64_t published;
+    uint64_t publishedBytes;
+    uint64_t publishDigest;
+    uint64_t twinUpdates;
+    uint64_t twinReports;
+    uint64_t methodCalls;
+    uint64_t methodsFailed;
+    uint64_t intercoreRequests;
+    uint64_t buttonPresses;
+} counts = {.publishDigest = 14695981039346656037ull};
+
+static bool terminationRequired = false;
+static int terminationExitCode = 0;
+static bool azureConnected = false;
+static void (*connectionChanged)(bool connected);
+
+static int cloudFds[2] = {-1, -1}; // The DevX stand-in reads [0], the cloud writes [1]
+static DX_DEVICE_TWIN_BINDING **twinBindings;
+static size_t twinBindingCount;
+static DX_DIRECT_METHOD_BINDING **methodBindings;
+static size_t methodBindingCount;
+static JSON_Value *lastPatch; // Owns the JSON_Object a JSON twin handler was given
+
+static DX_INTERCORE_BINDING *intercoreBinding;
+static int realTimeAppFd = -1;
+static IC_COMMAND_BLOCK_ALS_PT19 intercoreReplies[INTERCORE_REPLIES];
+static uint32_t nextReply;
+
+static GPIO_Value_Type buttonALevel = GPIO_Value_High;
+
+// The event loop, EventLoop_Run() only ever polls
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)eventBitmask;
+
+    if (el->count == MAX_REGISTRATIONS) {
+        return NULL;
+    }
+    el->registrations[el->count] = (REGISTRATION){.fd = fd, .callback = callback, .context = context};
+    return (EventRegistration *)&el->registrations[el->count++];
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    for (size_t i = 0; i < el->count; i++) {
+        if ((EventRegistration *)&el->registrations[i] == reg) {
+            el->registrations[i] = el->registrations[--el->count];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+EventLoop_Run_Result EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event)
+{
+    struct pollfd fds[MAX_REGISTRATIONS];
+    EventLoop_Run_Result result = EventLoop_Run_FinishedEmpty;
+
+    for (size_t i = 0; i < el->count; i++) {
+        fds[i] = (struct pollfd){.fd = el->registrations[i].fd, .events = POLLIN};
+    }
+    if (poll(fds, el->count, duration_in_milliseconds) < 0) {
+        return EventLoop_Run_Failed;
+    }
+    for (size_t i = 0; i < el->count; i++) {
+        if (fds[i].revents & POLLIN) {
+            REGISTRATION *registration = &el->registrations[i];
+            registration->callback(el, registration->fd, EventLoop_Input, registration->context);
+            result = EventLoop_Run_Finished;
+            if (process_one_event) {
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// DevX timers, the application timers run on the timer wheel
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return &eventLoop;
+}
+
+void dx_timerEventLoopStop(void)
+{
+}
+
+void dx_registerTerminationHandler(void)
+{
+}
+
+void dx_terminate(int exitCode)
+{
+    terminationExitCode = exitCode;
+    terminationRequired = true;
+}
+
+bool dx_isTerminationRequired(void)
+{
+    return terminationRequired;
+}
+
+int dx_getTerminationExitCode(void)
+{
+    return terminationExitCode;
+}
+
+bool dx_configParseCmdLineArguments(int argc, char *argv[], DX_USER_CONFIG *userConfig)
+{
+    (void)argc;
+    (void)argv;
+    (void)userConfig;
+    return true;
+}
+
+bool dx_isStringPrintable(char *data)
+{
+    for (; *data != '\0'; data++) {
+        if (!isprint((unsigned char)*data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool dx_jsonSerialize(char *buffer, size_t bufferSize, int keyValueCount, ...)
+{
+    va_list args;
+    size_t used = 0;
+    int written = snprintf(buffer, bufferSize, "{");
+
+    va_start(args, keyValueCount);
+    for (int i = 0; i < keyValueCount && written >= 0 && (size_t)written < bufferSize - used; i++) {
+        used += (size_t)written;
+        int type = va_arg(args, int);
+        const char *key = va_arg(args, const char *);
+        const char *separator = i == 0 ? "" : ",";
+
+        if (type == DX_JSON_INT || type == DX_JSON_BOOL) {
+            written = snprintf(buffer + used, bufferSize - used, "%s\"%s\":%d", separator, key, va_arg(args, int));
+        } else if (type == DX_JSON_STRING) {
+            written = snprintf(buffer + used, bufferSize - used, "%s\"%s\":\"%s\"", separator, key,
+                               va_arg(args, const char *));
+        } else {
+            written = snprintf(buffer + used, bufferSize - used, "%s\"%s\":%f", separator, key, va_arg(args, double));
+        }
+    }
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= bufferSize - used) {
+        return false;
+    }
+    used += (size_t)written;
+    return snprintf(buffer + used, bufferSize - used, "}") == 1;
+}
+
+// IoT Hub, always connected. Published messages are counted and folded into the digest.
+void dx_azureConnect(DX_USER_CONFIG *userConfig, const char *networkInterface, const char *plugAndPlayModelId)
+{
+    (void)userConfig;
+    (void)networkInterface;
+    (void)plugAndPlayModelId;
+    azureConnected = true;
+}
+
+bool dx_isAzureConnected(void)
+{
+    return azureConnected;
+}
+
+void dx_azureRegisterConnectionChangedNotification(void (*connectionStatusCallback)(bool connected))
+{
+    connectionChanged = connectionStatusCallback;
+    connectionChanged(azureConnected);
+}
+
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties)
+{
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+
+    // FNV-1a
+    for (size_t i = 0; i < messageLength; i++) {
+        counts.publishDigest = (counts.publishDigest ^ ((const uint8_t *)message)[i]) * 1099511628211ull;
+    }
+    counts.published++;
+    counts.publishedBytes += messageLength;
+    return true;
+}
+
+// Device twins and direct methods, from the messages the cloud writes to cloudFds[1]
+static void SetTwinValue(DX_DEVICE_TWIN_BINDING *binding, JSON_Value *value)
+{
+    void *propertyValue = NULL;
+
+    switch (binding->twinType) {
+    case DX_DEVICE_TWIN_BOOL:
+        if ((propertyValue = malloc(sizeof(bool))) != NULL) {
+            *(bool *)propertyValue = json_value_get_boolean(value) == 1;
+        }
+        break;
+    case DX_DEVICE_TWIN_INT:
+        if ((propertyValue = malloc(sizeof(int))) != NULL) {
+            *(int *)propertyValue = (int)json_value_get_number(value);
+        }
+        break;
+    case DX_DEVICE_TWIN_STRING:
+        propertyValue = strdup(json_value_get_string(value) != NULL ? json_value_get_string(value) : "");
+        break;
+    default:
+        break;
+    }
+
+    if (binding->twinType == DX_DEVICE_TWIN_JSON_OBJECT) {
+        binding->propertyValue = json_value_get_object(value);
+    } else {
+        free(binding->propertyValue);
+        binding->propertyValue = propertyValue;
+    }
+    binding->propertyVersion++;
+    binding->propertyUpdated = true;
+}
+
+static void DeliverTwinPatch(JSON_Object *desired)
+{
+    for (size_t i = 0; i < twinBindingCount; i++) {
+        DX_DEVICE_TWIN_BINDING *binding = twinBindings[i];
+        JSON_Value *value = json_object_get_value(desired, binding->propertyName);
+
+        if (value != NULL && binding->handler != NULL) {
+            SetTwinValue(binding, value);
+            counts.twinUpdates++;
+            binding->handler(binding);
+            binding->propertyUpdated = false;
+        }
+    }
+}
+
+static void CallDirectMethod(JSON_Object *call)
+{
+    const char *name = json_object_get_string(call, "methodName");
+
+    for (size_t i = 0; i < methodBindingCount; i++) {
+        if (name != NULL && strcmp(methodBindings[i]->methodName, name) == 0) {
+            char *responseMsg = NULL;
+
+            counts.methodCalls++;
+            if (methodBindings[i]->handler(json_object_get_value(call, "payload"), methodBindings[i], &responseMsg) !=
+                DX_METHOD_SUCCEEDED) {
+                counts.methodsFailed++;
+            }
+            free(responseMsg);
+            return;
+        }
+    }
+    counts.methodsFailed++;
+}
+
+static void CloudMessageHandler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    (void)el;
+    (void)events;
+    (void)context;
+    char message[512];
+    ssize_t length = recv(fd, message, sizeof(message) - 1, 0);
+
+    if (length <= 0) {
+        return;
+    }
+    message[length] = '\0';
+
+    json_value_free(lastPatch);
+    lastPatch = json_parse_string(message);
+    JSON_Object *object = json_value_get_object(lastPatch);
+    if (object == NULL) {
+        Log_Debug("ERROR: cloud message is not JSON: %s\n", message);
+    } else if (json_object_get_value(object, "methodName") != NULL) {
+        CallDirectMethod(object);
+    } else {
+        DeliverTwinPatch(object);
+    }
+}
+
+void dx_deviceTwinSubscribe(DX_DEVICE_TWIN_BINDING *deviceTwins[], size_t deviceTwinCount)
+{
+    twinBindings = deviceTwins;
+    twinBindingCount = deviceTwinCount;
+    EventLoop_RegisterIo(&eventLoop, cloudFds[0], EventLoop_Input, CloudMessageHandler, NULL);
+}
+
+void dx_deviceTwinUnsubscribe(void)
+{
+    for (size_t i = 0; i < twinBindingCount; i++) {
+        if (twinBindings[i]->twinType != DX_DEVICE_TWIN_JSON_OBJECT) {
+            free(twinBindings[i]->propertyValue);
+        }
+        twinBindings[i]->propertyValue = NULL;
+    }
+    twinBindingCount = 0;
+}
+
+bool dx_deviceTwinReportValue(DX_DEVICE_TWIN_BINDING *deviceTwinBinding, const void *value)
+{
+    (void)deviceTwinBinding;
+    (void)value;
+    counts.twinReports++;
+    return true;
+}
+
+bool dx_deviceTwinAckDesiredValue(DX_DEVICE_TWIN_BINDING *deviceTwinBinding, void *state,
+                                  DX_DEVICE_TWIN_RESPONSE_CODE statusCode)
+{
+    (void)statusCode;
+    return dx_deviceTwinReportValue(deviceTwinBinding, state);
+}
+
+void dx_directMethodSubscribe(DX_DIRECT_METHOD_BINDING *directMethods[], size_t directMethodCount)
+{
+    methodBindings = directMethods;
+    methodBindingCount = directMethodCount;
+}
+
+void dx_directMethodUnsubscribe(void)
+{
+    methodBindingCount = 0;
+}
+
+// Intercore, the emulated real time app answers each read 1 ms later with the light level
+static void IntercoreReceiveHandler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    (void)el;
+    (void)events;
+    (void)context;
+    ssize_t length = recv(fd, intercoreBinding->intercore_recv_block, intercoreBinding->intercore_recv_block_length, 0);
+
+    if (length > 0) {
+        intercoreBinding->interCoreCallback(intercoreBinding->intercore_recv_block, length);
+    }
+}
+
+bool dx_intercoreConnect(DX_INTERCORE_BINDING *intercore_binding)
+{
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == -1) {
+        return false;
+    }
+    intercoreBinding = intercore_binding;
+    intercore_binding->sockFd = fds[0];
+    realTimeAppFd = fds[1];
+    return EventLoop_RegisterIo(&eventLoop, fds[0], EventLoop_Input, IntercoreReceiveHandler, NULL) != NULL;
+}
+
+bool dx_intercorePublish(DX_INTERCORE_BINDING *intercore_binding, void *control_block, size_t message_length)
+{
+    (void)intercore_binding;
+    (void)message_length;
+    IC_COMMAND_BLOCK_ALS_PT19 *reply = &intercoreReplies[nextReply++ % INTERCORE_REPLIES];
+    double hour = (double)(timer_wheel_now_ns() % ONE_DAY_NS) / (double)ONE_HOUR_NS;
+
+    counts.intercoreRequests++;
+    *reply = *(IC_COMMAND_BLOCK_ALS_PT19 *)control_block;
+    reply->lightSensorLuxData = hour < 6 || hour >= 20 ? 5.0 : 5.0 + 400.0 * sin(M_PI * (hour - 6) / 14);
+    return virtual_clock_inject_bytes(ONE_MS, realTimeAppFd, reply, sizeof(*reply));
+}
+
+// GPIO, the buttons read high unless PressButtonA() holds button A low
+void dx_gpioSetOpen(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount)
+{
+    for (size_t i = 0; i < gpioSetCount; i++) {
+        gpioSet[i]->fd = gpioSet[i]->pin;
+    }
+}
+
+void dx_gpioSetClose(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount)
+{
+    for (size_t i = 0; i < gpioSetCount; i++) {
+        gpioSet[i]->fd = -1;
+    }
+}
+
+void dx_gpioOn(DX_GPIO_BINDING *peripheral)
+{
+    (void)peripheral;
+}
+
+void dx_gpioOff(DX_GPIO_BINDING *peripheral)
+{
+    (void)peripheral;
+}
+
+int GPIO_GetValue(int gpioFd, GPIO_Value_Type *outValue)
+{
+    *outValue = gpioFd == SAMPLE_BUTTON_1 ? buttonALevel : GPIO_Value_High;
+    return 0;
+}
+
+int WifiConfig_GetCurrentNetwork(WifiConfig_ConnectedNetwork *connectedNetwork)
+{
+    static const char ssid[] = "SoakTestAP";
+
+    *connectedNetwork = (WifiConfig_ConnectedNetwork){
+        .bssid = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01}, .frequencyMHz = 2437, .signalRssi = -52};
+    memcpy(connectedNetwork->ssid, ssid, sizeof(ssid) - 1);
+    connectedNetwork->ssidLength = sizeof(ssid) - 1;
+    return 0;
+}
+
+int PowerManagement_ForceSystemReboot(void)
+{
+    Log_Debug("Reboot requested, ending the run\n");
+    dx_terminate(0);
+    return 0;
+}
+
+size_t Applications_GetTotalMemoryUsageInKB(void)
+{
+    long pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm != NULL) {
+        if (fscanf(statm, "%*s %ld", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+    return (size_t)pages * (size_t)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// The high water mark of the same resident size, ru_maxrss can lag behind it
+size_t Applications_GetPeakUserModeMemoryUsageInKB(void)
+{
+    char line[128];
+    size_t peakKB = 0;
+    FILE *status = fopen("/proc/self/status", "r");
+
+    if (status != NULL) {
+        while (fgets(line, sizeof(line), status) != NULL && sscanf(line, "VmHWM: %zu", &peakKB) != 1) {
+        }
+        fclose(status);
+    }
+    return peakKB;
+}
+
+// The scenario
+static void ReleaseButtonA(void *context)
+{
+    (void)context;
+    buttonALevel = GPIO_Value_High;
+}
+
+static void PressButtonA(void *context)
+{
+    (void)context;
+    counts.buttonPresses++;
+    buttonALevel = GPIO_Value_Low;
+    virtual_clock_inject(200 * ONE_MS, ReleaseButtonA, NULL);
+    virtual_clock_inject(ONE_HOUR_NS, PressButtonA, NULL);
+}
+
+static void ReportDay(void *context)
+{
+    (void)context;
+    VIRTUAL_CLOCK_STATS stats;
+
+    virtual_clock_get_stats(&stats);
+    printf("day %lld  telemetry %8llu  twin updates %3llu  reports %4llu  methods %2llu  intercore %7llu  "
+           "memory %5zu KB  peak %5zu KB\n",
+           (long long)((timer_wheel_now_ns() + ONE_HOUR_NS) / ONE_DAY_NS), (unsigned long long)counts.published,
+           (unsigned long long)counts.twinUpdates, (unsigned long long)counts.twinReports,
+           (unsigned long long)counts.methodCalls, (unsigned long long)counts.intercoreRequests,
+           Applications_GetTotalMemoryUsageInKB(), Applications_GetPeakUserModeMemoryUsageInKB());
+    fflush(stdout);
+    virtual_clock_inject(ONE_DAY_NS, ReportDay, NULL);
+}
+
+static double RealSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+    static char *argv[] = {"sk_demo_soak", NULL};
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, cloudFds) == -1) {
+        perror("socketpair");
+        return 1;
+    }
+    for (size_t i = 0; i < NELEMS(cloudMessages); i++) {
+        virtual_clock_inject_bytes(cloudMessages[i].atNs, cloudFds[1], cloudMessages[i].message,
+                                   strlen(cloudMessages[i].message));
+    }
+    virtual_clock_inject(30 * 60 * ONE_SECOND_NS, PressButtonA, NULL);
+    virtual_clock_inject(ONE_DAY_NS - 1, ReportDay, NULL);
+
+    double startSeconds = RealSeconds();
+    int exitCode = sk_demo_main(1, argv);
+    double realSeconds = RealSeconds() - startSeconds;
+
+    VIRTUAL_CLOCK_STATS stats;
+    virtual_clock_get_stats(&stats);
+    printf("simulated %.1f days in %.1f s real  exit code %d\n", (double)stats.elapsedNs / (double)ONE_DAY_NS,
+           realSeconds, exitCode);
+    printf("timer wakeups %llu  injected events %llu  slept in sensor waits %.1f h  button presses %llu\n",
+           (unsigned long long)stats.timerWakeups, (unsigned long long)stats.injectedEvents,
+           (double)stats.sleptNs / (double)ONE_HOUR_NS, (unsigned long long)counts.buttonPresses);
+    printf("published %llu messages, %llu bytes, digest %016llx  methods failed %llu\n",
+           (unsigned long long)counts.published, (unsigned long long)counts.publishedBytes,
+           (unsigned long long)counts.publishDigest, (unsigned long long)counts.methodsFailed);
+
+    json_value_free(lastPatch);
+    return exitCode;
+}
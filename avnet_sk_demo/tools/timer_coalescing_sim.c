@@ -0,0 +1,209 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host simulation of timer slack in timer_wheel.c, on the simulated clock of virtual_clock.c.
+   Each run starts the timers at unrelated phases, runs SIMULATED_MINUTES and reports the timer
+   wakeups per minute, the handlers run per minute, how many of those shared a wakeup with
+   another timer, and the longest any handler ran after its nominal time.
+
+   Every handler checks its own start against the nominal schedule, the start time plus a whole
+   number of periods. It must run no earlier and no later than its slack allows, a run outside
+   that window counts as a violation.
+
+   - the starter kit timers, with the periods and slack main.h gives them, once with the slack
+     and once with it set to zero. Then the same without the 10 ms button poll, which has no
+     slack and on its own sets the wakeup rate.
+   - RANDOM_TIMERS timers with random periods from 10 ms to 60 s, random phases and random
+     slack of up to half the period, a quarter of them with none, for RANDOM_MINUTES.
+
+   Build: gcc -O2 -DUSE_VIRTUAL_CLOCK -I host -I .. -o timer_coalescing_sim
+              timer_coalescing_sim.c ../timer_wheel.c ../virtual_clock.c
+   Usage: timer_coalescing_sim 2>/dev/null
+*/
+
+#include "timer_wheel.h"
+#include "virtual_clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ONE_MS 1000000LL
+#define SIMULATED_MINUTES 10
+#define RANDOM_TIMERS 300
+#define RANDOM_MINUTES 60
+
+typedef struct {
+    TIMER_WHEEL_BINDING binding; // Must be first
+    int64_t nominalNs;           // When the next run is due without slack
+    int64_t periodNs;
+    int64_t slackNs;
+} SIM_TIMER;
+
+typedef struct {
+    const char *name;
+    int64_t periodMs;
+    int64_t slackMs;
+} TIMER_SPEC;
+
+// The starter kit timers as main.h sets them up
+static const TIMER_SPEC starterKit[] = {
+    {"tmr_monitor_wifi_network", 30000, 5000},
+    {"tmr_read_sensors", 5000, 500},
+    {"buttonPressCheckTimer", 10, 0},
+    {"oledTimer", 100, 50},
+    {"tmr_profiler_report", 60000, 10000},
+};
+
+static SIM_TIMER timers[RANDOM_TIMERS];
+static uint64_t handlerRuns;
+static uint64_t coalescedRuns; // Runs before the end of the slack, on another timer's wakeup
+static uint64_t violations;
+static int64_t maxLateNs;
+static uint64_t randomState = 88172645463325252ull;
+
+bool dx_isTerminationRequired(void)
+{
+    return false;
+}
+
+EventLoop_Run_Result EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event)
+{
+    (void)el;
+    (void)duration_in_milliseconds;
+    (void)process_one_event;
+    return EventLoop_Run_FinishedEmpty;
+}
+
+// With the simulated clock the wheel has no timerfd to register
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)fd;
+    (void)eventBitmask;
+    (void)callback;
+    (void)context;
+    return NULL;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    return 0;
+}
+
+static int64_t Random(int64_t low, int64_t high)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return low + (int64_t)(randomState % (uint64_t)(high - low + 1));
+}
+
+static TIMER_WHEEL_HANDLER(SimHandler)
+{
+    SIM_TIMER *timer = (SIM_TIMER *)timerBinding;
+    int64_t late = timer_wheel_now_ns() - timer->nominalNs;
+
+    handlerRuns++;
+    if (late < timer->slackNs) {
+        coalescedRuns++;
+    }
+    if (late < 0 || late > timer->slackNs) {
+        violations++;
+    }
+    if (late > maxLateNs) {
+        maxLateNs = late;
+    }
+    timer->nominalNs += timer->periodNs;
+}
+TIMER_WHEEL_HANDLER_END
+
+static void AddTimer(size_t index, const char *name, int64_t periodMs, int64_t slackMs)
+{
+    SIM_TIMER *timer = &timers[index];
+
+    memset(timer, 0, sizeof(*timer));
+    timer->binding.name = name;
+    timer->binding.handler = SimHandler;
+    timer->binding.period = (struct timespec){(time_t)(periodMs / 1000), (long)(periodMs % 1000 * ONE_MS)};
+    timer->binding.slack = (struct timespec){(time_t)(slackMs / 1000), (long)(slackMs % 1000 * ONE_MS)};
+    timer->periodNs = periodMs * ONE_MS;
+    timer->slackNs = slackMs * ONE_MS;
+}
+
+// Start every timer at its own whole millisecond phase, then run for the given time
+static void Run(const char *name, size_t timerCount, int64_t phaseMs[], int minutes)
+{
+    VIRTUAL_CLOCK_STATS before;
+    VIRTUAL_CLOCK_STATS after;
+
+    timer_wheel_init(NULL);
+    for (size_t i = 0; i < timerCount; i++) {
+        timer_wheel_advance(timer_wheel_now_ns() + phaseMs[i] * ONE_MS);
+        timers[i].nominalNs = timer_wheel_now_ns() + timers[i].periodNs;
+        timer_wheel_start(&timers[i].binding);
+    }
+
+    handlerRuns = 0;
+    coalescedRuns = 0;
+    violations = 0;
+    maxLateNs = 0;
+
+    virtual_clock_get_stats(&before);
+    virtual_clock_run(NULL, minutes * 60 * 1000 * ONE_MS);
+    virtual_clock_get_stats(&after);
+
+    for (size_t i = 0; i < timerCount; i++) {
+        timer_wheel_stop(&timers[i].binding);
+    }
+    timer_wheel_close();
+
+    printf("%-34s wakeups/min %8.1f  runs/min %8.1f  coalesced/min %7.1f  max late %6.1f ms  "
+           "outside slack %llu\n",
+           name, (double)(after.timerWakeups - before.timerWakeups) / minutes, (double)handlerRuns / minutes,
+           (double)coalescedRuns / minutes, (double)maxLateNs / ONE_MS, (unsigned long long)violations);
+}
+
+static void RunStarterKit(const char *name, bool withButtonPoll, bool withSlack)
+{
+    int64_t phaseMs[RANDOM_TIMERS];
+    size_t count = 0;
+
+    for (size_t i = 0; i < sizeof(starterKit) / sizeof(starterKit[0]); i++) {
+        if (!withButtonPoll && starterKit[i].periodMs == 10) {
+            continue;
+        }
+        AddTimer(count, starterKit[i].name, starterKit[i].periodMs, withSlack ? starterKit[i].slackMs : 0);
+        phaseMs[count++] = (int64_t)i * 37 + 3;
+    }
+    Run(name, count, phaseMs, SIMULATED_MINUTES);
+}
+
+static void RunRandom(const char *name, bool withSlack)
+{
+    int64_t phaseMs[RANDOM_TIMERS];
+
+    randomState = 88172645463325252ull;
+    for (size_t i = 0; i < RANDOM_TIMERS; i++) {
+        int64_t periodMs = Random(10, 60000);
+        int64_t slackMs = Random(0, 3) == 0 ? 0 : Random(0, periodMs / 2);
+
+        AddTimer(i, "random", periodMs, withSlack ? slackMs : 0);
+        phaseMs[i] = Random(0, 100);
+    }
+    Run(name, RANDOM_TIMERS, phaseMs, RANDOM_MINUTES);
+}
+
+int main(void)
+{
+    RunStarterKit("starter kit, no slack", true, false);
+    RunStarterKit("starter kit, slack", true, true);
+    RunStarterKit("starter kit less button, no slack", false, false);
+    RunStarterKit("starter kit less button, slack", false, true);
+    RunRandom("300 random timers, no slack", false);
+    RunRandom("300 random timers, slack", true);
+    return 0;
+}
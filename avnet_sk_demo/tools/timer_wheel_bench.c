@@ -0,0 +1,265 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host benchmark for timer_wheel.c against a timerfd per timer, the way the DevX timers run.
+   For 10, 100, 1000 and 10000 active timers it reports:
+
+   - re-arm cost, a one shot timer picked at random set again to a random 1 to 10000 ms
+   - file descriptors the timers hold open
+   - dispatch jitter, how long after the requested time each handler starts while every timer
+     re-arms itself for a random 10 to 1000 ms, over JITTER_SECONDS of real time
+
+   The wheel rounds every deadline up to its 1 ms tick, so its jitter includes up to 1 ms of
+   rounding.
+
+   Build: gcc -O2 -I host -I .. -o timer_wheel_bench timer_wheel_bench.c ../timer_wheel.c
+   Usage: timer_wheel_bench
+*/
+
+#include "timer_wheel.h"
+
+#include <dirent.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define MAX_TIMERS 10000
+#define REARMS 1000000
+#define JITTER_SECONDS 5
+#define MAX_SAMPLES 2000000
+
+typedef struct {
+    TIMER_WHEEL_BINDING binding; // Must be first
+    int fd;                      // The timerfd of the baseline
+    int64_t targetNs;            // When the handler was asked to run
+} BENCH_TIMER;
+
+static BENCH_TIMER timers[MAX_TIMERS];
+static double *lateness;
+static size_t samples;
+static uint64_t randomState = 88172645463325252ull;
+
+static int wheelFd = -1;
+static EventLoopIoCallback *wheelCallback;
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    wheelFd = fd;
+    wheelCallback = callback;
+    return (EventRegistration *)&wheelFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    wheelFd = -1;
+    return 0;
+}
+
+static uint32_t Random(uint32_t low, uint32_t high)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return low + (uint32_t)(randomState % (high - low + 1));
+}
+
+static int64_t NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static struct timespec Milliseconds(uint32_t ms)
+{
+    return (struct timespec){ms / 1000, (long)(ms % 1000) * 1000000};
+}
+
+static int OpenDescriptors(void)
+{
+    int count = 0;
+    DIR *directory = opendir("/proc/self/fd");
+
+    if (directory == NULL) {
+        return -1;
+    }
+    while (readdir(directory) != NULL) {
+        count++;
+    }
+    closedir(directory);
+    return count - 3; // ".", ".." and the directory itself
+}
+
+static void RecordLateness(BENCH_TIMER *timer)
+{
+    if (samples < MAX_SAMPLES) {
+        lateness[samples++] = (double)(NowNs() - timer->targetNs) / 1e3;
+    }
+}
+
+static void Rearm(BENCH_TIMER *timer, uint32_t ms)
+{
+    struct timespec delay = Milliseconds(ms);
+
+    timer->targetNs = NowNs() + (int64_t)ms * 1000000;
+    if (timer->fd == -1) {
+        timer_wheel_oneshot_set(&timer->binding, &delay);
+    } else {
+        timerfd_settime(timer->fd, 0, &(struct itimerspec){.it_value = delay}, NULL);
+    }
+}
+
+static TIMER_WHEEL_HANDLER(WheelHandler)
+{
+    BENCH_TIMER *timer = (BENCH_TIMER *)timerBinding;
+
+    RecordLateness(timer);
+    Rearm(timer, Random(10, 1000));
+}
+TIMER_WHEEL_HANDLER_END
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void PrintLateness(void)
+{
+    qsort(lateness, samples, sizeof(lateness[0]), CompareDoubles);
+    printf("runs %7zu  late us p50 %7.1f p99 %7.1f max %8.1f", samples, lateness[samples / 2],
+           lateness[(size_t)((double)(samples - 1) * 0.99)], lateness[samples - 1]);
+}
+
+static void BenchWheel(int count)
+{
+    int descriptorsBefore = OpenDescriptors();
+
+    timer_wheel_init(NULL);
+    for (int i = 0; i < count; i++) {
+        timers[i] = (BENCH_TIMER){.binding = {.name = "bench", .handler = WheelHandler}, .fd = -1};
+        Rearm(&timers[i], Random(1, 10000));
+    }
+    int descriptors = OpenDescriptors() - descriptorsBefore;
+
+    int64_t start = NowNs();
+    for (int i = 0; i < REARMS; i++) {
+        Rearm(&timers[Random(0, (uint32_t)count - 1)], Random(1, 10000));
+    }
+    double rearmNs = (double)(NowNs() - start) / REARMS;
+
+    samples = 0;
+    for (int i = 0; i < count; i++) {
+        Rearm(&timers[i], Random(10, 1000));
+    }
+    int64_t end = NowNs() + (int64_t)JITTER_SECONDS * 1000000000;
+    while (NowNs() < end) {
+        struct pollfd fd = {.fd = wheelFd, .events = POLLIN};
+
+        if (poll(&fd, 1, 100) > 0) {
+            wheelCallback(NULL, wheelFd, EventLoop_Input, NULL);
+        }
+    }
+
+    TIMER_WHEEL_STATS stats;
+    timer_wheel_get_stats(&stats, true);
+    for (int i = 0; i < count; i++) {
+        timer_wheel_stop(&timers[i].binding);
+    }
+    timer_wheel_close();
+
+    printf("wheel    %5d timers  re-arm %6.1f ns  fds %5d  ", count, rearmNs, descriptors);
+    PrintLateness();
+    printf("  wakeups %u\n", stats.wakeups);
+}
+
+// A timerfd per timer in one epoll set, as the event loop runs the DevX timers
+static void BenchTimerfd(int count)
+{
+    int descriptorsBefore = OpenDescriptors();
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ready[64];
+    uint32_t wakeups = 0;
+
+    for (int i = 0; i < count; i++) {
+        timers[i] = (BENCH_TIMER){.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)};
+        if (timers[i].fd == -1) {
+            printf("timerfd %5d timers  timerfd_create failed after %d timers\n", count, i);
+            for (int j = 0; j < i; j++) {
+                close(timers[j].fd);
+            }
+            close(epollFd);
+            return;
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, timers[i].fd, &(struct epoll_event){.events = EPOLLIN, .data.ptr = &timers[i]});
+        Rearm(&timers[i], Random(1, 10000));
+    }
+    int descriptors = OpenDescriptors() - descriptorsBefore;
+
+    int64_t start = NowNs();
+    for (int i = 0; i < REARMS; i++) {
+        Rearm(&timers[Random(0, (uint32_t)count - 1)], Random(1, 10000));
+    }
+    double rearmNs = (double)(NowNs() - start) / REARMS;
+
+    samples = 0;
+    for (int i = 0; i < count; i++) {
+        Rearm(&timers[i], Random(10, 1000));
+    }
+    int64_t end = NowNs() + (int64_t)JITTER_SECONDS * 1000000000;
+    while (NowNs() < end) {
+        int n = epoll_wait(epollFd, ready, 64, 100);
+
+        wakeups += n > 0;
+        for (int i = 0; i < n; i++) {
+            BENCH_TIMER *timer = (BENCH_TIMER *)ready[i].data.ptr;
+            uint64_t expirations;
+
+            if (read(timer->fd, &expirations, sizeof(expirations)) > 0) {
+                RecordLateness(timer);
+                Rearm(timer, Random(10, 1000));
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        close(timers[i].fd);
+    }
+    close(epollFd);
+
+    printf("timerfd  %5d timers  re-arm %6.1f ns  fds %5d  ", count, rearmNs, descriptors);
+    PrintLateness();
+    printf("  wakeups %u\n", wakeups);
+}
+
+int main(void)
+{
+    static const int counts[] = {10, 100, 1000, 10000};
+    struct rlimit limit;
+
+    // Room for a timerfd per timer in the baseline
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < MAX_TIMERS + 64) {
+        limit.rlim_cur = limit.rlim_max < MAX_TIMERS + 64 ? limit.rlim_max : MAX_TIMERS + 64;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    lateness = malloc(MAX_SAMPLES * sizeof(double));
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        BenchWheel(counts[i]);
+        BenchTimerfd(counts[i]);
+    }
+    free(lateness);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "virtual_clock.h"
+
+#ifdef USE_VIRTUAL_CLOCK
+
+#include "dx_terminate.h"
+#include "timer_wheel.h"
+#include <applibs/log.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    int64_t due;
+    uint64_t sequence; // Injection order, breaks ties between events due at the same time
+    VIRTUAL_CLOCK_EVENT handler; // NULL for bytes to write
+    void *context;
+    int fd;
+    const void *data;
+    size_t length;
+} VIRTUAL_CLOCK_ENTRY;
+
+// Binary min heap ordered by due time then sequence
+static VIRTUAL_CLOCK_ENTRY events[VIRTUAL_CLOCK_MAX_EVENTS];
+static uint32_t event_count = 0;
+static uint64_t next_sequence = 0;
+
+static int64_t start_ns = 0;
+static uint64_t timer_wakeups = 0;
+static uint64_t injected_events = 0;
+static int64_t slept_ns = 0;
+
+static bool entry_before(const VIRTUAL_CLOCK_ENTRY *a, const VIRTUAL_CLOCK_ENTRY *b)
+{
+    return a->due < b->due || (a->due == b->due && a->sequence < b->sequence);
+}
+
+static void swap_entries(uint32_t a, uint32_t b)
+{
+    VIRTUAL_CLOCK_ENTRY temp = events[a];
+    events[a] = events[b];
+    events[b] = temp;
+}
+
+static void pop_event(VIRTUAL_CLOCK_ENTRY *entry)
+{
+    uint32_t parent = 0;
+
+    *entry = events[0];
+    events[0] = events[--event_count];
+
+    for (;;) {
+        uint32_t smallest = parent;
+        uint32_t left = 2 * parent + 1;
+        uint32_t right = left + 1;
+
+        if (left < event_count && entry_before(&events[left], &events[smallest])) {
+            smallest = left;
+        }
+        if (right < event_count && entry_before(&events[right], &events[smallest])) {
+            smallest = right;
+        }
+        if (smallest == parent) {
+            break;
+        }
+        swap_entries(parent, smallest);
+        parent = smallest;
+    }
+}
+
+static bool push_event(int64_t delayNs, const VIRTUAL_CLOCK_ENTRY *entry)
+{
+    if (event_count == VIRTUAL_CLOCK_MAX_EVENTS) {
+        Log_Debug("ERROR: virtual clock could not queue event\n");
+        return false;
+    }
+
+    uint32_t child = event_count++;
+    events[child] = *entry;
+    events[child].due = timer_wheel_now_ns() + (delayNs < 0 ? 0 : delayNs);
+    events[child].sequence = next_sequence++;
+
+    while (child > 0) {
+        uint32_t parent = (child - 1) / 2;
+        if (!entry_before(&events[child], &events[parent])) {
+            break;
+        }
+        swap_entries(child, parent);
+        child = parent;
+    }
+    return true;
+}
+
+bool virtual_clock_inject(int64_t delayNs, VIRTUAL_CLOCK_EVENT handler, void *context)
+{
+    if (handler == NULL) {
+        return false;
+    }
+    return push_event(delayNs, &(VIRTUAL_CLOCK_ENTRY){.handler = handler, .context = context, .fd = -1});
+}
+
+bool virtual_clock_inject_bytes(int64_t delayNs, int fd, const void *data, size_t length)
+{
+    if (fd < 0 || data == NULL) {
+        return false;
+    }
+    return push_event(delayNs, &(VIRTUAL_CLOCK_ENTRY){.fd = fd, .data = data, .length = length});
+}
+
+void virtual_clock_sleep(int64_t durationNs)
+{
+    if (durationNs > 0) {
+        timer_wheel_pass_time(durationNs);
+        slept_ns += durationNs;
+    }
+}
+
+static void run_event(const VIRTUAL_CLOCK_ENTRY *entry)
+{
+    if (entry->handler != NULL) {
+        entry->handler(entry->context);
+    } else if (write(entry->fd, entry->data, entry->length) != (ssize_t)entry->length) {
+        Log_Debug("ERROR: virtual clock write to fd %d: errno=%d (%s)\n", entry->fd, errno, strerror(errno));
+    }
+}
+
+void virtual_clock_run(EventLoop *eventLoop, int64_t durationNs)
+{
+    start_ns = timer_wheel_now_ns();
+    int64_t end = start_ns + durationNs;
+
+    while (!dx_isTerminationRequired()) {
+        int64_t nextTimer = timer_wheel_next_deadline_ns();
+        int64_t nextEvent = event_count == 0 ? INT64_MAX : events[0].due;
+
+        if (nextTimer > end && nextEvent > end) {
+            timer_wheel_advance(end);
+            break;
+        }
+
+        if (nextTimer <= nextEvent) {
+            timer_wakeups++;
+            timer_wheel_advance(nextTimer);
+        } else {
+            VIRTUAL_CLOCK_ENTRY entry;
+            pop_event(&entry);
+            // No timer is due before entry.due, so this only moves the clock
+            timer_wheel_advance(entry.due);
+            injected_events++;
+            run_event(&entry);
+        }
+
+        // Everything that is ready, including bytes just written by run_event()
+        while (eventLoop != NULL && EventLoop_Run(eventLoop, 0, true) == EventLoop_Run_Finished) {
+        }
+    }
+}
+
+void virtual_clock_get_stats(VIRTUAL_CLOCK_STATS *stats)
+{
+    stats->elapsedNs = timer_wheel_now_ns() - start_ns;
+    stats->timerWakeups = timer_wakeups;
+    stats->injectedEvents = injected_events;
+    stats->pendingEvents = event_count;
+    stats->sleptNs = slept_ns;
+}
+
+#endif // USE_VIRTUAL_CLOCK
@@ -0,0 +1,75 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "build_options.h"
+
+// Enable USE_VIRTUAL_CLOCK in build_options.h to run the application on simulated time. The
+// timer wheel reads its time from here instead of CLOCK_MONOTONIC, and virtual_clock_run()
+// replaces the EventLoop_Run() loop in main(). It jumps straight to whichever comes first, the
+// next due timer or the next injected event. Days of timer driven behaviour then run as fast
+// as the handlers execute, and two runs with the same injected events fire the same handlers
+// in the same order. tools/sk_demo_soak.c builds the application this way on a Linux host.
+//
+// Code that blocks for a fixed time, such as the I2C sensor hub polling, calls
+// virtual_clock_sleep() so the wait passes on the simulated clock.
+//
+// Twin updates, UART bytes and intercore replies are not real I/O in a simulation. Write them
+// with virtual_clock_inject_bytes() to the fd the application reads them from, the UART, the
+// intercore socket or the transport DevX receives twin updates on. They land at a known point
+// on the same clock and reach the application through its own event loop handlers.
+
+#ifdef USE_VIRTUAL_CLOCK
+
+#include <applibs/eventloop.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Injected events waiting to run, virtual_clock_inject() fails beyond this
+#define VIRTUAL_CLOCK_MAX_EVENTS 64
+
+typedef void (*VIRTUAL_CLOCK_EVENT)(void *context);
+
+typedef struct {
+    int64_t elapsedNs;       // Simulated time since virtual_clock_run() started
+    uint64_t timerWakeups;   // Times the clock jumped to a timer deadline
+    uint64_t injectedEvents; // Injected events run
+    uint32_t pendingEvents;  // Injected events still queued
+    int64_t sleptNs;         // Simulated time spent in virtual_clock_sleep()
+} VIRTUAL_CLOCK_STATS;
+
+/// <summary>
+/// Run handler(context) delayNs after the current simulated time. Events due at the same
+/// time run in the order they were injected, after any timer due at that time.
+/// </summary>
+/// <returns>false if the event queue is full</returns>
+bool virtual_clock_inject(int64_t delayNs, VIRTUAL_CLOCK_EVENT handler, void *context);
+
+/// <summary>
+/// Write length bytes of data to fd delayNs after the current simulated time, in the same
+/// order as virtual_clock_inject(). The handler registered for the other end of fd then runs
+/// in the same step. data must stay valid until the write.
+/// </summary>
+/// <returns>false if the event queue is full</returns>
+bool virtual_clock_inject_bytes(int64_t delayNs, int fd, const void *data, size_t length);
+
+/// <summary>
+/// Block for durationNs of simulated time. Timers that fall due meanwhile run late, once the
+/// caller returns to virtual_clock_run(), as they would after a real blocking wait.
+/// </summary>
+void virtual_clock_sleep(int64_t durationNs);
+
+/// <summary>
+/// Advance the simulated clock through durationNs of timers and injected events. Returns
+/// early once dx_isTerminationRequired(). When eventLoop is not NULL, any fd events that are
+/// ready are dispatched at each step without blocking, which is how bytes from
+/// virtual_clock_inject_bytes() reach their handlers. Other fd events follow real time, so keep
+/// them out of runs that must be repeatable.
+/// </summary>
+void virtual_clock_run(EventLoop *eventLoop, int64_t durationNs);
+
+void virtual_clock_get_stats(VIRTUAL_CLOCK_STATS *stats);
+
+#endif // USE_VIRTUAL_CLOCK
@@ -0,0 +1,54 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "parson.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// avnet_sk_demo holds the canonical copy of this module, azure_end_to_end an identical one.
+// avnet_sk_demo/tools/adaptive_sampler_replay.c replays a sensor trace through it against fixed
+// sampling rates.
+
+// Enough for the sensors one read handler samples together
+#define ADAPTIVE_SAMPLER_MAX_CHANNELS 8
+
+// Weight of the newest sample in each channel's running average of its change
+#define ADAPTIVE_SAMPLER_SMOOTHING 0.25
+
+typedef struct {
+    const char *name;
+    // Change between two samples, in the channel's own units, that counts as activity
+    double threshold;
+    // Managed by the sampler
+    double last;
+    double averageChange;
+} ADAPTIVE_SAMPLER_CHANNEL;
+
+typedef struct {
+    bool enabled;
+    int minPeriodMs;       // Fastest sampling while the signal is moving
+    int maxPeriodMs;       // The floor rate the sampler backs off to while the signal is stable
+    double aggressiveness; // 0 to 1, how quickly the period shrinks on activity and grows after it
+    ADAPTIVE_SAMPLER_CHANNEL channels[ADAPTIVE_SAMPLER_MAX_CHANNELS];
+    size_t channelCount;
+    // Managed by the sampler
+    int periodMs;
+    bool primed;
+} ADAPTIVE_SAMPLER;
+
+/// <summary>
+/// Feed one sample per channel, in the order the channels were declared. The period shrinks
+/// when any channel's latest change or its recent average change crosses its threshold, and
+/// grows back towards maxPeriodMs while every channel stays below it.
+/// </summary>
+/// <returns>The period to sample at next, in milliseconds</returns>
+int adaptive_sampler_update(ADAPTIVE_SAMPLER *sampler, const double values[], size_t count);
+
+/// <summary>
+/// Apply {"enabled": bool, "minPeriodMs": int, "maxPeriodMs": int, "aggressiveness": number}
+/// from a device twin. Missing keys keep their current value. Out of range settings are
+/// rejected and nothing changes.
+/// </summary>
+bool adaptive_sampler_configure(ADAPTIVE_SAMPLER *sampler, const JSON_Object *settings);
@@ -70,6 +70,18 @@ DX_TIMER_HANDLER(read_sensor_handler)
     environment.latest.humidity = 55;
     environment.latest.pressure = 1050;
     environment.validated = true;
+
+    if (sensor_sampler.enabled)
+    {
+        double readings[] = {environment.latest.temperature, environment.latest.humidity, environment.latest.pressure};
+        int previous_period_ms = sensor_sampler.periodMs;
+        int period_ms = adaptive_sampler_update(&sensor_sampler, readings, NELEMS(readings));
+
+        if (period_ms != previous_period_ms)
+        {
+            dx_timerChange(&tmr_read_sensor, &(struct timespec){period_ms / 1000, (period_ms % 1000) * 1000000});
+        }
+    }
 }
 DX_TIMER_HANDLER_END
 
@@ -101,11 +113,14 @@ DX_TIMER_HANDLER_END
 
 static DX_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler, deviceTwinBinding)
 {
-    int sample_rate_seconds = *(int *)deviceTwinBinding->propertyValue;
+    int requested_seconds = *(int *)deviceTwinBinding->propertyValue;
 
     // validate data is sensible range before applying
-    if (IN_RANGE(sample_rate_seconds, 1, 120))
+    if (IN_RANGE(requested_seconds, 1, 120))
     {
+        // A fixed period takes over from adaptive sampling
+        sensor_sampler.enabled = false;
+        sample_rate_seconds = requested_seconds;
         dx_timerChange(&tmr_read_sensor, &(struct timespec){sample_rate_seconds, 0});
         dx_deviceTwinAckDesiredValue(deviceTwinBinding, deviceTwinBinding->propertyValue, DX_DEVICE_TWIN_RESPONSE_COMPLETED);
     }
@@ -116,6 +131,28 @@ static DX_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler, deviceTwinBinding)
 }
 DX_DEVICE_TWIN_HANDLER_END
 
+/// <summary>
+/// AdaptiveSampling: {"enabled": bool, "minPeriodMs": int, "maxPeriodMs": int, "aggressiveness": 0 to 1}
+/// While enabled the sensor read period moves between the bounds depending on how much the
+/// readings change. Turning it off goes back to the DesiredSampleRate period.
+/// </summary>
+static DX_DEVICE_TWIN_HANDLER(dt_adaptive_sampling_handler, deviceTwinBinding)
+{
+    bool was_enabled = sensor_sampler.enabled;
+
+    if (adaptive_sampler_configure(&sensor_sampler, (JSON_Object *)deviceTwinBinding->propertyValue))
+    {
+        Log_Debug("Adaptive sampling %s: %d to %d ms, aggressiveness %.2f\n", sensor_sampler.enabled ? "on" : "off",
+                  sensor_sampler.minPeriodMs, sensor_sampler.maxPeriodMs, sensor_sampler.aggressiveness);
+
+        if (was_enabled && !sensor_sampler.enabled)
+        {
+            dx_timerChange(&tmr_read_sensor, &(struct timespec){sample_rate_seconds, 0});
+        }
+    }
+}
+DX_DEVICE_TWIN_HANDLER_END
+
 DX_DIRECT_METHOD_HANDLER(LightOnHandler, json, directMethodBinding, responseMsg)
 {
     DX_GPIO_BINDING *led = (DX_GPIO_BINDING *)directMethodBinding->context;
@@ -2,6 +2,7 @@
 
 #include "hw/azure_sphere_learning_path.h" // Hardware definition
 
+#include "adaptive_sampler.h"
 #include "app_exit_codes.h"
 #include "dx_azure_iot.h"
 #include "dx_config.h"
@@ -19,6 +20,7 @@
 #define SAMPLE_VERSION_NUMBER "1.0"
 
 // Forward declarations
+static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_adaptive_sampling_handler);
 static DX_DECLARE_DEVICE_TWIN_HANDLER(dt_desired_sample_rate_handler);
 static DX_DECLARE_DIRECT_METHOD_HANDLER(LightOffHandler);
 static DX_DECLARE_DIRECT_METHOD_HANDLER(LightOnHandler);
@@ -44,6 +46,19 @@ ENVIRONMENT_T environment;
 DX_USER_CONFIG dx_config;
 static bool azure_connected = false;
 
+// The read period set through DesiredSampleRate, used while adaptive sampling is off
+static int sample_rate_seconds = 4;
+
+// Adapts the tmr_read_sensor period to how much the readings are changing. Configured and
+// enabled through the AdaptiveSampling device twin, see adaptive_sampler.h
+static ADAPTIVE_SAMPLER sensor_sampler = {.minPeriodMs = 1000,
+                                          .maxPeriodMs = 60 * 1000,
+                                          .aggressiveness = 0.5,
+                                          .channels = {{.name = "temperature", .threshold = 1},
+                                                       {.name = "humidity", .threshold = 2},
+                                                       {.name = "pressure", .threshold = 2}},
+                                          .channelCount = 3};
+
 /****************************************************************************************
  * Telemetry message buffer property sets
  ****************************************************************************************/
@@ -58,6 +73,7 @@ static DX_MESSAGE_PROPERTY *messageProperties[] = {&(DX_MESSAGE_PROPERTY){.key =
 static DX_MESSAGE_CONTENT_PROPERTIES contentProperties = {.contentEncoding = "utf-8", .contentType = "application/json"};
 
 // declare all bindings
+static DX_DEVICE_TWIN_BINDING dt_adaptive_sampling = {.propertyName = "AdaptiveSampling", .twinType = DX_DEVICE_TWIN_JSON_OBJECT, .handler = dt_adaptive_sampling_handler};
 static DX_DEVICE_TWIN_BINDING dt_desired_sample_rate = {.propertyName = "DesiredSampleRate", .twinType = DX_DEVICE_TWIN_INT, .handler = dt_desired_sample_rate_handler};
 static DX_DEVICE_TWIN_BINDING dt_deviceConnectUtc = {.propertyName = "DeviceConnectUtc", .twinType = DX_DEVICE_TWIN_STRING};
 static DX_DEVICE_TWIN_BINDING dt_deviceStartUtc = {.propertyName = "DeviceStartUtc", .twinType = DX_DEVICE_TWIN_STRING};
@@ -78,7 +94,7 @@ static DX_DIRECT_METHOD_BINDING dm_light_off = {.methodName = "LightOff", .handl
 
 // All bindings referenced in the following binding sets are initialised in the InitPeripheralsAndHandlers function
 DX_DEVICE_TWIN_BINDING *device_twin_bindings[] = {&dt_deviceStartUtc, &dt_softwareVersion, &dt_desired_sample_rate, &dt_temperature,
-                                                  &dt_humidity, &dt_deviceConnectUtc, &dt_pressure};
+                                                  &dt_humidity, &dt_deviceConnectUtc, &dt_pressure, &dt_adaptive_sampling};
 DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_light_off, &dm_light_on};
 DX_GPIO_BINDING *gpio_bindings[] = {&gpio_network_led, &gpio_led};
 DX_TIMER_BINDING *timer_bindings[] = {&tmr_publish_message, &tmr_report_properties, &tmr_read_sensor};
\ No newline at end of file
@@ -0,0 +1,73 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+ * Licensed under the MIT License. */
+
+#include "json_reader.h"
+
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+
+/// <summary>
+/// Copy value to the key's destination if it has the key's type
+/// </summary>
+static bool read_value(const JSON_Value *value, JSON_READER_KEY *key)
+{
+    double number;
+
+    switch (key->type) {
+    case JSON_READER_BOOL:
+        if (json_value_get_type(value) != JSONBoolean) {
+            return false;
+        }
+        *(bool *)key->destination = json_value_get_boolean(value) != 0;
+        return true;
+
+    case JSON_READER_INT:
+        number = json_value_get_number(value);
+        // Converting a value outside the range of int is undefined, treat it as a mismatch
+        if (json_value_get_type(value) != JSONNumber || !(number > (double)INT_MIN - 1.0 && number < (double)INT_MAX + 1.0)) {
+            return false;
+        }
+        *(int *)key->destination = (int)number;
+        return true;
+
+    case JSON_READER_FLOAT:
+        number = json_value_get_number(value);
+        if (json_value_get_type(value) != JSONNumber || !(number >= -FLT_MAX && number <= FLT_MAX)) {
+            return false;
+        }
+        *(float *)key->destination = (float)number;
+        return true;
+
+    case JSON_READER_DOUBLE:
+        if (json_value_get_type(value) != JSONNumber) {
+            return false;
+        }
+        *(double *)key->destination = json_value_get_number(value);
+        return true;
+
+    case JSON_READER_STRING:
+        if (json_value_get_type(value) != JSONString || key->destinationSize == 0) {
+            return false;
+        }
+        strncpy(key->destination, json_value_get_string(value), key->destinationSize - 1);
+        ((char *)key->destination)[key->destinationSize - 1] = '\0';
+        return true;
+    }
+
+    return false;
+}
+
+int json_reader_extract_object(const JSON_Object *object, JSON_READER_KEY *keys, size_t keyCount)
+{
+    int found = 0;
+
+    for (size_t i = 0; i < keyCount; i++) {
+        JSON_Value *value = object != NULL ? json_object_dotget_value(object, keys[i].path) : NULL;
+
+        keys[i].found = value != NULL && read_value(value, &keys[i]);
+        found += keys[i].found;
+    }
+
+    return object != NULL ? found : -1;
+}
@@ -0,0 +1,43 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+ * Licensed under the MIT License.
+ *
+ * Table driven JSON reader.
+ *
+ * The application describes the keys it cares about in a static JSON_READER_KEY table, each
+ * entry maps a dotted path ("keyJsonObj.nestedKeyInt") to a typed C destination.
+ * json_reader_extract_object() fills the table from the parson object DevX has already parsed
+ * for a twin or direct method handler, looking each path up with json_object_dotget_value().
+ * It does not allocate.
+ *
+ * device_twins_json_object/json_reader.c/h is the canonical copy, direct_methods has an
+ * identical copy. Make changes here and copy them across.
+ *
+ ************************************************************************************************/
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parson.h"
+
+typedef enum {
+    JSON_READER_BOOL,   // destination is bool
+    JSON_READER_INT,    // destination is int, numbers outside its range are not found
+    JSON_READER_FLOAT,  // destination is float, numbers outside its range are not found
+    JSON_READER_DOUBLE, // destination is double
+    JSON_READER_STRING  // destination is char[destinationSize]
+} JSON_READER_TYPE;
+
+typedef struct {
+    const char *path;
+    JSON_READER_TYPE type;
+    void *destination;
+    size_t destinationSize; // Only used for JSON_READER_STRING
+    bool found;             // Set by the reader when the key was present with the expected type
+} JSON_READER_KEY;
+
+/// <summary>
+/// Extract the keys listed in keys[] from an object DevX has already parsed.
+/// </summary>
+/// <returns>Number of keys found, or -1 if object is NULL</returns>
+int json_reader_extract_object(const JSON_Object *object, JSON_READER_KEY *keys, size_t keyCount);
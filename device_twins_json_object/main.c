@@ -33,6 +33,23 @@
 
 #include "main.h"
 
+// Variables to hold the expected data from the incomming SampleJsonObject
+static bool key_bool_value = true;
+static int key_int_value = 0;
+static float key_float_value = 0.0F;
+static double key_double_value = 0.0L;
+static char key_string_value[MAX_STRING_LEN] = {0x00};
+static int key_nested_key_int_value = 0;
+
+// Map each SampleJsonObject key to the variable that receives its value
+static JSON_READER_KEY sample_json_object_keys[] = {
+    {.path = "keyBool", .type = JSON_READER_BOOL, .destination = &key_bool_value},
+    {.path = "keyInt", .type = JSON_READER_INT, .destination = &key_int_value},
+    {.path = "keyFloat", .type = JSON_READER_FLOAT, .destination = &key_float_value},
+    {.path = "keyDouble", .type = JSON_READER_DOUBLE, .destination = &key_double_value},
+    {.path = "keyString", .type = JSON_READER_STRING, .destination = key_string_value, .destinationSize = MAX_STRING_LEN},
+    {.path = "keyJsonObj.nestedKeyInt", .type = JSON_READER_INT, .destination = &key_nested_key_int_value}};
+
 // Sample device twin handler that demonstrates how to manage JSON Object device twin types.  
 // When passing a JSON Object into a device twin handler, the handler gets a JSON_Object pointer to 
 // the value part of the ("key": value) pair.
@@ -69,85 +86,44 @@
 //
 static void dt_json_object_handler(DX_DEVICE_TWIN_BINDING *deviceTwinBinding)
 {
-    // Define variables to hold the expected data from the incomming JSON Object
-    bool key_bool_value = true;
-    int key_int_value = 0;
-    float key_float_value = 0.0F;
-    double key_double_value = 0.0L;
-    char key_string_value[MAX_STRING_LEN] = {0x00};
-    JSON_Object *key_nested_json_obj = NULL;
-    int key_nested_key_int_value = 0;
-
     // Cast the incomming propertyValue to a JSON_Object and verify we have 
     // a valid pointer
     JSON_Object *root_object = (JSON_Object *)deviceTwinBinding->propertyValue;
     if(root_object != NULL){
 
-        // At this point root_object points to the {"key", value) value payload that is a JSON Oject
-        // The developer must understand what the JSON Object looks like so data can be pulled. 
-
-        // The SampleJsonObject properties should have a "keyBool" key
-        if (json_object_has_value(root_object, "keyBool") != 0) {
-            key_bool_value = (bool)json_object_get_boolean(root_object, "keyBool");
-            Log_Debug("keyBool = %s\n", key_bool_value? "true": "false");
-        } else {
-            Log_Debug("keyBool not found!\n");
-        }
-
-        // The SampleJsonObject properties should have a "keyInt" key
-        if (json_object_has_value(root_object, "keyInt") != 0) {
-            key_int_value = (int)json_object_get_number(root_object, "keyInt");
-            Log_Debug("keyInt = %d\n", key_int_value);
-        } else {
-            Log_Debug("keyInt not found!\n");
-        }
-
-        // The SampleJsonObject properties should have a "keyFloat" key
-        if (json_object_has_value(root_object, "keyFloat") != 0) {
-            key_float_value = (float)json_object_get_number(root_object, "keyFloat");
-            Log_Debug("keyFloat = %.2f\n", key_float_value);
-        } else {
-            Log_Debug("keyFloat not found!\n");
-        }
-
-        // The SampleJsonObject properties should have a "keyDouble" key
-        if (json_object_has_value(root_object, "keyDouble") != 0) {
-            key_double_value = (double)json_object_get_number(root_object, "keyDouble");
-            Log_Debug("keyDouble = %.4lf\n", key_double_value);
-        } else {
-            Log_Debug("keyDouble not found!\n");
-        }
-
-        // The SampleJsonObject properties should have a "keyString" key
-        if (json_object_has_value(root_object, "keyString") != 0) {
-            strncpy(key_string_value, json_object_get_string(root_object,"keyString"), MAX_STRING_LEN);
-            Log_Debug("keyString = %s\n", key_string_value);
-        } else {
-            Log_Debug("keyString not found!\n");
-        }      
+        // At this point root_object points to the {"key", value) value payload that is a JSON Oject.
+        // Rather than testing for and pulling each key by hand, the sample_json_object_keys table
+        // above maps each key path to a C variable, nested keys use a dotted path.  Each table
+        // entry's found flag is set if the key was present with the expected type.
+        json_reader_extract_object(root_object, sample_json_object_keys, NELEMS(sample_json_object_keys));
 
-        // When we have nested objects within an object, we get a new JSON_Object pointer to the 
-        // nested object and pull data as above.
+        for (size_t i = 0; i < NELEMS(sample_json_object_keys); i++) {
 
-        // The SampleJsonObject properties should have a "keyJsonObj" key
-        if (json_object_has_value(root_object, "keyJsonObj") != 0) {
+            JSON_READER_KEY *key = &sample_json_object_keys[i];
 
-            // Check to see if the object contains a "keyJsonObj" object
-            key_nested_json_obj = json_object_get_object(root_object, "keyJsonObj");
-            if (key_nested_json_obj == NULL) {
-                Log_Debug("keyJsonObj not found\n");
+            if (!key->found) {
+                Log_Debug("%s not found!\n", key->path);
+                continue;
             }
 
-            // The keyJsonObj properties should have a "nestedKeyInt" key
-            if (json_object_has_value(key_nested_json_obj, "nestedKeyInt") != 0) {
-                key_nested_key_int_value = (int)json_object_get_number(key_nested_json_obj, "nestedKeyInt");
-                Log_Debug("nestedKeyInt = %d\n", key_nested_key_int_value);
-            } else {
-                Log_Debug("nestedKeyInt not found!\n");
+            switch (key->type) {
+            case JSON_READER_BOOL:
+                Log_Debug("%s = %s\n", key->path, *(bool *)key->destination ? "true" : "false");
+                break;
+            case JSON_READER_INT:
+                Log_Debug("%s = %d\n", key->path, *(int *)key->destination);
+                break;
+            case JSON_READER_FLOAT:
+                Log_Debug("%s = %.2f\n", key->path, *(float *)key->destination);
+                break;
+            case JSON_READER_DOUBLE:
+                Log_Debug("%s = %.4lf\n", key->path, *(double *)key->destination);
+                break;
+            case JSON_READER_STRING:
+                Log_Debug("%s = %s\n", key->path, (char *)key->destination);
+                break;
             }
-        } else {
-            Log_Debug("keyJsonObj not found!\n");
-        }      
+        }
 
         // We need to manually build the response JSON
         
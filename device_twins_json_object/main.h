@@ -9,6 +9,7 @@
 #include "dx_terminate.h"
 #include "dx_timer.h"
 #include "dx_utilities.h"
+#include "json_reader.h"
 
 #include <applibs/log.h>
 #include <time.h>
@@ -0,0 +1,201 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+ * Licensed under the MIT License.
+ *
+ * Host benchmark for json_reader.c against the hand written parson calls it replaced in
+ * dt_json_object_handler. For each twin patch it reports the time and heap DevX spends parsing
+ * it with json_parse_string(), then the time and heap to pull the keys out of the parsed object
+ * with the old json_object_has_value()/json_object_get_*() calls and with the key table.
+ *
+ * parson is part of AzureSphereDevX, which is a submodule. Build against its parson.c, or any
+ * checkout of https://github.com/kgabis/parson, with PARSON set to the directory holding it:
+ *
+ * Build: gcc -O2 -I .. -I $PARSON -o json_reader_bench json_reader_bench.c ../json_reader.c
+ *            $PARSON/parson.c
+ * Usage: json_reader_bench
+ *
+ ************************************************************************************************/
+
+#include "json_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
+#define MAX_STRING_LEN 64
+#define ITERATIONS 200000
+
+// Heap counters, parson allocates through the functions below
+typedef struct {
+    size_t bytes;
+    size_t peakBytes;
+    size_t allocations;
+} HEAP_COUNTERS;
+
+static HEAP_COUNTERS heap;
+
+static void *CountingMalloc(size_t size)
+{
+    size_t *block = malloc(sizeof(max_align_t) + size);
+
+    if (block == NULL) {
+        return NULL;
+    }
+    *block = size;
+    heap.bytes += size;
+    heap.allocations++;
+    if (heap.bytes > heap.peakBytes) {
+        heap.peakBytes = heap.bytes;
+    }
+    return (char *)block + sizeof(max_align_t);
+}
+
+static void CountingFree(void *pointer)
+{
+    if (pointer != NULL) {
+        size_t *block = (size_t *)((char *)pointer - sizeof(max_align_t));
+        heap.bytes -= *block;
+        free(block);
+    }
+}
+
+static void ResetHeapCounters(void)
+{
+    heap.peakBytes = heap.bytes;
+    heap.allocations = 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+// The variables dt_json_object_handler fills
+static bool key_bool_value;
+static int key_int_value;
+static float key_float_value;
+static double key_double_value;
+static char key_string_value[MAX_STRING_LEN];
+static int key_nested_key_int_value;
+
+static JSON_READER_KEY sample_json_object_keys[] = {
+    {.path = "keyBool", .type = JSON_READER_BOOL, .destination = &key_bool_value},
+    {.path = "keyInt", .type = JSON_READER_INT, .destination = &key_int_value},
+    {.path = "keyFloat", .type = JSON_READER_FLOAT, .destination = &key_float_value},
+    {.path = "keyDouble", .type = JSON_READER_DOUBLE, .destination = &key_double_value},
+    {.path = "keyString", .type = JSON_READER_STRING, .destination = key_string_value, .destinationSize = MAX_STRING_LEN},
+    {.path = "keyJsonObj.nestedKeyInt", .type = JSON_READER_INT, .destination = &key_nested_key_int_value}};
+
+// dt_json_object_handler before the key table, less the logging
+static int ExtractByHand(const JSON_Object *root_object)
+{
+    int found = 0;
+
+    if (json_object_has_value(root_object, "keyBool") != 0) {
+        key_bool_value = (bool)json_object_get_boolean(root_object, "keyBool");
+        found++;
+    }
+    if (json_object_has_value(root_object, "keyInt") != 0) {
+        key_int_value = (int)json_object_get_number(root_object, "keyInt");
+        found++;
+    }
+    if (json_object_has_value(root_object, "keyFloat") != 0) {
+        key_float_value = (float)json_object_get_number(root_object, "keyFloat");
+        found++;
+    }
+    if (json_object_has_value(root_object, "keyDouble") != 0) {
+        key_double_value = (double)json_object_get_number(root_object, "keyDouble");
+        found++;
+    }
+    if (json_object_has_value(root_object, "keyString") != 0) {
+        strncpy(key_string_value, json_object_get_string(root_object, "keyString"), MAX_STRING_LEN - 1);
+        found++;
+    }
+    if (json_object_has_value(root_object, "keyJsonObj") != 0) {
+        JSON_Object *key_nested_json_obj = json_object_get_object(root_object, "keyJsonObj");
+        if (json_object_has_value(key_nested_json_obj, "nestedKeyInt") != 0) {
+            key_nested_key_int_value = (int)json_object_get_number(key_nested_json_obj, "nestedKeyInt");
+            found++;
+        }
+    }
+    return found;
+}
+
+static int ExtractByTable(const JSON_Object *root_object)
+{
+    return json_reader_extract_object(root_object, sample_json_object_keys, NELEMS(sample_json_object_keys));
+}
+
+typedef struct {
+    const char *name;
+    const char *json;
+} PATCH;
+
+static const PATCH patches[] = {
+    {"README sample",
+     "{\"keyBool\": true, \"keyInt\": 2, \"keyFloat\": 32.35, \"keyDouble\": 4567.891, "
+     "\"keyString\": \"Avnet knows IoT!!\", \"keyJsonObj\": {\"nestedKeyInt\": 12}}"},
+    {"two keys changed", "{\"keyInt\": 3, \"keyJsonObj\": {\"nestedKeyInt\": 13}}"},
+    {"sample + 20 others",
+     "{\"keyBool\": true, \"keyInt\": 2, \"keyFloat\": 32.35, \"keyDouble\": 4567.891, "
+     "\"keyString\": \"Avnet knows IoT!!\", \"keyJsonObj\": {\"nestedKeyInt\": 12, \"a\": [1, 2, 3]}, "
+     "\"o1\": 1, \"o2\": \"two\", \"o3\": 3.5, \"o4\": false, \"o5\": null, \"o6\": {\"x\": 1, \"y\": 2}, "
+     "\"o7\": [\"a\", \"b\"], \"o8\": 8, \"o9\": \"nine\", \"o10\": 10, \"o11\": 11, \"o12\": 12, "
+     "\"o13\": \"thirteen\", \"o14\": 14.25, \"o15\": true, \"o16\": {\"z\": [0]}, \"o17\": 17, "
+     "\"o18\": \"eighteen\", \"o19\": 19, \"o20\": 20}"},
+};
+
+static void Run(const PATCH *patch)
+{
+    double start;
+    volatile int found = 0;
+
+    // What DevX does before calling the handler
+    ResetHeapCounters();
+    start = NowNs();
+    for (int i = 0; i < ITERATIONS; i++) {
+        json_value_free(json_parse_string(patch->json));
+    }
+    double parseNs = (NowNs() - start) / ITERATIONS;
+
+    ResetHeapCounters();
+    JSON_Value *value = json_parse_string(patch->json);
+    size_t domBytes = heap.peakBytes;
+    size_t domAllocations = heap.allocations;
+    const JSON_Object *object = json_value_get_object(value);
+
+    ResetHeapCounters();
+    start = NowNs();
+    for (int i = 0; i < ITERATIONS; i++) {
+        found = ExtractByHand(object);
+    }
+    double handNs = (NowNs() - start) / ITERATIONS;
+    size_t handAllocations = heap.allocations;
+    int handFound = found;
+
+    ResetHeapCounters();
+    start = NowNs();
+    for (int i = 0; i < ITERATIONS; i++) {
+        found = ExtractByTable(object);
+    }
+    double tableNs = (NowNs() - start) / ITERATIONS;
+    size_t tableAllocations = heap.allocations;
+
+    printf("%-20s %4zu B  parse %6.0f ns  DOM %5zu B in %3zu allocs  by hand %5.0f ns %zu allocs %d keys  "
+           "table %5.0f ns %zu allocs %d keys\n",
+           patch->name, strlen(patch->json), parseNs, domBytes, domAllocations, handNs, handAllocations, handFound,
+           tableNs, tableAllocations, found);
+    json_value_free(value);
+}
+
+int main(void)
+{
+    json_set_allocation_functions(CountingMalloc, CountingFree);
+    for (size_t i = 0; i < NELEMS(patches); i++) {
+        Run(&patches[i]);
+    }
+    return 0;
+}
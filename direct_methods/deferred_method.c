@@ -0,0 +1,352 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "deferred_method.h"
+
+#include "dx_timer.h"
+#include <applibs/eventloop.h>
+#include <applibs/log.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_WAITING, // Started with deferred_method_begin, waiting for deferred_method_complete
+    SLOT_QUEUED,  // Waiting for the worker thread
+    SLOT_RUNNING, // Work function running on the worker thread
+    SLOT_DONE     // Result ready to be published from the event loop
+} SLOT_STATE;
+
+typedef struct {
+    SLOT_STATE state;
+    DEFERRED_METHOD_TOKEN token;
+    const char *methodName;
+    DEFERRED_METHOD_WORK work;
+    void *context;
+    DX_DIRECT_METHOD_RESPONSE_CODE status;
+    char result[DEFERRED_METHOD_RESULT_BYTES];
+} DEFERRED_METHOD_SLOT;
+
+// The response pool, every method result is built in one of these slots
+static DEFERRED_METHOD_SLOT slots[DEFERRED_METHOD_POOL_SIZE];
+static char publish_buffer[DEFERRED_METHOD_RESULT_BYTES + 128];
+static unsigned int token_generation = 0;
+
+static pthread_mutex_t slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t worker_stopping; // Monotonic clock, for deferred_method_wait()
+static pthread_t worker_thread;
+static bool worker_running = false;
+static bool worker_stop = false;
+
+static int completion_fd = -1;
+static EventRegistration *completion_registration = NULL;
+
+static DX_MESSAGE_PROPERTY *resultMessageProperties[] = {
+    &(DX_MESSAGE_PROPERTY){.key = "type", .value = "methodResult"},
+    &(DX_MESSAGE_PROPERTY){.key = "schema", .value = "1"}};
+
+static DX_MESSAGE_CONTENT_PROPERTIES resultContentProperties = {.contentEncoding = "utf-8",
+                                                                .contentType = "application/json"};
+
+// A result that fills the buffer may have been cut off mid value, send an error instead of
+// invalid JSON
+static void check_result_length(DEFERRED_METHOD_SLOT *slot)
+{
+    if (strnlen(slot->result, sizeof(slot->result)) >= sizeof(slot->result) - 1) {
+        Log_Debug("ERROR: deferred method %s result truncated\n", slot->methodName);
+        slot->status = DX_METHOD_FAILED;
+        snprintf(slot->result, sizeof(slot->result), "{\"error\":\"result too large\"}");
+    }
+}
+
+static void publish_result(DEFERRED_METHOD_SLOT *slot)
+{
+    static const char resultFormat[] =
+        "{\"methodResult\":{\"token\":%d,\"method\":\"%s\",\"status\":%d,\"payload\":%s}}";
+
+    if (!dx_isAzureConnected()) {
+        Log_Debug("Not connected, deferred method %s result %d dropped\n", slot->methodName, slot->token);
+        return;
+    }
+
+    check_result_length(slot);
+
+    int len = snprintf(publish_buffer, sizeof(publish_buffer), resultFormat, slot->token,
+                       slot->methodName, slot->status, slot->result[0] ? slot->result : "null");
+
+    if (len < 0 || (size_t)len >= sizeof(publish_buffer)) {
+        Log_Debug("ERROR: deferred method %s result too large\n", slot->methodName);
+        return;
+    }
+
+    dx_azurePublish(publish_buffer, (size_t)len, resultMessageProperties,
+                    NELEMS(resultMessageProperties), &resultContentProperties);
+}
+
+/// <summary>
+/// Event loop handler, publish every completed result and return its slot to the pool
+/// </summary>
+static void completion_handler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        Log_Debug("ERROR: deferred method eventfd read: errno=%d (%s)\n", errno, strerror(errno));
+    }
+
+    for (size_t i = 0; i < DEFERRED_METHOD_POOL_SIZE; i++) {
+        // Only the event loop thread moves a slot out of SLOT_DONE, so the result can be
+        // published without holding the lock
+        pthread_mutex_lock(&slot_lock);
+        bool done = slots[i].state == SLOT_DONE;
+        pthread_mutex_unlock(&slot_lock);
+
+        if (done) {
+            publish_result(&slots[i]);
+
+            pthread_mutex_lock(&slot_lock);
+            slots[i].state = SLOT_FREE;
+            pthread_mutex_unlock(&slot_lock);
+        }
+    }
+}
+
+static void signal_completion(void)
+{
+    uint64_t one = 1;
+
+    if (write(completion_fd, &one, sizeof(one)) < 0) {
+        Log_Debug("ERROR: deferred method eventfd write: errno=%d (%s)\n", errno, strerror(errno));
+    }
+}
+
+static void *worker(void *arg)
+{
+    pthread_mutex_lock(&slot_lock);
+
+    while (!worker_stop) {
+        DEFERRED_METHOD_SLOT *slot = NULL;
+
+        for (size_t i = 0; i < DEFERRED_METHOD_POOL_SIZE; i++) {
+            if (slots[i].state == SLOT_QUEUED) {
+                slot = &slots[i];
+                break;
+            }
+        }
+
+        if (slot == NULL) {
+            pthread_cond_wait(&work_queued, &slot_lock);
+            continue;
+        }
+
+        slot->state = SLOT_RUNNING;
+        pthread_mutex_unlock(&slot_lock);
+
+        slot->result[0] = '\0';
+        DX_DIRECT_METHOD_RESPONSE_CODE status =
+            slot->work(slot->context, slot->result, sizeof(slot->result));
+
+        pthread_mutex_lock(&slot_lock);
+        slot->status = status;
+        slot->state = SLOT_DONE;
+        signal_completion();
+    }
+
+    pthread_mutex_unlock(&slot_lock);
+    return NULL;
+}
+
+bool deferred_method_wait(const struct timespec *duration)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += duration->tv_sec;
+    deadline.tv_nsec += duration->tv_nsec;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    int waitResult = 0;
+
+    pthread_mutex_lock(&slot_lock);
+    while (!worker_stop && waitResult != ETIMEDOUT) {
+        waitResult = pthread_cond_timedwait(&worker_stopping, &slot_lock, &deadline);
+    }
+    bool stopping = worker_stop;
+    pthread_mutex_unlock(&slot_lock);
+
+    return !stopping;
+}
+
+bool deferred_method_init(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&worker_stopping, &attr);
+    pthread_condattr_destroy(&attr);
+
+    completion_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (completion_fd == -1) {
+        Log_Debug("ERROR: deferred method eventfd: errno=%d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    completion_registration = EventLoop_RegisterIo(dx_timerGetEventLoop(), completion_fd,
+                                                   EventLoop_Input, completion_handler, NULL);
+    if (completion_registration == NULL) {
+        Log_Debug("ERROR: deferred method EventLoop_RegisterIo failed\n");
+        deferred_method_close();
+        return false;
+    }
+
+    worker_stop = false;
+    if (pthread_create(&worker_thread, NULL, worker, NULL) != 0) {
+        Log_Debug("ERROR: deferred method worker thread could not be started\n");
+        deferred_method_close();
+        return false;
+    }
+    worker_running = true;
+
+    return true;
+}
+
+void deferred_method_close(void)
+{
+    if (worker_running) {
+        pthread_mutex_lock(&slot_lock);
+        worker_stop = true;
+        pthread_cond_broadcast(&work_queued);
+        pthread_cond_broadcast(&worker_stopping);
+        pthread_mutex_unlock(&slot_lock);
+
+        // Waits for a work function that is already running, queued work is discarded
+        pthread_join(worker_thread, NULL);
+        worker_running = false;
+    }
+
+    if (completion_registration != NULL) {
+        EventLoop_UnregisterIo(dx_timerGetEventLoop(), completion_registration);
+        completion_registration = NULL;
+    }
+
+    if (completion_fd != -1) {
+        close(completion_fd);
+        completion_fd = -1;
+    }
+
+    memset(slots, 0, sizeof(slots));
+}
+
+static DEFERRED_METHOD_TOKEN claim_slot(DX_DIRECT_METHOD_BINDING *directMethodBinding,
+                                        SLOT_STATE state, DEFERRED_METHOD_WORK work,
+                                        void *context, char **responseMsg)
+{
+    DEFERRED_METHOD_SLOT *slot = NULL;
+    DEFERRED_METHOD_TOKEN token = DEFERRED_METHOD_INVALID_TOKEN;
+
+    pthread_mutex_lock(&slot_lock);
+
+    for (size_t i = 0; i < DEFERRED_METHOD_POOL_SIZE; i++) {
+        if (slots[i].state == SLOT_FREE) {
+            slot = &slots[i];
+
+            // Tokens map back to their slot, token % DEFERRED_METHOD_POOL_SIZE == slot index
+            token_generation = (token_generation + 1) % (INT_MAX / DEFERRED_METHOD_POOL_SIZE);
+            token = (DEFERRED_METHOD_TOKEN)(token_generation * DEFERRED_METHOD_POOL_SIZE + i);
+
+            slot->token = token;
+            slot->methodName = directMethodBinding->methodName;
+            slot->work = work;
+            slot->context = context;
+            slot->status = DX_METHOD_FAILED;
+            slot->result[0] = '\0';
+            slot->state = state;
+            break;
+        }
+    }
+
+    if (slot != NULL && state == SLOT_QUEUED) {
+        pthread_cond_signal(&work_queued);
+    }
+
+    pthread_mutex_unlock(&slot_lock);
+
+    if (slot == NULL) {
+        Log_Debug("Deferred method pool exhausted, %s rejected\n", directMethodBinding->methodName);
+        return DEFERRED_METHOD_INVALID_TOKEN;
+    }
+
+    // DevX frees the synchronous response, so this short acknowledgement is the only
+    // allocation left on the direct method path
+    if (responseMsg != NULL) {
+        static const char pendingFormat[] = "{\"token\":%d,\"status\":\"pending\"}";
+        size_t responseLen = sizeof(pendingFormat) + 12;
+
+        *responseMsg = (char *)malloc(responseLen);
+        if (*responseMsg != NULL) {
+            snprintf(*responseMsg, responseLen, pendingFormat, token);
+        }
+    }
+
+    return token;
+}
+
+DEFERRED_METHOD_TOKEN deferred_method_begin(DX_DIRECT_METHOD_BINDING *directMethodBinding,
+                                            char **responseMsg)
+{
+    return claim_slot(directMethodBinding, SLOT_WAITING, NULL, NULL, responseMsg);
+}
+
+DEFERRED_METHOD_TOKEN deferred_method_start(DX_DIRECT_METHOD_BINDING *directMethodBinding,
+                                            DEFERRED_METHOD_WORK work, void *context,
+                                            char **responseMsg)
+{
+    if (work == NULL || !worker_running) {
+        return DEFERRED_METHOD_INVALID_TOKEN;
+    }
+    return claim_slot(directMethodBinding, SLOT_QUEUED, work, context, responseMsg);
+}
+
+bool deferred_method_complete(DEFERRED_METHOD_TOKEN token, DX_DIRECT_METHOD_RESPONSE_CODE status,
+                              const char *result)
+{
+    if (token < 0) {
+        return false;
+    }
+
+    DEFERRED_METHOD_SLOT *slot = &slots[token % DEFERRED_METHOD_POOL_SIZE];
+
+    pthread_mutex_lock(&slot_lock);
+    bool waiting = slot->state == SLOT_WAITING && slot->token == token;
+    pthread_mutex_unlock(&slot_lock);
+
+    if (!waiting) {
+        return false;
+    }
+
+    slot->status = status;
+    if (result != NULL) {
+        strncpy(slot->result, result, sizeof(slot->result));
+    }
+
+    // Already on the event loop thread, publish straight away
+    publish_result(slot);
+
+    pthread_mutex_lock(&slot_lock);
+    slot->state = SLOT_FREE;
+    pthread_mutex_unlock(&slot_lock);
+
+    return true;
+}
@@ -0,0 +1,71 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "dx_azure_iot.h"
+#include "dx_direct_methods.h"
+
+// Maximum number of direct methods that can be in flight at the same time
+#define DEFERRED_METHOD_POOL_SIZE 4
+
+// Size of each preallocated result buffer
+#define DEFERRED_METHOD_RESULT_BYTES 256
+
+typedef int DEFERRED_METHOD_TOKEN;
+#define DEFERRED_METHOD_INVALID_TOKEN -1
+
+/// <summary>
+/// Work function run on the deferred method worker thread. Write a JSON value (object,
+/// string, number...) describing the result into result, or leave it empty for no payload.
+/// A result that fills resultSize is taken as truncated and replaced with an error.
+/// </summary>
+typedef DX_DIRECT_METHOD_RESPONSE_CODE (*DEFERRED_METHOD_WORK)(void *context, char *result,
+                                                               size_t resultSize);
+
+/// <summary>
+/// Create the worker thread and register its completion event with the DevX event loop.
+/// </summary>
+bool deferred_method_init(void);
+
+/// <summary>
+/// Cancel queued work, stop the worker thread and unregister from the event loop. A work
+/// function in deferred_method_wait() is woken, its result is discarded.
+/// </summary>
+void deferred_method_close(void);
+
+/// <summary>
+/// Wait for up to duration on the worker thread. Work functions wait with this rather than
+/// sleeping, so deferred_method_close() does not have to wait for them to finish.
+/// </summary>
+/// <returns>false if the wait was cut short because the worker is stopping</returns>
+bool deferred_method_wait(const struct timespec *duration);
+
+/// <summary>
+/// Take a slot from the pool for a method that will be completed later from the event loop
+/// with deferred_method_complete(), for example from a one shot timer or an intercore reply.
+/// When responseMsg is not NULL it is set to {"token":n,"status":"pending"}, which is what
+/// the handler returns to the caller straight away.
+/// </summary>
+/// <returns>The token, or DEFERRED_METHOD_INVALID_TOKEN if the pool is exhausted</returns>
+DEFERRED_METHOD_TOKEN deferred_method_begin(DX_DIRECT_METHOD_BINDING *directMethodBinding,
+                                            char **responseMsg);
+
+/// <summary>
+/// As deferred_method_begin(), and queue work to run on the worker thread. The method
+/// completes when work returns.
+/// </summary>
+DEFERRED_METHOD_TOKEN deferred_method_start(DX_DIRECT_METHOD_BINDING *directMethodBinding,
+                                            DEFERRED_METHOD_WORK work, void *context,
+                                            char **responseMsg);
+
+/// <summary>
+/// Complete a method started with deferred_method_begin(). Must be called on the event loop
+/// thread. result is a JSON value, or NULL for no payload.
+/// </summary>
+bool deferred_method_complete(DEFERRED_METHOD_TOKEN token, DX_DIRECT_METHOD_RESPONSE_CODE status,
+                              const char *result);
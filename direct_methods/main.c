@@ -46,26 +46,19 @@ DX_TIMER_HANDLER_END
 // false, "Duration":2}
 static DX_DIRECT_METHOD_HANDLER(LightControlHandler, json, directMethodBinding, responseMsg)
 {
-    char duration_str[] = "Duration";
-    char state_str[] = "State";
     bool requested_state;
     int requested_duration_seconds;
 
-    JSON_Object *jsonObject = json_value_get_object(json);
-    if (jsonObject == NULL) {
-        return DX_METHOD_FAILED;
-    }
+    JSON_READER_KEY keys[] = {
+        {.path = "State", .type = JSON_READER_BOOL, .destination = &requested_state},
+        {.path = "Duration", .type = JSON_READER_INT, .destination = &requested_duration_seconds}};
 
     // check JSON properties sent through are the correct type
-    if (!json_object_has_value_of_type(jsonObject, duration_str, JSONNumber) ||
-        !json_object_has_value_of_type(jsonObject, state_str, JSONBoolean)) {
+    if (json_reader_extract_object(json_value_get_object(json), keys, NELEMS(keys)) != (int)NELEMS(keys)) {
         return DX_METHOD_FAILED;
     }
 
-    requested_state = (bool)json_object_get_boolean(jsonObject, state_str);
     Log_Debug("State %d \n", requested_state);
-
-    requested_duration_seconds = (int)json_object_get_number(jsonObject, duration_str);
     Log_Debug("Duration %d \n", requested_duration_seconds);
 
     if (!IN_RANGE(requested_duration_seconds, 1, 120)) {
@@ -98,18 +91,19 @@ DX_TIMER_HANDLER_END
 /// </summary>
 static DX_DIRECT_METHOD_HANDLER(RestartDeviceHandler, json, directMethodBinding, responseMsg)
 {
-    // Allocate and initialize a response message buffer. The
-    // calling function is responsible for the freeing memory
+    // The response message is freed by DevX with free(), so it has to come from the heap
+    // rather than a pool. Allocate it only once the request is known to need one.
     const size_t responseLen = 100;
     static struct timespec period;
 
-    *responseMsg = (char *)malloc(responseLen);
-    memset(*responseMsg, 0, responseLen);
-
     if (json_value_get_type(json) != JSONNumber) {
         return DX_METHOD_FAILED;
     }
 
+    if ((*responseMsg = (char *)malloc(responseLen)) == NULL) {
+        return DX_METHOD_FAILED;
+    }
+
     int seconds = (int)json_value_get_number(json);
 
     // leave enough time for the device twin dt_reportedRestartUtc
@@ -133,6 +127,45 @@ static DX_DIRECT_METHOD_HANDLER(RestartDeviceHandler, json, directMethodBinding,
 }
 DX_DIRECT_METHOD_HANDLER_END
 
+/// <summary>
+/// Runs on the deferred method worker thread. Stands in for any slow operation, such as
+/// polling an external device, that must not block the event loop.
+/// </summary>
+static DX_DIRECT_METHOD_RESPONSE_CODE LongRunningWork(void *context, char *result, size_t resultSize)
+{
+    int seconds = (int)(intptr_t)context;
+
+    if (!deferred_method_wait(&(struct timespec){seconds, 0})) {
+        return DX_METHOD_FAILED;
+    }
+    snprintf(result, resultSize, "{\"Seconds\":%d}", seconds);
+
+    return DX_METHOD_SUCCEEDED;
+}
+
+// Direct method name = LongRunning, json payload = {"Seconds": 5}
+// The method returns {"token":n,"status":"pending"} straight away, the result is sent
+// as a methodResult telemetry message with the same token when the work completes.
+static DX_DIRECT_METHOD_HANDLER(LongRunningHandler, json, directMethodBinding, responseMsg)
+{
+    int seconds;
+
+    JSON_READER_KEY keys[] = {{.path = "Seconds", .type = JSON_READER_INT, .destination = &seconds}};
+
+    if (json_reader_extract_object(json_value_get_object(json), keys, NELEMS(keys)) != (int)NELEMS(keys) ||
+        !IN_RANGE(seconds, 1, 60)) {
+        return DX_METHOD_FAILED;
+    }
+
+    if (deferred_method_start(directMethodBinding, LongRunningWork, (void *)(intptr_t)seconds,
+                              responseMsg) == DEFERRED_METHOD_INVALID_TOKEN) {
+        return DX_METHOD_FAILED;
+    }
+
+    return DX_METHOD_SUCCEEDED;
+}
+DX_DIRECT_METHOD_HANDLER_END
+
 /// <summary>
 ///  Initialize peripherals, device twins, direct methods, timers.
 /// </summary>
@@ -141,6 +174,9 @@ static void InitPeripheralsAndHandlers(void)
     dx_azureConnect(&dx_config, NETWORK_INTERFACE, IOT_PLUG_AND_PLAY_MODEL_ID);
     dx_timerSetStart(timers, NELEMS(timers));
     dx_gpioSetOpen(gpio_set, NELEMS(gpio_set));
+    if (!deferred_method_init()) {
+        dx_terminate(APP_ExitCode_DeferredMethodInit);
+    }
     dx_directMethodSubscribe(direct_method_bindings, NELEMS(direct_method_bindings));
 }
 
@@ -152,6 +188,7 @@ static void ClosePeripheralsAndHandlers(void)
     dx_timerSetStop(timers, NELEMS(timers));
     dx_gpioSetClose(gpio_set, NELEMS(gpio_set));
     dx_directMethodUnsubscribe();
+    deferred_method_close();
     dx_timerEventLoopStop();
 }
 
@@ -6,12 +6,15 @@
 #include "dx_config.h"
 #include "dx_direct_methods.h"
 #include "app_exit_codes.h"
+#include "deferred_method.h"
+#include "json_reader.h"
 #include "dx_gpio.h"
 #include "dx_terminate.h"
 #include "dx_timer.h"
 #include "dx_utilities.h"
 #include <applibs/log.h>
 #include <applibs/powermanagement.h>
+#include <stdint.h>
 
 // https://docs.microsoft.com/en-us/azure/iot-pnp/overview-iot-plug-and-play
 #define IOT_PLUG_AND_PLAY_MODEL_ID "dtmi:com:example:azuresphere:labmonitor;1"
@@ -20,6 +23,8 @@
 // Forward declarations
 static DX_DIRECT_METHOD_RESPONSE_CODE LightControlHandler(
     JSON_Value *json, DX_DIRECT_METHOD_BINDING *directMethodBinding, char **responseMsg);
+static DX_DIRECT_METHOD_RESPONSE_CODE LongRunningHandler(
+    JSON_Value *json, DX_DIRECT_METHOD_BINDING *directMethodBinding, char **responseMsg);
 static DX_DIRECT_METHOD_RESPONSE_CODE RestartDeviceHandler(
     JSON_Value *json, DX_DIRECT_METHOD_BINDING *directMethodBinding, char **responseMsg);
 static void DelayRestartDeviceTimerHandler(EventLoopTimer *eventLoopTimer);
@@ -62,6 +67,10 @@ static DX_DIRECT_METHOD_BINDING dm_light_control = {.methodName = "LightControl"
 static DX_DIRECT_METHOD_BINDING dm_restart_device = {.methodName = "RestartDevice",
                                                      .handler = RestartDeviceHandler};
 
+static DX_DIRECT_METHOD_BINDING dm_long_running = {.methodName = "LongRunning",
+                                                   .handler = LongRunningHandler};
+
 // All direct methods referenced in direct_method_bindings will be subscribed to in
 // the InitPeripheralsAndHandlers function
-DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_restart_device, &dm_light_control};
\ No newline at end of file
+DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_restart_device, &dm_light_control,
+                                                      &dm_long_running};
\ No newline at end of file
@@ -0,0 +1,218 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host test for deferred_method.c with a stand-in transport. An event loop runs a 10 ms
+   periodic timer and records how late each tick fires. At 100 ms a burst of slow direct
+   method calls arrives. Each call needs 500 ms of work, as LongRunning does for {"Seconds"}.
+
+   In the first run the handlers do the work inline, the way the example's handlers answered
+   before deferred responses. In the second they call deferred_method_start() and return the
+   pending token. The transport records each methodResult message the event loop publishes
+   and when. It reports the longest stall, the slowest handler, when each result went out, a
+   call refused because the pool was full, a deferred_method_begin()/complete() pair, and how
+   long deferred_method_close() takes while work is waiting.
+
+   Build: gcc -O2 -I host -I .. -o deferred_method_stall deferred_method_stall.c
+              ../deferred_method.c -lpthread
+   Usage: deferred_method_stall
+*/
+
+#include "deferred_method.h"
+
+#include "dx_timer.h"
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TICK_MS 10
+#define CALL_AT_MS 100
+#define WORK_MS 500
+#define CALLS (DEFERRED_METHOD_POOL_SIZE + 1)
+#define RUN_MS (CALL_AT_MS + WORK_MS * CALLS + 200)
+
+typedef struct {
+    double atMs;
+    char message[DEFERRED_METHOD_RESULT_BYTES + 128];
+} PUBLISHED;
+
+static PUBLISHED published[16];
+static int publishedCount;
+static double startMs;
+
+static int completionFd = -1;
+static EventLoopIoCallback *completionCallback;
+
+static double NowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return (EventLoop *)&completionFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    completionFd = fd;
+    completionCallback = callback;
+    return (EventRegistration *)&completionFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    completionFd = -1;
+    return 0;
+}
+
+// The stand-in transport, keeps each message and when it was sent
+bool dx_isAzureConnected(void)
+{
+    return true;
+}
+
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties)
+{
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+    if (publishedCount < (int)NELEMS(published)) {
+        PUBLISHED *entry = &published[publishedCount++];
+        entry->atMs = NowMs() - startMs;
+        snprintf(entry->message, sizeof(entry->message), "%.*s", (int)messageLength, (const char *)message);
+    }
+    return true;
+}
+
+static DX_DIRECT_METHOD_BINDING longRunning = {.methodName = "LongRunning"};
+
+// LongRunningWork from main.c, in milliseconds
+static DX_DIRECT_METHOD_RESPONSE_CODE SlowWork(void *context, char *result, size_t resultSize)
+{
+    int ms = (int)(intptr_t)context;
+
+    if (!deferred_method_wait(&(struct timespec){ms / 1000, (ms % 1000) * 1000000L})) {
+        return DX_METHOD_FAILED;
+    }
+    snprintf(result, resultSize, "{\"Milliseconds\":%d}", ms);
+    return DX_METHOD_SUCCEEDED;
+}
+
+// The handler as it was before deferred responses, the caller waits for the work
+static DX_DIRECT_METHOD_RESPONSE_CODE BlockingHandler(char **responseMsg)
+{
+    struct timespec work = {WORK_MS / 1000, (WORK_MS % 1000) * 1000000L};
+
+    nanosleep(&work, NULL);
+    *responseMsg = strdup("{\"Milliseconds\":500}");
+    return DX_METHOD_SUCCEEDED;
+}
+
+static DX_DIRECT_METHOD_RESPONSE_CODE DeferredHandler(char **responseMsg)
+{
+    if (deferred_method_start(&longRunning, SlowWork, (void *)(intptr_t)WORK_MS, responseMsg) ==
+        DEFERRED_METHOD_INVALID_TOKEN) {
+        return DX_METHOD_FAILED;
+    }
+    return DX_METHOD_SUCCEEDED;
+}
+
+// Run the event loop for RUN_MS, the method calls arrive at CALL_AT_MS
+static void Run(const char *name, DX_DIRECT_METHOD_RESPONSE_CODE (*handler)(char **responseMsg))
+{
+    double nextTickMs = TICK_MS;
+    double maxLateMs = 0;
+    double maxHandlerMs = 0;
+    bool called = false;
+    int refused = 0;
+
+    publishedCount = 0;
+    startMs = NowMs();
+    printf("-- %s\n", name);
+
+    for (;;) {
+        double nowMs = NowMs() - startMs;
+        if (nowMs >= RUN_MS) {
+            break;
+        }
+
+        if (nowMs >= nextTickMs) {
+            if (nowMs - nextTickMs > maxLateMs) {
+                maxLateMs = nowMs - nextTickMs;
+            }
+            nextTickMs += TICK_MS * (1 + (int)((nowMs - nextTickMs) / TICK_MS));
+
+            if (!called && nowMs >= CALL_AT_MS) {
+                called = true;
+                for (int i = 0; i < CALLS; i++) {
+                    char *responseMsg = NULL;
+                    double handlerStartMs = NowMs();
+                    DX_DIRECT_METHOD_RESPONSE_CODE status = handler(&responseMsg);
+                    double handlerMs = NowMs() - handlerStartMs;
+
+                    if (handlerMs > maxHandlerMs) {
+                        maxHandlerMs = handlerMs;
+                    }
+                    refused += status != DX_METHOD_SUCCEEDED;
+                    printf("  call %d returned %d after %7.3f ms: %s\n", i, status, handlerMs,
+                           responseMsg != NULL ? responseMsg : "");
+                    free(responseMsg);
+                }
+            }
+        }
+
+        struct pollfd fd = {.fd = completionFd, .events = POLLIN};
+        int timeoutMs = (int)(nextTickMs - (NowMs() - startMs)) + 1;
+        if (poll(&fd, completionFd >= 0 ? 1 : 0, timeoutMs > 0 ? timeoutMs : 0) > 0) {
+            completionCallback(NULL, completionFd, EventLoop_Input, NULL);
+        }
+    }
+
+    for (int i = 0; i < publishedCount; i++) {
+        printf("  published at %6.1f ms: %s\n", published[i].atMs, published[i].message);
+    }
+    printf("  longest stall %.1f ms, slowest handler %.3f ms, refused %d, results published %d\n", maxLateMs,
+           maxHandlerMs, refused, publishedCount);
+}
+
+int main(void)
+{
+    if (!deferred_method_init()) {
+        printf("deferred_method_init failed\n");
+        return 1;
+    }
+
+    Run("handlers do the work inline", BlockingHandler);
+    Run("handlers defer the work", DeferredHandler);
+
+    // Completed later from the event loop, as an intercore reply would
+    publishedCount = 0;
+    DEFERRED_METHOD_TOKEN token = deferred_method_begin(&longRunning, NULL);
+    bool completed = deferred_method_complete(token, DX_METHOD_SUCCEEDED, "{\"reply\":1}");
+    bool completedTwice = deferred_method_complete(token, DX_METHOD_SUCCEEDED, "{\"reply\":2}");
+    printf("-- begin/complete\n  completed %d, completed again %d, published %d: %s\n", completed, completedTwice,
+           publishedCount, publishedCount > 0 ? published[0].message : "");
+
+    // Work waiting 60 s does not hold up shutdown
+    deferred_method_start(&longRunning, SlowWork, (void *)(intptr_t)60000, NULL);
+    deferred_method_start(&longRunning, SlowWork, (void *)(intptr_t)60000, NULL);
+    struct timespec settle = {0, 50000000L};
+    nanosleep(&settle, NULL);
+    double closeStartMs = NowMs();
+    deferred_method_close();
+    printf("-- close\n  deferred_method_close() with one method running and one queued took %.3f ms\n",
+           NowMs() - closeStartMs);
+    return 0;
+}
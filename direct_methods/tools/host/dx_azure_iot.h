@@ -0,0 +1,27 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. Each tool defines the
+// functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
+
+typedef struct {
+    const char *key;
+    const char *value;
+} DX_MESSAGE_PROPERTY;
+
+typedef struct {
+    const char *contentEncoding;
+    const char *contentType;
+} DX_MESSAGE_CONTENT_PROPERTIES;
+
+bool dx_isAzureConnected(void);
+
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties);
@@ -0,0 +1,16 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory
+
+#pragma once
+
+typedef enum {
+    DX_METHOD_SUCCEEDED = 200,
+    DX_METHOD_FAILED = 500,
+    DX_METHOD_NOT_FOUND = 404
+} DX_DIRECT_METHOD_RESPONSE_CODE;
+
+typedef struct {
+    const char *methodName;
+} DX_DIRECT_METHOD_BINDING;
@@ -0,0 +1,168 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "flight_recorder.h"
+
+#include <applibs/log.h>
+#include <applibs/storage.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FLIGHT_RECORDER_MASK (FLIGHT_RECORDER_CAPACITY - 1)
+
+// Bytes of the previous recording on each "FR:" debug line
+#define DUMP_LINE_BYTES 32
+
+static FLIGHT_RECORDER_RECORD records[FLIGHT_RECORDER_CAPACITY];
+static atomic_uint recorded;
+static int storage_fd = -1;
+
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+void flight_recorder_event(FLIGHT_RECORDER_EVENT event, uint32_t arg0, uint32_t arg1)
+{
+    uint32_t sequence = atomic_fetch_add_explicit(&recorded, 1, memory_order_relaxed);
+    FLIGHT_RECORDER_RECORD *record = &records[sequence & FLIGHT_RECORDER_MASK];
+
+    record->timestampNs = clock_ns(CLOCK_MONOTONIC);
+    record->event = (uint16_t)event;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+
+    // Until the sequence matches the slot the decoder treats the record as not written
+    atomic_signal_fence(memory_order_release);
+    record->sequence = sequence;
+}
+
+bool flight_recorder_flush(uint32_t reason)
+{
+    // Only async signal safe calls from here on, this runs in the fatal signal handler
+    FLIGHT_RECORDER_HEADER header = {.magic = FLIGHT_RECORDER_MAGIC,
+                                     .version = FLIGHT_RECORDER_VERSION,
+                                     .recordSize = sizeof(FLIGHT_RECORDER_RECORD),
+                                     .capacity = FLIGHT_RECORDER_CAPACITY,
+                                     .recorded = atomic_load(&recorded),
+                                     .reason = reason,
+                                     .flushedNs = clock_ns(CLOCK_MONOTONIC)};
+
+    if (storage_fd == -1) {
+        return false;
+    }
+
+    header.wallClockSeconds = (int64_t)(clock_ns(CLOCK_REALTIME) / 1000000000);
+
+    // Records first so a flush cut short leaves the previous header, the per record sequence
+    // check drops whatever was half written
+    if (pwrite(storage_fd, records, sizeof(records), sizeof(header)) != (ssize_t)sizeof(records) ||
+        pwrite(storage_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        return false;
+    }
+    return fsync(storage_fd) == 0;
+}
+
+static void fatal_signal_handler(int signalNumber, siginfo_t *info, void *context)
+{
+    (void)context;
+
+    flight_recorder_event(FR_EVENT_SIGNAL, (uint32_t)signalNumber,
+                          (uint32_t)(uintptr_t)info->si_addr);
+    flight_recorder_flush((uint32_t)signalNumber);
+
+    // SA_RESETHAND restored the default action, raise again so the crash still reaches the
+    // Azure Sphere error reporting
+    raise(signalNumber);
+}
+
+/// <summary>
+/// Log the recording the previous run left in mutable storage, for tools/flight_recorder_decode
+/// </summary>
+static void dump_previous_recording(void)
+{
+    FLIGHT_RECORDER_HEADER header;
+    uint8_t chunk[DUMP_LINE_BYTES];
+    char line[8 + DUMP_LINE_BYTES * 2 + 1];
+
+    if (pread(storage_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != FLIGHT_RECORDER_MAGIC || header.version != FLIGHT_RECORDER_VERSION ||
+        header.recordSize != sizeof(FLIGHT_RECORDER_RECORD) ||
+        header.capacity != FLIGHT_RECORDER_CAPACITY) {
+        Log_Debug("Flight recorder: no previous recording\n");
+        return;
+    }
+
+    if (header.reason != 0) {
+        Log_Debug("Flight recorder: previous run ended by signal %lu (%s) after %lu events\n",
+                  (unsigned long)header.reason, strsignal((int)header.reason),
+                  (unsigned long)header.recorded);
+    } else {
+        Log_Debug("Flight recorder: previous run checkpointed after %lu events\n",
+                  (unsigned long)header.recorded);
+    }
+
+    for (size_t offset = 0; offset < FLIGHT_RECORDER_FILE_BYTES; offset += DUMP_LINE_BYTES) {
+        size_t length = FLIGHT_RECORDER_FILE_BYTES - offset;
+        if (length > DUMP_LINE_BYTES) {
+            length = DUMP_LINE_BYTES;
+        }
+        if (pread(storage_fd, chunk, length, (off_t)offset) != (ssize_t)length) {
+            Log_Debug("ERROR: flight recorder read: errno=%d (%s)\n", errno, strerror(errno));
+            return;
+        }
+
+        int used = snprintf(line, sizeof(line), "%04zx:", offset);
+        for (size_t i = 0; i < length; i++) {
+            used += snprintf(line + used, sizeof(line) - (size_t)used, "%02x", chunk[i]);
+        }
+        Log_Debug("FR:%s\n", line);
+    }
+}
+
+bool flight_recorder_init(void)
+{
+    // SA_RESETHAND is 0x80000000, an unsigned constant, sa_flags is an int
+    struct sigaction action = {.sa_sigaction = fatal_signal_handler,
+                               .sa_flags = (int)(SA_SIGINFO | SA_RESETHAND)};
+
+    storage_fd = Storage_OpenMutableFile();
+    if (storage_fd == -1) {
+        Log_Debug("ERROR: flight recorder mutable storage: errno=%d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    dump_previous_recording();
+
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < sizeof(fatal_signals) / sizeof(fatal_signals[0]); i++) {
+        if (sigaction(fatal_signals[i], &action, NULL) == -1) {
+            Log_Debug("ERROR: flight recorder sigaction: errno=%d (%s)\n", errno, strerror(errno));
+            return false;
+        }
+    }
+
+    flight_recorder_event(FR_EVENT_APP_START, 0, 0);
+    return true;
+}
+
+void flight_recorder_close(void)
+{
+    if (storage_fd == -1) {
+        return;
+    }
+    if (!flight_recorder_flush(0)) {
+        Log_Debug("ERROR: flight recorder flush: errno=%d (%s)\n", errno, strerror(errno));
+    }
+    close(storage_fd);
+    storage_fd = -1;
+}
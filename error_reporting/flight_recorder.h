@@ -0,0 +1,87 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Always on binary trace of what the application did last. Each event is a fixed size record
+// written into a RAM ring, the ring is written to mutable storage from the fatal signal handler
+// and on a periodic checkpoint. On the next start the previous recording is dumped to the debug
+// output as "FR:" hex lines, tools/flight_recorder_decode turns that output, or a copy of the
+// mutable storage file, back into a timeline.
+//
+// This header is shared with the host decoder, keep it free of applibs includes.
+
+#define FLIGHT_RECORDER_MAGIC 0x52444C46 // "FLDR"
+#define FLIGHT_RECORDER_VERSION 1
+
+// Records kept, must be a power of two. 256 records is 6 KB of RAM and of mutable storage.
+#define FLIGHT_RECORDER_CAPACITY 256
+
+#define FLIGHT_RECORDER_EVENTS(EVENT)                                                              \
+    EVENT(FR_EVENT_NONE)                                                                           \
+    EVENT(FR_EVENT_APP_START)                                                                      \
+    EVENT(FR_EVENT_HANDLER_ENTER)      /* arg0 handler id */                                       \
+    EVENT(FR_EVENT_HANDLER_EXIT)       /* arg0 handler id, arg1 handler specific */                \
+    EVENT(FR_EVENT_DIRECT_METHOD)      /* arg0 handler id, arg1 method specific */                 \
+    EVENT(FR_EVENT_PUBLISH)            /* arg0 bytes, arg1 message number */                       \
+    EVENT(FR_EVENT_I2C_READ)           /* arg0 device address, arg1 bytes */                       \
+    EVENT(FR_EVENT_I2C_WRITE)          /* arg0 device address, arg1 bytes */                       \
+    EVENT(FR_EVENT_INTERCORE_SEND)     /* arg0 command, arg1 bytes */                              \
+    EVENT(FR_EVENT_INTERCORE_RECEIVE)  /* arg0 command, arg1 bytes */                              \
+    EVENT(FR_EVENT_CONNECTION)         /* arg0 1 when connected */                                 \
+    EVENT(FR_EVENT_CHECKPOINT)                                                                     \
+    EVENT(FR_EVENT_SIGNAL)             /* arg0 signal number, arg1 low 32 bits of the address */   \
+    EVENT(FR_EVENT_EXIT)               /* arg0 exit code */
+
+#define FLIGHT_RECORDER_ENUM(name) name,
+
+typedef enum { FLIGHT_RECORDER_EVENTS(FLIGHT_RECORDER_ENUM) FR_EVENT_COUNT } FLIGHT_RECORDER_EVENT;
+
+typedef struct {
+    uint64_t timestampNs; // CLOCK_MONOTONIC
+    // Position in the whole trace, written last. The decoder orders records with it and skips
+    // any whose sequence does not match its slot, they were being written when the app died.
+    uint32_t sequence;
+    uint16_t event;
+    uint16_t reserved;
+    uint32_t arg0;
+    uint32_t arg1;
+} FLIGHT_RECORDER_RECORD;
+
+// Start of the mutable storage file, FLIGHT_RECORDER_CAPACITY records follow in ring order
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint32_t recorded;     // Events recorded, the next sequence number
+    uint32_t reason;       // 0 for a checkpoint, else the fatal signal number
+    uint32_t reserved;
+    int64_t wallClockSeconds; // CLOCK_REALTIME at the flush, maps timestampNs to wall clock time
+    uint64_t flushedNs;       // CLOCK_MONOTONIC at the flush
+} FLIGHT_RECORDER_HEADER;
+
+#define FLIGHT_RECORDER_FILE_BYTES                                                                 \
+    (sizeof(FLIGHT_RECORDER_HEADER) + FLIGHT_RECORDER_CAPACITY * sizeof(FLIGHT_RECORDER_RECORD))
+
+/// <summary>
+/// Dump the previous recording, open mutable storage and install handlers for the fatal signals.
+/// Events recorded before this are kept.
+/// </summary>
+bool flight_recorder_init(void);
+
+/// <summary>
+/// Add an event to the ring. Safe to call from any thread and from signal handlers.
+/// </summary>
+void flight_recorder_event(FLIGHT_RECORDER_EVENT event, uint32_t arg0, uint32_t arg1);
+
+/// <summary>
+/// Write the ring to mutable storage. Async signal safe.
+/// </summary>
+/// <param name="reason">0 for a checkpoint, else the signal that is ending the application</param>
+bool flight_recorder_flush(uint32_t reason);
+
+void flight_recorder_close(void);
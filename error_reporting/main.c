@@ -45,6 +45,7 @@
 #include "dx_terminate.h"
 #include "dx_timer.h"
 #include "dx_utilities.h"
+#include "flight_recorder.h"
 #include <applibs/log.h>
 #include <applibs/powermanagement.h>
 #include <signal.h>
@@ -54,11 +55,22 @@
 #define NETWORK_INTERFACE "wlan0"
 #define ONE_MS 1000000
 
+// How often the flight recorder is written to mutable storage when nothing crashes. Each
+// checkpoint rewrites about 6 KB of flash, the fatal signal handler covers crashes in between.
+#define FLIGHT_RECORDER_CHECKPOINT_SECONDS (5 * 60)
+
+// arg0 of the flight recorder handler and direct method events
+enum {
+    FR_HANDLER_AZURE_CONNECTION_CHECK = 1,
+    FR_HANDLER_ERROR_REPORT = 2
+};
+
 // Forward declarations
 static DX_DIRECT_METHOD_RESPONSE_CODE ErrorReportHandler(
     JSON_Value *json, DX_DIRECT_METHOD_BINDING *directMethodBinding, char **responseMsg);
 
 static void AzureConnectionCheckHandler(EventLoopTimer *eventLoopTimer);
+static void FlightRecorderCheckpointHandler(EventLoopTimer *eventLoopTimer);
 
 // Variables
 DX_USER_CONFIG dx_config;
@@ -89,8 +101,13 @@ DX_GPIO_BINDING *gpio_set[] = {&ledRed, &ledBlue};
 static DX_TIMER_BINDING azureConnectionCeckTimer = {
     .period = {2, 0}, .name = "AzureConnectionCheckTimer", .handler = AzureConnectionCheckHandler};
 
+static DX_TIMER_BINDING flightRecorderCheckpointTimer = {
+    .period = {FLIGHT_RECORDER_CHECKPOINT_SECONDS, 0},
+    .name = "FlightRecorderCheckpointTimer",
+    .handler = FlightRecorderCheckpointHandler};
+
 // All timers referenced in timers with be opened in the InitPeripheralsAndHandlers function
-DX_TIMER_BINDING *timers[] = {&azureConnectionCeckTimer};
+DX_TIMER_BINDING *timers[] = {&azureConnectionCeckTimer, &flightRecorderCheckpointTimer};
 
 /****************************************************************************************
  * Azure IoT Direct Method Bindings
@@ -107,6 +124,9 @@ DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_error_report};
 /// </summary>
 static void InitPeripheralsAndHandlers(void)
 {
+    // Events are still recorded in RAM if mutable storage is not available, they are just not
+    // persisted
+    flight_recorder_init();
     dx_azureConnect(&dx_config, NETWORK_INTERFACE, IOT_PLUG_AND_PLAY_MODEL_ID);
     dx_timerSetStart(timers, NELEMS(timers));
     dx_gpioSetOpen(gpio_set, NELEMS(gpio_set));
@@ -122,6 +142,9 @@ static void ClosePeripheralsAndHandlers(void)
     dx_gpioSetClose(gpio_set, NELEMS(gpio_set));
     dx_directMethodUnsubscribe();
     dx_timerEventLoopStop();
+
+    flight_recorder_event(FR_EVENT_EXIT, (uint32_t)dx_getTerminationExitCode(), 0);
+    flight_recorder_close();
 }
 
 int main(int argc, char *argv[])
@@ -174,6 +197,7 @@ static DX_DIRECT_METHOD_RESPONSE_CODE ErrorReportHandler(
 
     errorCode = (int)json_object_get_number(jsonObject, errorCode_str);
     Log_Debug("ErrorCode %d \n", errorCode);
+    flight_recorder_event(FR_EVENT_DIRECT_METHOD, FR_HANDLER_ERROR_REPORT, (uint32_t)errorCode);
 
     // Turn off the LEDs before exiting
     dx_gpioOff(&ledRed);
@@ -182,6 +206,9 @@ static DX_DIRECT_METHOD_RESPONSE_CODE ErrorReportHandler(
     switch(errorCode)
     {
         case 0: // generate SIGKILL exit
+            // SIGKILL cannot be caught, write the recording out while we still can
+            flight_recorder_event(FR_EVENT_SIGNAL, SIGKILL, 0);
+            flight_recorder_flush(SIGKILL);
             raise(SIGKILL);
             break;
         case 1: // generate SIGEGV exit
@@ -204,7 +231,17 @@ static void AzureConnectionCheckHandler(EventLoopTimer *eventLoopTimer)
         return;
     }
 
-    if(dx_isAzureConnected()){
+    static bool wasConnected = false;
+    bool connected = dx_isAzureConnected();
+
+    flight_recorder_event(FR_EVENT_HANDLER_ENTER, FR_HANDLER_AZURE_CONNECTION_CHECK, 0);
+
+    if (connected != wasConnected) {
+        flight_recorder_event(FR_EVENT_CONNECTION, connected, 0);
+        wasConnected = connected;
+    }
+
+    if(connected){
         dx_gpioOff(&ledRed);
         dx_gpioOn(&ledBlue);
     }
@@ -212,4 +249,23 @@ static void AzureConnectionCheckHandler(EventLoopTimer *eventLoopTimer)
         dx_gpioOn(&ledRed);
         dx_gpioOff(&ledBlue);
     }
+
+    flight_recorder_event(FR_EVENT_HANDLER_EXIT, FR_HANDLER_AZURE_CONNECTION_CHECK, connected);
+}
+
+/// <summary>
+/// Write the flight recorder to mutable storage, so a run that ends without a catchable signal
+/// still leaves its recent history behind
+/// </summary>
+static void FlightRecorderCheckpointHandler(EventLoopTimer *eventLoopTimer)
+{
+    if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+        dx_terminate(DX_ExitCode_ConsumeEventLoopTimeEvent);
+        return;
+    }
+
+    flight_recorder_event(FR_EVENT_CHECKPOINT, 0, 0);
+    if (!flight_recorder_flush(0)) {
+        Log_Debug("ERROR: flight recorder checkpoint: errno=%d (%s)\n", errno, strerror(errno));
+    }
 }
@@ -0,0 +1,56 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, times flight_recorder_event() and flight_recorder_flush() from the error_reporting
+   application. The flushes write flight_recorder.bin in the working directory, which
+   flight_recorder_decode reads.
+
+   Build: gcc -O2 -I host -o flight_recorder_bench flight_recorder_bench.c
+   Usage: flight_recorder_bench [events] [flushes]
+*/
+
+#include "../flight_recorder.c"
+
+#include <stdlib.h>
+
+static double now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    long events = argc > 1 ? strtol(argv[1], NULL, 10) : 20000000;
+    long flushes = argc > 2 ? strtol(argv[2], NULL, 10) : 100;
+
+    if (events <= 0 || flushes <= 0) {
+        fprintf(stderr, "Usage: flight_recorder_bench [events] [flushes]\n");
+        return 1;
+    }
+
+    double start = now_ns();
+    for (long i = 0; i < events; i++) {
+        flight_recorder_event(FR_EVENT_HANDLER_ENTER, 1, (uint32_t)i);
+    }
+    double elapsed = now_ns() - start;
+    printf("event: %.1f ns, %.1f million events/s\n", elapsed / (double)events,
+           (double)events / elapsed * 1e3);
+
+    storage_fd = Storage_OpenMutableFile();
+    if (storage_fd == -1) {
+        fprintf(stderr, "Cannot open flight_recorder.bin: %s\n", strerror(errno));
+        return 1;
+    }
+
+    start = now_ns();
+    for (long i = 0; i < flushes; i++) {
+        flight_recorder_flush(0);
+    }
+    elapsed = now_ns() - start;
+    printf("flush: %.1f us including fsync\n", elapsed / (double)flushes / 1e3);
+
+    close(storage_fd);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host tool, decodes a flight recorder dump from the error_reporting application.
+
+   Build: gcc -O2 -o flight_recorder_decode flight_recorder_decode.c
+   Usage: flight_recorder_decode <debug output with "FR:" lines | copy of the mutable storage file>
+*/
+
+#include "../flight_recorder.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FLIGHT_RECORDER_NAME(name) #name,
+
+static const char *event_names[] = {FLIGHT_RECORDER_EVENTS(FLIGHT_RECORDER_NAME)};
+
+static uint8_t image[FLIGHT_RECORDER_FILE_BYTES];
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/// <summary>
+/// Rebuild the file image from "FR:<offset>:<hex>" lines, anything else in the log is skipped
+/// </summary>
+static size_t load_debug_output(FILE *file)
+{
+    char line[512];
+    size_t highest = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *start = strstr(line, "FR:");
+        char *hex;
+        unsigned long offset;
+
+        if (start == NULL) {
+            continue;
+        }
+        offset = strtoul(start + 3, &hex, 16);
+        if (*hex != ':') {
+            continue;
+        }
+        hex++;
+
+        while (hex_value(hex[0]) >= 0 && hex_value(hex[1]) >= 0 && offset < sizeof(image)) {
+            image[offset++] = (uint8_t)(hex_value(hex[0]) << 4 | hex_value(hex[1]));
+            hex += 2;
+        }
+        if (offset > highest) {
+            highest = offset;
+        }
+    }
+    return highest;
+}
+
+static int compare_sequence(const void *a, const void *b)
+{
+    const FLIGHT_RECORDER_RECORD *left = a;
+    const FLIGHT_RECORDER_RECORD *right = b;
+    return left->sequence < right->sequence ? -1 : left->sequence > right->sequence;
+}
+
+static void print_args(const FLIGHT_RECORDER_RECORD *record)
+{
+    switch (record->event) {
+    case FR_EVENT_SIGNAL:
+        printf("signal %u (%s) address 0x%08x", record->arg0, strsignal((int)record->arg0),
+               record->arg1);
+        break;
+    case FR_EVENT_CONNECTION:
+        printf("%s", record->arg0 ? "connected" : "disconnected");
+        break;
+    case FR_EVENT_APP_START:
+    case FR_EVENT_CHECKPOINT:
+        break;
+    default:
+        printf("%u %u", record->arg0, record->arg1);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    FLIGHT_RECORDER_HEADER header;
+    FLIGHT_RECORDER_RECORD valid[FLIGHT_RECORDER_CAPACITY];
+    size_t validCount = 0;
+    size_t loaded;
+    FILE *file;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <debug output | mutable storage file>\n", argv[0]);
+        return 2;
+    }
+
+    file = fopen(argv[1], "rb");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // A copy of the storage file starts with the magic, debug output does not
+    loaded = fread(image, 1, sizeof(image), file);
+    memcpy(&header, image, sizeof(header));
+    if (loaded < sizeof(header) || header.magic != FLIGHT_RECORDER_MAGIC) {
+        memset(image, 0, sizeof(image));
+        rewind(file);
+        loaded = load_debug_output(file);
+        memcpy(&header, image, sizeof(header));
+    }
+    fclose(file);
+
+    if (loaded < sizeof(header) || header.magic != FLIGHT_RECORDER_MAGIC) {
+        fprintf(stderr, "%s: no flight recorder dump found\n", argv[1]);
+        return 1;
+    }
+    if (header.version != FLIGHT_RECORDER_VERSION ||
+        header.recordSize != sizeof(FLIGHT_RECORDER_RECORD) ||
+        header.capacity != FLIGHT_RECORDER_CAPACITY) {
+        fprintf(stderr, "Unsupported dump: version %u, record size %u, capacity %u\n",
+                header.version, header.recordSize, header.capacity);
+        return 1;
+    }
+    if (loaded < FLIGHT_RECORDER_FILE_BYTES) {
+        fprintf(stderr, "Warning: dump is truncated, %zu of %zu bytes\n", loaded,
+                FLIGHT_RECORDER_FILE_BYTES);
+    }
+
+    // Keep the records whose sequence matches their slot and falls inside the last lap
+    uint32_t oldest = header.recorded > FLIGHT_RECORDER_CAPACITY
+                          ? header.recorded - FLIGHT_RECORDER_CAPACITY
+                          : 0;
+    for (uint32_t slot = 0; slot < FLIGHT_RECORDER_CAPACITY; slot++) {
+        FLIGHT_RECORDER_RECORD record;
+        memcpy(&record, image + sizeof(header) + slot * sizeof(record), sizeof(record));
+
+        if (record.sequence % FLIGHT_RECORDER_CAPACITY == slot && record.sequence >= oldest &&
+            record.sequence < header.recorded && record.event != FR_EVENT_NONE) {
+            valid[validCount++] = record;
+        }
+    }
+    qsort(valid, validCount, sizeof(valid[0]), compare_sequence);
+
+    time_t flushed = (time_t)header.wallClockSeconds;
+    printf("Flushed %s", ctime(&flushed));
+    if (header.reason != 0) {
+        printf("Reason: signal %u (%s)\n", header.reason, strsignal((int)header.reason));
+    } else {
+        printf("Reason: checkpoint\n");
+    }
+    printf("Events: %u recorded, %zu in the dump\n\n", header.recorded, validCount);
+    printf("%10s %14s  %-26s %s\n", "sequence", "seconds", "event", "args");
+
+    for (size_t i = 0; i < validCount; i++) {
+        const FLIGHT_RECORDER_RECORD *record = &valid[i];
+        // Relative to the flush, negative seconds before the app stopped
+        double seconds = ((double)record->timestampNs - (double)header.flushedNs) / 1e9;
+
+        printf("%10u %14.6f  %-26s ", record->sequence, seconds,
+               record->event < FR_EVENT_COUNT ? event_names[record->event] : "?");
+        print_args(record);
+
+        if (record->event == FR_EVENT_HANDLER_EXIT) {
+            // Pair with the nearest earlier enter of the same handler for its run time
+            for (size_t j = i; j-- > 0;) {
+                if (valid[j].event == FR_EVENT_HANDLER_ENTER && valid[j].arg0 == record->arg0) {
+                    printf("  (%.1f us)", (double)(record->timestampNs - valid[j].timestampNs) / 1e3);
+                    break;
+                }
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory. The mutable
+// storage file is flight_recorder.bin in the working directory.
+
+#pragma once
+
+#include <fcntl.h>
+
+static inline int Storage_OpenMutableFile(void)
+{
+    return open("flight_recorder.bin", O_RDWR | O_CREAT, 0600);
+}
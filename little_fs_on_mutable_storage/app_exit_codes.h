@@ -16,5 +16,8 @@ typedef enum {
 	APP_ExitCode_Example = 1,
 	LITTLE_FS_FORMAT_FAIL = 2,
 	LITTLE_FS_MOUNT_FAIL = 3, 
-	LITTLE_FS_MKDIR_FAIL = 4 
+	LITTLE_FS_MKDIR_FAIL = 4,
+	APP_ExitCode_WorkerPoolInit = 5,
+	LITTLE_FS_LOG_OPEN_FAIL = 6,
+	LITTLE_FS_GROUP_COMMIT_FAIL = 7
 } App_Exit_Code;
\ No newline at end of file
@@ -0,0 +1,176 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "group_commit.h"
+
+#include "worker_pool.h"
+#include <string.h>
+
+typedef struct {
+    GROUP_COMMIT *commit;
+    int buffer;
+    bool succeeded;
+} GROUP_COMMIT_JOB;
+
+/// <summary>
+/// Worker pool job, hand the buffer to the writer
+/// </summary>
+static void commit_job(void *context)
+{
+    GROUP_COMMIT_JOB *job = (GROUP_COMMIT_JOB *)context;
+    GROUP_COMMIT *commit = job->commit;
+
+    job->succeeded = commit->config.writer(commit->buffers[job->buffer], commit->lengths[job->buffer], commit->config.context);
+}
+
+static void count_commit(GROUP_COMMIT *commit, int buffer, bool succeeded)
+{
+    uint32_t length = (uint32_t)commit->lengths[buffer];
+
+    if (succeeded) {
+        commit->stats.syncs++;
+        commit->stats.syncedBytes += length;
+        if (length > commit->stats.maxSyncBytes) {
+            commit->stats.maxSyncBytes = length;
+        }
+    } else {
+        commit->stats.failed++;
+    }
+    commit->lengths[buffer] = 0;
+    commit->submitted[buffer] = false;
+}
+
+static bool submit(GROUP_COMMIT *commit);
+
+/// <summary>
+/// Worker pool completion, runs on the event loop thread
+/// </summary>
+static void commit_job_complete(void *context, bool cancelled)
+{
+    GROUP_COMMIT_JOB *job = (GROUP_COMMIT_JOB *)context;
+    GROUP_COMMIT *commit = job->commit;
+
+    // Left submitted, group_commit_close() writes it
+    if (cancelled) {
+        return;
+    }
+
+    count_commit(commit, job->buffer, job->succeeded);
+
+    if ((commit->commitDue || commit->config.syncBytes == 0) && commit->lengths[commit->filling] > 0) {
+        submit(commit);
+    }
+}
+
+// Submit the filling buffer and start filling the other one
+static bool submit(GROUP_COMMIT *commit)
+{
+    int buffer = commit->filling;
+    GROUP_COMMIT_JOB job = {.commit = commit, .buffer = buffer};
+
+    if (commit->submitted[buffer] || commit->lengths[buffer] == 0) {
+        return false;
+    }
+
+    commit->submitted[buffer] = true;
+    commit->sequence[buffer] = commit->nextSequence++;
+    if (!worker_pool_submit(commit_job, commit_job_complete, &job, sizeof(job))) {
+        commit->submitted[buffer] = false;
+        commit->commitDue = true;
+        return false;
+    }
+
+    commit->filling ^= 1;
+    commit->commitDue = false;
+    return true;
+}
+
+// For the size and interval policies, wait for the commit in flight
+static void request_commit(GROUP_COMMIT *commit)
+{
+    if (commit->submitted[commit->filling ^ 1]) {
+        commit->commitDue = true;
+        return;
+    }
+    submit(commit);
+}
+
+bool group_commit_init(GROUP_COMMIT *commit, const GROUP_COMMIT_CONFIG *config)
+{
+    memset(commit, 0, sizeof(*commit));
+
+    if (config->writer == NULL || config->syncBytes > GROUP_COMMIT_BUFFER_BYTES || worker_pool_thread_count() != 1) {
+        return false;
+    }
+    commit->config = *config;
+    return true;
+}
+
+bool group_commit_write(GROUP_COMMIT *commit, const void *data, size_t length)
+{
+    // Retry a commit the worker pool refused, unless it is waiting for the one in flight
+    if (commit->commitDue && !commit->submitted[commit->filling ^ 1]) {
+        submit(commit);
+    }
+
+    int buffer = commit->filling;
+
+    // Full, move on to the other buffer if it is free
+    if (!commit->submitted[buffer] && commit->lengths[buffer] + length > GROUP_COMMIT_BUFFER_BYTES && !commit->submitted[buffer ^ 1]) {
+        submit(commit);
+        buffer = commit->filling;
+    }
+
+    if (commit->submitted[buffer] || commit->lengths[buffer] + length > GROUP_COMMIT_BUFFER_BYTES) {
+        commit->stats.dropped++;
+        return false;
+    }
+
+    memcpy(commit->buffers[buffer] + commit->lengths[buffer], data, length);
+    commit->lengths[buffer] += length;
+    commit->stats.writes++;
+
+    if (commit->lengths[buffer] >= commit->config.syncBytes) {
+        request_commit(commit);
+    }
+    return true;
+}
+
+void group_commit_barrier(GROUP_COMMIT *commit)
+{
+    submit(commit);
+}
+
+void group_commit_tick(GROUP_COMMIT *commit)
+{
+    if (commit->lengths[commit->filling] > 0) {
+        request_commit(commit);
+    }
+}
+
+void group_commit_close(GROUP_COMMIT *commit)
+{
+    int order[2];
+    int count = 0;
+
+    // Cancelled commits in the order they were submitted, then what was never submitted
+    for (int buffer = 0; buffer < 2; buffer++) {
+        if (commit->submitted[buffer]) {
+            order[count++] = buffer;
+        }
+    }
+    if (count == 2 && (int32_t)(commit->sequence[1] - commit->sequence[0]) < 0) {
+        order[0] = 1;
+        order[1] = 0;
+    }
+    if (count < 2 && !commit->submitted[commit->filling]) {
+        order[count++] = commit->filling;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int buffer = order[i];
+        if (commit->lengths[buffer] > 0) {
+            count_commit(commit, buffer, commit->config.writer(commit->buffers[buffer], commit->lengths[buffer], commit->config.context));
+        }
+    }
+}
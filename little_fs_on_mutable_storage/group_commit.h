@@ -0,0 +1,88 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Batches small writes from the event loop and commits them to littlefs on the worker pool, so
+// a record costs a share of one sync instead of a sync of its own. Writes go into one of two
+// buffers while the other is being committed. When to commit is the durability policy:
+//
+//   - every syncBytes bytes, 0 to commit whenever the worker is free (classic group commit,
+//     writes that arrive during a sync share the next one)
+//   - every T ms, by calling group_commit_tick() from a DevX timer with period T
+//   - on demand, group_commit_barrier() commits everything written so far
+//
+// The size and interval policies wait for the commit in flight, a barrier does not. A write
+// that finds no buffer with room is refused and counted as dropped. A commit the worker pool
+// refuses because it is full is retried by the next write or tick.
+//
+// Commits rely on the worker pool having a single worker: a barrier's commit can be queued
+// behind the one in flight, and only one worker keeps them in order and off littlefs at the
+// same time, as it is not thread safe. group_commit_init() fails otherwise.
+
+#define GROUP_COMMIT_BUFFER_BYTES 1024
+
+/// <summary>
+/// Runs on the worker thread, write length bytes and sync them.
+/// </summary>
+typedef bool (*GROUP_COMMIT_WRITER)(const uint8_t *data, size_t length, void *context);
+
+typedef struct {
+    GROUP_COMMIT_WRITER writer;
+    void *context;       // Passed to the writer
+    uint32_t syncBytes;  // Commit once this many bytes are buffered, GROUP_COMMIT_BUFFER_BYTES to
+                         // leave it to a full buffer, the tick and barriers
+} GROUP_COMMIT_CONFIG;
+
+typedef struct {
+    uint32_t writes;
+    uint32_t dropped;     // Refused, both buffers busy
+    uint32_t syncs;       // Commits completed
+    uint32_t failed;      // Commits the writer failed
+    uint64_t syncedBytes;
+    uint32_t maxSyncBytes;
+} GROUP_COMMIT_STATS;
+
+typedef struct {
+    GROUP_COMMIT_CONFIG config;
+    uint8_t buffers[2][GROUP_COMMIT_BUFFER_BYTES];
+    size_t lengths[2];
+    bool submitted[2];   // Until the commit completes, or for good if it was cancelled
+    uint32_t sequence[2]; // Submission order
+    uint32_t nextSequence;
+    int filling;         // Buffer taking writes, unless it is still submitted
+    bool commitDue;      // Requested while a commit was in flight
+    GROUP_COMMIT_STATS stats;
+} GROUP_COMMIT;
+
+/// <summary>
+/// Call after worker_pool_init(1).
+/// </summary>
+/// <returns>false if the config is invalid or the worker pool does not have exactly one worker</returns>
+bool group_commit_init(GROUP_COMMIT *commit, const GROUP_COMMIT_CONFIG *config);
+
+/// <summary>
+/// Buffer a write, commits it if the buffer reaches syncBytes. Call from the event loop thread.
+/// </summary>
+/// <returns>false if the write does not fit</returns>
+bool group_commit_write(GROUP_COMMIT *commit, const void *data, size_t length);
+
+/// <summary>
+/// Commit everything written so far. Jobs submitted to the worker pool afterwards run after
+/// the commit.
+/// </summary>
+void group_commit_barrier(GROUP_COMMIT *commit);
+
+/// <summary>
+/// Commit whatever is buffered, for the interval policy.
+/// </summary>
+void group_commit_tick(GROUP_COMMIT *commit);
+
+/// <summary>
+/// Write out what is left on the calling thread, call after worker_pool_close().
+/// </summary>
+void group_commit_close(GROUP_COMMIT *commit);
@@ -34,8 +34,13 @@
 #include "main.h"
 
 
-static void write_little_fs(void)
+/// <summary>
+/// Worker pool job, runs on the worker thread so the writes and sync don't stall the event loop
+/// </summary>
+static void write_little_fs(void *context)
 {
+    LITTLE_FS_JOB *job = (LITTLE_FS_JOB *)context;
+
     // Create a file
     Log_Debug("Create File /data/lorem.txt\n");
     if (lfs_file_open(&lfs, &datafile, "/data/lorem.txt", LFS_O_RDWR | LFS_O_CREAT) != LFS_ERR_OK) {
@@ -50,17 +55,22 @@ static void write_little_fs(void)
         if (lfs_file_write(&lfs, &datafile, writeMessage, dataLength) != dataLength) {
             break;
         }
+        job->bytes += dataLength;
     }    
 
-    lfs_file_sync(&lfs, &datafile);
+    job->succeeded = lfs_file_sync(&lfs, &datafile) == LFS_ERR_OK;
 
     // Close the file
     Log_Debug("Close file\n");
     lfs_file_close(&lfs, &datafile);
 }
 
-static void read_little_fs(void) {
+/// <summary>
+/// Worker pool job, littlefs is not thread safe so reads go through the same single worker
+/// </summary>
+static void read_little_fs(void *context) {
 
+    LITTLE_FS_JOB *job = (LITTLE_FS_JOB *)context;
     size_t dataLength = strlen(writeMessage);
 
     if (lfs_file_open(&lfs, &datafile, "/data/lorem.txt", LFS_O_RDWR) != LFS_ERR_OK) {
@@ -74,14 +84,169 @@ static void read_little_fs(void) {
         memset(buffer, 0x00, dataLength + 1);
         if (lfs_file_read(&lfs, &datafile, buffer, dataLength) == dataLength) {
             Log_Debug("Read data: %s\n", buffer);
+            job->bytes += dataLength;
         }
     }
 
     // Close the file
     Log_Debug("Close file\n");
-    lfs_file_close(&lfs, &datafile) == LFS_ERR_OK;
+    job->succeeded = lfs_file_close(&lfs, &datafile) == LFS_ERR_OK;
+}
+
+/// <summary>
+/// Worker pool completion, runs on the event loop thread
+/// </summary>
+static void little_fs_job_complete(void *context, bool cancelled)
+{
+    LITTLE_FS_JOB *job = (LITTLE_FS_JOB *)context;
+
+    if (cancelled) {
+        Log_Debug("File %s cancelled\n", job->operation);
+    } else {
+        Log_Debug("File %s %s, %zu bytes\n", job->operation, job->succeeded ? "complete" : "failed",
+                  job->bytes);
+    }
+}
+
+// Only used on the worker thread
+static uint32_t memorySamplesRejected;
+
+/// <summary>
+/// Group commit writer, runs on the worker thread. Append a group of memory samples to the log
+/// and commit them with one sync. A sample the log refuses is counted and the rest still go in.
+/// </summary>
+static bool write_memory_samples(const uint8_t *data, size_t length, void *context)
+{
+    for (size_t offset = 0; offset + sizeof(MEMORY_SAMPLE) <= length; offset += sizeof(MEMORY_SAMPLE)) {
+        MEMORY_SAMPLE sample;
+        memcpy(&sample, data + offset, sizeof(sample));
+        if (!ts_log_append(&memoryLog, sample.time, &sample.memoryKB)) {
+            memorySamplesRejected++;
+        }
+    }
+    return ts_log_sync(&memoryLog);
+}
+
+static bool add_memory_sample(uint64_t time, const void *payload, size_t length, void *context)
+{
+    MEMORY_LOG_JOB *job = (MEMORY_LOG_JOB *)context;
+    uint32_t memoryKB;
+
+    memcpy(&memoryKB, payload, sizeof(memoryKB));
+    if (job->records == 0 || memoryKB < job->minKB) {
+        job->minKB = memoryKB;
+    }
+    if (job->records == 0 || memoryKB > job->maxKB) {
+        job->maxKB = memoryKB;
+    }
+    job->sumKB += memoryKB;
+    job->records++;
+    return true;
 }
 
+/// <summary>
+/// Worker pool job, read back the samples of the last report period from the log
+/// </summary>
+static void query_memory_log(void *context)
+{
+    MEMORY_LOG_JOB *job = (MEMORY_LOG_JOB *)context;
+    uint64_t periodMs = MEMORY_REPORT_PERIOD_SECONDS * 1000ULL;
+    uint64_t firstTime = job->time > periodMs ? job->time - periodMs : 0;
+
+    job->succeeded = ts_log_query(&memoryLog, firstTime, job->time, add_memory_sample, job) >= 0;
+    job->rejected = memorySamplesRejected;
+}
+
+/// <summary>
+/// Worker pool completion for the memory log query, runs on the event loop thread
+/// </summary>
+static void memory_log_job_complete(void *context, bool cancelled)
+{
+    MEMORY_LOG_JOB *job = (MEMORY_LOG_JOB *)context;
+
+    if (cancelled) {
+        return;
+    }
+    if (!job->succeeded) {
+        Log_Debug("Memory log query failed\n");
+    } else if (job->records > 0) {
+        Log_Debug("Memory over the last %d seconds: %d samples, min %u KB, max %u KB, avg %u KB\n", MEMORY_REPORT_PERIOD_SECONDS, job->records, job->minKB,
+                  job->maxKB, (uint32_t)(job->sumKB / (uint64_t)job->records));
+    }
+
+    const GROUP_COMMIT_STATS *stats = &memoryCommit.stats;
+    if (stats->syncs > 0) {
+        Log_Debug("Memory log: %u syncs, %u bytes per sync on average, %u at most, %u failed, %u samples dropped, %u refused by the log\n",
+                  stats->syncs, (uint32_t)(stats->syncedBytes / stats->syncs), stats->maxSyncBytes, stats->failed, stats->dropped, job->rejected);
+    }
+}
+
+// The memory log's clock: wall clock time at startup carried on by the monotonic clock, so a
+// time sync while running cannot take it backwards and have ts_log refuse samples. If the wall
+// clock is behind the last sample logged, e.g. before the first sync, it carries on from there.
+static uint64_t logClockBaseMs;
+
+static uint64_t clock_ms(clockid_t clock)
+{
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static void start_log_clock(void)
+{
+    uint64_t startMs = clock_ms(CLOCK_REALTIME);
+
+    if (startMs < ts_log_last_time(&memoryLog)) {
+        startMs = ts_log_last_time(&memoryLog);
+    }
+    logClockBaseMs = startMs - clock_ms(CLOCK_MONOTONIC);
+}
+
+static uint64_t now_ms(void)
+{
+    return logClockBaseMs + clock_ms(CLOCK_MONOTONIC);
+}
+
+/// <summary>
+/// Memory sample timer event: log the application's memory use, it is committed with the next group
+/// </summary>
+static DX_TIMER_HANDLER(MemorySampleHandler)
+{
+    MEMORY_SAMPLE sample = {.time = now_ms(), .memoryKB = (uint32_t)Applications_GetTotalMemoryUsageInKB()};
+
+    if (!group_commit_write(&memoryCommit, &sample, sizeof(sample))) {
+        Log_Debug("Memory log busy, sample dropped\n");
+    }
+}
+DX_TIMER_HANDLER_END
+
+/// <summary>
+/// Memory commit timer event: commit the samples taken since the last group
+/// </summary>
+static DX_TIMER_HANDLER(MemoryCommitHandler)
+{
+    group_commit_tick(&memoryCommit);
+}
+DX_TIMER_HANDLER_END
+
+/// <summary>
+/// Memory report timer event: summarize the samples logged since the last report
+/// </summary>
+static DX_TIMER_HANDLER(MemoryReportHandler)
+{
+    MEMORY_LOG_JOB job = {.time = now_ms()};
+
+    // The query runs after the commit, so it sees every sample taken so far
+    group_commit_barrier(&memoryCommit);
+
+    if (!worker_pool_submit(query_memory_log, memory_log_job_complete, &job, sizeof(job))) {
+        Log_Debug("File system busy, memory report skipped\n");
+    }
+}
+DX_TIMER_HANDLER_END
+
 /// <summary>
 /// Handler to check for Button Presses
 /// </summary>
@@ -92,10 +257,12 @@ static DX_TIMER_HANDLER(ButtonPressCheckHandler)
 
     if (dx_gpioStateGet(&button_a, &button_a_state)) {
 
-        if (operation_select) {
-            write_little_fs();
-        } else {
-            read_little_fs();
+        LITTLE_FS_JOB job = {.operation = operation_select ? "write" : "read"};
+
+        if (!worker_pool_submit(operation_select ? write_little_fs : read_little_fs,
+                                little_fs_job_complete, &job, sizeof(job))) {
+            Log_Debug("File system busy, %s not queued\n", job.operation);
+            return;
         }
 
         operation_select = !operation_select;
@@ -135,6 +302,21 @@ static void InitPeripheralsAndHandlers(void)
 
     mutableStorageFd = Storage_OpenMutableFile();
     init_little_fs();
+
+    if (!ts_log_open(&memoryLog, &lfs, &memoryLogConfig)) {
+        dx_terminate(LITTLE_FS_LOG_OPEN_FAIL);
+    }
+    start_log_clock();
+
+    // One worker, file operations run in the order the button presses queued them. littlefs is
+    // not thread safe and group_commit relies on it too.
+    if (!worker_pool_init(1)) {
+        dx_terminate(APP_ExitCode_WorkerPoolInit);
+    }
+
+    if (!group_commit_init(&memoryCommit, &(GROUP_COMMIT_CONFIG){.writer = write_memory_samples, .syncBytes = GROUP_COMMIT_BUFFER_BYTES})) {
+        dx_terminate(LITTLE_FS_GROUP_COMMIT_FAIL);
+    }
 }
 
 /// <summary>
@@ -143,6 +325,11 @@ static void InitPeripheralsAndHandlers(void)
 static void ClosePeripheralsAndHandlers(void)
 {
     dx_timerSetStop(timer_bindings, NELEMS(timer_bindings));
+    worker_pool_close();
+
+    // The worker has stopped, so the samples not yet committed are written from here
+    group_commit_close(&memoryCommit);
+    ts_log_close(&memoryLog);
     dx_gpioSetClose(gpio_bindings, NELEMS(gpio_bindings));
     dx_timerEventLoopStop();
 }
@@ -11,11 +11,40 @@
 #include <applibs/storage.h>
 
 #include "littlefs_mgr.h"
+#include "group_commit.h"
+#include "ts_log.h"
+#include "worker_pool.h"
+#include <applibs/applications.h>
+#include <time.h>
 
 char writeMessage[] = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua\r\n";
 
+typedef struct {
+    const char *operation;
+    bool succeeded;
+    size_t bytes;
+} LITTLE_FS_JOB;
+
+typedef struct {
+    uint64_t time; // Milliseconds since the epoch
+    uint32_t memoryKB;
+} MEMORY_SAMPLE;
+
+typedef struct {
+    uint64_t time; // End of the report period
+    bool succeeded;
+    int records;
+    uint32_t minKB;
+    uint32_t maxKB;
+    uint64_t sumKB;
+    uint32_t rejected; // Samples ts_log_append() refused since startup
+} MEMORY_LOG_JOB;
+
 // Forward declarations
 static DX_DECLARE_TIMER_HANDLER(ButtonPressCheckHandler);
+static DX_DECLARE_TIMER_HANDLER(MemorySampleHandler);
+static DX_DECLARE_TIMER_HANDLER(MemoryReportHandler);
+static DX_DECLARE_TIMER_HANDLER(MemoryCommitHandler);
 
 // The Project is configured for 64K of Mutable Storage (256 blocks * 256 block size)
 #define BLOCK_SIZE 256
@@ -38,6 +67,20 @@ const struct lfs_config g_littlefs_config = {.read = storage_read,
                                              .lookahead_size = BLOCK_SIZE,
                                              .name_max = 255};
 
+// The application's memory use is sampled into a time-series log, 8 segments of 64 samples keep
+// the last 85 minutes in about 8 KB
+#define MEMORY_SAMPLE_PERIOD_SECONDS 10
+#define MEMORY_REPORT_PERIOD_SECONDS 60
+
+// Samples are committed in groups, every MEMORY_COMMIT_PERIOD_SECONDS and before each report, so
+// at most the last 30 seconds of samples are lost on a power cut
+#define MEMORY_COMMIT_PERIOD_SECONDS 30
+
+TS_LOG memoryLog;
+GROUP_COMMIT memoryCommit;
+
+static const TS_LOG_CONFIG memoryLogConfig = {.directory = "/data/memory", .recordBytes = sizeof(uint32_t), .segmentRecords = 64, .maxSegments = 8};
+
 /****************************************************************************************
  * GPIO Peripherals
  ****************************************************************************************/
@@ -50,6 +93,9 @@ DX_GPIO_BINDING *gpio_bindings[] = {&button_a};
  * Timer Bindings
  ****************************************************************************************/
 static DX_TIMER_BINDING buttonPressCheckTimer = {.period = {0, 1 * ONE_MS}, .name = "buttonPressCheckTimer", .handler = ButtonPressCheckHandler};
+static DX_TIMER_BINDING memorySampleTimer = {.period = {MEMORY_SAMPLE_PERIOD_SECONDS, 0}, .name = "memorySampleTimer", .handler = MemorySampleHandler};
+static DX_TIMER_BINDING memoryReportTimer = {.period = {MEMORY_REPORT_PERIOD_SECONDS, 0}, .name = "memoryReportTimer", .handler = MemoryReportHandler};
+static DX_TIMER_BINDING memoryCommitTimer = {.period = {MEMORY_COMMIT_PERIOD_SECONDS, 0}, .name = "memoryCommitTimer", .handler = MemoryCommitHandler};
 
 // All timers referenced in timers with be opened in the InitPeripheralsAndHandlers function
-DX_TIMER_BINDING *timer_bindings[] = {&buttonPressCheckTimer};
\ No newline at end of file
+DX_TIMER_BINDING *timer_bindings[] = {&buttonPressCheckTimer, &memorySampleTimer, &memoryReportTimer, &memoryCommitTimer};
\ No newline at end of file
@@ -0,0 +1,268 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host benchmark for group_commit.c with the real worker pool and ts_log.c, on the littlefs
+   stand-in in host/. Records are the example's 16-byte memory samples.
+
+   The burst runs write 20000 records as fast as the event loop can, with an fdatasync() per
+   sync, and compare a sync per record on the event loop with group commit at several
+   syncBytes. They report records per second, bytes per sync, the flash programmed and erased
+   per record and the longest time a write held up the event loop.
+
+   The paced runs write one record per second of simulated time for 10 hours and report the
+   syncs, flash cost and the most records written but not yet synced for each policy.
+
+   Build: gcc -O2 -I host -I .. -o group_commit_bench group_commit_bench.c ../group_commit.c
+              ../worker_pool.c ../ts_log.c host/lfs_host.c -lpthread
+   Usage: group_commit_bench <empty directory on the device to measure>
+*/
+
+#include "group_commit.h"
+#include "ts_log.h"
+#include "worker_pool.h"
+
+#include "dx_timer.h"
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define BURST_RECORDS 20000
+#define PACED_RECORDS 36000
+
+typedef struct {
+    uint64_t time;
+    uint32_t memoryKB;
+} MEMORY_SAMPLE;
+
+static lfs_t lfs;
+static TS_LOG memoryLog;
+static const char *rootDirectory;
+static int runs;
+static atomic_uint synced; // Records synced, counted on the worker thread
+
+static int completionFd = -1;
+static EventLoopIoCallback *completionCallback;
+
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return (EventLoop *)&completionFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    completionFd = fd;
+    completionCallback = callback;
+    return (EventRegistration *)&completionFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    completionFd = -1;
+    return 0;
+}
+
+// One turn of the event loop, run the worker pool's completions if there are any
+static void Pump(int timeoutMs)
+{
+    struct pollfd fd = {.fd = completionFd, .events = POLLIN};
+
+    if (poll(&fd, 1, timeoutMs) > 0) {
+        completionCallback(NULL, completionFd, EventLoop_Input, NULL);
+    }
+}
+
+static void WaitForCommits(GROUP_COMMIT *commit)
+{
+    while (commit->submitted[0] || commit->submitted[1]) {
+        Pump(100);
+    }
+}
+
+static double NowUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e6 + (double)now.tv_nsec / 1e3;
+}
+
+static bool WriteSamples(const uint8_t *data, size_t length, void *context)
+{
+    (void)context;
+    for (size_t offset = 0; offset + sizeof(MEMORY_SAMPLE) <= length; offset += sizeof(MEMORY_SAMPLE)) {
+        MEMORY_SAMPLE sample;
+        memcpy(&sample, data + offset, sizeof(sample));
+        ts_log_append(&memoryLog, sample.time, &sample.memoryKB);
+    }
+    if (!ts_log_sync(&memoryLog)) {
+        return false;
+    }
+    synced += (unsigned)(length / sizeof(MEMORY_SAMPLE));
+    return true;
+}
+
+// A new, empty file system and log for each run, with the example's layout
+static void Open(bool fsync)
+{
+    char path[LFS_HOST_PATH_BYTES];
+    TS_LOG_CONFIG config = {.directory = "/data/memory", .recordBytes = 4, .segmentRecords = 64, .maxSegments = 8};
+
+    snprintf(path, sizeof(path), "%s/run%d", rootDirectory, runs++);
+    mkdir(path, 0755);
+    lfs_host_mount(&lfs, path);
+    lfs.fsync = fsync;
+    lfs_mkdir(&lfs, "/data");
+    if (!ts_log_open(&memoryLog, &lfs, &config)) {
+        printf("ts_log_open failed\n");
+        exit(1);
+    }
+    lfs_host_reset_counters(&lfs);
+    synced = 0;
+}
+
+static void StartGroupCommit(GROUP_COMMIT *commit, uint32_t syncBytes)
+{
+    if (!worker_pool_init(1) ||
+        !group_commit_init(commit, &(GROUP_COMMIT_CONFIG){.writer = WriteSamples, .syncBytes = syncBytes})) {
+        printf("init failed\n");
+        exit(1);
+    }
+}
+
+static void PrintBurst(const char *name, double elapsedUs, uint32_t syncs, uint64_t syncedBytes, double maxStallUs,
+                       uint32_t refused)
+{
+    printf("%-24s %7.0f rec/s  syncs %5u  %6.1f B/sync  prog %6.1f B/rec  erase %5.3f/rec  stall max %7.1f us  "
+           "refused %u\n",
+           name, BURST_RECORDS / elapsedUs * 1e6, syncs, (double)syncedBytes / syncs,
+           (double)lfs.counters.progBytes / BURST_RECORDS, (double)lfs.counters.erases / BURST_RECORDS, maxStallUs,
+           refused);
+}
+
+// A sync per record on the event loop thread, as the example did before group commit
+static void BurstDirect(void)
+{
+    double maxStallUs = 0;
+
+    Open(true);
+    double start = NowUs();
+    for (int i = 0; i < BURST_RECORDS; i++) {
+        MEMORY_SAMPLE sample = {.time = (uint64_t)i * 100, .memoryKB = (uint32_t)i};
+        double writeStart = NowUs();
+
+        ts_log_append(&memoryLog, sample.time, &sample.memoryKB);
+        ts_log_sync(&memoryLog);
+        if (NowUs() - writeStart > maxStallUs) {
+            maxStallUs = NowUs() - writeStart;
+        }
+    }
+    PrintBurst("sync each, event loop", NowUs() - start, memoryLog.stats.syncs, BURST_RECORDS * sizeof(MEMORY_SAMPLE),
+               maxStallUs, 0);
+    ts_log_close(&memoryLog);
+}
+
+static void BurstGroup(uint32_t syncBytes)
+{
+    GROUP_COMMIT commit;
+    double maxStallUs = 0;
+    char name[64];
+
+    Open(true);
+    StartGroupCommit(&commit, syncBytes);
+    double start = NowUs();
+    for (int i = 0; i < BURST_RECORDS; i++) {
+        MEMORY_SAMPLE sample = {.time = (uint64_t)i * 100, .memoryKB = (uint32_t)i};
+
+        // A refused write waits for the event loop and is written again, nothing is lost
+        for (;;) {
+            double writeStart = NowUs();
+            bool written = group_commit_write(&commit, &sample, sizeof(sample));
+
+            if (NowUs() - writeStart > maxStallUs) {
+                maxStallUs = NowUs() - writeStart;
+            }
+            if (written) {
+                break;
+            }
+            Pump(100);
+        }
+        Pump(0);
+    }
+    group_commit_barrier(&commit);
+    WaitForCommits(&commit);
+    double elapsedUs = NowUs() - start;
+    worker_pool_close();
+
+    snprintf(name, sizeof(name), "group, syncBytes %u", syncBytes);
+    PrintBurst(name, elapsedUs, commit.stats.syncs, commit.stats.syncedBytes, maxStallUs, commit.stats.dropped);
+    ts_log_close(&memoryLog);
+}
+
+// One record per second of simulated time, a tick every tickSeconds and a barrier every
+// barrierRecords when they are not 0
+static void Paced(const char *name, uint32_t syncBytes, int tickSeconds, int barrierRecords)
+{
+    GROUP_COMMIT commit;
+    unsigned maxAtRisk = 0;
+
+    Open(false);
+    StartGroupCommit(&commit, syncBytes);
+    for (int i = 0; i < PACED_RECORDS; i++) {
+        MEMORY_SAMPLE sample = {.time = (uint64_t)i * 1000, .memoryKB = (uint32_t)i};
+
+        group_commit_write(&commit, &sample, sizeof(sample));
+        if (barrierRecords != 0 && (i + 1) % barrierRecords == 0) {
+            group_commit_barrier(&commit);
+        }
+        if (tickSeconds != 0 && (i + 1) % tickSeconds == 0) {
+            group_commit_tick(&commit);
+        }
+        WaitForCommits(&commit);
+
+        unsigned atRisk = (unsigned)(i + 1) - synced;
+        if (atRisk > maxAtRisk) {
+            maxAtRisk = atRisk;
+        }
+    }
+    worker_pool_close();
+
+    printf("%-24s syncs %5u  %6.1f B/sync  prog %6.1f B/rec  erase %5.3f/rec  at risk max %3u rec (%u s)\n", name,
+           commit.stats.syncs, (double)commit.stats.syncedBytes / commit.stats.syncs,
+           (double)lfs.counters.progBytes / PACED_RECORDS, (double)lfs.counters.erases / PACED_RECORDS, maxAtRisk,
+           maxAtRisk);
+    ts_log_close(&memoryLog);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: group_commit_bench <empty directory on the device to measure>\n");
+        return 1;
+    }
+    rootDirectory = argv[1];
+
+    printf("-- burst, %d records, fdatasync per sync\n", BURST_RECORDS);
+    BurstDirect();
+    BurstGroup(0);
+    BurstGroup(256);
+    BurstGroup(1024);
+
+    printf("-- paced, 1 record/s for 10 hours\n");
+    Paced("syncBytes 16 (each)", 16, 0, 0);
+    Paced("syncBytes 256", 256, 0, 0);
+    Paced("syncBytes 1024", 1024, 0, 0);
+    Paced("tick 10 s", 1024, 10, 0);
+    Paced("tick 30 s", 1024, 30, 0);
+    Paced("tick 60 s", 1024, 60, 0);
+    Paced("barrier every 10", 1024, 0, 10);
+    return 0;
+}
@@ -0,0 +1,249 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host checks for group_commit.c with the real worker pool and ts_log.c, on the littlefs
+   stand-in in host/: the single worker requirement, commits the worker pool refuses, and
+   commits still queued at shutdown.
+
+   Build: gcc -O1 -g -fsanitize=address,undefined -I host -I .. -o group_commit_check
+              group_commit_check.c ../group_commit.c ../worker_pool.c ../ts_log.c host/lfs_host.c
+              -lpthread
+   Usage: group_commit_check <empty directory>
+*/
+
+#include "group_commit.h"
+#include "ts_log.h"
+#include "worker_pool.h"
+
+#include "dx_timer.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECK(condition, ...)                          \
+    do {                                               \
+        bool passed = (condition);                     \
+        printf("%s: ", passed ? "ok  " : "FAIL");      \
+        printf(__VA_ARGS__);                           \
+        printf("\n");                                  \
+        failures += !passed;                           \
+    } while (0)
+
+typedef struct {
+    uint64_t time;
+    uint32_t memoryKB;
+} MEMORY_SAMPLE;
+
+typedef struct {
+    int records;
+    uint64_t lastTime;
+    bool ordered;
+} QUERY_RESULT;
+
+static lfs_t lfs;
+static TS_LOG memoryLog;
+static const char *rootDirectory;
+static int runs;
+static int failures;
+
+static int completionFd = -1;
+static EventLoopIoCallback *completionCallback;
+
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return (EventLoop *)&completionFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    completionFd = fd;
+    completionCallback = callback;
+    return (EventRegistration *)&completionFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    completionFd = -1;
+    return 0;
+}
+
+// One turn of the event loop, run the worker pool's completions if there are any
+static void Pump(int timeoutMs)
+{
+    struct pollfd fd = {.fd = completionFd, .events = POLLIN};
+
+    if (poll(&fd, 1, timeoutMs) > 0) {
+        completionCallback(NULL, completionFd, EventLoop_Input, NULL);
+    }
+}
+
+static void WaitForCommits(GROUP_COMMIT *commit)
+{
+    while (commit->submitted[0] || commit->submitted[1]) {
+        Pump(100);
+    }
+}
+
+static bool WriteSamples(const uint8_t *data, size_t length, void *context)
+{
+    (void)context;
+    for (size_t offset = 0; offset + sizeof(MEMORY_SAMPLE) <= length; offset += sizeof(MEMORY_SAMPLE)) {
+        MEMORY_SAMPLE sample;
+        memcpy(&sample, data + offset, sizeof(sample));
+        ts_log_append(&memoryLog, sample.time, &sample.memoryKB);
+    }
+    return ts_log_sync(&memoryLog);
+}
+
+static bool Write(GROUP_COMMIT *commit, uint64_t time)
+{
+    MEMORY_SAMPLE sample = {.time = time, .memoryKB = (uint32_t)time};
+    return group_commit_write(commit, &sample, sizeof(sample));
+}
+
+static void NoJob(void *context)
+{
+    (void)context;
+}
+
+// A new, empty file system and log for each check
+static void Open(void)
+{
+    char path[LFS_HOST_PATH_BYTES];
+    TS_LOG_CONFIG config = {.directory = "/data/memory", .recordBytes = 4, .segmentRecords = 64, .maxSegments = 8};
+
+    snprintf(path, sizeof(path), "%s/run%d", rootDirectory, runs++);
+    mkdir(path, 0755);
+    lfs_host_mount(&lfs, path);
+    lfs_mkdir(&lfs, "/data");
+    ts_log_open(&memoryLog, &lfs, &config);
+}
+
+static bool Visit(uint64_t time, const void *payload, size_t length, void *context)
+{
+    QUERY_RESULT *result = (QUERY_RESULT *)context;
+
+    (void)payload;
+    (void)length;
+    if (result->records > 0 && time <= result->lastTime) {
+        result->ordered = false;
+    }
+    result->lastTime = time;
+    result->records++;
+    return true;
+}
+
+static QUERY_RESULT QueryAll(void)
+{
+    QUERY_RESULT result = {.ordered = true};
+
+    ts_log_query(&memoryLog, 0, UINT64_MAX, Visit, &result);
+    return result;
+}
+
+static void CheckSingleWorker(void)
+{
+    GROUP_COMMIT commit;
+    GROUP_COMMIT_CONFIG config = {.writer = WriteSamples, .syncBytes = 256};
+
+    CHECK(!group_commit_init(&commit, &config), "group_commit_init() fails before the worker pool is running");
+
+    worker_pool_init(2);
+    CHECK(!group_commit_init(&commit, &config), "group_commit_init() fails with two workers");
+    worker_pool_close();
+
+    worker_pool_init(1);
+    CHECK(group_commit_init(&commit, &config), "group_commit_init() succeeds with one worker");
+    worker_pool_close();
+}
+
+// Fill the worker pool with finished jobs whose completions have not run yet
+static void FillWorkerPool(void)
+{
+    while (worker_pool_submit(NoJob, NULL, NULL, 0)) {
+    }
+    usleep(20000);
+}
+
+static void CheckRefusedCommit(void)
+{
+    GROUP_COMMIT commit;
+
+    Open();
+    worker_pool_init(1);
+    group_commit_init(&commit, &(GROUP_COMMIT_CONFIG){.writer = WriteSamples, .syncBytes = 1024});
+
+    FillWorkerPool();
+    Write(&commit, 1);
+    group_commit_barrier(&commit);
+    CHECK(!commit.submitted[0] && !commit.submitted[1] && commit.commitDue, "a barrier the worker pool refuses is left due");
+
+    Pump(100);
+    Write(&commit, 2);
+    CHECK(commit.submitted[0] || commit.submitted[1], "the next write submits the refused commit");
+    WaitForCommits(&commit);
+    CHECK(commit.stats.syncs == 1 && QueryAll().records == 1, "the refused commit is synced");
+
+    FillWorkerPool();
+    group_commit_barrier(&commit);
+    Pump(100);
+    group_commit_tick(&commit);
+    CHECK(commit.submitted[0] || commit.submitted[1], "the next tick submits the refused commit");
+    WaitForCommits(&commit);
+    CHECK(commit.stats.syncs == 2 && QueryAll().records == 2, "both records are synced");
+
+    worker_pool_close();
+    ts_log_close(&memoryLog);
+}
+
+static void CheckClose(void)
+{
+    GROUP_COMMIT commit;
+    int accepted = 0;
+    uint64_t time = 0;
+
+    Open();
+    worker_pool_init(1);
+    group_commit_init(&commit, &(GROUP_COMMIT_CONFIG){.writer = WriteSamples, .syncBytes = 1024});
+
+    // Two commits queued and a third refused, none of their completions run
+    for (int barrier = 0; barrier < 3; barrier++) {
+        for (int i = 0; i < 40; i++) {
+            accepted += Write(&commit, time++);
+        }
+        group_commit_barrier(&commit);
+    }
+    CHECK(accepted == 80 && commit.stats.dropped == 40, "writes are refused while both buffers are submitted");
+
+    worker_pool_close();
+    group_commit_close(&commit);
+    QUERY_RESULT result = QueryAll();
+    CHECK(result.records == 80 && result.ordered && commit.stats.failed == 0,
+          "group_commit_close() writes the queued commits in order");
+    ts_log_close(&memoryLog);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: group_commit_check <empty directory>\n");
+        return 1;
+    }
+    rootDirectory = argv[1];
+
+    CheckSingleWorker();
+    CheckRefusedCommit();
+    CheckClose();
+
+    printf("%d failed\n", failures);
+    return failures != 0;
+}
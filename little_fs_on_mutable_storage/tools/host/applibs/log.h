@@ -0,0 +1,8 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory
+
+#pragma once
+
+#define Log_Debug(...) ((void)0)
@@ -0,0 +1,11 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. Each tool defines the
+// functions itself.
+
+#pragma once
+
+#include <applibs/eventloop.h>
+
+EventLoop *dx_timerGetEventLoop(void);
@@ -0,0 +1,142 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the littlefs header, for the tools in this directory. It has only the calls
+// ts_log.c makes, lfs_host.c implements them on a directory of ordinary files.
+//
+// Flash cost is modeled on littlefs with 256-byte blocks, prog_size equal to block_size, as in
+// littlefs_mgr.c: a sync programs the partial tail block again plus the new data, rounded up to
+// whole blocks, and every metadata commit (sync, create, remove, mkdir) programs one block.
+// User attributes are kept in memory and only take the value passed to lfs_file_opencfg() when
+// the file is synced, as littlefs commits them.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LFS_HOST_BLOCK_BYTES 256
+#define LFS_HOST_MAX_ATTRIBUTES 128
+#define LFS_HOST_PATH_BYTES 256
+#define LFS_HOST_ATTRIBUTE_BYTES 64
+
+typedef uint32_t lfs_size_t;
+typedef uint32_t lfs_off_t;
+typedef int32_t lfs_ssize_t;
+typedef int32_t lfs_soff_t;
+
+enum lfs_error {
+    LFS_ERR_OK = 0,
+    LFS_ERR_IO = -5,
+    LFS_ERR_NOENT = -2,
+    LFS_ERR_EXIST = -17,
+    LFS_ERR_INVAL = -22,
+    LFS_ERR_NOSPC = -28,
+    LFS_ERR_NOATTR = -61,
+};
+
+enum lfs_type {
+    LFS_TYPE_REG = 0x001,
+    LFS_TYPE_DIR = 0x002,
+};
+
+enum lfs_open_flags {
+    LFS_O_RDONLY = 1,
+    LFS_O_WRONLY = 2,
+    LFS_O_RDWR = 3,
+    LFS_O_CREAT = 0x0100,
+    LFS_O_EXCL = 0x0200,
+    LFS_O_TRUNC = 0x0400,
+    LFS_O_APPEND = 0x0800,
+};
+
+enum lfs_whence_flags {
+    LFS_SEEK_SET = 0,
+    LFS_SEEK_CUR = 1,
+    LFS_SEEK_END = 2,
+};
+
+struct lfs_attr {
+    uint8_t type;
+    void *buffer;
+    lfs_size_t size;
+};
+
+struct lfs_file_config {
+    void *buffer;
+    struct lfs_attr *attrs;
+    lfs_size_t attr_count;
+};
+
+struct lfs_info {
+    uint8_t type;
+    lfs_size_t size;
+    char name[LFS_HOST_PATH_BYTES];
+};
+
+typedef struct {
+    bool used;
+    uint8_t type;
+    lfs_size_t size;
+    char path[LFS_HOST_PATH_BYTES];
+    uint8_t data[LFS_HOST_ATTRIBUTE_BYTES];
+} LFS_HOST_ATTRIBUTE;
+
+// Counters since the last lfs_host_reset_counters()
+typedef struct {
+    uint64_t progBytes;
+    uint64_t erases;
+    uint64_t commits;
+    uint64_t readBytes;
+    uint64_t reads;
+    uint64_t opens;
+} LFS_HOST_COUNTERS;
+
+typedef struct {
+    char root[LFS_HOST_PATH_BYTES];
+    bool fsync;       // fdatasync() every sync, for timings on a real device
+    int failCreates;  // The next opens with LFS_O_CREAT that fail with LFS_ERR_NOSPC
+    int failRemoves;  // The next removes that fail with LFS_ERR_IO
+    LFS_HOST_COUNTERS counters;
+    LFS_HOST_ATTRIBUTE attributes[LFS_HOST_MAX_ATTRIBUTES];
+} lfs_t;
+
+typedef struct {
+    int fd;
+    char path[LFS_HOST_PATH_BYTES];
+    const struct lfs_file_config *config;
+    uint8_t *pending; // Not in the file until the next sync
+    lfs_size_t pendingBytes;
+    lfs_off_t position;
+    bool dirty;       // Written since the last sync
+} lfs_file_t;
+
+typedef struct {
+    void *dir;
+    char path[LFS_HOST_PATH_BYTES];
+} lfs_dir_t;
+
+/// <summary>
+/// Use root, an existing directory, as the file system. Everything in it is kept.
+/// </summary>
+void lfs_host_mount(lfs_t *lfs, const char *root);
+
+void lfs_host_reset_counters(lfs_t *lfs);
+
+int lfs_mkdir(lfs_t *lfs, const char *path);
+int lfs_remove(lfs_t *lfs, const char *path);
+int lfs_stat(lfs_t *lfs, const char *path, struct lfs_info *info);
+lfs_ssize_t lfs_getattr(lfs_t *lfs, const char *path, uint8_t type, void *buffer, lfs_size_t size);
+
+int lfs_file_open(lfs_t *lfs, lfs_file_t *file, const char *path, int flags);
+int lfs_file_opencfg(lfs_t *lfs, lfs_file_t *file, const char *path, int flags, const struct lfs_file_config *config);
+int lfs_file_close(lfs_t *lfs, lfs_file_t *file);
+int lfs_file_sync(lfs_t *lfs, lfs_file_t *file);
+lfs_ssize_t lfs_file_read(lfs_t *lfs, lfs_file_t *file, void *buffer, lfs_size_t size);
+lfs_ssize_t lfs_file_write(lfs_t *lfs, lfs_file_t *file, const void *buffer, lfs_size_t size);
+lfs_soff_t lfs_file_seek(lfs_t *lfs, lfs_file_t *file, lfs_soff_t offset, int whence);
+
+int lfs_dir_open(lfs_t *lfs, lfs_dir_t *dir, const char *path);
+int lfs_dir_close(lfs_t *lfs, lfs_dir_t *dir);
+int lfs_dir_read(lfs_t *lfs, lfs_dir_t *dir, struct lfs_info *info);
@@ -0,0 +1,302 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for littlefs, see lfs.h in this directory
+
+#define _GNU_SOURCE
+
+#include "lfs.h"
+#include "lfs_util.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    const uint8_t *data = buffer;
+
+    for (size_t i = 0; i < size; i++) {
+        crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 0)) & 0xf];
+        crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0xf];
+    }
+    return crc;
+}
+
+void lfs_host_mount(lfs_t *lfs, const char *root)
+{
+    memset(lfs, 0, sizeof(*lfs));
+    snprintf(lfs->root, sizeof(lfs->root), "%s", root);
+}
+
+void lfs_host_reset_counters(lfs_t *lfs)
+{
+    memset(&lfs->counters, 0, sizeof(lfs->counters));
+}
+
+static void host_path(const lfs_t *lfs, const char *path, char *hostPath)
+{
+    snprintf(hostPath, LFS_HOST_PATH_BYTES * 2, "%s%s", lfs->root, path);
+}
+
+static void commit_metadata(lfs_t *lfs)
+{
+    lfs->counters.commits++;
+    lfs->counters.progBytes += LFS_HOST_BLOCK_BYTES;
+    lfs->counters.erases++;
+}
+
+static LFS_HOST_ATTRIBUTE *find_attribute(lfs_t *lfs, const char *path, uint8_t type, bool create)
+{
+    LFS_HOST_ATTRIBUTE *unused = NULL;
+
+    for (size_t i = 0; i < LFS_HOST_MAX_ATTRIBUTES; i++) {
+        LFS_HOST_ATTRIBUTE *attribute = &lfs->attributes[i];
+        if (attribute->used && attribute->type == type && strcmp(attribute->path, path) == 0) {
+            return attribute;
+        }
+        if (!attribute->used && unused == NULL) {
+            unused = attribute;
+        }
+    }
+    if (!create || unused == NULL) {
+        return NULL;
+    }
+    unused->used = true;
+    unused->type = type;
+    snprintf(unused->path, sizeof(unused->path), "%s", path);
+    return unused;
+}
+
+int lfs_mkdir(lfs_t *lfs, const char *path)
+{
+    char hostPath[LFS_HOST_PATH_BYTES * 2];
+
+    host_path(lfs, path, hostPath);
+    if (mkdir(hostPath, 0755) != 0) {
+        return errno == EEXIST ? LFS_ERR_EXIST : LFS_ERR_IO;
+    }
+    commit_metadata(lfs);
+    return LFS_ERR_OK;
+}
+
+int lfs_remove(lfs_t *lfs, const char *path)
+{
+    char hostPath[LFS_HOST_PATH_BYTES * 2];
+
+    if (lfs->failRemoves > 0) {
+        lfs->failRemoves--;
+        return LFS_ERR_IO;
+    }
+
+    host_path(lfs, path, hostPath);
+    if (unlink(hostPath) != 0) {
+        return errno == ENOENT ? LFS_ERR_NOENT : LFS_ERR_IO;
+    }
+    for (size_t i = 0; i < LFS_HOST_MAX_ATTRIBUTES; i++) {
+        if (lfs->attributes[i].used && strcmp(lfs->attributes[i].path, path) == 0) {
+            lfs->attributes[i].used = false;
+        }
+    }
+    commit_metadata(lfs);
+    return LFS_ERR_OK;
+}
+
+int lfs_stat(lfs_t *lfs, const char *path, struct lfs_info *info)
+{
+    char hostPath[LFS_HOST_PATH_BYTES * 2];
+    struct stat status;
+    const char *name = strrchr(path, '/');
+
+    host_path(lfs, path, hostPath);
+    if (stat(hostPath, &status) != 0) {
+        return LFS_ERR_NOENT;
+    }
+    info->type = S_ISDIR(status.st_mode) ? LFS_TYPE_DIR : LFS_TYPE_REG;
+    info->size = (lfs_size_t)status.st_size;
+    snprintf(info->name, sizeof(info->name), "%s", name != NULL ? name + 1 : path);
+    return LFS_ERR_OK;
+}
+
+lfs_ssize_t lfs_getattr(lfs_t *lfs, const char *path, uint8_t type, void *buffer, lfs_size_t size)
+{
+    LFS_HOST_ATTRIBUTE *attribute = find_attribute(lfs, path, type, false);
+
+    if (attribute == NULL) {
+        return LFS_ERR_NOATTR;
+    }
+    lfs_size_t copied = attribute->size < size ? attribute->size : size;
+    memcpy(buffer, attribute->data, copied);
+    return (lfs_ssize_t)copied;
+}
+
+int lfs_file_opencfg(lfs_t *lfs, lfs_file_t *file, const char *path, int flags, const struct lfs_file_config *config)
+{
+    char hostPath[LFS_HOST_PATH_BYTES * 2];
+    int hostFlags = (flags & LFS_O_RDWR) == LFS_O_RDONLY ? O_RDONLY : O_RDWR;
+
+    if ((flags & LFS_O_CREAT) && lfs->failCreates > 0) {
+        lfs->failCreates--;
+        return LFS_ERR_NOSPC;
+    }
+
+    hostFlags |= (flags & LFS_O_CREAT) ? O_CREAT : 0;
+    hostFlags |= (flags & LFS_O_EXCL) ? O_EXCL : 0;
+    hostFlags |= (flags & LFS_O_TRUNC) ? O_TRUNC : 0;
+
+    host_path(lfs, path, hostPath);
+    memset(file, 0, sizeof(*file));
+    file->fd = open(hostPath, hostFlags, 0644);
+    if (file->fd < 0) {
+        return errno == EEXIST ? LFS_ERR_EXIST : LFS_ERR_NOENT;
+    }
+
+    snprintf(file->path, sizeof(file->path), "%s", path);
+    file->config = config;
+    if (flags & LFS_O_APPEND) {
+        file->position = (lfs_off_t)lseek(file->fd, 0, SEEK_END);
+    }
+    if (flags & LFS_O_CREAT) {
+        commit_metadata(lfs);
+    }
+    lfs->counters.opens++;
+    return LFS_ERR_OK;
+}
+
+int lfs_file_open(lfs_t *lfs, lfs_file_t *file, const char *path, int flags)
+{
+    return lfs_file_opencfg(lfs, file, path, flags, NULL);
+}
+
+int lfs_file_sync(lfs_t *lfs, lfs_file_t *file)
+{
+    if (!file->dirty) {
+        return LFS_ERR_OK;
+    }
+
+    if (file->pendingBytes > 0) {
+        off_t size = lseek(file->fd, 0, SEEK_END);
+        lfs_size_t tail = (lfs_size_t)(size % LFS_HOST_BLOCK_BYTES);
+        lfs_size_t blocks = (tail + file->pendingBytes + LFS_HOST_BLOCK_BYTES - 1) / LFS_HOST_BLOCK_BYTES;
+
+        if (pwrite(file->fd, file->pending, file->pendingBytes, size) != (ssize_t)file->pendingBytes) {
+            return LFS_ERR_IO;
+        }
+        lfs->counters.progBytes += (uint64_t)blocks * LFS_HOST_BLOCK_BYTES;
+        lfs->counters.erases += blocks;
+        file->pendingBytes = 0;
+    }
+
+    if (lfs->fsync) {
+        fdatasync(file->fd);
+    }
+
+    // The attributes go out in the same commit as the data
+    for (lfs_size_t i = 0; file->config != NULL && i < file->config->attr_count; i++) {
+        const struct lfs_attr *source = &file->config->attrs[i];
+        LFS_HOST_ATTRIBUTE *attribute = find_attribute(lfs, file->path, source->type, true);
+        if (attribute == NULL || source->size > LFS_HOST_ATTRIBUTE_BYTES) {
+            return LFS_ERR_NOSPC;
+        }
+        memcpy(attribute->data, source->buffer, source->size);
+        attribute->size = source->size;
+    }
+    commit_metadata(lfs);
+    file->dirty = false;
+    return LFS_ERR_OK;
+}
+
+int lfs_file_close(lfs_t *lfs, lfs_file_t *file)
+{
+    int result = lfs_file_sync(lfs, file);
+
+    close(file->fd);
+    free(file->pending);
+    file->pending = NULL;
+    return result;
+}
+
+lfs_ssize_t lfs_file_write(lfs_t *lfs, lfs_file_t *file, const void *buffer, lfs_size_t size)
+{
+    uint8_t *pending = realloc(file->pending, file->pendingBytes + size);
+
+    (void)lfs;
+    if (pending == NULL) {
+        return LFS_ERR_NOSPC;
+    }
+    file->pending = pending;
+    memcpy(file->pending + file->pendingBytes, buffer, size);
+    file->pendingBytes += size;
+    file->position += size;
+    file->dirty = true;
+    return (lfs_ssize_t)size;
+}
+
+// Reads only see synced data, ts_log never reads through the file it appends to
+lfs_ssize_t lfs_file_read(lfs_t *lfs, lfs_file_t *file, void *buffer, lfs_size_t size)
+{
+    ssize_t result = pread(file->fd, buffer, size, file->position);
+
+    if (result < 0) {
+        return LFS_ERR_IO;
+    }
+    lfs->counters.reads++;
+    lfs->counters.readBytes += (uint64_t)result;
+    file->position += (lfs_off_t)result;
+    return (lfs_ssize_t)result;
+}
+
+lfs_soff_t lfs_file_seek(lfs_t *lfs, lfs_file_t *file, lfs_soff_t offset, int whence)
+{
+    (void)lfs;
+    if (whence == LFS_SEEK_SET) {
+        file->position = (lfs_off_t)offset;
+    } else if (whence == LFS_SEEK_CUR) {
+        file->position += (lfs_off_t)offset;
+    } else {
+        file->position = (lfs_off_t)(lseek(file->fd, 0, SEEK_END) + file->pendingBytes + offset);
+    }
+    return (lfs_soff_t)file->position;
+}
+
+int lfs_dir_open(lfs_t *lfs, lfs_dir_t *dir, const char *path)
+{
+    char hostPath[LFS_HOST_PATH_BYTES * 2];
+
+    host_path(lfs, path, hostPath);
+    dir->dir = opendir(hostPath);
+    snprintf(dir->path, sizeof(dir->path), "%s", path);
+    return dir->dir != NULL ? LFS_ERR_OK : LFS_ERR_NOENT;
+}
+
+int lfs_dir_close(lfs_t *lfs, lfs_dir_t *dir)
+{
+    (void)lfs;
+    closedir(dir->dir);
+    return LFS_ERR_OK;
+}
+
+int lfs_dir_read(lfs_t *lfs, lfs_dir_t *dir, struct lfs_info *info)
+{
+    struct dirent *entry;
+
+    while ((entry = readdir(dir->dir)) != NULL) {
+        char path[LFS_HOST_PATH_BYTES * 2];
+
+        snprintf(path, sizeof(path), "%s/%s", dir->path, entry->d_name);
+        if (lfs_stat(lfs, path, info) == LFS_ERR_OK) {
+            snprintf(info->name, sizeof(info->name), "%s", entry->d_name);
+            return 1;
+        }
+    }
+    return 0;
+}
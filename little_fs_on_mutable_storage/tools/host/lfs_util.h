@@ -0,0 +1,12 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the littlefs header, for the tools in this directory
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 as littlefs computes it, implemented in lfs_host.c
+uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size);
@@ -0,0 +1,211 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host test for how long the littlefs write holds up the event loop, on the littlefs stand-in
+   in host/ with an fdatasync() per sync. An event loop runs a 10 ms periodic timer and records
+   how late each tick fires. Every 250 ms the button handler runs write_little_fs from main.c,
+   25 writes of writeMessage then lfs_file_sync().
+
+   A first run has no writes, for the stall the host adds by itself. In the second the handler
+   does the write inline, the way the example did before the worker pool. In the third it
+   submits the write to worker_pool.c with one worker, as main.c does now. Each run reports the
+   longest stall, the slowest write and the writes refused because the pool was busy.
+
+   The stand-in keeps the data in host files, so the sync costs what fdatasync() costs on the
+   directory given. Point it at the slowest storage to hand, an SD card or USB stick is closer
+   to the device's flash than an SSD.
+
+   Build: gcc -O2 -I host -I .. -o littlefs_write_stall littlefs_write_stall.c ../worker_pool.c
+              host/lfs_host.c -lpthread
+   Usage: littlefs_write_stall <empty directory on the device to measure>
+*/
+
+#include "worker_pool.h"
+
+#include "dx_timer.h"
+#include "lfs.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define TICK_MS 10
+#define PRESS_MS 250
+#define RUN_MS 10000
+
+typedef enum {
+    NO_WRITES,
+    WRITE_INLINE,
+    WRITE_ON_WORKER
+} MODE;
+
+static const char *modeNames[] = {"no writes", "write inline", "write on worker_pool"};
+
+typedef struct {
+    double startMs;
+    double writeMs;
+    size_t bytes;
+    bool succeeded;
+} WRITE_JOB;
+
+static const char writeMessage[] = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+                                   "incididunt ut labore et dolore magna aliqua\r\n";
+
+static lfs_t lfs;
+static lfs_file_t datafile;
+static double maxWriteMs;
+static int writes;
+static int failed;
+
+static int completionFd = -1;
+static EventLoopIoCallback *completionCallback;
+
+EventLoop *dx_timerGetEventLoop(void)
+{
+    return (EventLoop *)&completionFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    (void)el;
+    (void)eventBitmask;
+    (void)context;
+    completionFd = fd;
+    completionCallback = callback;
+    return (EventRegistration *)&completionFd;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    (void)el;
+    (void)reg;
+    completionFd = -1;
+    return 0;
+}
+
+static double NowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+// write_little_fs from main.c, less the logging
+static void WriteLittleFs(void *context)
+{
+    WRITE_JOB *job = (WRITE_JOB *)context;
+    size_t dataLength = strlen(writeMessage);
+
+    job->startMs = NowMs();
+    if (lfs_file_open(&lfs, &datafile, "/data/lorem.txt", LFS_O_RDWR | LFS_O_CREAT) != LFS_ERR_OK) {
+        return;
+    }
+    for (size_t i = 0; i < 25; i++) {
+        if (lfs_file_write(&lfs, &datafile, writeMessage, dataLength) != (lfs_ssize_t)dataLength) {
+            break;
+        }
+        job->bytes += dataLength;
+    }
+    job->succeeded = lfs_file_sync(&lfs, &datafile) == LFS_ERR_OK;
+    lfs_file_close(&lfs, &datafile);
+    job->writeMs = NowMs() - job->startMs;
+}
+
+static void WriteComplete(void *context, bool cancelled)
+{
+    WRITE_JOB *job = (WRITE_JOB *)context;
+
+    if (cancelled || !job->succeeded) {
+        failed++;
+        return;
+    }
+    writes++;
+    if (job->writeMs > maxWriteMs) {
+        maxWriteMs = job->writeMs;
+    }
+}
+
+// A new, empty file system for each run
+static void Mount(const char *rootDirectory, int run)
+{
+    char path[LFS_HOST_PATH_BYTES];
+
+    snprintf(path, sizeof(path), "%s/run%d", rootDirectory, run);
+    mkdir(path, 0755);
+    lfs_host_mount(&lfs, path);
+    lfs.fsync = true;
+    lfs_mkdir(&lfs, "/data");
+}
+
+static void Run(const char *rootDirectory, int run, MODE mode)
+{
+    double startMs = NowMs();
+    double nextTickMs = TICK_MS;
+    double nextPressMs = PRESS_MS;
+    double maxLateMs = 0;
+    int refused = 0;
+
+    Mount(rootDirectory, run);
+    maxWriteMs = 0;
+    writes = 0;
+    failed = 0;
+
+    for (;;) {
+        double nowMs = NowMs() - startMs;
+        if (nowMs >= RUN_MS) {
+            break;
+        }
+
+        if (nowMs >= nextTickMs) {
+            if (nowMs - nextTickMs > maxLateMs) {
+                maxLateMs = nowMs - nextTickMs;
+            }
+            nextTickMs += TICK_MS * (1 + (int)((nowMs - nextTickMs) / TICK_MS));
+        }
+
+        // The button handler
+        if (nowMs >= nextPressMs) {
+            WRITE_JOB job = {.succeeded = false};
+
+            nextPressMs += PRESS_MS;
+            if (mode == WRITE_INLINE) {
+                WriteLittleFs(&job);
+                WriteComplete(&job, false);
+            } else if (mode == WRITE_ON_WORKER && !worker_pool_submit(WriteLittleFs, WriteComplete, &job, sizeof(job))) {
+                refused++;
+            }
+        }
+
+        struct pollfd fd = {.fd = completionFd, .events = POLLIN};
+        double dueMs = nextTickMs < nextPressMs ? nextTickMs : nextPressMs;
+        int timeoutMs = (int)(dueMs - (NowMs() - startMs)) + 1;
+        if (poll(&fd, completionFd >= 0 ? 1 : 0, timeoutMs > 0 ? timeoutMs : 0) > 0) {
+            completionCallback(NULL, completionFd, EventLoop_Input, NULL);
+        }
+    }
+
+    printf("%-22s longest stall %7.2f ms  slowest write %7.2f ms  writes %d  failed %d  refused %d\n",
+           modeNames[mode], maxLateMs, maxWriteMs, writes, failed, refused);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: littlefs_write_stall <empty directory on the device to measure>\n");
+        return 1;
+    }
+    if (!worker_pool_init(1)) {
+        printf("worker_pool_init failed\n");
+        return 1;
+    }
+
+    Run(argv[1], 0, NO_WRITES);
+    Run(argv[1], 1, WRITE_INLINE);
+    Run(argv[1], 2, WRITE_ON_WORKER);
+
+    worker_pool_close();
+    return 0;
+}
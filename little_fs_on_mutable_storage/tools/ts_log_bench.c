@@ -0,0 +1,265 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host benchmark for ts_log.c on the littlefs stand-in in host/, against one flat file that
+   keeps its retention by rewriting itself without the oldest records and answers queries by
+   reading it from the start. Records are 16 bytes, one every 10 s. For each layout it reports
+   the flash programmed and erased per record over the last 1000 appends, then the cost of 2000
+   random 60 s queries and whether each returned the right records.
+
+   Build: gcc -O2 -I host -I .. -o ts_log_bench ts_log_bench.c ../ts_log.c host/lfs_host.c
+   Usage: ts_log_bench <empty directory>
+*/
+
+#include "lfs_util.h"
+#include "ts_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define SAMPLE_MS 10000ULL
+#define QUERY_MS 60000ULL
+#define MEASURED_APPENDS 1000
+#define QUERIES 2000
+
+typedef struct {
+    int records;
+    uint64_t lastTime;
+    bool ordered;
+} QUERY_RESULT;
+
+// The flat file's records, the same layout as ts_log's
+typedef struct {
+    uint64_t time;
+    uint32_t value;
+    uint32_t crc;
+} FLAT_RECORD;
+
+static lfs_t lfs;
+static const char *rootDirectory;
+static int runs;
+
+static double NowUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e6 + (double)now.tv_nsec / 1e3;
+}
+
+// A new, empty file system for each run
+static void Mount(void)
+{
+    char path[LFS_HOST_PATH_BYTES];
+
+    snprintf(path, sizeof(path), "%s/run%d", rootDirectory, runs++);
+    mkdir(path, 0755);
+    lfs_host_mount(&lfs, path);
+    lfs_mkdir(&lfs, "/data");
+}
+
+static bool Visit(uint64_t time, const void *payload, size_t length, void *context)
+{
+    QUERY_RESULT *result = (QUERY_RESULT *)context;
+
+    (void)payload;
+    (void)length;
+    if (result->records > 0 && time < result->lastTime) {
+        result->ordered = false;
+    }
+    result->lastTime = time;
+    result->records++;
+    return true;
+}
+
+static int ExpectedRecords(uint64_t firstTime)
+{
+    return (int)((firstTime + QUERY_MS) / SAMPLE_MS - (firstTime + SAMPLE_MS - 1) / SAMPLE_MS + 1);
+}
+
+static void PrintWrites(const char *name, double elapsedUs)
+{
+    printf("%-28s append %5.1f us  prog %6.1f B/rec  erase %5.2f/rec  commits %5.2f/rec\n", name,
+           elapsedUs / MEASURED_APPENDS, (double)lfs.counters.progBytes / MEASURED_APPENDS,
+           (double)lfs.counters.erases / MEASURED_APPENDS, (double)lfs.counters.commits / MEASURED_APPENDS);
+}
+
+static void PrintQueries(double elapsedUs, int mismatches)
+{
+    printf("%-28s query  %5.1f us  %.2f files  %5.0f B read  %4.1f reads  mismatches %d\n", "", elapsedUs / QUERIES,
+           (double)lfs.counters.opens / QUERIES, (double)lfs.counters.readBytes / QUERIES,
+           (double)lfs.counters.reads / QUERIES, mismatches);
+}
+
+static void RunTsLog(uint32_t segmentRecords, uint32_t maxSegments, int total, int syncEvery)
+{
+    TS_LOG log;
+    TS_LOG_CONFIG config = {
+        .directory = "/data/memory", .recordBytes = 4, .segmentRecords = segmentRecords, .maxSegments = maxSegments};
+    char name[64];
+
+    Mount();
+    if (!ts_log_open(&log, &lfs, &config)) {
+        printf("ts_log_open failed\n");
+        exit(1);
+    }
+
+    double start = 0;
+    for (int i = 0; i < total; i++) {
+        uint32_t value = (uint32_t)i;
+
+        if (i == total - MEASURED_APPENDS) {
+            lfs_host_reset_counters(&lfs);
+            start = NowUs();
+        }
+        if (!ts_log_append(&log, (uint64_t)i * SAMPLE_MS, &value)) {
+            printf("ts_log_append failed\n");
+            exit(1);
+        }
+        if ((i + 1) % syncEvery == 0) {
+            ts_log_sync(&log);
+        }
+    }
+    ts_log_sync(&log);
+    snprintf(name, sizeof(name), "ts_log %ux%u, sync per %d", segmentRecords, maxSegments, syncEvery);
+    PrintWrites(name, NowUs() - start);
+
+    // Queries within the history every layout keeps, the oldest segment may go at any time
+    uint64_t oldest = (uint64_t)(total - (int)(segmentRecords * (maxSegments - 1))) * SAMPLE_MS;
+    uint64_t newest = (uint64_t)(total - 1) * SAMPLE_MS;
+    int mismatches = 0;
+
+    srand(1);
+    lfs_host_reset_counters(&lfs);
+    start = NowUs();
+    for (int q = 0; q < QUERIES; q++) {
+        uint64_t firstTime = oldest + (uint64_t)rand() % (newest - oldest - QUERY_MS);
+        QUERY_RESULT result = {.ordered = true};
+
+        if (ts_log_query(&log, firstTime, firstTime + QUERY_MS, Visit, &result) != ExpectedRecords(firstTime) ||
+            !result.ordered) {
+            mismatches++;
+        }
+    }
+    PrintQueries(NowUs() - start, mismatches);
+    ts_log_close(&log);
+}
+
+static void FlatAppend(lfs_file_t *file, bool *open, int *count, uint64_t time, uint32_t value, int capacity,
+                       int trim, int syncEvery)
+{
+    static FLAT_RECORD all[16384];
+    FLAT_RECORD record = {.time = time, .value = value};
+
+    record.crc = lfs_crc(0xffffffff, &record, offsetof(FLAT_RECORD, crc));
+    if (!*open) {
+        lfs_file_open(&lfs, file, "/data/flat.bin", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND);
+        *open = true;
+    }
+    lfs_file_write(&lfs, file, &record, sizeof(record));
+    if (++*count % syncEvery == 0) {
+        lfs_file_sync(&lfs, file);
+    }
+
+    // Retention, copy the file without its oldest trim records
+    if (*count > capacity) {
+        lfs_file_t copy;
+
+        lfs_file_close(&lfs, file);
+        *open = false;
+
+        lfs_file_open(&lfs, &copy, "/data/flat.bin", LFS_O_RDONLY);
+        int records = (int)(lfs_file_read(&lfs, &copy, all, sizeof(all)) / (lfs_ssize_t)sizeof(FLAT_RECORD));
+        lfs_file_close(&lfs, &copy);
+
+        lfs_file_open(&lfs, &copy, "/data/flat.bin", LFS_O_WRONLY | LFS_O_TRUNC);
+        lfs_file_write(&lfs, &copy, all + trim, (lfs_size_t)((records - trim) * (int)sizeof(FLAT_RECORD)));
+        lfs_file_close(&lfs, &copy);
+        *count = records - trim;
+    }
+}
+
+static int FlatQuery(uint64_t firstTime, uint64_t lastTime, QUERY_RESULT *result)
+{
+    lfs_file_t file;
+    FLAT_RECORD record;
+
+    lfs_file_open(&lfs, &file, "/data/flat.bin", LFS_O_RDONLY);
+    while (lfs_file_read(&lfs, &file, &record, sizeof(record)) == (lfs_ssize_t)sizeof(record)) {
+        if (record.crc != lfs_crc(0xffffffff, &record, offsetof(FLAT_RECORD, crc))) {
+            continue;
+        }
+        if (record.time > lastTime) {
+            break;
+        }
+        if (record.time >= firstTime) {
+            Visit(record.time, &record.value, sizeof(record.value), result);
+        }
+    }
+    lfs_file_close(&lfs, &file);
+    return result->records;
+}
+
+static void RunFlat(int capacity, int trim, int total, int syncEvery)
+{
+    lfs_file_t file;
+    bool open = false;
+    int count = 0;
+    char name[64];
+
+    Mount();
+
+    double start = 0;
+    for (int i = 0; i < total; i++) {
+        if (i == total - MEASURED_APPENDS) {
+            lfs_host_reset_counters(&lfs);
+            start = NowUs();
+        }
+        FlatAppend(&file, &open, &count, (uint64_t)i * SAMPLE_MS, (uint32_t)i, capacity, trim, syncEvery);
+    }
+    if (open) {
+        lfs_file_sync(&lfs, &file);
+    }
+    snprintf(name, sizeof(name), "flat %d, sync per %d", capacity, syncEvery);
+    PrintWrites(name, NowUs() - start);
+    if (open) {
+        lfs_file_close(&lfs, &file);
+    }
+
+    uint64_t oldest = (uint64_t)(total - capacity + trim) * SAMPLE_MS;
+    uint64_t newest = (uint64_t)(total - 1) * SAMPLE_MS;
+    int mismatches = 0;
+
+    srand(1);
+    lfs_host_reset_counters(&lfs);
+    start = NowUs();
+    for (int q = 0; q < QUERIES; q++) {
+        uint64_t firstTime = oldest + (uint64_t)rand() % (newest - oldest - QUERY_MS);
+        QUERY_RESULT result = {.ordered = true};
+
+        if (FlatQuery(firstTime, firstTime + QUERY_MS, &result) != ExpectedRecords(firstTime)) {
+            mismatches++;
+        }
+    }
+    PrintQueries(NowUs() - start, mismatches);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: ts_log_bench <empty directory>\n");
+        return 1;
+    }
+    rootDirectory = argv[1];
+
+    // The example's layout, 64 records x 8 segments, and a larger one
+    RunTsLog(64, 8, 5000, 1);
+    RunTsLog(64, 8, 5000, 16);
+    RunFlat(512, 64, 5000, 1);
+    RunFlat(512, 64, 5000, 16);
+    RunTsLog(256, 32, 12000, 1);
+    RunFlat(8192, 256, 12000, 1);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License.
+
+   Host checks for ts_log.c on the littlefs stand-in in host/: time order, CRC failures, power
+   cuts before the first sync, retention, and littlefs failures while starting a segment.
+
+   Build: gcc -O1 -g -fsanitize=address,undefined -I host -I .. -o ts_log_check ts_log_check.c
+              ../ts_log.c host/lfs_host.c
+   Usage: ts_log_check <empty directory>
+*/
+
+#include "ts_log.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECK(condition, ...)                          \
+    do {                                               \
+        bool passed = (condition);                     \
+        printf("%s: ", passed ? "ok  " : "FAIL");      \
+        printf(__VA_ARGS__);                           \
+        printf("\n");                                  \
+        failures += !passed;                           \
+    } while (0)
+
+static lfs_t lfs;
+static const char *rootDirectory;
+static int runs;
+static int failures;
+
+// A new, empty file system for each check
+static void Mount(void)
+{
+    char path[LFS_HOST_PATH_BYTES];
+
+    snprintf(path, sizeof(path), "%s/run%d", rootDirectory, runs++);
+    mkdir(path, 0755);
+    lfs_host_mount(&lfs, path);
+    lfs_mkdir(&lfs, "/data");
+}
+
+static bool CountRecords(uint64_t time, const void *payload, size_t length, void *context)
+{
+    (void)time;
+    (void)payload;
+    (void)length;
+    (*(int *)context)++;
+    return true;
+}
+
+static int Query(TS_LOG *log, uint64_t firstTime, uint64_t lastTime)
+{
+    int records = 0;
+    return ts_log_query(log, firstTime, lastTime, CountRecords, &records) < 0 ? -1 : records;
+}
+
+// Host path of a file in the log directory
+static void SegmentHostPath(const char *directory, uint32_t sequence, char *path, size_t size)
+{
+    snprintf(path, size, "%s%s/%08lx.seg", lfs.root, directory, (unsigned long)sequence);
+}
+
+static bool Append(TS_LOG *log, uint32_t first, uint32_t count, uint64_t step)
+{
+    for (uint32_t i = first; i < first + count; i++) {
+        if (!ts_log_append(log, i * step, &i)) {
+            return false;
+        }
+    }
+    return ts_log_sync(log);
+}
+
+static void CheckOrderAndDamage(void)
+{
+    TS_LOG log;
+    TS_LOG_CONFIG config = {.directory = "/data/m", .recordBytes = 4, .segmentRecords = 8, .maxSegments = 4};
+    char path[LFS_HOST_PATH_BYTES * 2];
+    uint32_t zero = 0;
+
+    Mount();
+    ts_log_open(&log, &lfs, &config);
+    Append(&log, 0, 20, 10);
+    CHECK(!ts_log_append(&log, 5, &zero), "a time stamp that goes backwards is refused");
+    CHECK(Query(&log, 0, 1000) == 20, "all 20 records are visited");
+    CHECK(ts_log_last_time(&log) == 190, "ts_log_last_time() is the last record's time");
+    ts_log_close(&log);
+
+    // Flip a payload byte of record 3 in segment 0, and leave a segment that was never synced
+    int fd;
+    char byte;
+    SegmentHostPath(config.directory, 0, path, sizeof(path));
+    fd = open(path, O_RDWR);
+    pread(fd, &byte, 1, 3 * 16 + 9);
+    byte ^= 1;
+    pwrite(fd, &byte, 1, 3 * 16 + 9);
+    close(fd);
+    SegmentHostPath(config.directory, 7, path, sizeof(path));
+    close(open(path, O_CREAT | O_WRONLY, 0644));
+
+    ts_log_open(&log, &lfs, &config);
+    CHECK(Query(&log, 0, 1000) == 19 && log.stats.badRecords == 1, "the damaged record is skipped and counted");
+    CHECK(access(path, F_OK) != 0, "the unsynced segment is removed on open");
+    CHECK(ts_log_last_time(&log) == 190, "ts_log_last_time() is restored on open");
+
+    Append(&log, 20, 20, 10);
+    CHECK(Query(&log, 0, 1000) == 32 && log.segments[0].sequence == 1, "retention keeps 4 segments of 8");
+    CHECK(Query(&log, 205, 255) == 5, "a range within a segment");
+    ts_log_close(&log);
+
+    config.maxSegments = 2;
+    ts_log_open(&log, &lfs, &config);
+    CHECK(log.segmentCount == 2 && Query(&log, 0, 1000) == 16, "lowering maxSegments trims the oldest");
+    ts_log_close(&log);
+}
+
+static void CheckDamagedProbe(void)
+{
+    TS_LOG log;
+    TS_LOG_CONFIG config = {.directory = "/data/m", .recordBytes = 4, .segmentRecords = 64, .maxSegments = 4};
+    char path[LFS_HOST_PATH_BYTES * 2];
+    uint64_t zero = 0;
+
+    Mount();
+    ts_log_open(&log, &lfs, &config);
+    Append(&log, 0, 64, 10);
+
+    // Record 32, the first one the binary search reads, gets a time stamp of 0 and fails its CRC
+    SegmentHostPath(config.directory, 0, path, sizeof(path));
+    int fd = open(path, O_RDWR);
+    pwrite(fd, &zero, sizeof(zero), 32 * 16);
+    close(fd);
+
+    CHECK(Query(&log, 100, 400) == 30 && log.stats.badRecords == 1,
+          "a damaged time stamp at a binary search probe does not hide records 10 to 31");
+    CHECK(Query(&log, 330, 400) == 8, "a range after the damaged record");
+    ts_log_close(&log);
+}
+
+static void CheckSegmentFailures(void)
+{
+    TS_LOG log;
+    TS_LOG_CONFIG config = {.directory = "/data/m", .recordBytes = 4, .segmentRecords = 8, .maxSegments = 4};
+    char path[LFS_HOST_PATH_BYTES * 2];
+    uint32_t value = 32;
+
+    Mount();
+    ts_log_open(&log, &lfs, &config);
+    Append(&log, 0, 32, 10);
+
+    lfs.failCreates = 1;
+    SegmentHostPath(config.directory, 0, path, sizeof(path));
+    CHECK(!ts_log_append(&log, 320, &value), "an append fails when the next segment cannot be created");
+    CHECK(log.segmentCount == 4 && access(path, F_OK) == 0 && Query(&log, 0, 1000) == 32,
+          "the oldest segment is kept when the next one cannot be created");
+
+    CHECK(Append(&log, 32, 1, 10) && log.segmentCount == 4 && access(path, F_OK) != 0,
+          "the oldest segment goes once the next one is created");
+
+    lfs.failRemoves = 1;
+    SegmentHostPath(config.directory, 1, path, sizeof(path));
+    CHECK(Append(&log, 33, 8, 10) && log.segmentCount == 4 && access(path, F_OK) == 0,
+          "appending carries on when the oldest segment cannot be removed");
+    ts_log_close(&log);
+
+    ts_log_open(&log, &lfs, &config);
+    CHECK(log.segmentCount == 4 && access(path, F_OK) != 0, "ts_log_open() removes the segment left behind");
+    ts_log_close(&log);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: ts_log_check <empty directory>\n");
+        return 1;
+    }
+    rootDirectory = argv[1];
+
+    CheckOrderAndDamage();
+    CheckDamagedProbe();
+    CheckSegmentFailures();
+
+    printf("%d failed\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,471 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "ts_log.h"
+
+#include "lfs_util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TS_LOG_MAGIC 0x474c5354 // "TSLG"
+#define TS_LOG_VERSION 1
+
+// littlefs user attribute type of the segment header
+#define TS_LOG_HEADER_ATTRIBUTE 0x74
+
+static lfs_size_t record_size(const TS_LOG *log)
+{
+    return (lfs_size_t)TS_LOG_RECORD_OVERHEAD + log->config.recordBytes;
+}
+
+static void segment_path(const TS_LOG *log, uint32_t sequence, char *path)
+{
+    snprintf(path, TS_LOG_PATH_BYTES, "%s/%08lx.seg", log->config.directory, (unsigned long)sequence);
+}
+
+// Segment files are named by their sequence number, e.g. "0000002a.seg"
+static bool parse_sequence(const char *name, uint32_t *sequence)
+{
+    uint32_t value = 0;
+
+    if (strlen(name) != 12 || strcmp(name + 8, ".seg") != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < 8; i++) {
+        char c = name[i];
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = (uint32_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (uint32_t)(c - 'a' + 10);
+        } else {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    *sequence = value;
+    return true;
+}
+
+static bool read_header(TS_LOG *log, uint32_t sequence, TS_LOG_HEADER *header)
+{
+    char path[TS_LOG_PATH_BYTES];
+    struct lfs_info info;
+
+    segment_path(log, sequence, path);
+    if (lfs_getattr(log->lfs, path, TS_LOG_HEADER_ATTRIBUTE, header, sizeof(*header)) != (lfs_ssize_t)sizeof(*header)) {
+        return false;
+    }
+    if (header->magic != TS_LOG_MAGIC || header->version != TS_LOG_VERSION || header->recordBytes != log->config.recordBytes ||
+        header->sequence != sequence || header->records == 0 || header->records > log->config.segmentRecords ||
+        header->firstTime > header->lastTime) {
+        return false;
+    }
+
+    // The header and the data are committed together, anything else is not a segment of ours
+    if (lfs_stat(log->lfs, path, &info) != LFS_ERR_OK || info.size < header->records * record_size(log)) {
+        return false;
+    }
+    return true;
+}
+
+static bool remove_segment(TS_LOG *log, uint32_t sequence)
+{
+    char path[TS_LOG_PATH_BYTES];
+
+    segment_path(log, sequence, path);
+    int result = lfs_remove(log->lfs, path);
+    return result == LFS_ERR_OK || result == LFS_ERR_NOENT;
+}
+
+static void drop_oldest(TS_LOG *log)
+{
+    log->segmentCount--;
+    memmove(&log->segments[0], &log->segments[1], log->segmentCount * sizeof(log->segments[0]));
+    log->stats.segmentsRemoved++;
+}
+
+static bool remove_oldest(TS_LOG *log)
+{
+    if (!remove_segment(log, log->segments[0].sequence)) {
+        return false;
+    }
+    drop_oldest(log);
+    return true;
+}
+
+static bool open_active(TS_LOG *log, const TS_LOG_HEADER *header, int flags)
+{
+    char path[TS_LOG_PATH_BYTES];
+
+    log->activeHeader = *header;
+    log->activeAttribute = (struct lfs_attr){.type = TS_LOG_HEADER_ATTRIBUTE, .buffer = &log->activeHeader, .size = sizeof(log->activeHeader)};
+    log->activeConfig = (struct lfs_file_config){.attrs = &log->activeAttribute, .attr_count = 1};
+
+    segment_path(log, log->activeHeader.sequence, path);
+    if (lfs_file_opencfg(log->lfs, &log->active, path, LFS_O_WRONLY | LFS_O_APPEND | flags, &log->activeConfig) != LFS_ERR_OK) {
+        return false;
+    }
+    log->activeOpen = true;
+    log->dirty = false;
+    return true;
+}
+
+// Closing syncs the data and the header
+static bool close_active(TS_LOG *log)
+{
+    if (!log->activeOpen) {
+        return true;
+    }
+
+    int result = lfs_file_close(log->lfs, &log->active);
+    log->activeOpen = false;
+    if (log->dirty) {
+        log->dirty = false;
+        log->stats.syncs++;
+    }
+    return result == LFS_ERR_OK;
+}
+
+static bool start_segment(TS_LOG *log, uint64_t time)
+{
+    uint32_t sequence = 0;
+
+    if (log->segmentCount > 0) {
+        sequence = log->segments[log->segmentCount - 1].sequence + 1;
+    }
+
+    // The header only reaches flash with the first sync, until then the index holds it
+    TS_LOG_HEADER header = {.magic = TS_LOG_MAGIC,
+                            .version = TS_LOG_VERSION,
+                            .recordBytes = (uint16_t)log->config.recordBytes,
+                            .sequence = sequence,
+                            .firstTime = time,
+                            .lastTime = time};
+
+    // Opened first, so a failure leaves every segment in place
+    if (!open_active(log, &header, LFS_O_CREAT | LFS_O_EXCL)) {
+        return false;
+    }
+
+    // Retention, the oldest segment makes way for the new one. It leaves the index even if its
+    // file cannot be removed, ts_log_open() removes it with the segments past maxSegments.
+    if (log->segmentCount == log->config.maxSegments) {
+        remove_segment(log, log->segments[0].sequence);
+        drop_oldest(log);
+    }
+
+    log->segments[log->segmentCount++] = header;
+    log->stats.segmentsStarted++;
+    return true;
+}
+
+// Keep the index sorted by sequence. When it is full the oldest segment is dropped from it and
+// returned through removed, it is deleted once the directory has been read.
+static bool index_segment(TS_LOG *log, const TS_LOG_HEADER *header, uint32_t *removed)
+{
+    size_t position = log->segmentCount;
+
+    while (position > 0 && log->segments[position - 1].sequence > header->sequence) {
+        position--;
+    }
+
+    if (log->segmentCount == TS_LOG_MAX_SEGMENTS) {
+        if (position == 0) {
+            *removed = header->sequence;
+            return true;
+        }
+        *removed = log->segments[0].sequence;
+        memmove(&log->segments[0], &log->segments[1], (position - 1) * sizeof(log->segments[0]));
+        log->segments[position - 1] = *header;
+        return true;
+    }
+
+    memmove(&log->segments[position + 1], &log->segments[position], (log->segmentCount - position) * sizeof(log->segments[0]));
+    log->segments[position] = *header;
+    log->segmentCount++;
+    return false;
+}
+
+bool ts_log_open(TS_LOG *log, lfs_t *lfs, const TS_LOG_CONFIG *config)
+{
+    uint32_t removals[TS_LOG_MAX_SEGMENTS];
+    size_t removalCount = 0;
+    lfs_dir_t dir;
+    struct lfs_info info;
+    int result;
+
+    memset(log, 0, sizeof(*log));
+
+    if (config->recordBytes == 0 || config->recordBytes > TS_LOG_MAX_RECORD_BYTES || config->segmentRecords == 0 || config->maxSegments < 2 ||
+        config->maxSegments > TS_LOG_MAX_SEGMENTS) {
+        return false;
+    }
+    log->lfs = lfs;
+    log->config = *config;
+
+    result = lfs_mkdir(lfs, config->directory);
+    if (result != LFS_ERR_OK && result != LFS_ERR_EXIST) {
+        return false;
+    }
+
+    if (lfs_dir_open(lfs, &dir, config->directory) != LFS_ERR_OK) {
+        return false;
+    }
+
+    while ((result = lfs_dir_read(lfs, &dir, &info)) > 0) {
+        uint32_t sequence;
+        uint32_t removed;
+        TS_LOG_HEADER header;
+
+        if (info.type != LFS_TYPE_REG || !parse_sequence(info.name, &sequence)) {
+            continue;
+        }
+
+        // Left over from a power cut before the segment's first sync, or not indexed. Any past
+        // TS_LOG_MAX_SEGMENTS go on the next open.
+        if (!read_header(log, sequence, &header)) {
+            removed = sequence;
+        } else if (!index_segment(log, &header, &removed)) {
+            continue;
+        }
+        if (removalCount < TS_LOG_MAX_SEGMENTS) {
+            removals[removalCount++] = removed;
+        }
+    }
+    lfs_dir_close(lfs, &dir);
+
+    if (result < 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < removalCount; i++) {
+        remove_segment(log, removals[i]);
+    }
+
+    // maxSegments may have been lowered since the segments were written
+    while (log->segmentCount > config->maxSegments) {
+        if (!remove_oldest(log)) {
+            return false;
+        }
+    }
+
+    if (log->segmentCount > 0) {
+        TS_LOG_HEADER *last = &log->segments[log->segmentCount - 1];
+        char path[TS_LOG_PATH_BYTES];
+
+        // Append to the last segment unless it is full or holds more than its header covers
+        segment_path(log, last->sequence, path);
+        if (last->records < config->segmentRecords && lfs_stat(lfs, path, &info) == LFS_ERR_OK &&
+            info.size == last->records * record_size(log)) {
+            return open_active(log, last, 0);
+        }
+    }
+    return true;
+}
+
+void ts_log_close(TS_LOG *log)
+{
+    close_active(log);
+}
+
+uint64_t ts_log_last_time(const TS_LOG *log)
+{
+    return log->segmentCount > 0 ? log->segments[log->segmentCount - 1].lastTime : 0;
+}
+
+bool ts_log_append(TS_LOG *log, uint64_t time, const void *payload)
+{
+    uint8_t record[TS_LOG_RECORD_OVERHEAD + TS_LOG_MAX_RECORD_BYTES];
+    lfs_size_t recordSize = record_size(log);
+    uint32_t crc;
+
+    // Queries rely on the records being in time order
+    if (log->segmentCount > 0 && time < log->segments[log->segmentCount - 1].lastTime) {
+        return false;
+    }
+
+    if (!log->activeOpen && !start_segment(log, time)) {
+        return false;
+    }
+
+    memcpy(record, &time, sizeof(time));
+    memcpy(record + sizeof(time), payload, log->config.recordBytes);
+    crc = lfs_crc(0xffffffff, record, recordSize - sizeof(crc));
+    memcpy(record + recordSize - sizeof(crc), &crc, sizeof(crc));
+
+    if (lfs_file_write(log->lfs, &log->active, record, recordSize) != (lfs_ssize_t)recordSize) {
+        // Part of the record may be in the file, the header does not count it and appending
+        // carries on in a new segment
+        close_active(log);
+        return false;
+    }
+
+    TS_LOG_HEADER *segment = &log->segments[log->segmentCount - 1];
+    segment->records++;
+    segment->lastTime = time;
+    log->activeHeader = *segment;
+    log->dirty = true;
+    log->stats.appended++;
+
+    // A full segment is closed, which syncs it, the next append starts a new one
+    if (segment->records == log->config.segmentRecords) {
+        return close_active(log);
+    }
+    return true;
+}
+
+bool ts_log_sync(TS_LOG *log)
+{
+    if (!log->activeOpen || !log->dirty) {
+        return true;
+    }
+    if (lfs_file_sync(log->lfs, &log->active) != LFS_ERR_OK) {
+        return false;
+    }
+    log->dirty = false;
+    log->stats.syncs++;
+    return true;
+}
+
+static bool check_record(const TS_LOG *log, const uint8_t *record)
+{
+    lfs_size_t recordSize = record_size(log);
+    uint32_t crc;
+
+    memcpy(&crc, record + recordSize - sizeof(crc), sizeof(crc));
+    return crc == lfs_crc(0xffffffff, record, recordSize - sizeof(crc));
+}
+
+// Time stamp of the first record from index on that passes the CRC, *index is moved to it.
+// 0 when there is none before end, -1 if littlefs failed.
+static int read_time(TS_LOG *log, lfs_file_t *file, uint32_t *index, uint32_t end, uint64_t *time)
+{
+    uint8_t record[TS_LOG_RECORD_OVERHEAD + TS_LOG_MAX_RECORD_BYTES];
+    lfs_size_t recordSize = record_size(log);
+    lfs_soff_t offset = (lfs_soff_t)(*index * recordSize);
+
+    if (lfs_file_seek(log->lfs, file, offset, LFS_SEEK_SET) != offset) {
+        return -1;
+    }
+    for (; *index < end; (*index)++) {
+        if (lfs_file_read(log->lfs, file, record, recordSize) != (lfs_ssize_t)recordSize) {
+            return -1;
+        }
+        if (check_record(log, record)) {
+            memcpy(time, record, sizeof(*time));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Visit the records of one segment in the range, *more is cleared when the visitor stops
+static int query_segment(TS_LOG *log, const TS_LOG_HEADER *header, uint64_t firstTime, uint64_t lastTime, TS_LOG_VISITOR visitor, void *context,
+                         bool *more)
+{
+    uint8_t record[TS_LOG_RECORD_OVERHEAD + TS_LOG_MAX_RECORD_BYTES];
+    lfs_size_t recordSize = record_size(log);
+    char path[TS_LOG_PATH_BYTES];
+    lfs_file_t file;
+    uint64_t time;
+    uint32_t first = 0;
+    int visited = 0;
+
+    segment_path(log, header->sequence, path);
+    if (lfs_file_open(log->lfs, &file, path, LFS_O_RDONLY) != LFS_ERR_OK) {
+        return -1;
+    }
+    log->stats.segmentsOpened++;
+
+    // Binary search on the time stamps for the first record in the range. A probe that fails
+    // the CRC moves on to the next good record, the bad ones in between are skipped below.
+    if (header->firstTime < firstTime) {
+        uint32_t high = header->records;
+        while (first < high) {
+            uint32_t middle = first + (high - first) / 2;
+            uint32_t probe = middle;
+            int result = read_time(log, &file, &probe, high, &time);
+            if (result < 0) {
+                visited = -1;
+                goto closeLabel;
+            }
+            if (result > 0 && time < firstTime) {
+                first = probe + 1;
+            } else {
+                high = middle;
+            }
+        }
+    }
+
+    // The records are contiguous, read on from there
+    lfs_soff_t offset = (lfs_soff_t)(first * recordSize);
+    if (lfs_file_seek(log->lfs, &file, offset, LFS_SEEK_SET) != offset) {
+        visited = -1;
+        goto closeLabel;
+    }
+
+    for (uint32_t index = first; index < header->records; index++) {
+        if (lfs_file_read(log->lfs, &file, record, recordSize) != (lfs_ssize_t)recordSize) {
+            visited = -1;
+            break;
+        }
+
+        if (!check_record(log, record)) {
+            log->stats.badRecords++;
+            continue;
+        }
+
+        memcpy(&time, record, sizeof(time));
+        if (time > lastTime) {
+            *more = false;
+            break;
+        }
+        if (time < firstTime) {
+            continue;
+        }
+
+        visited++;
+        if (!visitor(time, record + sizeof(time), log->config.recordBytes, context)) {
+            *more = false;
+            break;
+        }
+    }
+
+closeLabel:
+    lfs_file_close(log->lfs, &file);
+    return visited;
+}
+
+int ts_log_query(TS_LOG *log, uint64_t firstTime, uint64_t lastTime, TS_LOG_VISITOR visitor, void *context)
+{
+    size_t low = 0;
+    size_t high = log->segmentCount;
+    int visited = 0;
+    bool more = true;
+
+    // Readers only see what has been synced
+    if (!ts_log_sync(log)) {
+        return -1;
+    }
+
+    // Binary search the index for the first segment that ends in the range
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (log->segments[middle].lastTime < firstTime) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (size_t i = low; i < log->segmentCount && more && log->segments[i].firstTime <= lastTime; i++) {
+        TS_LOG_HEADER header = log->segments[i];
+        int result = query_segment(log, &header, firstTime, lastTime, visitor, context, &more);
+        if (result < 0) {
+            return -1;
+        }
+        visited += result;
+    }
+    return visited;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "lfs.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Append-only time-series log on littlefs. Records have a fixed size and go into segment files
+// of segmentRecords records each, named by sequence number in the log's directory. When a
+// segment is full the next one is started, and once there are maxSegments the oldest is
+// removed. Records are only ever appended, so littlefs never copies a file to change it.
+//
+// Each segment's header is a littlefs user attribute on the file holding its sequence, record
+// count and time range. It is committed by every ts_log_sync() together with the data it
+// describes, and can be read without opening the file. The headers are read into an index when
+// the log is opened, so a query binary searches the index, opens only the segments that overlap
+// the range and binary searches the records within the first one.
+//
+// Every record carries a CRC, records that fail it are skipped by queries and counted. The
+// binary searches only go by time stamps that pass it.
+//
+// littlefs is not thread safe, call everything from the thread that uses the file system.
+
+#define TS_LOG_MAX_SEGMENTS 32
+
+#define TS_LOG_MAX_RECORD_BYTES 64
+
+#define TS_LOG_PATH_BYTES 48
+
+// Time stamp, CRC
+#define TS_LOG_RECORD_OVERHEAD (sizeof(uint64_t) + sizeof(uint32_t))
+
+typedef struct {
+    const char *directory;   // Created if it does not exist, e.g. "/data/memory"
+    uint32_t recordBytes;    // Payload of every record, up to TS_LOG_MAX_RECORD_BYTES
+    uint32_t segmentRecords; // Records per segment file
+    uint32_t maxSegments;    // Segments kept, 2 to TS_LOG_MAX_SEGMENTS
+} TS_LOG_CONFIG;
+
+// Segment header, stored as the TS_LOG_HEADER_ATTRIBUTE user attribute of the segment file
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordBytes;
+    uint32_t sequence;
+    uint32_t records;
+    uint64_t firstTime;
+    uint64_t lastTime;
+} TS_LOG_HEADER;
+
+typedef struct {
+    uint32_t appended;
+    uint32_t syncs;
+    uint32_t segmentsStarted;
+    uint32_t segmentsRemoved;
+    uint32_t segmentsOpened;  // By queries
+    uint32_t badRecords;      // Failed the CRC in a query
+} TS_LOG_STATS;
+
+typedef struct {
+    lfs_t *lfs;
+    TS_LOG_CONFIG config;
+
+    // Oldest first, the last one is being appended to
+    TS_LOG_HEADER segments[TS_LOG_MAX_SEGMENTS];
+    size_t segmentCount;
+
+    lfs_file_t active;
+    bool activeOpen;
+    bool dirty; // Appended since the last sync
+    TS_LOG_HEADER activeHeader;
+    struct lfs_attr activeAttribute;
+    struct lfs_file_config activeConfig;
+
+    TS_LOG_STATS stats;
+} TS_LOG;
+
+/// <summary>
+/// Called for each record in time order, return false to stop the query.
+/// </summary>
+typedef bool (*TS_LOG_VISITOR)(uint64_t time, const void *payload, size_t length, void *context);
+
+/// <summary>
+/// Index the segments already in the directory and reopen the last one if it has room.
+/// Segments without a valid header, left by a power cut before their first sync, are removed.
+/// </summary>
+bool ts_log_open(TS_LOG *log, lfs_t *lfs, const TS_LOG_CONFIG *config);
+
+/// <summary>
+/// Sync and close the segment being appended to.
+/// </summary>
+void ts_log_close(TS_LOG *log);
+
+/// <summary>
+/// Time stamp of the last record appended, 0 if the log is empty. A clock for the log should
+/// not start before it.
+/// </summary>
+uint64_t ts_log_last_time(const TS_LOG *log);
+
+/// <summary>
+/// Append a record. Time stamps must not go backwards. The record is durable after the next
+/// ts_log_sync(), or once its segment is full.
+/// </summary>
+/// <returns>false if the time went backwards or littlefs failed</returns>
+bool ts_log_append(TS_LOG *log, uint64_t time, const void *payload);
+
+/// <summary>
+/// Commit the appended records and the segment header in one littlefs metadata commit.
+/// </summary>
+bool ts_log_sync(TS_LOG *log);
+
+/// <summary>
+/// Visit the records from firstTime to lastTime inclusive. Appended records are synced first.
+/// </summary>
+/// <returns>records visited, -1 if littlefs failed</returns>
+int ts_log_query(TS_LOG *log, uint64_t firstTime, uint64_t lastTime, TS_LOG_VISITOR visitor, void *context);
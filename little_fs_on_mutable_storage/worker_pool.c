@@ -0,0 +1,240 @@
+/* Copyright (c) Microsoft Corporation. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "worker_pool.h"
+
+#include "dx_timer.h"
+#include <applibs/eventloop.h>
+#include <applibs/log.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+typedef enum {
+    JOB_FREE,
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE // Waiting for the completion handler on the event loop thread
+} JOB_STATE;
+
+typedef struct {
+    JOB_STATE state;
+    uint32_t sequence; // Submission order
+    WORKER_POOL_JOB job;
+    WORKER_POOL_COMPLETION completion;
+    union {
+        max_align_t align;
+        unsigned char bytes[WORKER_POOL_CONTEXT_BYTES];
+    } context;
+} WORKER_POOL_SLOT;
+
+static WORKER_POOL_SLOT slots[WORKER_POOL_MAX_JOBS];
+static uint32_t next_sequence = 0;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_t threads[WORKER_POOL_MAX_THREADS];
+static size_t thread_count = 0;
+static atomic_bool closing = false;
+
+static int completion_fd = -1;
+static EventRegistration *completion_registration = NULL;
+
+// Oldest slot in the given state, call with pool_lock held
+static WORKER_POOL_SLOT *oldest_slot(JOB_STATE state)
+{
+    WORKER_POOL_SLOT *oldest = NULL;
+
+    for (size_t i = 0; i < WORKER_POOL_MAX_JOBS; i++) {
+        if (slots[i].state == state &&
+            (oldest == NULL || (int32_t)(slots[i].sequence - oldest->sequence) < 0)) {
+            oldest = &slots[i];
+        }
+    }
+    return oldest;
+}
+
+/// <summary>
+/// Event loop handler, run the completion of every finished job in submission order
+/// </summary>
+static void completion_handler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        Log_Debug("ERROR: worker pool eventfd read: errno=%d (%s)\n", errno, strerror(errno));
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        WORKER_POOL_SLOT *slot = oldest_slot(JOB_DONE);
+        pthread_mutex_unlock(&pool_lock);
+
+        if (slot == NULL) {
+            break;
+        }
+
+        // Only the event loop thread moves a slot out of JOB_DONE
+        if (slot->completion != NULL) {
+            slot->completion(slot->context.bytes, false);
+        }
+
+        pthread_mutex_lock(&pool_lock);
+        slot->state = JOB_FREE;
+        pthread_mutex_unlock(&pool_lock);
+    }
+}
+
+static void *worker(void *arg)
+{
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&pool_lock);
+
+    while (!closing) {
+        WORKER_POOL_SLOT *slot = oldest_slot(JOB_QUEUED);
+
+        if (slot == NULL) {
+            pthread_cond_wait(&job_queued, &pool_lock);
+            continue;
+        }
+
+        slot->state = JOB_RUNNING;
+        pthread_mutex_unlock(&pool_lock);
+
+        slot->job(slot->context.bytes);
+
+        pthread_mutex_lock(&pool_lock);
+        slot->state = JOB_DONE;
+
+        if (write(completion_fd, &one, sizeof(one)) < 0) {
+            Log_Debug("ERROR: worker pool eventfd write: errno=%d (%s)\n", errno, strerror(errno));
+        }
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+bool worker_pool_init(size_t threadCount)
+{
+    if (threadCount == 0 || threadCount > WORKER_POOL_MAX_THREADS) {
+        Log_Debug("ERROR: worker pool supports 1 to %d threads\n", WORKER_POOL_MAX_THREADS);
+        return false;
+    }
+
+    closing = false;
+    memset(slots, 0, sizeof(slots));
+
+    completion_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (completion_fd == -1) {
+        Log_Debug("ERROR: worker pool eventfd: errno=%d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    completion_registration = EventLoop_RegisterIo(dx_timerGetEventLoop(), completion_fd,
+                                                   EventLoop_Input, completion_handler, NULL);
+    if (completion_registration == NULL) {
+        Log_Debug("ERROR: worker pool EventLoop_RegisterIo failed\n");
+        worker_pool_close();
+        return false;
+    }
+
+    for (thread_count = 0; thread_count < threadCount; thread_count++) {
+        if (pthread_create(&threads[thread_count], NULL, worker, NULL) != 0) {
+            Log_Debug("ERROR: worker pool thread could not be started\n");
+            worker_pool_close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t worker_pool_thread_count(void)
+{
+    return thread_count;
+}
+
+void worker_pool_close(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    closing = true;
+    pthread_cond_broadcast(&job_queued);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (size_t i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    thread_count = 0;
+
+    // The workers have stopped, finish off what is left so callers can release resources
+    for (;;) {
+        WORKER_POOL_SLOT *slot = oldest_slot(JOB_DONE);
+        bool cancelled = false;
+
+        if (slot == NULL) {
+            slot = oldest_slot(JOB_QUEUED);
+            cancelled = true;
+        }
+        if (slot == NULL) {
+            break;
+        }
+
+        if (slot->completion != NULL) {
+            slot->completion(slot->context.bytes, cancelled);
+        }
+        slot->state = JOB_FREE;
+    }
+
+    if (completion_registration != NULL) {
+        EventLoop_UnregisterIo(dx_timerGetEventLoop(), completion_registration);
+        completion_registration = NULL;
+    }
+
+    if (completion_fd != -1) {
+        close(completion_fd);
+        completion_fd = -1;
+    }
+}
+
+bool worker_pool_submit(WORKER_POOL_JOB job, WORKER_POOL_COMPLETION completion,
+                        const void *context, size_t contextSize)
+{
+    WORKER_POOL_SLOT *slot = NULL;
+
+    if (job == NULL || contextSize > WORKER_POOL_CONTEXT_BYTES) {
+        return false;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+
+    if (thread_count > 0 && !closing) {
+        slot = oldest_slot(JOB_FREE);
+    }
+
+    if (slot != NULL) {
+        slot->job = job;
+        slot->completion = completion;
+        slot->sequence = next_sequence++;
+        memset(slot->context.bytes, 0, sizeof(slot->context.bytes));
+        if (context != NULL) {
+            memcpy(slot->context.bytes, context, contextSize);
+        }
+        slot->state = JOB_QUEUED;
+        pthread_cond_signal(&job_queued);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+
+    return slot != NULL;
+}
+
+bool worker_pool_closing(void)
+{
+    return closing;
+}
@@ -0,0 +1,10 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BUILD_OPTIONS_H
+#define BUILD_OPTIONS_H
+
+// Track live bytes, allocation counts and peak usage per malloc call site in this application's
+// code. Reported in the memory telemetry, by the getHeapSites direct method and in the debug
+// log, see heap_tracker.h
+//#define ENABLE_HEAP_TRACKING
+
+#endif 
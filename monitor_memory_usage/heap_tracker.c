@@ -0,0 +1,382 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "heap_tracker.h"
+
+#ifdef ENABLE_HEAP_TRACKING
+
+// This file is the tracker, it allocates from the real allocator
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+#include <applibs/log.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+// Open addressed, power of two. Blocks are only tracked while the table is at most 3/4 full,
+// so probes stay short.
+#define BLOCK_TABLE_MASK (HEAP_TRACKER_TABLE_SLOTS - 1)
+#define BLOCK_TABLE_LIMIT (HEAP_TRACKER_TABLE_SLOTS / 4 * 3)
+
+typedef struct {
+    void *pointer; // NULL when the slot is free
+    HEAP_TRACKER_SITE *site;
+    size_t size;
+} BLOCK;
+
+// Every site that has allocated at least once
+static HEAP_TRACKER_SITE *sites = NULL;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t total_live_bytes;
+static size_t total_peak_bytes;
+static uint32_t total_live_blocks;
+static uint32_t total_untracked;
+
+// Every live block allocated through the tracker. Whether a pointer is tracked is decided here,
+// never by reading memory around it, so pointers from other allocators are safe to pass in.
+static BLOCK blocks[HEAP_TRACKER_TABLE_SLOTS];
+
+// The build machine's directories are not interesting, report the file name only
+static const char *site_file(const HEAP_TRACKER_SITE *site)
+{
+    const char *slash = strrchr(site->file, '/');
+    return slash == NULL ? site->file : slash + 1;
+}
+
+static size_t block_slot(const void *pointer)
+{
+    // Fibonacci hashing, the low bits of heap pointers are mostly alignment
+    return (size_t)(((uint64_t)(uintptr_t)pointer * 0x9E3779B97F4A7C15ull) >> 32) &
+           BLOCK_TABLE_MASK;
+}
+
+// The block for pointer, NULL if it was not allocated through the tracker. Called with lock held.
+static BLOCK *find_block(const void *pointer)
+{
+    for (size_t slot = block_slot(pointer);; slot = (slot + 1) & BLOCK_TABLE_MASK) {
+        if (blocks[slot].pointer == pointer) {
+            return &blocks[slot];
+        }
+        if (blocks[slot].pointer == NULL) {
+            return NULL;
+        }
+    }
+}
+
+// Called with lock held, there has to be a free slot
+static void insert_block(void *pointer, HEAP_TRACKER_SITE *site, size_t size)
+{
+    size_t slot = block_slot(pointer);
+    while (blocks[slot].pointer != NULL) {
+        slot = (slot + 1) & BLOCK_TABLE_MASK;
+    }
+    blocks[slot] = (BLOCK){.pointer = pointer, .site = site, .size = size};
+}
+
+// Called with lock held. Moves later blocks of the probe run back so lookups need no tombstones.
+static void remove_block(BLOCK *block)
+{
+    size_t hole = (size_t)(block - blocks);
+
+    for (size_t slot = (hole + 1) & BLOCK_TABLE_MASK; blocks[slot].pointer != NULL;
+         slot = (slot + 1) & BLOCK_TABLE_MASK) {
+        size_t home = block_slot(blocks[slot].pointer);
+
+        // Move it into the hole unless its home slot lies after the hole in the probe run
+        if (((slot - home) & BLOCK_TABLE_MASK) >= ((slot - hole) & BLOCK_TABLE_MASK)) {
+            blocks[hole] = blocks[slot];
+            hole = slot;
+        }
+    }
+    blocks[hole].pointer = NULL;
+}
+
+// Called with lock held
+static void account_alloc(HEAP_TRACKER_SITE *site, size_t size)
+{
+    if (!site->registered) {
+        site->registered = true;
+        site->next = sites;
+        sites = site;
+    }
+
+    site->allocations++;
+    site->liveBlocks++;
+    site->liveBytes += size;
+    if (site->liveBytes > site->peakBytes) {
+        site->peakBytes = site->liveBytes;
+    }
+
+    total_live_blocks++;
+    total_live_bytes += size;
+    if (total_live_bytes > total_peak_bytes) {
+        total_peak_bytes = total_live_bytes;
+    }
+}
+
+// Called with lock held
+static void account_free(HEAP_TRACKER_SITE *site, size_t size)
+{
+    site->frees++;
+    site->liveBlocks--;
+    site->liveBytes -= size;
+    total_live_blocks--;
+    total_live_bytes -= size;
+}
+
+// Called with lock held. A full table leaves the block to the real allocator, uncounted.
+static void *track(void *pointer, size_t size, HEAP_TRACKER_SITE *site)
+{
+    if (pointer == NULL) {
+        return NULL;
+    }
+
+    if (total_live_blocks >= BLOCK_TABLE_LIMIT) {
+        total_untracked++;
+        return pointer;
+    }
+
+    insert_block(pointer, site, size);
+    account_alloc(site, size);
+    return pointer;
+}
+
+void *heap_tracker_malloc(size_t size, HEAP_TRACKER_SITE *site)
+{
+    void *pointer = malloc(size);
+
+    pthread_mutex_lock(&lock);
+    pointer = track(pointer, size, site);
+    pthread_mutex_unlock(&lock);
+
+    return pointer;
+}
+
+void *heap_tracker_calloc(size_t count, size_t size, HEAP_TRACKER_SITE *site)
+{
+    // calloc checks count * size for overflow, the product is only used once it succeeded
+    void *pointer = calloc(count, size);
+
+    pthread_mutex_lock(&lock);
+    pointer = track(pointer, count * size, site);
+    pthread_mutex_unlock(&lock);
+
+    return pointer;
+}
+
+void *heap_tracker_realloc(void *pointer, size_t size, HEAP_TRACKER_SITE *site)
+{
+    if (pointer == NULL) {
+        return heap_tracker_malloc(size, site);
+    }
+    if (size == 0) {
+        heap_tracker_free(pointer);
+        return NULL;
+    }
+
+    // Held across realloc, so the old address cannot be handed out and tracked again before its
+    // block is removed
+    pthread_mutex_lock(&lock);
+
+    BLOCK *block = find_block(pointer);
+    void *resized = realloc(pointer, size);
+
+    if (block != NULL && resized != NULL) {
+        // The block now belongs to the site that resized it
+        account_free(block->site, block->size);
+        block->site->frees--; // A resize is not a free
+        remove_block(block);
+        track(resized, size, site);
+    }
+    // On failure the old block is untouched and still accounted to its site
+
+    pthread_mutex_unlock(&lock);
+    return resized;
+}
+
+void heap_tracker_free(void *pointer)
+{
+    if (pointer == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    // Blocks allocated by a library, or while the table was full, are not in the table
+    BLOCK *block = find_block(pointer);
+    if (block != NULL) {
+        account_free(block->site, block->size);
+        remove_block(block);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    // Out of the table first, the address may be handed out again as soon as it is freed
+    free(pointer);
+}
+
+uint32_t heap_tracker_sample(void)
+{
+    uint32_t started = 0;
+
+    pthread_mutex_lock(&lock);
+
+    for (HEAP_TRACKER_SITE *site = sites; site != NULL; site = site->next) {
+        bool growing = true;
+
+        if (site->sampleCount == HEAP_TRACKER_GROWTH_SAMPLES) {
+            memmove(&site->samples[0], &site->samples[1],
+                    (HEAP_TRACKER_GROWTH_SAMPLES - 1) * sizeof(site->samples[0]));
+            site->sampleCount--;
+        }
+        site->samples[site->sampleCount++] = site->liveBytes;
+
+        if (site->sampleCount < HEAP_TRACKER_GROWTH_SAMPLES ||
+            site->samples[HEAP_TRACKER_GROWTH_SAMPLES - 1] <= site->samples[0]) {
+            growing = false;
+        }
+        for (uint32_t i = 1; growing && i < site->sampleCount; i++) {
+            growing = site->samples[i] >= site->samples[i - 1];
+        }
+
+        if (growing && !site->growing) {
+            Log_Debug("WARNING: heap growing at %s:%d, %zu bytes in %lu blocks\n", site_file(site),
+                      site->line, site->liveBytes, (unsigned long)site->liveBlocks);
+            started++;
+        }
+        site->growing = growing;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return started;
+}
+
+void heap_tracker_get_totals(HEAP_TRACKER_TOTALS *totals)
+{
+    pthread_mutex_lock(&lock);
+
+    *totals = (HEAP_TRACKER_TOTALS){.liveBytes = total_live_bytes,
+                                    .peakBytes = total_peak_bytes,
+                                    .liveBlocks = total_live_blocks,
+                                    .untrackedBlocks = total_untracked};
+
+    for (HEAP_TRACKER_SITE *site = sites; site != NULL; site = site->next) {
+        totals->sites++;
+        if (site->growing) {
+            totals->growingSites++;
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+// Fill largest[] with the sites holding the most live bytes, most first. Called with lock held.
+static size_t largest_sites(HEAP_TRACKER_SITE *largest[HEAP_TRACKER_REPORT_SITES])
+{
+    size_t count = 0;
+
+    for (HEAP_TRACKER_SITE *site = sites; site != NULL; site = site->next) {
+        size_t position = count;
+
+        while (position > 0 && largest[position - 1]->liveBytes < site->liveBytes) {
+            position--;
+        }
+
+        if (position < HEAP_TRACKER_REPORT_SITES) {
+            size_t last = count < HEAP_TRACKER_REPORT_SITES ? count : HEAP_TRACKER_REPORT_SITES - 1;
+            memmove(&largest[position + 1], &largest[position],
+                    (last - position) * sizeof(largest[0]));
+            largest[position] = site;
+            if (count < HEAP_TRACKER_REPORT_SITES) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+bool heap_tracker_top_site(char *name, size_t size, size_t *liveBytes)
+{
+    HEAP_TRACKER_SITE *largest[HEAP_TRACKER_REPORT_SITES];
+
+    pthread_mutex_lock(&lock);
+
+    bool found = largest_sites(largest) > 0;
+    if (found) {
+        snprintf(name, size, "%s:%d", site_file(largest[0]), largest[0]->line);
+        *liveBytes = largest[0]->liveBytes;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+void heap_tracker_log_report(void)
+{
+    HEAP_TRACKER_SITE *largest[HEAP_TRACKER_REPORT_SITES];
+
+    pthread_mutex_lock(&lock);
+
+    size_t count = largest_sites(largest);
+    Log_Debug("Heap: %zu bytes live in %lu blocks, peak %zu, %lu not tracked. Largest %zu sites: "
+              "live blocks peak | allocs frees\n",
+              total_live_bytes, (unsigned long)total_live_blocks, total_peak_bytes,
+              (unsigned long)total_untracked, count);
+
+    for (size_t i = 0; i < count; i++) {
+        HEAP_TRACKER_SITE *site = largest[i];
+        Log_Debug("  %s:%-5d %10zu %6lu %10zu | %8lu %8lu%s\n", site_file(site), site->line,
+                  site->liveBytes, (unsigned long)site->liveBlocks, site->peakBytes,
+                  (unsigned long)site->allocations, (unsigned long)site->frees,
+                  site->growing ? " growing" : "");
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+char *heap_tracker_report_json(void)
+{
+    static const char siteFormat[] = "%s{\"site\":\"%s:%d\",\"liveBytes\":%zu,\"liveBlocks\":%lu,"
+                                     "\"peakBytes\":%zu,\"allocations\":%lu,\"frees\":%lu,"
+                                     "\"growing\":%s}";
+    HEAP_TRACKER_SITE *largest[HEAP_TRACKER_REPORT_SITES];
+
+    pthread_mutex_lock(&lock);
+
+    size_t count = largest_sites(largest);
+    size_t size = 128 + count * (sizeof(siteFormat) + 64 + 5 * 20);
+    char *json = malloc(size);
+
+    if (json == NULL) {
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+
+    size_t len = (size_t)snprintf(json, size,
+                                  "{\"liveBytes\":%zu,\"liveBlocks\":%lu,\"peakBytes\":%zu,\"sites\":[",
+                                  total_live_bytes, (unsigned long)total_live_blocks,
+                                  total_peak_bytes);
+
+    for (size_t i = 0; i < count; i++) {
+        HEAP_TRACKER_SITE *site = largest[i];
+        int written = snprintf(json + len, size - len, siteFormat, i == 0 ? "" : ",",
+                               site_file(site), site->line, site->liveBytes,
+                               (unsigned long)site->liveBlocks, site->peakBytes,
+                               (unsigned long)site->allocations, (unsigned long)site->frees,
+                               site->growing ? "true" : "false");
+        if (written < 0 || (size_t)written >= size - len) {
+            break;
+        }
+        len += (size_t)written;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    snprintf(json + len, size - len, "]}");
+    return json;
+}
+
+#endif // ENABLE_HEAP_TRACKING
@@ -0,0 +1,107 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include "build_options.h"
+
+// Define ENABLE_HEAP_TRACKING in build_options.h to count live bytes, allocations and
+// peak usage for every malloc, calloc, realloc and free call site in the files that include it.
+// Unlike Applications_GetPeakUserModeMemoryUsageInKB() this sees frees, and names the call site
+// that is holding the memory. When it is not defined nothing is redirected.
+//
+// Only code that includes this header is tracked, DevX, parson and the Azure IoT SDK are not.
+// Tracked blocks are kept in a fixed table, HEAP_TRACKER_TABLE_SLOTS / 4 * 3 of them at most,
+// allocations beyond that are served but counted as untracked. Memory passed to a library that
+// frees it itself, such as a direct method responseMsg, has to come from the untracked
+// allocator, call it as (malloc)(size). Blocks the libraries allocate can still be given to
+// free(), pointers not in the table are passed straight through.
+//
+// tools/heap_tracker_bench.c checks the totals and measures the cost per call on a Linux host,
+// tools/memory_leak_replay.c replays the MemoryLeak direct method against the tracker.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h> // Declared before malloc and friends are redirected below
+
+#ifdef ENABLE_HEAP_TRACKING
+
+// Number of heap_tracker_sample() calls a site's live bytes have to keep growing over, without
+// ever going down, before it is reported as growing
+#define HEAP_TRACKER_GROWTH_SAMPLES 4
+
+// Size of the table of tracked blocks, a power of two
+#define HEAP_TRACKER_TABLE_SLOTS 1024
+
+// Sites listed in the log report and the getHeapSites response, largest live bytes first
+#define HEAP_TRACKER_REPORT_SITES 8
+
+typedef struct HEAP_TRACKER_SITE {
+    const char *file;
+    int line;
+    struct HEAP_TRACKER_SITE *next;
+    bool registered;
+    size_t liveBytes;
+    size_t peakBytes;
+    uint32_t liveBlocks;
+    uint32_t allocations;
+    uint32_t frees;
+    // Live bytes at the last HEAP_TRACKER_GROWTH_SAMPLES samples, oldest first
+    size_t samples[HEAP_TRACKER_GROWTH_SAMPLES];
+    uint32_t sampleCount;
+    bool growing;
+} HEAP_TRACKER_SITE;
+
+typedef struct {
+    size_t liveBytes;
+    size_t peakBytes;
+    uint32_t liveBlocks;
+    uint32_t untrackedBlocks; // Allocated while the table was full
+    uint32_t sites;
+    uint32_t growingSites;
+} HEAP_TRACKER_TOTALS;
+
+void *heap_tracker_malloc(size_t size, HEAP_TRACKER_SITE *site);
+void *heap_tracker_calloc(size_t count, size_t size, HEAP_TRACKER_SITE *site);
+void *heap_tracker_realloc(void *pointer, size_t size, HEAP_TRACKER_SITE *site);
+void heap_tracker_free(void *pointer);
+
+/// <summary>
+/// Take one growth sample for every site, call it periodically. A site whose live bytes have
+/// not gone down over the last HEAP_TRACKER_GROWTH_SAMPLES samples, and are higher than at the
+/// first of them, is marked growing.
+/// </summary>
+/// <returns>Number of sites that started growing with this sample</returns>
+uint32_t heap_tracker_sample(void);
+
+void heap_tracker_get_totals(HEAP_TRACKER_TOTALS *totals);
+
+/// <summary>
+/// Name, as file:line, and live bytes of the site holding the most memory.
+/// </summary>
+/// <returns>false before anything has been allocated</returns>
+bool heap_tracker_top_site(char *name, size_t size, size_t *liveBytes);
+
+/// <summary>
+/// Log the sites holding the most memory.
+/// </summary>
+void heap_tracker_log_report(void);
+
+/// <summary>
+/// The same report as JSON, from the untracked allocator so it can be a direct method response.
+/// </summary>
+char *heap_tracker_report_json(void);
+
+#define HEAP_TRACKER_CALL(call, ...)                                                               \
+    ({                                                                                             \
+        static HEAP_TRACKER_SITE heap_tracker_site_ = {.file = __FILE__, .line = __LINE__};       \
+        call(__VA_ARGS__, &heap_tracker_site_);                                                    \
+    })
+
+#define malloc(size) HEAP_TRACKER_CALL(heap_tracker_malloc, size)
+#define calloc(count, size) HEAP_TRACKER_CALL(heap_tracker_calloc, count, size)
+#define realloc(pointer, size) HEAP_TRACKER_CALL(heap_tracker_realloc, pointer, size)
+#define free(pointer) heap_tracker_free(pointer)
+
+#endif // ENABLE_HEAP_TRACKING
@@ -117,9 +117,81 @@ static DX_TIMER_HANDLER(monitor_memory_handler)
             }
         }
     }
+
+#ifdef ENABLE_HEAP_TRACKING
+    report_heap_sites();
+#endif // ENABLE_HEAP_TRACKING
 }
 DX_TIMER_HANDLER_END
 
+#ifdef ENABLE_HEAP_TRACKING
+/// <summary>
+/// Sample every tracked call site for growth and send the heap totals and the call site holding
+/// the most memory whenever they change. Unlike the OS high water mark these go down on free.
+/// </summary>
+static void report_heap_sites(void)
+{
+    static size_t lastLiveBytes = 0;
+    HEAP_TRACKER_TOTALS totals;
+    char topSite[64];
+    size_t topSiteBytes = 0;
+
+    uint32_t startedGrowing = heap_tracker_sample();
+    heap_tracker_get_totals(&totals);
+
+    if (totals.liveBytes == lastLiveBytes && startedGrowing == 0) {
+        return;
+    }
+    lastLiveBytes = totals.liveBytes;
+    heap_tracker_log_report();
+
+    if (!heap_tracker_top_site(topSite, sizeof(topSite), &topSiteBytes)) {
+        return;
+    }
+
+#ifdef USE_AVNET_IOTCONNECT
+    if (dx_isAvnetConnected()) {
+        bool serialization_result = dx_avnetJsonSerialize(msgBuffer, sizeof(msgBuffer), NULL, 5,
+                                    DX_JSON_INT, "HeapLiveBytes", (int)totals.liveBytes,
+                                    DX_JSON_INT, "HeapPeakBytes", (int)totals.peakBytes,
+                                    DX_JSON_INT, "HeapGrowingSites", (int)totals.growingSites,
+                                    DX_JSON_STRING, "HeapTopSite", topSite,
+                                    DX_JSON_INT, "HeapTopSiteBytes", (int)topSiteBytes);
+#else
+    if (dx_isAzureConnected()) {
+        bool serialization_result = dx_jsonSerialize(msgBuffer, sizeof(msgBuffer), 5,
+                                    DX_JSON_INT, "HeapLiveBytes", (int)totals.liveBytes,
+                                    DX_JSON_INT, "HeapPeakBytes", (int)totals.peakBytes,
+                                    DX_JSON_INT, "HeapGrowingSites", (int)totals.growingSites,
+                                    DX_JSON_STRING, "HeapTopSite", topSite,
+                                    DX_JSON_INT, "HeapTopSiteBytes", (int)topSiteBytes);
+#endif
+        if (serialization_result) {
+            Log_Debug("%s\n", msgBuffer);
+            dx_azurePublish(msgBuffer, strlen(msgBuffer), memoryMessageProperties, NELEMS(memoryMessageProperties), &contentProperties);
+        } else {
+            Log_Debug("JSON Serialization failed: Buffer too small\n");
+        }
+    }
+}
+
+/// <summary>
+///  name: getHeapSites
+///  Returns the tracked call sites holding the most memory, with their allocation and free
+///  counts and whether they are growing
+/// </summary>
+static DX_DIRECT_METHOD_HANDLER(HeapSitesHandler, json, directMethodBinding, responseMsg)
+{
+    // From the untracked allocator, DevX frees the response
+    *responseMsg = heap_tracker_report_json();
+    if (*responseMsg == NULL) {
+        return DX_METHOD_FAILED;
+    }
+    return DX_METHOD_SUCCEEDED;
+}
+DX_DIRECT_METHOD_HANDLER_END
+#endif // ENABLE_HEAP_TRACKING
+
 /// <summary>
 ///  Initialize peripherals, device twins, direct methods, timer_bindings.
 /// </summary>
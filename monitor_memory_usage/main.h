@@ -1,6 +1,7 @@
 #include "hw/azure_sphere_learning_path.h" // Hardware definition
 
 #include "app_exit_codes.h"
+#include "build_options.h"
 #include "dx_azure_iot.h"
 #include "dx_config.h"
 #include "dx_json_serializer.h"
@@ -12,6 +13,9 @@
 #include <applibs/log.h>
 #include <applibs/applications.h>
 
+// Last, it redirects malloc and friends when ENABLE_HEAP_TRACKING is defined
+#include "heap_tracker.h"
+
 // Use main.h to define all your application definitions, message properties/contentProperties,
 // bindings and binding sets.
 
@@ -41,6 +45,10 @@ DX_USER_CONFIG dx_config;
  ****************************************************************************************/
 static DX_DECLARE_DIRECT_METHOD_HANDLER(MemoryLeakHandler);
 static DX_DECLARE_TIMER_HANDLER(monitor_memory_handler);
+#ifdef ENABLE_HEAP_TRACKING
+static DX_DECLARE_DIRECT_METHOD_HANDLER(HeapSitesHandler);
+static void report_heap_sites(void);
+#endif // ENABLE_HEAP_TRACKING
 
 /****************************************************************************************
  * Telemetry message buffer property sets
@@ -64,6 +72,9 @@ static DX_MESSAGE_CONTENT_PROPERTIES contentProperties = {.contentEncoding = "ut
  * DevX Bindings
  ****************************************************************************************/
 static DX_DIRECT_METHOD_BINDING dm_memory_leak = {.methodName = "MemoryLeak", .handler = MemoryLeakHandler};
+#ifdef ENABLE_HEAP_TRACKING
+static DX_DIRECT_METHOD_BINDING dm_heap_sites = {.methodName = "getHeapSites", .handler = HeapSitesHandler};
+#endif // ENABLE_HEAP_TRACKING
 static DX_TIMER_BINDING tmr_monitor_memory = {.period = {MONITOR_PERIOD, 0}, .name = "tmr_monitor_memory", .handler = monitor_memory_handler};
 
 /****************************************************************************************
@@ -72,6 +83,10 @@ static DX_TIMER_BINDING tmr_monitor_memory = {.period = {MONITOR_PERIOD, 0}, .na
 // These sets are used by the initailization code.
 
 DX_DEVICE_TWIN_BINDING *device_twin_bindings[] = {};
+#ifdef ENABLE_HEAP_TRACKING
+DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_memory_leak, &dm_heap_sites};
+#else
 DX_DIRECT_METHOD_BINDING *direct_method_bindings[] = {&dm_memory_leak};
+#endif // ENABLE_HEAP_TRACKING
 DX_GPIO_BINDING *gpio_bindings[] = {};
 DX_TIMER_BINDING *timer_bindings[] = {&tmr_monitor_memory};
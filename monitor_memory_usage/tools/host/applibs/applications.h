@@ -0,0 +1,12 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory. Each tool defines
+// the functions itself.
+
+#pragma once
+
+#include <stddef.h>
+
+size_t Applications_GetTotalMemoryUsageInKB(void);
+size_t Applications_GetPeakUserModeMemoryUsageInKB(void);
@@ -0,0 +1,13 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the Azure Sphere header, for the tools in this directory. Each tool defines
+// the functions itself.
+
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct EventLoop EventLoop;
+
+int EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event);
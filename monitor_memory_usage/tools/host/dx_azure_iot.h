@@ -0,0 +1,30 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. Each tool defines the
+// functions itself. Like the DevX include chain it brings in the twin, direct method and GPIO
+// headers main.h uses.
+
+#pragma once
+
+#include "dx_config.h"
+#include "dx_device_twins.h"
+#include "dx_direct_methods.h"
+#include "dx_gpio.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *key;
+    const char *value;
+} DX_MESSAGE_PROPERTY;
+
+typedef struct {
+    const char *contentEncoding;
+    const char *contentType;
+} DX_MESSAGE_CONTENT_PROPERTIES;
+
+void dx_azureConnect(DX_USER_CONFIG *userConfig, const char *networkInterface, const char *plugAndPlayModelId);
+bool dx_isAzureConnected(void);
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties);
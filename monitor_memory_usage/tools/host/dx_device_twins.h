@@ -0,0 +1,18 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. The example has no device
+// twins, only the binding type and the subscribe calls are declared.
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct _deviceTwinBinding {
+    const char *propertyName;
+    void *propertyValue;
+    void (*handler)(struct _deviceTwinBinding *deviceTwinBinding);
+} DX_DEVICE_TWIN_BINDING;
+
+void dx_deviceTwinSubscribe(DX_DEVICE_TWIN_BINDING *deviceTwins[], size_t deviceTwinCount);
+void dx_deviceTwinUnsubscribe(void);
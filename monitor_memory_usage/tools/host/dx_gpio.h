@@ -0,0 +1,18 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. The example opens no
+// GPIOs, only the binding type and the set calls are declared.
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct {
+    int fd;
+    int pin;
+    const char *name;
+} DX_GPIO_BINDING;
+
+void dx_gpioSetOpen(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount);
+void dx_gpioSetClose(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount);
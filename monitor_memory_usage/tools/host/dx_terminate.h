@@ -0,0 +1,15 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. Each tool defines the
+// functions itself.
+
+#pragma once
+
+#include "dx_exit_codes.h"
+#include <stdbool.h>
+
+void dx_registerTerminationHandler(void);
+void dx_terminate(int exitCode);
+bool dx_isTerminationRequired(void);
+int dx_getTerminationExitCode(void);
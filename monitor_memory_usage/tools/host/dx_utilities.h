@@ -0,0 +1,16 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory. Like the DevX header it
+// brings in the C library headers main.c relies on.
+
+#pragma once
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NELEMS(x) (sizeof(x) / sizeof((x)[0]))
+#define IN_RANGE(number, low, high) ((low) <= (number) && (number) <= (high))
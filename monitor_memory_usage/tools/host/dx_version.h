@@ -0,0 +1,8 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the DevX header, for the tools in this directory
+
+#pragma once
+
+#define AZURE_SPHERE_DEVX_VERSION 0
@@ -0,0 +1,7 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for the hardware definition, for the tools in this directory. The example uses
+// no pins.
+
+#pragma once
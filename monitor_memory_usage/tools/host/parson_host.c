@@ -0,0 +1,238 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host stand-in for parson, see parson.h in this directory
+
+#include "parson.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MEMBERS 32
+
+struct json_object_t {
+    size_t count;
+    char *names[MAX_MEMBERS];
+    JSON_Value *values[MAX_MEMBERS];
+};
+
+struct json_value_t {
+    JSON_Value_Type type;
+    union {
+        char *string;
+        double number;
+        int boolean;
+        JSON_Object *object;
+    } value;
+};
+
+static JSON_Value *parse_value(const char **cursor);
+
+static void skip_space(const char **cursor)
+{
+    while (isspace((unsigned char)**cursor)) {
+        (*cursor)++;
+    }
+}
+
+static char *parse_string(const char **cursor)
+{
+    const char *start = ++(*cursor);
+    const char *end = strchr(start, '"');
+
+    if (end == NULL) {
+        return NULL;
+    }
+    *cursor = end + 1;
+    return strndup(start, (size_t)(end - start));
+}
+
+static JSON_Value *new_value(JSON_Value_Type type)
+{
+    JSON_Value *value = calloc(1, sizeof(JSON_Value));
+
+    if (value != NULL) {
+        value->type = type;
+    }
+    return value;
+}
+
+static JSON_Value *parse_object(const char **cursor)
+{
+    JSON_Value *value = new_value(JSONObject);
+
+    if (value == NULL || (value->value.object = calloc(1, sizeof(JSON_Object))) == NULL) {
+        free(value);
+        return NULL;
+    }
+    JSON_Object *object = value->value.object;
+
+    (*cursor)++;
+    skip_space(cursor);
+    if (**cursor == '}') {
+        (*cursor)++;
+        return value;
+    }
+
+    for (;;) {
+        skip_space(cursor);
+        if (**cursor != '"' || object->count == MAX_MEMBERS) {
+            break;
+        }
+        char *name = parse_string(cursor);
+        skip_space(cursor);
+        if (name == NULL || *(*cursor)++ != ':') {
+            free(name);
+            break;
+        }
+        JSON_Value *member = parse_value(cursor);
+        if (member == NULL) {
+            free(name);
+            break;
+        }
+        object->names[object->count] = name;
+        object->values[object->count++] = member;
+
+        skip_space(cursor);
+        if (**cursor == ',') {
+            (*cursor)++;
+        } else if (*(*cursor)++ == '}') {
+            return value;
+        } else {
+            break;
+        }
+    }
+
+    json_value_free(value);
+    return NULL;
+}
+
+static JSON_Value *parse_value(const char **cursor)
+{
+    JSON_Value *value = NULL;
+
+    skip_space(cursor);
+    if (**cursor == '{') {
+        return parse_object(cursor);
+    }
+    if (**cursor == '"') {
+        if ((value = new_value(JSONString)) != NULL && (value->value.string = parse_string(cursor)) == NULL) {
+            free(value);
+            value = NULL;
+        }
+    } else if (strncmp(*cursor, "true", 4) == 0 || strncmp(*cursor, "false", 5) == 0) {
+        if ((value = new_value(JSONBoolean)) != NULL) {
+            value->value.boolean = **cursor == 't';
+            *cursor += value->value.boolean ? 4 : 5;
+        }
+    } else if (strncmp(*cursor, "null", 4) == 0) {
+        value = new_value(JSONNull);
+        *cursor += 4;
+    } else {
+        char *end;
+        double number = strtod(*cursor, &end);
+        if (end != *cursor && (value = new_value(JSONNumber)) != NULL) {
+            value->value.number = number;
+            *cursor = end;
+        }
+    }
+    return value;
+}
+
+JSON_Value *json_parse_string(const char *string)
+{
+    return string == NULL ? NULL : parse_value(&string);
+}
+
+void json_value_free(JSON_Value *value)
+{
+    if (value == NULL) {
+        return;
+    }
+    if (value->type == JSONString) {
+        free(value->value.string);
+    } else if (value->type == JSONObject) {
+        for (size_t i = 0; i < value->value.object->count; i++) {
+            free(value->value.object->names[i]);
+            json_value_free(value->value.object->values[i]);
+        }
+        free(value->value.object);
+    }
+    free(value);
+}
+
+JSON_Value_Type json_value_get_type(const JSON_Value *value)
+{
+    return value == NULL ? JSONError : value->type;
+}
+
+JSON_Object *json_value_get_object(const JSON_Value *value)
+{
+    return json_value_get_type(value) == JSONObject ? value->value.object : NULL;
+}
+
+const char *json_value_get_string(const JSON_Value *value)
+{
+    return json_value_get_type(value) == JSONString ? value->value.string : NULL;
+}
+
+double json_value_get_number(const JSON_Value *value)
+{
+    return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
+}
+
+int json_value_get_boolean(const JSON_Value *value)
+{
+    return json_value_get_type(value) == JSONBoolean ? value->value.boolean : -1;
+}
+
+size_t json_object_get_count(const JSON_Object *object)
+{
+    return object == NULL ? 0 : object->count;
+}
+
+const char *json_object_get_name(const JSON_Object *object, size_t index)
+{
+    return index < json_object_get_count(object) ? object->names[index] : NULL;
+}
+
+JSON_Value *json_object_get_value_at(const JSON_Object *object, size_t index)
+{
+    return index < json_object_get_count(object) ? object->values[index] : NULL;
+}
+
+JSON_Value *json_object_get_value(const JSON_Object *object, const char *name)
+{
+    for (size_t i = 0; i < json_object_get_count(object); i++) {
+        if (strcmp(object->names[i], name) == 0) {
+            return object->values[i];
+        }
+    }
+    return NULL;
+}
+
+JSON_Object *json_object_get_object(const JSON_Object *object, const char *name)
+{
+    return json_value_get_object(json_object_get_value(object, name));
+}
+
+int json_object_has_value_of_type(const JSON_Object *object, const char *name, JSON_Value_Type type)
+{
+    return json_value_get_type(json_object_get_value(object, name)) == type;
+}
+
+double json_object_get_number(const JSON_Object *object, const char *name)
+{
+    return json_value_get_number(json_object_get_value(object, name));
+}
+
+int json_object_get_boolean(const JSON_Object *object, const char *name)
+{
+    return json_value_get_boolean(json_object_get_value(object, name));
+}
+
+const char *json_object_get_string(const JSON_Object *object, const char *name)
+{
+    return json_value_get_string(json_object_get_value(object, name));
+}
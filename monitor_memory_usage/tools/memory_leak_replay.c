@@ -0,0 +1,249 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License.
+
+   Host replay of the MemoryLeak direct method against the heap tracker. It builds main.c
+   unchanged with ENABLE_HEAP_TRACKING and the DevX stand-ins in host/, and calls its handlers
+   the way DevX would, on a simulated REPLAY_MINUTES timeline:
+
+   - monitor_memory_handler every MONITOR_PERIOD seconds, which samples the tracker
+   - every period, telemetry buffers allocated and freed again, a site that never grows
+   - a receive buffer resized up and down between 1 and 4 KB, a site that goes up and down
+   - from LEAK_START_MINUTES, MemoryLeak with {"LeakSize":LEAK_KB} every LEAK_EVERY_MINUTES
+   - getHeapSites at the end
+
+   It prints when the tracker first reported each site as growing and how many leak calls had
+   been made by then, the site at the top of the report, and the getHeapSites response. The
+   tracker's own log goes to stderr.
+
+   Build: gcc -O2 -DENABLE_HEAP_TRACKING -I host -I .. -o memory_leak_replay memory_leak_replay.c
+              ../heap_tracker.c host/parson_host.c -lpthread
+   Usage: memory_leak_replay 2>/dev/null
+*/
+
+// The application, with its main() renamed so this file can drive it
+#define main memory_monitor_main
+#include "main.c"
+#undef main
+
+#include <stdarg.h>
+
+#define REPLAY_MINUTES 60
+#define LEAK_START_MINUTES 10
+#define LEAK_EVERY_MINUTES 2
+#define LEAK_KB 5
+#define TELEMETRY_BUFFERS 10
+
+static int published;
+
+// DevX stand-ins
+int ConsumeEventLoopTimerEvent(EventLoopTimer *eventLoopTimer)
+{
+    (void)eventLoopTimer;
+    return 0;
+}
+
+bool dx_isAzureConnected(void)
+{
+    return true;
+}
+
+bool dx_azurePublish(const void *message, size_t messageLength, DX_MESSAGE_PROPERTY **messageProperties,
+                     size_t messagePropertyCount, DX_MESSAGE_CONTENT_PROPERTIES *messageContentProperties)
+{
+    (void)message;
+    (void)messageLength;
+    (void)messageProperties;
+    (void)messagePropertyCount;
+    (void)messageContentProperties;
+    published++;
+    return true;
+}
+
+// Start up and shut down, main.c's own main() is not run
+void dx_registerTerminationHandler(void) {}
+void dx_terminate(int exitCode) { (void)exitCode; }
+bool dx_isTerminationRequired(void) { return false; }
+int dx_getTerminationExitCode(void) { return 0; }
+bool dx_configParseCmdLineArguments(int argc, char *argv[], DX_USER_CONFIG *userConfig)
+{
+    (void)argc;
+    (void)argv;
+    (void)userConfig;
+    return true;
+}
+void dx_azureConnect(DX_USER_CONFIG *userConfig, const char *networkInterface, const char *plugAndPlayModelId)
+{
+    (void)userConfig;
+    (void)networkInterface;
+    (void)plugAndPlayModelId;
+}
+void dx_gpioSetOpen(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount) { (void)gpioSet; (void)gpioSetCount; }
+void dx_gpioSetClose(DX_GPIO_BINDING **gpioSet, size_t gpioSetCount) { (void)gpioSet; (void)gpioSetCount; }
+void dx_timerSetStart(DX_TIMER_BINDING *timerSet[], size_t timerCount) { (void)timerSet; (void)timerCount; }
+void dx_timerSetStop(DX_TIMER_BINDING *timerSet[], size_t timerCount) { (void)timerSet; (void)timerCount; }
+void dx_timerEventLoopStop(void) {}
+EventLoop *dx_timerGetEventLoop(void) { return NULL; }
+int EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event)
+{
+    (void)el;
+    (void)duration_in_milliseconds;
+    (void)process_one_event;
+    return 0;
+}
+void dx_deviceTwinSubscribe(DX_DEVICE_TWIN_BINDING *deviceTwins[], size_t deviceTwinCount)
+{
+    (void)deviceTwins;
+    (void)deviceTwinCount;
+}
+void dx_deviceTwinUnsubscribe(void) {}
+void dx_directMethodSubscribe(DX_DIRECT_METHOD_BINDING *directMethods[], size_t directMethodCount)
+{
+    (void)directMethods;
+    (void)directMethodCount;
+}
+void dx_directMethodUnsubscribe(void) {}
+
+// Only the DX_JSON_INT and DX_JSON_STRING pairs main.c serializes
+bool dx_jsonSerialize(char *buffer, size_t bufferSize, int keyValueCount, ...)
+{
+    va_list args;
+    size_t length = 1;
+
+    va_start(args, keyValueCount);
+    snprintf(buffer, bufferSize, "{");
+    for (int i = 0; i < keyValueCount && length < bufferSize; i++) {
+        DX_JSON_TYPE type = va_arg(args, DX_JSON_TYPE);
+        const char *key = va_arg(args, const char *);
+        int written;
+
+        if (type == DX_JSON_STRING) {
+            written = snprintf(buffer + length, bufferSize - length, "%s\"%s\":\"%s\"", i == 0 ? "" : ",", key,
+                               va_arg(args, const char *));
+        } else {
+            written = snprintf(buffer + length, bufferSize - length, "%s\"%s\":%d", i == 0 ? "" : ",", key,
+                               va_arg(args, int));
+        }
+        length += written < 0 ? 0 : (size_t)written;
+    }
+    va_end(args);
+
+    if (length + 2 > bufferSize) {
+        return false;
+    }
+    snprintf(buffer + length, bufferSize - length, "}");
+    return true;
+}
+
+// The process high water mark, as the OS reports it on the device
+size_t Applications_GetPeakUserModeMemoryUsageInKB(void)
+{
+    char line[128];
+    size_t peakKB = 0;
+    FILE *status = fopen("/proc/self/status", "r");
+
+    if (status != NULL) {
+        while (fgets(line, sizeof(line), status) != NULL && sscanf(line, "VmHWM: %zu", &peakKB) != 1) {
+        }
+        fclose(status);
+    }
+    return peakKB;
+}
+
+// The workload, allocated here so it shows up as this file's call sites
+static void SendTelemetry(void)
+{
+    char *buffers[TELEMETRY_BUFFERS];
+
+    for (int i = 0; i < TELEMETRY_BUFFERS; i++) {
+        buffers[i] = malloc(256);
+    }
+    for (int i = 0; i < TELEMETRY_BUFFERS; i++) {
+        free(buffers[i]);
+    }
+}
+
+static void ResizeReceiveBuffer(char **buffer, int period)
+{
+    static const size_t sizes[] = {1024, 4096, 2048, 3072, 1024, 4096, 1536};
+    char *resized = realloc(*buffer, sizes[period % (int)NELEMS(sizes)]);
+
+    if (resized != NULL) {
+        *buffer = resized;
+    }
+}
+
+static DX_DIRECT_METHOD_RESPONSE_CODE CallMethod(DX_DIRECT_METHOD_BINDING *binding, const char *payload,
+                                                 char **response)
+{
+    JSON_Value *json = json_parse_string(payload);
+    DX_DIRECT_METHOD_RESPONSE_CODE result = binding->handler(json, binding, response);
+
+    json_value_free(json);
+    return result;
+}
+
+int main(void)
+{
+    const int periods = REPLAY_MINUTES * 60 / MONITOR_PERIOD;
+    char *receiveBuffer = NULL;
+    int leakCalls = 0;
+    int leakFlagged = -1;
+    int leakCallsWhenFlagged = 0;
+    int otherFlagged = 0;
+    char payload[32];
+    char topSite[64];
+    size_t topSiteBytes = 0;
+
+    snprintf(payload, sizeof(payload), "{\"LeakSize\":%d}", LEAK_KB);
+
+    for (int period = 1; period <= periods; period++) {
+        int seconds = period * MONITOR_PERIOD;
+
+        SendTelemetry();
+        ResizeReceiveBuffer(&receiveBuffer, period);
+
+        if (seconds >= LEAK_START_MINUTES * 60 && (seconds - LEAK_START_MINUTES * 60) % (LEAK_EVERY_MINUTES * 60) == 0) {
+            char *response = NULL;
+            if (CallMethod(&dm_memory_leak, payload, &response) == DX_METHOD_SUCCEEDED) {
+                leakCalls++;
+            }
+        }
+
+        monitor_memory_handler(NULL);
+
+        // Which sites the tracker now calls growing
+        HEAP_TRACKER_TOTALS totals;
+        heap_tracker_get_totals(&totals);
+        if (totals.growingSites == 0) {
+            continue;
+        }
+        if (heap_tracker_top_site(topSite, sizeof(topSite), &topSiteBytes) && strstr(topSite, "main.c") != NULL &&
+            leakFlagged < 0) {
+            leakFlagged = seconds;
+            leakCallsWhenFlagged = leakCalls;
+        }
+        if (totals.growingSites > (leakFlagged >= 0 ? 1u : 0u)) {
+            otherFlagged++;
+        }
+    }
+
+    if (leakFlagged >= 0) {
+        printf("leak site reported growing at %d min %d s, after %d MemoryLeak calls\n", leakFlagged / 60,
+               leakFlagged % 60, leakCallsWhenFlagged);
+    } else {
+        printf("leak site never reported growing\n");
+    }
+    printf("samples with another site growing: %d of %d\n", otherFlagged, periods);
+
+    heap_tracker_top_site(topSite, sizeof(topSite), &topSiteBytes);
+    printf("top site %s, %zu bytes, after %d MemoryLeak calls of %d KB\n", topSite, topSiteBytes, leakCalls, LEAK_KB);
+
+    char *response = NULL;
+    CallMethod(&dm_heap_sites, "{}", &response);
+    printf("getHeapSites: %s\n", response != NULL ? response : "(none)");
+    (free)(response);
+    printf("telemetry messages published %d\n", published);
+
+    free(receiveBuffer);
+    return 0;
+}
@@ -38,7 +38,7 @@
 /// </summary>
 static DX_TIMER_HANDLER(oneShotHandler)
 {
-    dx_Log_Debug("Hello from the oneshot timer. Reloading the oneshot timer period\n");
+    ASYNC_LOG_INFO("Hello from the oneshot timer. Reloading the oneshot timer period\n");
     // The oneshot timer will trigger again in 2.5 seconds
     dx_timerOneShotSet(&oneShotTimer, &(struct timespec){2, 500 * ONE_MS});
 }
@@ -49,7 +49,7 @@ DX_TIMER_HANDLER_END
 /// </summary>
 static DX_TIMER_HANDLER(PeriodicHandler)
 {
-    dx_Log_Debug("Hello from the periodic timer called every 6 seconds\n");
+    ASYNC_LOG_INFO("Hello from the periodic timer called every 6 seconds\n");
 }
 DX_TIMER_HANDLER_END
 
@@ -58,7 +58,8 @@ DX_TIMER_HANDLER_END
 /// </summary>
 static void InitPeripheralsAndHandlers(void)
 {
-    dx_Log_Debug_Init(debug_msg_buffer, sizeof(debug_msg_buffer));
+    // Handlers log through the writer thread, if it cannot start they log synchronously
+    async_log_init();
     dx_timerSetStart(timers, NELEMS(timers));
 }
 
@@ -69,6 +70,7 @@ static void ClosePeripheralsAndHandlers(void)
 {
     dx_timerSetStop(timers, NELEMS(timers));
     dx_timerEventLoopStop();
+    async_log_close();
 }
 
 int main(void)
@@ -3,6 +3,7 @@
 #include "hw/azure_sphere_learning_path.h" // Hardware definition
 
 #include "app_exit_codes.h"
+#include "async_log.h"
 #include "dx_terminate.h"
 #include "dx_timer.h"
 #include "dx_utilities.h"
@@ -11,8 +12,6 @@
 static DX_DECLARE_TIMER_HANDLER(PeriodicHandler);
 static DX_DECLARE_TIMER_HANDLER(oneShotHandler);
 
-static char debug_msg_buffer[128];
-
 /****************************************************************************************
  * Timer Bindings
  ****************************************************************************************/